@@ -0,0 +1,144 @@
+/**
+ * @file arena.c
+ * @brief Bump allocator for per-frame scratch data.
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ARENA_ALIGN 16
+
+static arena_t frame;
+static int frame_ready = 0;
+
+/**
+ * @brief Allocate the backing block of an arena.
+ *
+ * @param arena Arena to set up.
+ * @param size Capacity in bytes.
+ * @return 0 on success, -1 if memory is exhausted.
+ */
+int arena_init(arena_t *arena, size_t size) {
+	arena->base = malloc(size);
+	arena->size = arena->base ? size : 0;
+	arena->used = 0;
+	arena->peak = 0;
+	return arena->base ? 0 : -1;
+}
+
+/**
+ * @brief Release the backing block.
+ *
+ * @param arena Arena to free.
+ */
+void arena_free(arena_t *arena) {
+	free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+/**
+ * @brief Bump-allocate aligned memory.
+ *
+ * @param arena Arena to allocate from.
+ * @param size Requested size in bytes.
+ * @return Pointer into the arena, or NULL if it is full.
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+	size_t start = (arena->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	if (start > arena->size || size > arena->size - start) {
+		return NULL;
+	}
+	arena->used = start + size;
+	if (arena->used > arena->peak) {
+		arena->peak = arena->used;
+	}
+	return arena->base + start;
+}
+
+/**
+ * @brief Get the current position.
+ *
+ * @param arena Arena.
+ * @return Mark for arena_rewind().
+ */
+size_t arena_mark(const arena_t *arena) {
+	return arena->used;
+}
+
+/**
+ * @brief Release everything allocated after a mark.
+ *
+ * @param arena Arena.
+ * @param mark Value returned by arena_mark().
+ */
+void arena_rewind(arena_t *arena, size_t mark) {
+	if (mark < arena->used) {
+		arena->used = mark;
+	}
+}
+
+/**
+ * @brief Release every allocation.
+ *
+ * @param arena Arena.
+ */
+void arena_reset(arena_t *arena) {
+	arena->used = 0;
+}
+
+/**
+ * @brief Read a file into an arena buffer with open/read.
+ *
+ * @param arena Arena to allocate from.
+ * @param path File to read.
+ * @param max_size Buffer size.
+ * @param length Output for bytes read (may be NULL).
+ * @return NUL-terminated contents, or NULL on failure.
+ */
+char *arena_read_file(arena_t *arena, const char *path, size_t max_size,
+		      size_t *length) {
+	size_t mark = arena_mark(arena);
+	char *buffer = arena_alloc(arena, max_size);
+	if (!buffer) {
+		return NULL;
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		arena_rewind(arena, mark);
+		return NULL;
+	}
+
+	/* /proc files may return less than requested per read */
+	size_t total = 0;
+	ssize_t n;
+	while (total < max_size - 1 &&
+	       (n = read(fd, buffer + total, max_size - 1 - total)) > 0) {
+		total += (size_t)n;
+	}
+	close(fd);
+
+	buffer[total] = '\0';
+	if (length) {
+		*length = total;
+	}
+	return buffer;
+}
+
+/**
+ * @brief Get the shared frame arena, allocating it on first use.
+ *
+ * @return Frame arena.
+ */
+arena_t *frame_arena(void) {
+	if (!frame_ready) {
+		arena_init(&frame, FRAME_ARENA_SIZE);
+		frame_ready = 1;
+	}
+	return &frame;
+}
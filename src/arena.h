@@ -0,0 +1,98 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Size of the shared per-frame arena.
+ */
+#define FRAME_ARENA_SIZE (4 * 1024 * 1024)
+
+/**
+ * @brief Bump allocator over one preallocated block.
+ *
+ * Allocations are never freed individually: callers take a mark, allocate
+ * scratch data and rewind to the mark when done, so a refresh or render
+ * cycle costs no malloc/free calls at all.
+ */
+typedef struct {
+	char *base;     /**< Start of the block */
+	size_t size;    /**< Capacity in bytes */
+	size_t used;    /**< Bytes handed out */
+	size_t peak;    /**< Largest value of used so far */
+} arena_t;
+
+/**
+ * @brief Allocates the backing block of an arena.
+ *
+ * @param arena Arena to set up.
+ * @param size Capacity in bytes.
+ * @return 0 on success, -1 if memory is exhausted.
+ */
+int arena_init(arena_t *arena, size_t size);
+
+/**
+ * @brief Releases the backing block.
+ *
+ * @param arena Arena to free.
+ */
+void arena_free(arena_t *arena);
+
+/**
+ * @brief Hands out 16-byte aligned, uninitialized memory.
+ *
+ * @param arena Arena to allocate from.
+ * @param size Requested size in bytes.
+ * @return Pointer into the arena, or NULL if it is full.
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Gets the current position, to be passed to arena_rewind().
+ *
+ * @param arena Arena.
+ * @return Opaque mark.
+ */
+size_t arena_mark(const arena_t *arena);
+
+/**
+ * @brief Releases everything allocated after a mark.
+ *
+ * @param arena Arena.
+ * @param mark Value returned by arena_mark().
+ */
+void arena_rewind(arena_t *arena, size_t mark);
+
+/**
+ * @brief Releases every allocation.
+ *
+ * @param arena Arena.
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief Reads (the beginning of) a file into arena memory.
+ *
+ * Uses open/read instead of stdio, which would malloc a FILE per call.
+ *
+ * @param arena Arena to allocate the buffer from.
+ * @param path File to read.
+ * @param max_size Buffer size; at most max_size - 1 bytes are read.
+ * @param length Output for the number of bytes read (may be NULL).
+ * @return NUL-terminated contents, or NULL if the file cannot be read or
+ *         the arena is full.
+ */
+char *arena_read_file(arena_t *arena, const char *path, size_t max_size,
+		      size_t *length);
+
+/**
+ * @brief Gets the arena shared by the refresh and render code.
+ *
+ * The block is allocated on first use and reset at the start of every
+ * main loop cycle. Only the UI thread may use it.
+ *
+ * @return Frame arena (its base is NULL if the first allocation failed).
+ */
+arena_t *frame_arena(void);
+
+#endif // ARENA_H
@@ -0,0 +1,205 @@
+/**
+ * @file budget.c
+ * @brief Own CPU and memory accounting of the collector, adaptive interval.
+ *
+ * The collector measures the CPU time of every pass and of the whole
+ * process, and stretches the interval between passes so that its total
+ * usage stays within the configured share of a core. Its own usage is
+ * published as pb_self_* metrics.
+ */
+
+#include "budget.h"
+#include "arena.h"
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+/* ioprio_set(2) has no glibc wrapper */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_LOWEST 7
+
+/* Weight of the newest pass in the smoothed cost */
+#define COST_WEIGHT 0.3
+
+static budget_stats_t stats = { .interval = BUDGET_MIN_INTERVAL };
+static double pass_start = 0;
+static double last_cpu = 0;
+static double last_wall = -1;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Read the CPU time used by the whole process.
+ *
+ * @return Seconds.
+ */
+static double process_cpu(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Read the process's own resident size from /proc/self/statm.
+ *
+ * Always the live /proc, whatever proc_set_root() points at.
+ *
+ * @return Bytes, or 0 if unreadable.
+ */
+static long own_resident(void) {
+	char buffer[128];
+	int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return 0;
+	}
+	ssize_t len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (len <= 0) {
+		return 0;
+	}
+	buffer[len] = '\0';
+
+	long pages = 0;
+	sscanf(buffer, "%*s %ld", &pages);
+	return pages * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Lower scheduling and I/O priority (collection is never urgent).
+ */
+static void lower_priority(void) {
+	if (getpriority(PRIO_PROCESS, 0) < BUDGET_NICE) {
+		setpriority(PRIO_PROCESS, 0, BUDGET_NICE);
+	}
+	struct sched_param param = { 0 };
+	sched_setscheduler(0, SCHED_BATCH, &param);
+#ifdef SYS_ioprio_set
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+		(IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | IOPRIO_LOWEST);
+#endif
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Set up the collector's resource budget.
+ *
+ * @param cpu_percent Allowed CPU percent (0 for none).
+ */
+void budget_init(double cpu_percent) {
+	memset(&stats, 0, sizeof(stats));
+	stats.cpu_budget = cpu_percent > 0 ? cpu_percent : 0;
+	stats.interval = BUDGET_MIN_INTERVAL;
+	last_wall = -1;
+
+	/* One heap for every thread; touch the whole frame arena now */
+	mallopt(M_ARENA_MAX, 1);
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	size_t peak = arena->peak;
+	size_t rest = arena->size - mark;
+	char *block = arena_alloc(arena, rest);
+	if (block) {
+		memset(block, 0, rest);
+	}
+	arena_rewind(arena, mark);
+	arena->peak = peak;
+
+	if (stats.cpu_budget > 0) {
+		lower_priority();
+	}
+}
+
+/**
+ * @brief Mark the start of a collection pass.
+ */
+void budget_pass_begin(void) {
+	pass_start = process_cpu();
+}
+
+/**
+ * @brief Mark the end of a collection pass.
+ *
+ * @return Seconds to wait before the next pass.
+ */
+double budget_pass_end(void) {
+	double cpu = process_cpu();
+	double wall = monotonic_seconds();
+	double elapsed = last_wall >= 0 && wall > last_wall ? wall - last_wall : 0;
+	double interval = budget_account(cpu - pass_start, cpu - last_cpu,
+					 elapsed);
+
+	last_cpu = cpu;
+	last_wall = wall;
+	stats.cpu_seconds = cpu;
+	stats.resident_bytes = own_resident();
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		stats.peak_resident_bytes = usage.ru_maxrss * 1024L;
+	}
+	if (stats.peak_resident_bytes < stats.resident_bytes) {
+		stats.peak_resident_bytes = stats.resident_bytes;
+	}
+	return interval;
+}
+
+/**
+ * @brief Account one pass and the process's CPU time since the last one.
+ *
+ * @param pass_seconds CPU seconds spent by the pass.
+ * @param cpu_seconds Whole-process CPU seconds since the previous pass end.
+ * @param wall_seconds Wall-clock seconds of cpu_seconds (0 if unknown).
+ * @return Seconds to wait before the next pass.
+ */
+double budget_account(double pass_seconds, double cpu_seconds,
+		      double wall_seconds) {
+	stats.pass_seconds = pass_seconds;
+	stats.pass_average = stats.passes == 0 ? pass_seconds :
+			     stats.pass_average * (1 - COST_WEIGHT) +
+			     pass_seconds * COST_WEIGHT;
+	stats.passes++;
+
+	if (wall_seconds > 0) {
+		stats.cpu_percent = cpu_seconds / wall_seconds * 100;
+		double background = cpu_seconds > pass_seconds ?
+				    (cpu_seconds - pass_seconds) /
+				    wall_seconds * 100 : 0;
+		stats.background_percent =
+			stats.background_percent * (1 - COST_WEIGHT) +
+			background * COST_WEIGHT;
+	}
+
+	double interval = BUDGET_MIN_INTERVAL;
+	if (stats.cpu_budget > 0) {
+		/* Passes get what the rest of the process leaves */
+		double share = stats.cpu_budget - stats.background_percent;
+		interval = share > 0 ? stats.pass_average * 100 / share :
+				       BUDGET_MAX_INTERVAL;
+	}
+	if (interval < BUDGET_MIN_INTERVAL) {
+		interval = BUDGET_MIN_INTERVAL;
+	} else if (interval > BUDGET_MAX_INTERVAL) {
+		interval = BUDGET_MAX_INTERVAL;
+	}
+	stats.interval = interval;
+	return interval;
+}
+
+/**
+ * @brief Get the collector's own resource usage.
+ *
+ * @return Statistics.
+ */
+const budget_stats_t *budget_stats(void) {
+	return &stats;
+}
@@ -0,0 +1,90 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+/**
+ * @brief Seconds between collection passes when they are cheap enough.
+ */
+#define BUDGET_MIN_INTERVAL 1.0
+
+/**
+ * @brief Longest interval the CPU budget may stretch passes to.
+ */
+#define BUDGET_MAX_INTERVAL 30.0
+
+/**
+ * @brief Nice value the collector lowers itself to under a budget.
+ */
+#define BUDGET_NICE 10
+
+/**
+ * @brief Own resource usage of the collector.
+ */
+typedef struct {
+	double cpu_budget;          /**< Allowed CPU percent (0: no budget) */
+	double interval;            /**< Seconds until the next pass */
+	double pass_seconds;        /**< CPU seconds of the last pass */
+	double pass_average;        /**< Smoothed CPU seconds per pass */
+	double cpu_percent;         /**< Own CPU usage since the previous pass */
+	double background_percent;  /**< Smoothed own CPU usage between passes */
+	double cpu_seconds;         /**< Own CPU time since start */
+	long resident_bytes;        /**< Own resident memory */
+	long peak_resident_bytes;   /**< Largest resident memory so far */
+	unsigned long passes;       /**< Collection passes so far */
+} budget_stats_t;
+
+/**
+ * @brief Sets up the collector's resource budget.
+ *
+ * Memory is settled up front: one malloc arena for all threads and the
+ * frame arena prefaulted, so the resident size reached after the first
+ * passes does not grow. With a CPU budget the process also lowers its
+ * scheduling priority (nice BUDGET_NICE, SCHED_BATCH) and its I/O
+ * priority (lowest best-effort level).
+ *
+ * @param cpu_percent Allowed CPU percent of one core (0 for no budget).
+ */
+void budget_init(double cpu_percent);
+
+/**
+ * @brief Marks the start of a collection pass.
+ */
+void budget_pass_begin(void);
+
+/**
+ * @brief Marks the end of a collection pass and plans the next one.
+ *
+ * Measures the pass's CPU time and the whole process's CPU time since the
+ * previous pass (see budget_account()) and samples its resident memory.
+ *
+ * @return Seconds to wait before the next pass.
+ */
+double budget_pass_end(void);
+
+/**
+ * @brief Accounts one pass and the process's CPU time since the last one.
+ *
+ * The interval adapts so that the whole process, not only the passes,
+ * stays within the budget. The CPU time outside the pass (query and
+ * scrape serving, the detail worker) gives a smoothed background share
+ * of a core; passes get the rest: smoothed pass cost / (budget -
+ * background), clamped to BUDGET_MIN_INTERVAL and BUDGET_MAX_INTERVAL
+ * (the longest when the background alone exceeds the budget).
+ *
+ * @param pass_seconds CPU seconds spent by the pass.
+ * @param cpu_seconds CPU seconds of the whole process since the end of
+ *                    the previous pass, this pass included.
+ * @param wall_seconds Wall-clock seconds over which cpu_seconds was spent
+ *                     (0 for the first pass).
+ * @return Seconds to wait before the next pass.
+ */
+double budget_account(double pass_seconds, double cpu_seconds,
+		      double wall_seconds);
+
+/**
+ * @brief Gets the collector's own resource usage.
+ *
+ * @return Statistics as of the last budget_pass_end().
+ */
+const budget_stats_t *budget_stats(void);
+
+#endif // BUDGET_H
@@ -0,0 +1,18 @@
+/**
+ * @file clock.c
+ * @brief Monotonic time shared by the loop, the budget and the exporter.
+ */
+
+#include "clock.h"
+#include <time.h>
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return Seconds since an arbitrary start.
+ */
+double monotonic_seconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
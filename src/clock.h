@@ -0,0 +1,14 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/**
+ * @brief Reads CLOCK_MONOTONIC.
+ *
+ * Unaffected by changes of the wall clock, so differences are safe to use
+ * for intervals and timeouts.
+ *
+ * @return Seconds since an arbitrary start.
+ */
+double monotonic_seconds(void);
+
+#endif // CLOCK_H
@@ -0,0 +1,837 @@
+/**
+ * @file columns.c
+ * @brief Column registry, per-frame layout and cell formatting.
+ */
+
+#include "columns.h"
+#include "textwidth.h"
+#include "arena.h"
+#include <string.h>
+
+/**
+ * @brief Formats one cell (pre-filled with spaces, not terminated).
+ */
+typedef void (*column_format_t)(const proc_info_t *proc, wchar_t *cell,
+				int width);
+
+/**
+ * @brief Registry entry of one column.
+ */
+typedef struct {
+	const char *name;           /* Name used by --columns */
+	const char *header;         /* Header text */
+	const char *scaled_header;  /* Header with COLUMN_UNIT_AUTO (or NULL) */
+	int scaled_width;           /* Width with COLUMN_UNIT_AUTO */
+	int min_width;              /* Width without spare space */
+	int max_width;              /* Upper bound when growing */
+	int flex;                   /* Share of spare space (0 = fixed) */
+	int right;                  /* Right-aligned (numbers) */
+	int sort;                   /* SortType, or -1 if not sortable */
+	column_format_t format;
+} column_t;
+
+/* Current selection; empty until the first use (then COLUMNS_DEFAULT) */
+static ColumnId visible[COL_COUNT];
+static int visible_count = 0;
+static int focus = 0;
+
+/* Unit of every column; zero (COLUMN_UNIT_AUTO) unless toggled */
+static ColumnUnit units[COL_COUNT];
+
+/* Bumped by every change that affects a layout */
+static unsigned int generation = 0;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Write ASCII characters (reversed in digits) into a cell.
+ *
+ * @param cell Cell.
+ * @param width Cell width.
+ * @param digits Characters in reverse order.
+ * @param len Number of characters.
+ * @param right Right-align if non-zero.
+ */
+static void put_reversed(wchar_t *cell, int width, const char *digits,
+			 int len, int right) {
+	if (len > width) {
+		wmemset(cell, L'*', width);
+		return;
+	}
+	wchar_t *out = right ? cell + width - len : cell;
+	for (int i = 0; i < len; i++) {
+		out[i] = digits[len - 1 - i];
+	}
+}
+
+/**
+ * @brief Write a decimal integer into a cell without snprintf.
+ *
+ * Digits are produced right to left in a scratch buffer. A value that
+ * does not fit is shown as '*' characters.
+ *
+ * @param cell Cell.
+ * @param width Cell width.
+ * @param value Value (negative values get a '-' sign).
+ * @param right Right-align if non-zero.
+ * @param suffix Character appended after the digits ('\0' for none).
+ */
+static void put_int(wchar_t *cell, int width, long long value, int right,
+		    char suffix) {
+	char digits[24];
+	int len = 0;
+	unsigned long long magnitude = value < 0 ? -(unsigned long long)value
+						 : (unsigned long long)value;
+
+	if (suffix) {
+		digits[len++] = suffix;
+	}
+	do {
+		digits[len++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0) {
+		digits[len++] = '-';
+	}
+	put_reversed(cell, width, digits, len, right);
+}
+
+/**
+ * @brief Write a value with one decimal place into a right-aligned cell.
+ *
+ * @param cell Cell.
+ * @param width Cell width.
+ * @param value Value (clamped at zero).
+ */
+static void put_fixed1(wchar_t *cell, int width, double value) {
+	long long tenths = value > 0 ? (long long)(value * 10 + 0.5) : 0;
+	char digits[24];
+	int len = 0;
+
+	digits[len++] = '0' + tenths % 10;
+	digits[len++] = '.';
+	tenths /= 10;
+	do {
+		digits[len++] = '0' + tenths % 10;
+		tenths /= 10;
+	} while (tenths);
+	put_reversed(cell, width, digits, len, 1);
+}
+
+/**
+ * @brief Write digits of a small value in reverse into a scratch buffer.
+ *
+ * @param digits Output (reversed).
+ * @param len Current length of digits.
+ * @param value Value.
+ * @return New length.
+ */
+static int push_digits(char *digits, int len, unsigned long long value) {
+	do {
+		digits[len++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	return len;
+}
+
+/**
+ * @brief Format the PID column (left-aligned).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_pid(const proc_info_t *proc, wchar_t *cell, int width) {
+	put_int(cell, width, proc->pid, 0, '\0');
+}
+
+/**
+ * @brief Format the command name (display width cached per name hash).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_name(const proc_info_t *proc, wchar_t *cell, int width) {
+	text_cells_cached(proc->name_hash, proc->name, cell, width);
+}
+
+/**
+ * @brief Format the owner's user name.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_user(const proc_info_t *proc, wchar_t *cell, int width) {
+	text_cells(proc->user, cell, width);
+}
+
+/**
+ * @brief Format the state letter ('?' if unknown).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width (unused, always 1).
+ */
+static void format_state(const proc_info_t *proc, wchar_t *cell, int width) {
+	(void)width;
+	cell[0] = proc->state ? proc->state : '?';
+}
+
+/**
+ * @brief Format RSS in kB, or scaled to a unit when the column is auto.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_mem(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (units[COL_MEM] == COLUMN_UNIT_AUTO) {
+		columns_put_scaled(cell, width, proc->memory > 0 ?
+				   (unsigned long long)proc->memory * 10 : 0, 1);
+	} else {
+		put_int(cell, width, proc->memory, 1, '\0');
+	}
+}
+
+/**
+ * @brief Format CPU usage with one decimal place, clamped to 100.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_cpu(const proc_info_t *proc, wchar_t *cell, int width) {
+	/* Clamp CPU percentage to [0.0, 100.0] range */
+	put_fixed1(cell, width, proc->cpu_usage > 100.0f ? 100.0f
+							 : proc->cpu_usage);
+}
+
+/**
+ * @brief Format the open descriptor count.
+ *
+ * Shows "-" until the rotation sampled the process or if it was denied.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_fds(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (proc->fd_count >= 0) {
+		put_int(cell, width, proc->fd_count, 1, '\0');
+	} else {
+		cell[width - 1] = '-';
+	}
+}
+
+/**
+ * @brief Format the socket count ("-" like format_fds()).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_sock(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (proc->fd_count >= 0) {
+		put_int(cell, width, proc->sock_count, 1, '\0');
+	} else {
+		cell[width - 1] = '-';
+	}
+}
+
+/**
+ * @brief Format the age of the descriptor sample in seconds.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_age(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (proc->fd_age >= 0) {
+		put_int(cell, width, proc->fd_age, 1, 's');
+	} else {
+		cell[width - 1] = '-';
+	}
+}
+
+/**
+ * @brief Format TCP throughput in kB/s, or scaled when the column is auto.
+ *
+ * Shows "-" when no socket byte counters are available.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_net(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (proc->net_rate < 0) {
+		cell[width - 1] = '-';
+	} else if (units[COL_NET] == COLUMN_UNIT_AUTO) {
+		columns_put_scaled(cell, width, proc->net_rate > 0 ?
+				   (unsigned long long)(proc->net_rate * 10) : 0,
+				   1);
+	} else {
+		put_fixed1(cell, width, proc->net_rate);
+	}
+}
+
+/**
+ * @brief Format the thread count.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_threads(const proc_info_t *proc, wchar_t *cell, int width) {
+	put_int(cell, width, proc->threads, 1, '\0');
+}
+
+/**
+ * @brief Format the cgroup path.
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_cgroup(const proc_info_t *proc, wchar_t *cell, int width) {
+	text_cells(proc->cgroup, cell, width);
+}
+
+/**
+ * @brief Format the PID inside the process's own PID namespace.
+ *
+ * Only differs from the PID inside a nested namespace (containers).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_nspid(const proc_info_t *proc, wchar_t *cell, int width) {
+	if (proc->ns_pid > 0) {
+		put_int(cell, width, proc->ns_pid, 0, '\0');
+	} else {
+		cell[0] = '-';
+	}
+}
+
+/**
+ * @brief Format the container id ("-" outside containers).
+ *
+ * @param proc Process.
+ * @param cell Cell, blank-filled.
+ * @param width Cell width.
+ */
+static void format_container(const proc_info_t *proc, wchar_t *cell,
+			     int width) {
+	text_cells(proc->container[0] ? proc->container : "-", cell, width);
+}
+
+/* Indexed by ColumnId */
+static const column_t registry[COL_COUNT] = {
+	{ "pid", "PID", NULL, 0, 6, 6, 0, 0, SORT_PID, format_pid },
+	{ "name", "NAME", NULL, 0, 20, 64, 2, 0, SORT_NAME, format_name },
+	{ "user", "USER", NULL, 0, 12, 32, 1, 0, -1, format_user },
+	{ "state", "S", NULL, 0, 1, 1, 0, 0, -1, format_state },
+	{ "mem", "MEM(kB)", "MEM", 6, 12, 12, 0, 1, SORT_MEM, format_mem },
+	{ "cpu", "CPU%", NULL, 0, 6, 6, 0, 1, SORT_CPU, format_cpu },
+	{ "fds", "FDS", NULL, 0, 6, 6, 0, 1, -1, format_fds },
+	{ "sock", "SOCK", NULL, 0, 5, 5, 0, 1, -1, format_sock },
+	{ "age", "AGE", NULL, 0, 4, 4, 0, 1, -1, format_age },
+	{ "net", "NET(kB/s)", "NET/s", 6, 9, 9, 0, 1, SORT_NET, format_net },
+	{ "threads", "THR", NULL, 0, 5, 5, 0, 1, -1, format_threads },
+	{ "cgroup", "CGROUP", NULL, 0, 16, 128, 3, 0, -1, format_cgroup },
+	{ "nspid", "NSPID", NULL, 0, 7, 7, 0, 0, -1, format_nspid },
+	{ "container", "CONTAINER", NULL, 0, 12, 12, 0, 0, -1,
+	  format_container },
+};
+
+/**
+ * @brief Get the CPU usage a threshold is checked against.
+ *
+ * @param proc Process.
+ * @return CPU percentage.
+ */
+static double value_cpu(const proc_info_t *proc) {
+	return proc->cpu_usage;
+}
+
+/**
+ * @brief Get the RSS a threshold is checked against.
+ *
+ * @param proc Process.
+ * @return RSS in kB.
+ */
+static double value_mem(const proc_info_t *proc) {
+	return proc->memory;
+}
+
+/**
+ * @brief Get the throughput a threshold is checked against.
+ *
+ * @param proc Process.
+ * @return kB/s (-1 if unknown).
+ */
+static double value_net(const proc_info_t *proc) {
+	return proc->net_rate;
+}
+
+/*
+ * Cell highlighting, checked in order (first match wins). A percentile
+ * limit is resolved per frame: 99 highlights the top 1% of the rows.
+ */
+static const struct {
+	ColumnId column;
+	double (*value)(const proc_info_t *proc);
+	int percentile;             /* limit is a percentile of the frame */
+	double limit;
+	CellTone tone;
+} thresholds[] = {
+	{ COL_CPU, value_cpu, 0, 90.0, TONE_CRIT },
+	{ COL_CPU, value_cpu, 0, 50.0, TONE_WARN },
+	{ COL_MEM, value_mem, 1, 99.0, TONE_TOP },
+	{ COL_NET, value_net, 1, 99.0, TONE_TOP },
+};
+
+#define THRESHOLD_COUNT ((int)(sizeof(thresholds) / sizeof(thresholds[0])))
+_Static_assert(THRESHOLD_COUNT <= COLUMNS_MAX_THRESHOLDS,
+	       "column_layout_t.limits is too small");
+
+/**
+ * @brief Find the k-th smallest value (quickselect, reorders values).
+ *
+ * @param values Values.
+ * @param count Number of values.
+ * @param k Rank (0-based).
+ * @return The k-th smallest value.
+ */
+static double select_kth(double *values, int count, int k) {
+	int left = 0, right = count - 1;
+
+	while (left < right) {
+		double pivot = values[left + (right - left) / 2];
+		int i = left, j = right;
+		while (i <= j) {
+			while (values[i] < pivot)
+				i++;
+			while (values[j] > pivot)
+				j--;
+			if (i <= j) {
+				double tmp = values[i];
+				values[i++] = values[j];
+				values[j--] = tmp;
+			}
+		}
+		if (k <= j)
+			right = j;
+		else if (k >= i)
+			left = i;
+		else
+			break;
+	}
+	return values[k];
+}
+
+/**
+ * @brief Check whether a column is shown in scaled units.
+ */
+static int is_scaled(ColumnId id) {
+	return registry[id].scaled_header && units[id] == COLUMN_UNIT_AUTO;
+}
+
+/**
+ * @brief Select the default columns if nothing was selected yet.
+ */
+static void ensure_selection(void) {
+	if (visible_count == 0) {
+		columns_select(COLUMNS_DEFAULT);
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Select the visible columns and their order.
+ *
+ * @param spec Comma-separated column names.
+ * @return 0 on success, -1 on an unknown, repeated or missing name.
+ */
+int columns_select(const char *spec) {
+	ColumnId ids[COL_COUNT];
+	int count = 0;
+	int seen[COL_COUNT] = { 0 };
+
+	while (*spec) {
+		size_t len = strcspn(spec, ",");
+		int found = -1;
+		for (int i = 0; i < COL_COUNT; i++) {
+			if (strlen(registry[i].name) == len &&
+			    strncmp(registry[i].name, spec, len) == 0) {
+				found = i;
+			}
+		}
+		if (found < 0 || seen[found]) {
+			return -1;
+		}
+		seen[found] = 1;
+		ids[count++] = found;
+		spec += len;
+		if (*spec == ',') {
+			spec++;
+		}
+	}
+	if (count == 0) {
+		return -1;
+	}
+
+	memcpy(visible, ids, count * sizeof(ids[0]));
+	visible_count = count;
+	focus = 0;
+	generation++;
+	return 0;
+}
+
+/**
+ * @brief Get the number of changes made to the selection so far.
+ *
+ * @return Generation counter.
+ */
+unsigned int columns_generation(void) {
+	return generation;
+}
+
+/**
+ * @brief Get the names of all registered columns.
+ *
+ * @return Comma-separated list.
+ */
+const char *columns_all(void) {
+	static char names[256];
+	if (!names[0]) {
+		for (int i = 0; i < COL_COUNT; i++) {
+			if (i > 0) {
+				strcat(names, ",");
+			}
+			strcat(names, registry[i].name);
+		}
+	}
+	return names;
+}
+
+/**
+ * @brief Move the focus to the previous or next column.
+ *
+ * @param delta Direction.
+ */
+void columns_focus(int delta) {
+	ensure_selection();
+	focus = (focus + delta + visible_count) % visible_count;
+	generation++;
+}
+
+/**
+ * @brief Swap the focused column with a neighbour.
+ *
+ * @param delta Direction.
+ */
+void columns_move(int delta) {
+	ensure_selection();
+	int other = focus + delta;
+	if (other < 0 || other >= visible_count) {
+		return;
+	}
+	ColumnId id = visible[focus];
+	visible[focus] = visible[other];
+	visible[other] = id;
+	focus = other;
+	generation++;
+}
+
+/**
+ * @brief Hide the focused column.
+ */
+void columns_hide(void) {
+	ensure_selection();
+	if (visible_count <= 1) {
+		return;
+	}
+	memmove(&visible[focus], &visible[focus + 1],
+		(visible_count - focus - 1) * sizeof(visible[0]));
+	visible_count--;
+	if (focus >= visible_count) {
+		focus = visible_count - 1;
+	}
+	generation++;
+}
+
+/**
+ * @brief Show the next hidden column right of the focused one.
+ *
+ * Hidden columns are taken in registry order, starting after the focused
+ * column's id.
+ */
+void columns_show_next(void) {
+	ensure_selection();
+	int shown[COL_COUNT] = { 0 };
+	for (int i = 0; i < visible_count; i++) {
+		shown[visible[i]] = 1;
+	}
+
+	for (int step = 1; step < COL_COUNT; step++) {
+		ColumnId id = (visible[focus] + step) % COL_COUNT;
+		if (!shown[id]) {
+			focus++;
+			memmove(&visible[focus + 1], &visible[focus],
+				(visible_count - focus) * sizeof(visible[0]));
+			visible[focus] = id;
+			visible_count++;
+			generation++;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Set the unit of a size or rate column.
+ *
+ * @param id Column.
+ * @param unit Unit.
+ * @return 0 on success, -1 if the column has no unit.
+ */
+int columns_set_unit(ColumnId id, ColumnUnit unit) {
+	if (!registry[id].scaled_header) {
+		return -1;
+	}
+	units[id] = unit;
+	generation++;
+	return 0;
+}
+
+/**
+ * @brief Switch the focused column between scaled and raw units.
+ *
+ * @return 0 on success, -1 if the column has no unit.
+ */
+int columns_toggle_unit(void) {
+	ensure_selection();
+	ColumnId id = visible[focus];
+	return columns_set_unit(id, units[id] == COLUMN_UNIT_AUTO ?
+					    COLUMN_UNIT_RAW : COLUMN_UNIT_AUTO);
+}
+
+/**
+ * @brief Format a size in kB scaled to a unit.
+ *
+ * Pure integer arithmetic: the value is divided by 1024 (with rounding)
+ * until it is below 1024 units.
+ *
+ * @param out Output cell.
+ * @param width Cell width.
+ * @param tenths_kb Size in tenths of a kB.
+ * @param right Right-align if non-zero.
+ */
+void columns_put_scaled(wchar_t *out, int width, unsigned long long tenths_kb,
+			int right) {
+	static const char unit_names[] = "KMGTPE";
+	char digits[24];
+	int unit = 0;
+	int len = 0;
+
+	while (tenths_kb >= 10240 && unit < 5) {
+		tenths_kb = (tenths_kb + 512) >> 10;
+		unit++;
+	}
+
+	digits[len++] = unit_names[unit];
+	if (tenths_kb < 1000) {
+		/* One decimal below 100 units */
+		digits[len++] = '0' + tenths_kb % 10;
+		digits[len++] = '.';
+		len = push_digits(digits, len, tenths_kb / 10);
+	} else {
+		len = push_digits(digits, len, (tenths_kb + 5) / 10);
+	}
+	put_reversed(out, width, digits, len, right);
+}
+
+/**
+ * @brief Get the sort key of the focused column.
+ *
+ * @param type Output sort criteria.
+ * @return 0 on success, -1 if the column cannot be sorted.
+ */
+int columns_sort_key(SortType *type) {
+	ensure_selection();
+	int sort = registry[visible[focus]].sort;
+	if (sort < 0) {
+		return -1;
+	}
+	*type = (SortType)sort;
+	return 0;
+}
+
+/**
+ * @brief Compute the layout of the visible columns.
+ *
+ * Spare width is handed out in rounds of `flex` cells per flexible column,
+ * so wider columns grow faster until they reach their maximum. Columns
+ * that start beyond the screen are dropped and the last one is clipped.
+ *
+ * @param layout Output layout.
+ * @param width Available screen width.
+ */
+void columns_layout(column_layout_t *layout, int width) {
+	ensure_selection();
+	int used = 1;  /* Leading space */
+
+	for (int i = 0; i < visible_count; i++) {
+		layout->ids[i] = visible[i];
+		layout->width[i] = is_scaled(visible[i]) ?
+				   registry[visible[i]].scaled_width :
+				   registry[visible[i]].min_width;
+		used += layout->width[i] + 1;
+	}
+
+	int spare = width - used;
+	for (int grown = 1; spare > 0 && grown;) {
+		grown = 0;
+		for (int i = 0; i < visible_count && spare > 0; i++) {
+			const column_t *column = &registry[visible[i]];
+			int room = column->max_width - layout->width[i];
+			int add = column->flex < room ? column->flex : room;
+			if (add > spare) {
+				add = spare;
+			}
+			if (add > 0) {
+				layout->width[i] += add;
+				spare -= add;
+				grown = 1;
+			}
+		}
+	}
+
+	int x = 1;
+	layout->count = 0;
+	for (int i = 0; i < visible_count && x < width; i++) {
+		layout->x[i] = x;
+		if (x + layout->width[i] > width) {
+			layout->width[i] = width - x;
+		}
+		x += layout->width[i] + 1;
+		layout->count++;
+	}
+	layout->end = layout->count > 0 ? x - 1 : 0;
+	layout->focus = focus < layout->count ? focus : -1;
+
+	/* Percentile limits stay disabled until columns_measure() */
+	for (int t = 0; t < THRESHOLD_COUNT; t++) {
+		layout->limits[t] = thresholds[t].percentile ? -1
+							     : thresholds[t].limit;
+	}
+}
+
+/**
+ * @brief Resolve the thresholds of a frame.
+ *
+ * Percentile limits use a scratch array from the frame arena; without
+ * room they stay disabled for the frame.
+ *
+ * @param layout Layout of the frame.
+ * @param plist Rows of the frame.
+ */
+void columns_measure(column_layout_t *layout, const proc_list_t *plist) {
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	double *values = NULL;
+
+	for (int t = 0; t < THRESHOLD_COUNT; t++) {
+		if (!thresholds[t].percentile || plist->count == 0) {
+			continue;
+		}
+		if (!values) {
+			values = arena_alloc(arena, plist->count * sizeof(double));
+			if (!values) {
+				break;
+			}
+		}
+		for (int i = 0; i < plist->count; i++) {
+			values[i] = thresholds[t].value(&plist->list[i]);
+		}
+		int top = (int)(plist->count * (100 - thresholds[t].limit) / 100);
+		if (top < 1) {
+			top = 1;
+		}
+		layout->limits[t] = select_kth(values, plist->count,
+					       plist->count - top);
+	}
+	arena_rewind(arena, mark);
+}
+
+/**
+ * @brief Format the header line.
+ *
+ * @param layout Layout of the frame.
+ * @param line Output of at least layout->end cells.
+ */
+void columns_format_header(const column_layout_t *layout, wchar_t *line) {
+	wmemset(line, L' ', layout->end);
+	for (int i = 0; i < layout->count; i++) {
+		const column_t *column = &registry[layout->ids[i]];
+		const char *header = is_scaled(layout->ids[i]) ?
+				     column->scaled_header : column->header;
+		int len = strlen(header);
+		int width = layout->width[i];
+		if (len > width) {
+			len = width;
+		}
+		wchar_t *cell = line + layout->x[i];
+		if (column->right) {
+			cell += width - len;
+		}
+		for (int j = 0; j < len; j++) {
+			cell[j] = header[j];
+		}
+	}
+}
+
+/**
+ * @brief Format one process row.
+ *
+ * @param layout Layout of the frame.
+ * @param proc Process.
+ * @param line Output of at least layout->end cells.
+ */
+void columns_format_row(const column_layout_t *layout,
+			const proc_info_t *proc, wchar_t *line,
+			unsigned char *tones) {
+	wmemset(line, L' ', layout->end);
+	for (int i = 0; i < layout->count; i++) {
+		registry[layout->ids[i]].format(proc, line + layout->x[i],
+						layout->width[i]);
+	}
+	if (!tones) {
+		return;
+	}
+
+	/* Inactive rows are dimmed as a whole */
+	int dim = proc->state == 'Z' || proc->state == 'D';
+	memset(tones, dim ? TONE_DIM : TONE_NORMAL, layout->end);
+	if (dim) {
+		return;
+	}
+
+	for (int i = 0; i < layout->count; i++) {
+		for (int t = 0; t < THRESHOLD_COUNT; t++) {
+			if (thresholds[t].column != layout->ids[i]) {
+				continue;
+			}
+			double value = thresholds[t].value(proc);
+			if (value > 0 && layout->limits[t] >= 0 &&
+			    value >= layout->limits[t]) {
+				memset(tones + layout->x[i], thresholds[t].tone,
+				       layout->width[i]);
+				break;
+			}
+		}
+	}
+}
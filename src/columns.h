@@ -0,0 +1,212 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "proc.h"
+#include "sort.h"
+#include <wchar.h>
+
+/**
+ * @brief Identifiers of the columns of the process list.
+ */
+typedef enum {
+	COL_PID,      /**< Process ID */
+	COL_NAME,     /**< Command name */
+	COL_USER,     /**< Owner user name */
+	COL_STATE,    /**< State letter */
+	COL_MEM,      /**< RSS in kB */
+	COL_CPU,      /**< CPU usage percentage */
+	COL_FDS,      /**< Open descriptors */
+	COL_SOCK,     /**< Open sockets */
+	COL_AGE,      /**< Age of the descriptor sample */
+	COL_NET,      /**< TCP throughput */
+	COL_THREADS,  /**< Thread count */
+	COL_CGROUP,   /**< cgroup path */
+	COL_NSPID,    /**< PID inside its own PID namespace */
+	COL_CONTAINER, /**< Short container id */
+	COL_COUNT     /**< Number of columns in the registry */
+} ColumnId;
+
+/**
+ * @brief Highlight of a cell, mapped to colors by the UI.
+ */
+typedef enum {
+	TONE_NORMAL,  /**< No highlight */
+	TONE_WARN,    /**< Above the warning threshold (yellow) */
+	TONE_CRIT,    /**< Above the critical threshold (red) */
+	TONE_TOP,     /**< In the top percentile of the frame (magenta) */
+	TONE_DIM,     /**< Inactive row: zombie or uninterruptible sleep */
+	TONE_COUNT    /**< Number of tones */
+} CellTone;
+
+/**
+ * @brief Capacity of the per-frame threshold limits in a layout.
+ */
+#define COLUMNS_MAX_THRESHOLDS 8
+
+/**
+ * @brief Display units of size and rate columns (mem, net).
+ */
+typedef enum {
+	COLUMN_UNIT_AUTO,  /**< Scaled to K/M/G/T/P with a fixed width */
+	COLUMN_UNIT_RAW    /**< Plain kB (kB/s) */
+} ColumnUnit;
+
+/**
+ * @brief Default column list (used when --columns is not given).
+ */
+#define COLUMNS_DEFAULT "pid,name,user,state,mem,cpu,fds,sock,age,net"
+
+/**
+ * @brief Positions of the visible columns for one frame.
+ *
+ * Computed once per frame by columns_layout(); rows are then formatted
+ * cell by cell without measuring anything again.
+ */
+typedef struct {
+	ColumnId ids[COL_COUNT];    /**< Visible columns, left to right */
+	int x[COL_COUNT];           /**< First screen column of each cell */
+	int width[COL_COUNT];       /**< Width of each cell */
+	int count;                  /**< Number of visible columns */
+	int focus;                  /**< Index of the focused column */
+	int end;                    /**< First screen column after the last cell */
+	double limits[COLUMNS_MAX_THRESHOLDS]; /**< Resolved threshold values */
+} column_layout_t;
+
+/**
+ * @brief Selects the visible columns and their order.
+ *
+ * @param spec Comma-separated column names (see columns_all()).
+ * @return 0 on success, -1 on an unknown, repeated or missing name (the
+ *         current selection is kept).
+ */
+int columns_select(const char *spec);
+
+/**
+ * @brief Returns a counter bumped by every change of the selection, order,
+ *        focus or units.
+ *
+ * A layout only has to be recomputed when this value (or the screen size)
+ * changed since columns_layout() was called.
+ *
+ * @return Generation counter.
+ */
+unsigned int columns_generation(void);
+
+/**
+ * @brief Returns the names of all registered columns.
+ *
+ * @return Comma-separated list, for help texts.
+ */
+const char *columns_all(void);
+
+/**
+ * @brief Moves the focus to the previous (-1) or next (+1) column.
+ *
+ * @param delta Direction.
+ */
+void columns_focus(int delta);
+
+/**
+ * @brief Swaps the focused column with its left (-1) or right (+1) neighbour.
+ *
+ * @param delta Direction.
+ */
+void columns_move(int delta);
+
+/**
+ * @brief Hides the focused column (the last visible column stays).
+ */
+void columns_hide(void);
+
+/**
+ * @brief Shows the next hidden column right of the focused one.
+ */
+void columns_show_next(void);
+
+/**
+ * @brief Sets the unit of a size or rate column.
+ *
+ * @param id Column.
+ * @param unit Unit.
+ * @return 0 on success, -1 if the column has no unit.
+ */
+int columns_set_unit(ColumnId id, ColumnUnit unit);
+
+/**
+ * @brief Switches the focused column between scaled and raw units.
+ *
+ * @return 0 on success, -1 if the column has no unit.
+ */
+int columns_toggle_unit(void);
+
+/**
+ * @brief Formats a size in kB scaled to a unit, without printf.
+ *
+ * Shows one decimal below 100 ("1.5M", "64.0G") and whole units above
+ * ("512K", "123G"), so the text never exceeds 5 characters.
+ *
+ * @param out Output cell (pre-filled, not terminated).
+ * @param width Cell width.
+ * @param tenths_kb Size in tenths of a kB.
+ * @param right Right-align if non-zero.
+ */
+void columns_put_scaled(wchar_t *out, int width, unsigned long long tenths_kb,
+			int right);
+
+/**
+ * @brief Gets the sort key of the focused column.
+ *
+ * @param type Output sort criteria.
+ * @return 0 on success, -1 if the column cannot be sorted.
+ */
+int columns_sort_key(SortType *type);
+
+/**
+ * @brief Computes the layout of the visible columns.
+ *
+ * Every column gets its minimum width; spare space is shared among the
+ * flexible columns (name, user, cgroup) up to their maximum.
+ *
+ * @param layout Output layout.
+ * @param width Available screen width.
+ */
+void columns_layout(column_layout_t *layout, int width);
+
+/**
+ * @brief Resolves the thresholds of a frame.
+ *
+ * Fixed thresholds are set by columns_layout(); percentile thresholds
+ * (e.g. top 1% RSS) are computed here from the rows of the frame with a
+ * linear-time selection and stay disabled until then.
+ *
+ * @param layout Layout of the frame.
+ * @param plist Rows of the frame.
+ */
+void columns_measure(column_layout_t *layout, const proc_list_t *plist);
+
+/**
+ * @brief Formats the header line.
+ *
+ * @param layout Layout of the frame.
+ * @param line Output of at least layout->end cells (not terminated).
+ */
+void columns_format_header(const column_layout_t *layout, wchar_t *line);
+
+/**
+ * @brief Formats one process row.
+ *
+ * Numbers are converted to ASCII directly into their cells; text is
+ * truncated by display width (see textwidth.h), so one element is one
+ * screen cell. The tone of every cell is filled in the same pass from the
+ * threshold table (see columns_measure()).
+ *
+ * @param layout Layout of the frame.
+ * @param proc Process.
+ * @param line Output of at least layout->end cells (not terminated).
+ * @param tones Output tone (CellTone) of each cell, or NULL.
+ */
+void columns_format_row(const column_layout_t *layout,
+			const proc_info_t *proc, wchar_t *line,
+			unsigned char *tones);
+
+#endif // COLUMNS_H
@@ -0,0 +1,551 @@
+/**
+ * @file detail.c
+ * @brief Lazy, background deep inspection of the selected process.
+ *
+ * Only one PID is inspected at a time. The worker thread re-reads it every
+ * DETAIL_REFRESH_SEC seconds; changing the selection bumps a generation
+ * counter which makes an in-flight read bail out between files.
+ */
+
+#include "detail.h"
+#include "proc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+const char *const detail_ns_names[DETAIL_NS_COUNT] = {
+	[DETAIL_NS_PID] = "pid",
+	[DETAIL_NS_MNT] = "mnt",
+	[DETAIL_NS_NET] = "net",
+	[DETAIL_NS_USER] = "user",
+	[DETAIL_NS_UTS] = "uts",
+	[DETAIL_NS_IPC] = "ipc",
+};
+
+static pthread_t worker;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static int worker_running = 0;
+static int stop_requested = 0;
+
+static pid_t selected_pid = 0;       /* Guarded by lock */
+static proc_detail_t published;      /* Guarded by lock */
+static atomic_uint generation = 0;   /* Bumped on every selection change */
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Check whether a read for the given generation became obsolete.
+ *
+ * @param gen Generation the read was started for (0 = never cancelled).
+ * @return 1 if the selection moved on, 0 otherwise.
+ */
+static int cancelled(unsigned gen) {
+	return gen != 0 && atomic_load(&generation) != gen;
+}
+
+/**
+ * @brief Read a whole /proc/[pid]/<name> file into a buffer.
+ *
+ * @param pid Process ID.
+ * @param name File name inside the process directory.
+ * @param buffer Output buffer (NUL-terminated on success).
+ * @param buf_size Size of the output buffer.
+ * @return Number of bytes read, or -1 on error.
+ */
+static long read_proc_file(pid_t pid, const char *name, char *buffer,
+			   size_t buf_size) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/%s", proc_root(), pid, name);
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+
+	size_t total = 0;
+	ssize_t n;
+	while (total < buf_size - 1 &&
+	       (n = read(fd, buffer + total, buf_size - 1 - total)) > 0) {
+		total += n;
+	}
+	close(fd);
+	buffer[total] = '\0';
+	return (long)total;
+}
+
+/**
+ * @brief Resolve a /proc/[pid]/<name> symlink.
+ *
+ * @param pid Process ID.
+ * @param name Link name inside the process directory.
+ * @param buffer Output buffer ("-" if the link cannot be read).
+ * @param buf_size Size of the output buffer.
+ */
+static void read_proc_link(pid_t pid, const char *name, char *buffer,
+			   size_t buf_size) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/%s", proc_root(), pid, name);
+
+	ssize_t len = readlink(path, buffer, buf_size - 1);
+	if (len < 0) {
+		snprintf(buffer, buf_size, "-");
+		return;
+	}
+	buffer[len] = '\0';
+}
+
+/**
+ * @brief Read the command line (up to the size of the field).
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ */
+static void read_cmdline(pid_t pid, proc_detail_t *out) {
+	long len = read_proc_file(pid, "cmdline", out->cmdline,
+				  sizeof(out->cmdline));
+	/* Arguments are NUL-separated; join them with spaces */
+	for (long i = 0; i < len - 1; i++) {
+		if (out->cmdline[i] == '\0') {
+			out->cmdline[i] = ' ';
+		}
+	}
+}
+
+/**
+ * @brief Read command line and environment size.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ */
+static void read_cmdline_env(pid_t pid, proc_detail_t *out) {
+	read_cmdline(pid, out);
+
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/environ", proc_root(), pid);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+
+	/* The environment can be large; only its size is of interest */
+	char chunk[4096];
+	ssize_t n;
+	out->env_size = 0;
+	out->env_count = 0;
+	while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+		out->env_size += n;
+		for (ssize_t i = 0; i < n; i++) {
+			if (chunk[i] == '\0') {
+				out->env_count++;
+			}
+		}
+	}
+	close(fd);
+}
+
+/**
+ * @brief Count entries of /proc/[pid]/fd.
+ *
+ * @param pid Process ID.
+ * @return Number of open descriptors, or -1 if not permitted.
+ */
+static int count_fds(pid_t pid) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/fd", proc_root(), pid);
+
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return -1;
+	}
+
+	int count = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] != '.') {
+			count++;
+		}
+	}
+	closedir(dir);
+	return count;
+}
+
+/**
+ * @brief Extract "soft/hard" of one limit from /proc/[pid]/limits.
+ *
+ * @param limits Contents of the limits file.
+ * @param label Limit name, e.g. "Max open files".
+ * @param buffer Output buffer ("-" if not found).
+ * @param buf_size Size of the output buffer.
+ */
+static void parse_limit(const char *limits, const char *label, char *buffer,
+			size_t buf_size) {
+	const char *line = strstr(limits, label);
+	char soft[20], hard[20];
+
+	if (line && sscanf(line + strlen(label), "%19s %19s", soft, hard) == 2) {
+		snprintf(buffer, buf_size, "%s/%s", soft, hard);
+	} else {
+		snprintf(buffer, buf_size, "-");
+	}
+}
+
+/**
+ * @brief Read thread count, limits and cgroup.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ */
+static void read_status_limits(pid_t pid, proc_detail_t *out) {
+	char buffer[4096];
+
+	if (read_proc_file(pid, "status", buffer, sizeof(buffer)) > 0) {
+		const char *line = strstr(buffer, "\nThreads:");
+		if (line) {
+			sscanf(line + 9, "%d", &out->threads);
+		}
+		/* "State:\tD (disk sleep)" */
+		line = strstr(buffer, "\nState:");
+		if (line) {
+			sscanf(line + 7, " %c", &out->state);
+		}
+	}
+
+	if (read_proc_file(pid, "limits", buffer, sizeof(buffer)) > 0) {
+		parse_limit(buffer, "Max open files", out->limit_nofile,
+			    sizeof(out->limit_nofile));
+		parse_limit(buffer, "Max processes", out->limit_nproc,
+			    sizeof(out->limit_nproc));
+	}
+
+	if (read_proc_file(pid, "cgroup", buffer, sizeof(buffer)) > 0) {
+		/* Format is "id:controllers:path"; take the first line */
+		buffer[strcspn(buffer, "\n")] = '\0';
+		const char *path = strrchr(buffer, ':');
+		snprintf(out->cgroup, sizeof(out->cgroup), "%.*s",
+			 (int)sizeof(out->cgroup) - 1, path ? path + 1 : buffer);
+	}
+}
+
+/**
+ * @brief Read namespace inodes from /proc/[pid]/ns links.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ */
+static void read_namespaces(pid_t pid, proc_detail_t *out) {
+	for (int i = 0; i < DETAIL_NS_COUNT; i++) {
+		char name[16], link[64];
+		snprintf(name, sizeof(name), "ns/%s", detail_ns_names[i]);
+		read_proc_link(pid, name, link, sizeof(link));
+
+		/* Link looks like "pid:[4026531836]" */
+		const char *bracket = strchr(link, '[');
+		out->ns[i] = bracket ? strtoul(bracket + 1, NULL, 10) : 0;
+	}
+}
+
+/**
+ * @brief Read where a process in uninterruptible sleep is blocked.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ */
+static void read_blocked(pid_t pid, proc_detail_t *out) {
+	char buffer[4096];
+
+	/* "0" means the process is running again */
+	if (read_proc_file(pid, "wchan", out->wchan, sizeof(out->wchan)) <= 0 ||
+	    strcmp(out->wchan, "0") == 0) {
+		snprintf(out->wchan, sizeof(out->wchan), "-");
+	}
+
+	if (read_proc_file(pid, "stack", buffer, sizeof(buffer)) > 0) {
+		detail_format_stack(buffer, out->stack, sizeof(out->stack));
+	}
+}
+
+/**
+ * @brief Summarize /proc/[pid]/maps: region count and total size.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @param gen Generation of the read (checked every few hundred lines).
+ */
+static void read_maps(pid_t pid, proc_detail_t *out, unsigned gen) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/maps", proc_root(), pid);
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		return;
+	}
+
+	char line[512];
+	out->map_count = 0;
+	out->map_file_count = 0;
+	out->map_total_kb = 0;
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long start, end, inode;
+		if (sscanf(line, "%lx-%lx %*s %*s %*s %lu", &start, &end,
+			   &inode) == 3) {
+			out->map_count++;
+			out->map_total_kb += (long)((end - start) / 1024);
+			if (inode != 0) {
+				out->map_file_count++;
+			}
+		}
+		if ((out->map_count & 255) == 0 && cancelled(gen)) {
+			break;
+		}
+	}
+	fclose(f);
+}
+
+/**
+ * @brief Read every detail field, aborting early when cancelled.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @param gen Generation of the read (0 = not cancellable).
+ * @param deep 0 to skip the walks whose cost grows with the process
+ *             (environment, fd table, memory maps).
+ * @return 0 on success, -1 if the process is gone or the read was cancelled.
+ */
+static int read_detail(pid_t pid, proc_detail_t *out, unsigned gen,
+		       int deep) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d", proc_root(), pid);
+	if (access(path, F_OK) != 0) {
+		return -1;
+	}
+
+	memset(out, 0, sizeof(*out));
+	out->pid = pid;
+	out->env_size = -1;
+	out->env_count = -1;
+	out->threads = -1;
+	snprintf(out->limit_nofile, sizeof(out->limit_nofile), "-");
+	snprintf(out->limit_nproc, sizeof(out->limit_nproc), "-");
+	snprintf(out->cgroup, sizeof(out->cgroup), "-");
+	snprintf(out->wchan, sizeof(out->wchan), "-");
+	snprintf(out->stack, sizeof(out->stack), "-");
+	out->state = '?';
+
+	if (deep) {
+		read_cmdline_env(pid, out);
+	} else {
+		read_cmdline(pid, out);
+		out->fd_count = -1;
+		out->map_count = -1;
+		out->map_file_count = -1;
+		out->map_total_kb = -1;
+	}
+	if (cancelled(gen)) {
+		return -1;
+	}
+	read_proc_link(pid, "cwd", out->cwd, sizeof(out->cwd));
+	read_proc_link(pid, "exe", out->exe, sizeof(out->exe));
+	if (deep) {
+		out->fd_count = count_fds(pid);
+	}
+	if (cancelled(gen)) {
+		return -1;
+	}
+	read_status_limits(pid, out);
+	read_namespaces(pid, out);
+	if (out->state == 'D') {
+		read_blocked(pid, out);
+	}
+	if (cancelled(gen)) {
+		return -1;
+	}
+	if (deep) {
+		read_maps(pid, out, gen);
+	}
+	if (cancelled(gen)) {
+		return -1;
+	}
+
+	out->valid = 1;
+	out->updated = time(NULL);
+	return 0;
+}
+
+/**
+ * @brief Worker thread: inspect the selected PID, then sleep until the
+ * next refresh or a selection change.
+ *
+ * @param arg Unused.
+ * @return NULL.
+ */
+static void *worker_main(void *arg) {
+	(void)arg;
+	proc_detail_t scratch;
+
+	pthread_mutex_lock(&lock);
+	while (!stop_requested) {
+		pid_t pid = selected_pid;
+		unsigned gen = atomic_load(&generation);
+
+		if (pid > 0) {
+			/* Read without holding the lock */
+			pthread_mutex_unlock(&lock);
+			int rc = read_detail(pid, &scratch, gen, 1);
+			pthread_mutex_lock(&lock);
+
+			if (!cancelled(gen)) {
+				if (rc == 0) {
+					published = scratch;
+				} else {
+					/* Process exited: keep pane, mark stale */
+					published.pid = pid;
+					published.valid = 0;
+				}
+			}
+		}
+
+		if (stop_requested || cancelled(gen)) {
+			continue;
+		}
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += DETAIL_REFRESH_SEC;
+		while (!stop_requested && !cancelled(gen)) {
+			if (pthread_cond_timedwait(&wakeup, &lock,
+						   &deadline) != 0) {
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Format the contents of /proc/[pid]/stack as one line.
+ *
+ * @param text Contents of the stack file.
+ * @param out Output buffer.
+ * @param out_size Size of the output buffer.
+ */
+void detail_format_stack(const char *text, char *out, size_t out_size) {
+	size_t len = 0;
+
+	out[0] = '\0';
+	while (*text) {
+		size_t line_len = strcspn(text, "\n");
+		const char *name = memchr(text, ']', line_len);
+		name = name ? name + 1 : text;
+		while (*name == ' ') {
+			name++;
+		}
+		int name_len = (int)strcspn(name, "+\n");
+
+		if (name_len > 0 && len < out_size) {
+			len += snprintf(out + len, out_size - len, "%s%.*s",
+					len > 0 ? " < " : "", name_len, name);
+		}
+		text += line_len;
+		if (*text == '\n') {
+			text++;
+		}
+	}
+	if (len == 0) {
+		snprintf(out, out_size, "-");
+	}
+}
+
+/**
+ * @brief Read all detail fields of a process synchronously.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @return 0 on success, -1 if the process does not exist.
+ */
+int detail_read(pid_t pid, proc_detail_t *out) {
+	return read_detail(pid, out, 0, 1);
+}
+
+/**
+ * @brief Read the detail fields of bounded cost synchronously.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @return 0 on success, -1 if the process does not exist.
+ */
+int detail_read_brief(pid_t pid, proc_detail_t *out) {
+	return read_detail(pid, out, 0, 0);
+}
+
+/**
+ * @brief Start the background inspection thread.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int detail_start(void) {
+	if (worker_running) {
+		return 0;
+	}
+	stop_requested = 0;
+	if (pthread_create(&worker, NULL, worker_main, NULL) != 0) {
+		return -1;
+	}
+	worker_running = 1;
+	return 0;
+}
+
+/**
+ * @brief Stop and join the background inspection thread.
+ */
+void detail_stop(void) {
+	if (!worker_running) {
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	stop_requested = 1;
+	atomic_fetch_add(&generation, 1);
+	pthread_cond_signal(&wakeup);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(worker, NULL);
+	worker_running = 0;
+}
+
+/**
+ * @brief Select the process to inspect, cancelling any read in progress.
+ *
+ * @param pid Process ID to inspect, or 0 to stop inspecting.
+ */
+void detail_select(pid_t pid) {
+	pthread_mutex_lock(&lock);
+	if (pid != selected_pid) {
+		selected_pid = pid;
+		memset(&published, 0, sizeof(published));
+		atomic_fetch_add(&generation, 1);
+		pthread_cond_signal(&wakeup);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Copy the latest detail data for the selected process.
+ *
+ * @param out Destination structure.
+ * @return 1 if data for the selected PID is available, 0 while loading.
+ */
+int detail_get(proc_detail_t *out) {
+	pthread_mutex_lock(&lock);
+	*out = published;
+	int ready = (selected_pid != 0 && published.pid == selected_pid);
+	pthread_mutex_unlock(&lock);
+	return ready;
+}
@@ -0,0 +1,135 @@
+#ifndef DETAIL_H
+#define DETAIL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * @brief Seconds between background refreshes of the detail pane.
+ *
+ * Deliberately slower than the main list (1 s), since a deep inspection
+ * touches many more files per process.
+ */
+#define DETAIL_REFRESH_SEC 3
+
+/**
+ * @brief Namespaces reported in the detail pane.
+ */
+#define DETAIL_NS_COUNT 6
+
+/**
+ * @brief Index of each namespace in proc_detail_t.ns (and detail_ns_names).
+ */
+typedef enum {
+	DETAIL_NS_PID,
+	DETAIL_NS_MNT,
+	DETAIL_NS_NET,
+	DETAIL_NS_USER,
+	DETAIL_NS_UTS,
+	DETAIL_NS_IPC
+} DetailNamespace;
+
+/**
+ * @brief In-depth information about a single process.
+ *
+ * Numeric fields are -1 when the value could not be read (usually because
+ * the process belongs to another user).
+ */
+typedef struct {
+	pid_t pid;                  /**< Inspected process */
+	int valid;                  /**< 1 once the process was read successfully */
+	time_t updated;             /**< Time of the last completed read */
+	char cmdline[512];          /**< Full command line, arguments space-separated */
+	char cwd[256];              /**< Current working directory */
+	char exe[256];              /**< Path of the executable */
+	long env_size;              /**< Size of the environment in bytes */
+	int env_count;              /**< Number of environment variables */
+	int fd_count;               /**< Number of open file descriptors */
+	int threads;                /**< Number of threads */
+	char limit_nofile[48];      /**< "soft/hard" limit of open files */
+	char limit_nproc[48];       /**< "soft/hard" limit of processes */
+	char cgroup[256];           /**< cgroup path (unified hierarchy or first line) */
+	unsigned long ns[DETAIL_NS_COUNT]; /**< Namespace inodes, see detail_ns_names */
+	int map_count;              /**< Number of memory mappings */
+	int map_file_count;         /**< Mappings backed by a file */
+	long map_total_kb;          /**< Total mapped virtual size in kB */
+	char state;                 /**< State letter ('?' if unknown) */
+	char wchan[64];             /**< Wait channel of a D-state process ("-" if unknown) */
+	char stack[256];            /**< Kernel call chain of a D-state process ("-" if not permitted) */
+} proc_detail_t;
+
+/**
+ * @brief Names of the namespaces stored in proc_detail_t.ns, in order.
+ */
+extern const char *const detail_ns_names[DETAIL_NS_COUNT];
+
+/**
+ * @brief Formats the contents of /proc/[pid]/stack as one line.
+ *
+ * Frames such as "[<0>] io_schedule+0x16/0x40" are reduced to their
+ * function names and joined innermost first ("io_schedule < ...").
+ *
+ * @param text Contents of the stack file.
+ * @param out Output buffer (truncated, always terminated).
+ * @param out_size Size of the output buffer.
+ */
+void detail_format_stack(const char *text, char *out, size_t out_size);
+
+/**
+ * @brief Reads all detail fields of a process synchronously.
+ *
+ * Where a process is blocked (wait channel and kernel stack) is only read
+ * for processes in uninterruptible sleep (state D); the stack needs
+ * CAP_SYS_ADMIN and is "-" otherwise.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @return 0 on success, -1 if the process does not exist.
+ */
+int detail_read(pid_t pid, proc_detail_t *out);
+
+/**
+ * @brief Reads the detail fields whose cost does not grow with the process.
+ *
+ * Like detail_read() but without the environment, fd table and memory
+ * map walks: env_size, env_count, fd_count and the map fields are -1.
+ * Every file read is bounded by its field, so a server loop can call it.
+ *
+ * @param pid Process ID.
+ * @param out Destination structure.
+ * @return 0 on success, -1 if the process does not exist.
+ */
+int detail_read_brief(pid_t pid, proc_detail_t *out);
+
+/**
+ * @brief Starts the background inspection thread.
+ *
+ * @return 0 on success, -1 if the thread could not be created.
+ */
+int detail_start(void);
+
+/**
+ * @brief Stops and joins the background inspection thread.
+ */
+void detail_stop(void);
+
+/**
+ * @brief Selects the process to inspect.
+ *
+ * Any read in progress for a previous selection is abandoned. Passing 0
+ * cancels inspection altogether.
+ *
+ * @param pid Process ID to inspect, or 0.
+ */
+void detail_select(pid_t pid);
+
+/**
+ * @brief Copies the latest detail data for the selected process.
+ *
+ * @param out Destination structure.
+ * @return 1 if data for the currently selected PID is available, 0 while loading.
+ */
+int detail_get(proc_detail_t *out);
+
+#endif // DETAIL_H
@@ -0,0 +1,316 @@
+/**
+ * @file diff.c
+ * @brief Differences between two recorded frames.
+ *
+ * Both frames are sorted by PID, so the comparison is one merge-join:
+ * linear in the number of processes, without hashing or sorting.
+ */
+
+#include "diff.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *section_names[DIFF_SECTIONS] = {
+	"appeared", "disappeared", "cpu", "rss", "io", "net"
+};
+
+/* Text form of the two figures of each section (see diff_print()) */
+static const char *figure_formats[DIFF_SECTIONS] = {
+	"%.0f %.2f", "%.0f %.2f", "%.2f %.1f", "%+.0f %.0f", "%.1f %.1f",
+	"%.1f %.1f"
+};
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Get the number of clock ticks per second.
+ *
+ * @return Ticks per second (USER_HZ).
+ */
+static double clock_rate(void) {
+	long rate = sysconf(_SC_CLK_TCK);
+	return rate > 0 ? rate : 100;
+}
+
+/**
+ * @brief Ranking value of an entry in a biggest-delta section.
+ *
+ * @param entry Entry.
+ * @param section DIFF_CPU, DIFF_RSS, DIFF_IO or DIFF_NET.
+ * @return Larger for bigger changes.
+ */
+static double delta_key(const diff_entry_t *entry, DiffSection section) {
+	switch (section) {
+	case DIFF_CPU:
+		return entry->cpu_seconds;
+	case DIFF_RSS:
+		return labs(entry->rss_kb);
+	case DIFF_IO:
+		return entry->io_kb;
+	case DIFF_NET:
+		return entry->net_kb;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Insert an entry into a bounded, descending top list.
+ *
+ * @param result Diff being built.
+ * @param section DIFF_CPU, DIFF_RSS, DIFF_IO or DIFF_NET.
+ * @param entry Candidate.
+ */
+static void keep_top(diff_result_t *result, DiffSection section,
+		     const diff_entry_t *entry) {
+	double key = delta_key(entry, section);
+	if (key <= 0) {
+		return;
+	}
+
+	diff_entry_t *top = result->entries[section];
+	int count = result->counts[section];
+	if (count == DIFF_TOP && key <= delta_key(&top[count - 1], section)) {
+		return;
+	}
+
+	int at = count < DIFF_TOP ? count : DIFF_TOP - 1;
+	while (at > 0 && delta_key(&top[at - 1], section) < key) {
+		top[at] = top[at - 1];
+		at--;
+	}
+	top[at] = *entry;
+	if (count < DIFF_TOP) {
+		result->counts[section]++;
+	}
+}
+
+/**
+ * @brief Get the storage I/O of a record.
+ *
+ * @param record Record (NULL counts as zero).
+ * @return Bytes read + written, or -1 if the counters were not readable.
+ */
+static double io_bytes(const recording_record_t *record) {
+	if (!record) {
+		return 0;
+	}
+	if (record->read_bytes < 0 || record->write_bytes < 0) {
+		return -1;
+	}
+	return (double)record->read_bytes + record->write_bytes;
+}
+
+/**
+ * @brief Account a process present at the end of the interval.
+ *
+ * @param result Diff being built.
+ * @param before Earlier record (NULL if the process appeared).
+ * @param after Later record.
+ * @param ticks_per_second Clock ticks per second.
+ */
+static void add_deltas(diff_result_t *result, const recording_record_t *before,
+		       const recording_record_t *after, double ticks_per_second) {
+	diff_entry_t entry = { .before = before, .after = after };
+	unsigned long long ticks = after->cpu_ticks;
+	if (before) {
+		ticks = after->cpu_ticks >= before->cpu_ticks ?
+				after->cpu_ticks - before->cpu_ticks : 0;
+	}
+	entry.cpu_seconds = ticks / ticks_per_second;
+	entry.rss_kb = after->memory - (before ? before->memory : 0);
+	entry.net_kb = after->net_kb - (before ? before->net_kb : 0);
+	if (entry.net_kb < 0) {
+		entry.net_kb = 0;
+	}
+	double io_before = io_bytes(before), io_after = io_bytes(after);
+	if (io_before >= 0 && io_after > io_before) {
+		entry.io_kb = (io_after - io_before) / 1024;
+	}
+
+	keep_top(result, DIFF_CPU, &entry);
+	keep_top(result, DIFF_RSS, &entry);
+	keep_top(result, DIFF_IO, &entry);
+	keep_top(result, DIFF_NET, &entry);
+}
+
+/**
+ * @brief Format a timestamp as UTC ISO 8601.
+ *
+ * @param ms Milliseconds since the epoch.
+ * @param out Output buffer.
+ * @param size Size of out.
+ */
+static void format_utc(int64_t ms, char *out, size_t size) {
+	time_t seconds = ms / 1000;
+	struct tm tm;
+	gmtime_r(&seconds, &tm);
+	strftime(out, size, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Compare two frames with a merge-join on PID.
+ *
+ * @param a One frame.
+ * @param b The other frame.
+ * @param result Output.
+ * @return 0 on success, -1 if memory ran out.
+ */
+int diff_frames(const recording_frame_t *a, const recording_frame_t *b,
+		diff_result_t *result) {
+	const recording_frame_t *before = a->timestamp_ms <= b->timestamp_ms ? a : b;
+	const recording_frame_t *after = before == a ? b : a;
+
+	memset(result, 0, sizeof(*result));
+	result->from_ms = before->timestamp_ms;
+	result->to_ms = after->timestamp_ms;
+	result->before_count = before->count;
+	result->after_count = after->count;
+
+	/* Worst cases: nothing survived, or everything did */
+	size_t sizes[DIFF_SECTIONS] = {
+		after->count, before->count, DIFF_TOP, DIFF_TOP, DIFF_TOP,
+		DIFF_TOP
+	};
+	for (int section = 0; section < DIFF_SECTIONS; section++) {
+		result->entries[section] = malloc((sizes[section] ? sizes[section] : 1) *
+						  sizeof(diff_entry_t));
+		if (!result->entries[section]) {
+			diff_free(result);
+			return -1;
+		}
+	}
+
+	double ticks_per_second = clock_rate();
+
+	diff_entry_t *appeared = result->entries[DIFF_APPEARED];
+	diff_entry_t *disappeared = result->entries[DIFF_DISAPPEARED];
+	const recording_record_t *old = before->records;
+	const recording_record_t *new = after->records;
+	int i = 0, j = 0;
+	while (i < before->count || j < after->count) {
+		if (j == after->count ||
+		    (i < before->count && old[i].pid < new[j].pid)) {
+			disappeared[result->counts[DIFF_DISAPPEARED]++] =
+				(diff_entry_t){ .before = &old[i] };
+			i++;
+		} else if (i == before->count || new[j].pid < old[i].pid) {
+			appeared[result->counts[DIFF_APPEARED]++] =
+				(diff_entry_t){ .after = &new[j] };
+			add_deltas(result, NULL, &new[j], ticks_per_second);
+			j++;
+		} else if (old[i].start_time != new[j].start_time) {
+			/* PID reused: a different process */
+			disappeared[result->counts[DIFF_DISAPPEARED]++] =
+				(diff_entry_t){ .before = &old[i] };
+			appeared[result->counts[DIFF_APPEARED]++] =
+				(diff_entry_t){ .after = &new[j] };
+			add_deltas(result, NULL, &new[j], ticks_per_second);
+			i++;
+			j++;
+		} else {
+			add_deltas(result, &old[i], &new[j], ticks_per_second);
+			i++;
+			j++;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Release the entries of a diff.
+ *
+ * @param result Diff.
+ */
+void diff_free(diff_result_t *result) {
+	for (int section = 0; section < DIFF_SECTIONS; section++) {
+		free(result->entries[section]);
+		result->entries[section] = NULL;
+		result->counts[section] = 0;
+	}
+}
+
+/**
+ * @brief Get the name of a section.
+ *
+ * @param section Section.
+ * @return Static name.
+ */
+const char *diff_section_name(DiffSection section) {
+	return section >= 0 && section < DIFF_SECTIONS ? section_names[section] : "";
+}
+
+/**
+ * @brief Get the two figures shown for an entry.
+ *
+ * @param result Diff the entry belongs to.
+ * @param section Section of the entry.
+ * @param entry Entry.
+ * @param figures Output.
+ */
+void diff_figures(const diff_result_t *result, DiffSection section,
+		  const diff_entry_t *entry, double figures[2]) {
+	const recording_record_t *record = entry->after ? entry->after :
+							  entry->before;
+	double seconds = (result->to_ms - result->from_ms) / 1000.0;
+	double ticks_per_second = clock_rate();
+
+	switch (section) {
+	case DIFF_CPU:
+		figures[0] = entry->cpu_seconds;
+		figures[1] = seconds > 0 ? entry->cpu_seconds / seconds * 100 : 0;
+		break;
+	case DIFF_RSS:
+		figures[0] = entry->rss_kb;
+		figures[1] = record->memory;
+		break;
+	case DIFF_IO:
+		figures[0] = entry->io_kb;
+		figures[1] = seconds > 0 ? entry->io_kb / seconds : 0;
+		break;
+	case DIFF_NET:
+		figures[0] = entry->net_kb;
+		figures[1] = seconds > 0 ? entry->net_kb / seconds : 0;
+		break;
+	default:
+		figures[0] = record->memory;
+		figures[1] = record->cpu_ticks / ticks_per_second;
+		break;
+	}
+}
+
+/**
+ * @brief Print a diff as text.
+ *
+ * @param result Diff.
+ * @param out Output stream.
+ */
+void diff_print(const diff_result_t *result, FILE *out) {
+	char from[32], to[32];
+	format_utc(result->from_ms, from, sizeof(from));
+	format_utc(result->to_ms, to, sizeof(to));
+	fprintf(out, "# from %s to %s seconds %.0f processes %d %d "
+		"appeared %d disappeared %d\n", from, to,
+		(result->to_ms - result->from_ms) / 1000.0,
+		result->before_count, result->after_count,
+		result->counts[DIFF_APPEARED], result->counts[DIFF_DISAPPEARED]);
+
+	for (int section = 0; section < DIFF_SECTIONS; section++) {
+		for (int i = 0; i < result->counts[section]; i++) {
+			const diff_entry_t *entry = &result->entries[section][i];
+			const recording_record_t *record = entry->after ?
+							   entry->after : entry->before;
+			double figures[2];
+			diff_figures(result, section, entry, figures);
+			fprintf(out, "%s %d %s ", section_names[section],
+				record->pid, record->user[0] ? record->user : "-");
+			fprintf(out, figure_formats[section], figures[0],
+				figures[1]);
+			fprintf(out, " %s\n", record->name);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "recording.h"
+#include <stdio.h>
+
+/**
+ * @brief Entries kept in each of the biggest-delta sections.
+ */
+#define DIFF_TOP 20
+
+/**
+ * @brief Sections of a diff, in display order.
+ */
+typedef enum {
+	DIFF_APPEARED,     /**< Processes only in the later frame */
+	DIFF_DISAPPEARED,  /**< Processes only in the earlier frame */
+	DIFF_CPU,          /**< Most CPU time between the frames */
+	DIFF_RSS,          /**< Largest RSS changes (either sign) */
+	DIFF_IO,           /**< Most storage I/O between the frames */
+	DIFF_NET,          /**< Most TCP traffic between the frames */
+	DIFF_SECTIONS      /**< Number of sections */
+} DiffSection;
+
+/**
+ * @brief One process of a diff section.
+ *
+ * A process that appeared counts from zero, so its whole CPU time, RSS,
+ * I/O and traffic fall between the frames.
+ */
+typedef struct {
+	const recording_record_t *before;  /**< Earlier record (NULL if appeared) */
+	const recording_record_t *after;   /**< Later record (NULL if disappeared) */
+	double cpu_seconds;                /**< CPU time between the frames */
+	long rss_kb;                       /**< RSS change in kB */
+	double io_kb;                      /**< kB read + written between the frames */
+	double net_kb;                     /**< TCP traffic between the frames */
+} diff_entry_t;
+
+/**
+ * @brief Differences between two frames.
+ *
+ * Entries point into the frames, which must outlive the result.
+ */
+typedef struct {
+	int64_t from_ms;                          /**< Time of the earlier frame */
+	int64_t to_ms;                            /**< Time of the later frame */
+	int before_count;                         /**< Processes in the earlier frame */
+	int after_count;                          /**< Processes in the later frame */
+	diff_entry_t *entries[DIFF_SECTIONS];     /**< Entries per section (malloc'd) */
+	int counts[DIFF_SECTIONS];                /**< Entries per section */
+} diff_result_t;
+
+/**
+ * @brief Compares two frames.
+ *
+ * The frames are ordered by time first, then joined on PID in one pass
+ * (both are sorted by PID). A PID whose start time changed is a different
+ * process: it disappeared and appeared. Appeared and disappeared list
+ * every such process by PID; the other sections keep the DIFF_TOP
+ * largest deltas of the processes present at the end.
+ *
+ * @param a One frame.
+ * @param b The other frame.
+ * @param result Output (release with diff_free()).
+ * @return 0 on success, -1 if memory ran out.
+ */
+int diff_frames(const recording_frame_t *a, const recording_frame_t *b,
+		diff_result_t *result);
+
+/**
+ * @brief Releases the entries of a diff.
+ *
+ * @param result Diff filled by diff_frames().
+ */
+void diff_free(diff_result_t *result);
+
+/**
+ * @brief Gets the name of a section ("appeared", "cpu", ...).
+ *
+ * @param section Section.
+ * @return Static name.
+ */
+const char *diff_section_name(DiffSection section);
+
+/**
+ * @brief Gets the two figures shown for an entry (see diff_print()).
+ *
+ * @param result Diff the entry belongs to.
+ * @param section Section of the entry.
+ * @param entry Entry.
+ * @param figures Output: the section's two figures.
+ */
+void diff_figures(const diff_result_t *result, DiffSection section,
+		  const diff_entry_t *entry, double figures[2]);
+
+/**
+ * @brief Prints a diff as text for postmortems and scripts.
+ *
+ * A "#" summary line with the UTC times, the seconds between them and the
+ * process counts, then one line per entry: the section name, PID, user,
+ * the section's figures and the command name last (it may hold spaces).
+ *
+ *     appeared    PID USER RSS_KB CPU_SECONDS NAME
+ *     disappeared PID USER RSS_KB CPU_SECONDS NAME
+ *     cpu         PID USER CPU_SECONDS PERCENT_OF_A_CORE NAME
+ *     rss         PID USER DELTA_KB RSS_KB NAME
+ *     io          PID USER DELTA_KB KB_PER_SECOND NAME
+ *     net         PID USER DELTA_KB KB_PER_SECOND NAME
+ *
+ * Appeared and disappeared processes show their last recorded RSS and
+ * CPU time over their whole life; "io" is storage reads plus writes from
+ * /proc/[pid]/io (processes whose counters were not readable are left
+ * out), "net" is TCP traffic.
+ *
+ * @param result Diff.
+ * @param out Output stream.
+ */
+void diff_print(const diff_result_t *result, FILE *out);
+
+#endif // DIFF_H
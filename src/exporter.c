@@ -0,0 +1,692 @@
+/**
+ * @file exporter.c
+ * @brief Prometheus/OpenMetrics text endpoint with bounded cardinality.
+ *
+ * Only the top processes (by CPU and by RSS) get their own series; the
+ * rest are summed. Users and cgroups are aggregated the same way, so the
+ * payload size does not grow with the number of processes.
+ */
+
+#include "exporter.h"
+#include "budget.h"
+#include "sort.h"
+#include "strbuf.h"
+#include "clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define PAYLOAD_MAX (512 * 1024)
+#define REQUEST_MAX 2048
+#define GROUP_BUCKETS (MAX_PROCESSES * 2)
+#define OTHER_LABEL "__other__"
+
+/**
+ * @brief Connection state of one scraper.
+ */
+typedef struct {
+	int fd;                     /**< Socket, -1 if the slot is free */
+	double accepted;            /**< Monotonic time of the accept */
+	char in[REQUEST_MAX];       /**< Request bytes received so far */
+	size_t in_len;              /**< Bytes in in */
+	char *out;                  /**< Response (headers + payload) */
+	size_t out_len;             /**< Bytes in out */
+	size_t out_off;             /**< Bytes of out already sent */
+} scraper_t;
+
+/**
+ * @brief Totals of one user or cgroup.
+ */
+typedef struct {
+	const char *key;            /**< Label value (points into the snapshot) */
+	int processes;              /**< Number of processes */
+	double cpu;                 /**< Summed CPU percent */
+	double resident_kb;         /**< Summed RSS in kB */
+} group_t;
+
+/**
+ * @brief A per-process metric family.
+ */
+typedef struct {
+	const char *name;
+	const char *help;
+	double (*value)(const proc_info_t *proc);
+} family_t;
+
+static int listen_fd = -1;
+static int epoll_fd = -1;
+static int bound_port = 0;
+static scraper_t scrapers[EXPORTER_MAX_CLIENTS];
+
+static char payload[PAYLOAD_MAX];
+static size_t payload_length = 0;
+static unsigned long long payload_generation = 0;
+
+/* Scratch of one render */
+static const proc_list_t *ranking;
+static int order[MAX_PROCESSES];
+static unsigned char selected[MAX_PROCESSES];
+static group_t groups[MAX_PROCESSES];
+static int group_buckets[GROUP_BUCKETS];
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Get the value of pb_process_cpu_percent.
+ *
+ * @param proc Process.
+ * @return CPU percentage.
+ */
+static double cpu_of(const proc_info_t *proc) {
+	return proc->cpu_usage;
+}
+
+/**
+ * @brief Get the value of pb_process_resident_bytes.
+ *
+ * @param proc Process.
+ * @return Resident bytes.
+ */
+static double resident_of(const proc_info_t *proc) {
+	return proc->memory * 1024.0;
+}
+
+/**
+ * @brief Get the value of pb_process_open_fds.
+ *
+ * @param proc Process.
+ * @return Open descriptors (-1 if not sampled).
+ */
+static double fds_of(const proc_info_t *proc) {
+	return proc->fd_count;
+}
+
+/**
+ * @brief Get the value of pb_process_network_bytes_per_second.
+ *
+ * @param proc Process.
+ * @return Bytes per second (negative if unknown).
+ */
+static double network_of(const proc_info_t *proc) {
+	return proc->net_rate * 1024.0;
+}
+
+static const family_t families[] = {
+	{ "pb_process_cpu_percent", "CPU usage of a top process.", cpu_of },
+	{ "pb_process_resident_bytes", "Resident memory of a top process.",
+	  resident_of },
+	{ "pb_process_open_fds", "Open descriptors of a top process (when "
+	  "sampled).", fds_of },
+	{ "pb_process_network_bytes_per_second", "TCP throughput of a top "
+	  "process.", network_of },
+};
+
+/**
+ * @brief Comparator for ranking indexes by CPU usage (descending).
+ *
+ * @param a Pointer to first index into ranking.
+ * @param b Pointer to second index.
+ * @return Positive if b uses more CPU, negative if less, zero if equal.
+ */
+static int compare_cpu_index(const void *a, const void *b) {
+	float ca = ranking->list[*(const int *)a].cpu_usage;
+	float cb = ranking->list[*(const int *)b].cpu_usage;
+	return (cb > ca) - (cb < ca);
+}
+
+/**
+ * @brief Comparator for ranking indexes by RSS (descending).
+ *
+ * @param a Pointer to first index into ranking.
+ * @param b Pointer to second index.
+ * @return Positive if b is larger, negative if smaller, zero if equal.
+ */
+static int compare_mem_index(const void *a, const void *b) {
+	long ma = ranking->list[*(const int *)a].memory;
+	long mb = ranking->list[*(const int *)b].memory;
+	return (mb > ma) - (mb < ma);
+}
+
+/**
+ * @brief Comparator for groups: CPU, then RSS (both descending).
+ *
+ * @param a Pointer to first group.
+ * @param b Pointer to second group.
+ * @return Positive if b ranks higher, negative if lower, zero if equal.
+ */
+static int compare_group(const void *a, const void *b) {
+	const group_t *ga = a;
+	const group_t *gb = b;
+	if (ga->cpu != gb->cpu) {
+		return (gb->cpu > ga->cpu) - (gb->cpu < ga->cpu);
+	}
+	return (gb->resident_kb > ga->resident_kb) -
+	       (gb->resident_kb < ga->resident_kb);
+}
+
+/**
+ * @brief Mark the top processes of the snapshot in selected[].
+ *
+ * @param plist Snapshot.
+ * @param compare Ranking comparator on list indices.
+ */
+static void select_top(const proc_list_t *plist,
+		       int (*compare)(const void *, const void *)) {
+	ranking = plist;
+	for (int i = 0; i < plist->count; i++) {
+		order[i] = i;
+	}
+	sort_array(order, plist->count, sizeof(int), compare);
+	for (int i = 0; i < plist->count && i < EXPORTER_TOP_PROCESSES; i++) {
+		selected[order[i]] = 1;
+	}
+}
+
+/**
+ * @brief Sum processes per user or cgroup.
+ *
+ * @param plist Snapshot.
+ * @param by_cgroup 0 to group by user, 1 by cgroup.
+ * @return Number of groups in groups[].
+ */
+static int aggregate(const proc_list_t *plist, int by_cgroup) {
+	int count = 0;
+	memset(group_buckets, 0, sizeof(group_buckets));
+
+	for (int i = 0; i < plist->count; i++) {
+		const proc_info_t *proc = &plist->list[i];
+		const char *key = by_cgroup ? proc->cgroup : proc->user;
+
+		/* FNV-1a, linear probing; buckets hold index + 1 */
+		unsigned int hash = 2166136261u;
+		for (const char *p = key; *p; p++) {
+			hash = (hash ^ (unsigned char)*p) * 16777619u;
+		}
+		unsigned int pos = hash % GROUP_BUCKETS;
+		while (group_buckets[pos] &&
+		       strcmp(groups[group_buckets[pos] - 1].key, key) != 0) {
+			pos = (pos + 1) % GROUP_BUCKETS;
+		}
+		if (!group_buckets[pos]) {
+			groups[count].key = key;
+			groups[count].processes = 0;
+			groups[count].cpu = 0;
+			groups[count].resident_kb = 0;
+			group_buckets[pos] = ++count;
+		}
+
+		group_t *group = &groups[group_buckets[pos] - 1];
+		group->processes++;
+		group->cpu += proc->cpu_usage;
+		group->resident_kb += proc->memory;
+	}
+
+	sort_array(groups, count, sizeof(group_t), compare_group);
+
+	/* Fold everything past the top N into one bucket */
+	if (count > EXPORTER_TOP_GROUPS) {
+		group_t *other = &groups[EXPORTER_TOP_GROUPS];
+		for (int i = EXPORTER_TOP_GROUPS + 1; i < count; i++) {
+			other->processes += groups[i].processes;
+			other->cpu += groups[i].cpu;
+			other->resident_kb += groups[i].resident_kb;
+		}
+		other->key = OTHER_LABEL;
+		count = EXPORTER_TOP_GROUPS + 1;
+	}
+	return count;
+}
+
+/**
+ * @brief Emit the HELP and TYPE lines of a gauge family.
+ *
+ * @param sb Writer.
+ * @param name Metric name.
+ * @param help Help text.
+ */
+static void put_header(strbuf_t *sb, const char *name, const char *help) {
+	strbuf_printf(sb, "# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+}
+
+/**
+ * @brief Emit the three families of a group aggregation.
+ *
+ * @param sb Writer.
+ * @param prefix "pb_user" or "pb_cgroup".
+ * @param label Label name.
+ * @param count Number of groups.
+ */
+static void put_groups(strbuf_t *sb, const char *prefix, const char *label,
+		       int count) {
+	static const char *const suffixes[] = {
+		"processes", "cpu_percent", "resident_bytes"
+	};
+
+	for (int f = 0; f < 3; f++) {
+		char name[64];
+		snprintf(name, sizeof(name), "%s_%s", prefix, suffixes[f]);
+		put_header(sb, name, f == 0 ? "Number of processes." :
+				     f == 1 ? "Summed CPU usage." :
+					      "Summed resident memory.");
+		for (int i = 0; i < count; i++) {
+			strbuf_printf(sb, "%s{%s=\"", name, label);
+			strbuf_put_quoted(sb, groups[i].key);
+			strbuf_printf(sb, "\"} %.*f\n", f == 1 ? 1 : 0,
+				      f == 0 ? (double)groups[i].processes :
+				      f == 1 ? groups[i].cpu :
+					       groups[i].resident_kb * 1024.0);
+		}
+	}
+}
+
+/**
+ * @brief Encode a snapshot into payload[].
+ *
+ * @param plist Snapshot.
+ */
+static void encode(const proc_list_t *plist) {
+	strbuf_t sb;
+	strbuf_init(&sb, payload, sizeof(payload));
+
+	put_header(&sb, "pb_processes", "Processes found in /proc.");
+	strbuf_printf(&sb, "pb_processes %d\n", plist->total);
+
+	/* Every other family covers only the listed processes */
+	put_header(&sb, "pb_unlisted_processes",
+		   "Processes found but not listed (over the list cap), so "
+		   "missing from every other sum.");
+	strbuf_printf(&sb, "pb_unlisted_processes %d\n",
+		      plist->total > plist->count ? plist->total - plist->count :
+						    0);
+
+	put_header(&sb, "pb_processes_state",
+		   "Processes per state (D: uninterruptible, Z: zombie).");
+	for (int i = 0; i < PROC_STATE_COUNT; i++) {
+		strbuf_printf(&sb, "pb_processes_state{state=\"%c\"} %d\n",
+			      PROC_STATES[i], plist->states[i]);
+	}
+
+	memset(selected, 0, sizeof(selected));
+	select_top(plist, compare_cpu_index);
+	select_top(plist, compare_mem_index);
+
+	for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+		put_header(&sb, families[f].name, families[f].help);
+		for (int i = 0; i < plist->count; i++) {
+			const proc_info_t *proc = &plist->list[i];
+			double value = families[f].value(proc);
+			if (!selected[i] || value < 0) {
+				continue;
+			}
+			strbuf_printf(&sb, "%s{pid=\"%d\",name=\"",
+				      families[f].name, proc->pid);
+			strbuf_put_quoted(&sb, proc->name);
+			strbuf_printf(&sb, "\",user=\"");
+			strbuf_put_quoted(&sb, proc->user);
+			strbuf_printf(&sb, "\"} %.1f\n", value);
+		}
+	}
+
+	int others = 0;
+	double other_cpu = 0, other_resident = 0;
+	for (int i = 0; i < plist->count; i++) {
+		if (!selected[i]) {
+			others++;
+			other_cpu += plist->list[i].cpu_usage;
+			other_resident += plist->list[i].memory * 1024.0;
+		}
+	}
+	put_header(&sb, "pb_other_processes",
+		   "Processes without individual series.");
+	strbuf_printf(&sb, "pb_other_processes %d\n", others);
+	put_header(&sb, "pb_other_cpu_percent",
+		   "Summed CPU usage of processes without individual series.");
+	strbuf_printf(&sb, "pb_other_cpu_percent %.1f\n", other_cpu);
+	put_header(&sb, "pb_other_resident_bytes",
+		   "Summed resident memory of processes without individual "
+		   "series.");
+	strbuf_printf(&sb, "pb_other_resident_bytes %.0f\n", other_resident);
+
+	put_groups(&sb, "pb_user", "user", aggregate(plist, 0));
+	put_groups(&sb, "pb_cgroup", "cgroup", aggregate(plist, 1));
+
+	/* The collector's own overhead, as of the pass that made plist */
+	const budget_stats_t *self = budget_stats();
+	const struct {
+		const char *name;
+		const char *help;
+		double value;
+	} own[] = {
+		{ "pb_self_cpu_seconds", "CPU time used by pb since start.",
+		  self->cpu_seconds },
+		{ "pb_self_cpu_percent", "CPU usage of pb since the previous "
+		  "pass.", self->cpu_percent },
+		{ "pb_self_background_cpu_percent", "Smoothed CPU usage of pb "
+		  "between passes (serving).", self->background_percent },
+		{ "pb_self_resident_bytes", "Resident memory of pb.",
+		  (double)self->resident_bytes },
+		{ "pb_self_peak_resident_bytes", "Largest resident memory of pb.",
+		  (double)self->peak_resident_bytes },
+		{ "pb_self_pass_cpu_seconds", "CPU time of the last collection "
+		  "pass.", self->pass_seconds },
+		{ "pb_self_interval_seconds", "Seconds between collection passes.",
+		  self->interval },
+		{ "pb_self_passes", "Collection passes since start.",
+		  (double)self->passes },
+		{ "pb_self_cpu_budget_percent", "Configured CPU budget (0: none).",
+		  self->cpu_budget },
+	};
+	for (size_t i = 0; i < sizeof(own) / sizeof(own[0]); i++) {
+		put_header(&sb, own[i].name, own[i].help);
+		strbuf_printf(&sb, "%s %.10g\n", own[i].name, own[i].value);
+	}
+	strbuf_printf(&sb, "# EOF\n");
+
+	if (sb.overflow) {
+		/* Cannot happen with the limits above; keep the output valid */
+		strbuf_init(&sb, payload, sizeof(payload));
+		strbuf_printf(&sb, "# EOF\n");
+	}
+	payload_length = sb.length;
+}
+
+/**
+ * @brief Disconnect a scraper and free its slot.
+ *
+ * @param scraper Scraper.
+ */
+static void scraper_close(scraper_t *scraper) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, scraper->fd, NULL);
+	close(scraper->fd);
+	free(scraper->out);
+	memset(scraper, 0, sizeof(*scraper));
+	scraper->fd = -1;
+}
+
+/**
+ * @brief Send the pending response; close once it is complete.
+ *
+ * @param scraper Scraper.
+ */
+static void scraper_flush(scraper_t *scraper) {
+	while (scraper->out_off < scraper->out_len) {
+		ssize_t n = send(scraper->fd, scraper->out + scraper->out_off,
+				 scraper->out_len - scraper->out_off,
+				 MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				struct epoll_event event = { 0 };
+				event.events = EPOLLOUT;
+				event.data.ptr = scraper;
+				epoll_ctl(epoll_fd, EPOLL_CTL_MOD, scraper->fd,
+					  &event);
+				return;
+			}
+			break;
+		}
+		scraper->out_off += (size_t)n;
+	}
+	scraper_close(scraper);
+}
+
+/**
+ * @brief Build the HTTP response for a complete request.
+ *
+ * @param scraper Scraper.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ */
+static void scraper_respond(scraper_t *scraper, const proc_list_t *plist,
+			    unsigned long long generation) {
+	const char *status = "404 Not Found";
+	const char *type = "text/plain";
+	const char *body = "Not found. Metrics are at /metrics\n";
+	size_t body_length = strlen(body);
+
+	if (strncmp(scraper->in, "GET /metrics ", 13) == 0 ||
+	    strncmp(scraper->in, "GET /metrics?", 13) == 0) {
+		status = "200 OK";
+		type = "text/plain; version=0.0.4; charset=utf-8";
+		body = exporter_render(plist, generation, &body_length);
+	} else if (strncmp(scraper->in, "GET ", 4) != 0) {
+		status = "405 Method Not Allowed";
+		body = "Only GET is supported\n";
+		body_length = strlen(body);
+	}
+
+	char header[256];
+	int header_length = snprintf(header, sizeof(header),
+				     "HTTP/1.1 %s\r\nContent-Type: %s\r\n"
+				     "Content-Length: %zu\r\n"
+				     "Connection: close\r\n\r\n",
+				     status, type, body_length);
+
+	/* Copied: the payload buffer may be re-encoded while we send */
+	scraper->out = malloc(header_length + body_length);
+	if (!scraper->out) {
+		scraper_close(scraper);
+		return;
+	}
+	memcpy(scraper->out, header, header_length);
+	memcpy(scraper->out + header_length, body, body_length);
+	scraper->out_len = header_length + body_length;
+	scraper_flush(scraper);
+}
+
+/**
+ * @brief Read request bytes; respond once the headers are complete.
+ *
+ * @param scraper Scraper.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ */
+static void scraper_read(scraper_t *scraper, const proc_list_t *plist,
+			 unsigned long long generation) {
+	ssize_t n = recv(scraper->fd, scraper->in + scraper->in_len,
+			 sizeof(scraper->in) - 1 - scraper->in_len, 0);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		return;
+	}
+	if (n <= 0) {
+		scraper_close(scraper);
+		return;
+	}
+	scraper->in_len += (size_t)n;
+	scraper->in[scraper->in_len] = '\0';
+
+	if (strstr(scraper->in, "\r\n\r\n") || strstr(scraper->in, "\n\n")) {
+		scraper_respond(scraper, plist, generation);
+	} else if (scraper->in_len == sizeof(scraper->in) - 1) {
+		scraper_close(scraper);
+	}
+}
+
+/**
+ * @brief Accept pending connections into free scraper slots.
+ *
+ * Connections beyond EXPORTER_MAX_CLIENTS are closed at once.
+ */
+static void accept_scrapers(void) {
+	int fd;
+	while ((fd = accept4(listen_fd, NULL, NULL,
+			     SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		scraper_t *scraper = NULL;
+		for (int i = 0; i < EXPORTER_MAX_CLIENTS && !scraper; i++) {
+			if (scrapers[i].fd < 0) {
+				scraper = &scrapers[i];
+			}
+		}
+		if (!scraper) {
+			close(fd);
+			continue;
+		}
+
+		scraper->fd = fd;
+		scraper->accepted = monotonic_seconds();
+		struct epoll_event event = { 0 };
+		event.events = EPOLLIN;
+		event.data.ptr = scraper;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			close(fd);
+			scraper->fd = -1;
+		}
+	}
+}
+
+/**
+ * @brief Close scrapers that did not finish within EXPORTER_TIMEOUT.
+ *
+ * Idle connections would otherwise keep their slots forever.
+ */
+static void expire_scrapers(void) {
+	double now = monotonic_seconds();
+	for (int i = 0; i < EXPORTER_MAX_CLIENTS; i++) {
+		if (scrapers[i].fd >= 0 &&
+		    now - scrapers[i].accepted >= EXPORTER_TIMEOUT) {
+			scraper_close(&scrapers[i]);
+		}
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Listen on 127.0.0.1:port.
+ *
+ * @param port TCP port (0 for any).
+ * @return 0 on success, -1 on failure.
+ */
+int exporter_open(int port) {
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((unsigned short)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (int i = 0; i < EXPORTER_MAX_CLIENTS; i++) {
+		scrapers[i].fd = -1;
+	}
+
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		return -1;
+	}
+	int one = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	socklen_t len = sizeof(addr);
+	struct epoll_event event = { 0 };
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(listen_fd, 16) < 0 ||
+	    getsockname(listen_fd, (struct sockaddr *)&addr, &len) < 0 ||
+	    (epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+	    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0) {
+		int saved = errno;
+		exporter_close();
+		errno = saved;
+		return -1;
+	}
+	bound_port = ntohs(addr.sin_port);
+	return 0;
+}
+
+/**
+ * @brief Get the bound port.
+ *
+ * @return Port, or 0.
+ */
+int exporter_port(void) {
+	return bound_port;
+}
+
+/**
+ * @brief Get the epoll descriptor (readable when events are pending).
+ *
+ * @return Descriptor, or -1.
+ */
+int exporter_fd(void) {
+	return epoll_fd;
+}
+
+/**
+ * @brief Serve scrapes until the timeout expires.
+ *
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @param timeout_ms Time to wait for events.
+ */
+void exporter_poll(const proc_list_t *plist, unsigned long long generation,
+		   int timeout_ms) {
+	struct epoll_event events[EXPORTER_MAX_CLIENTS + 1];
+
+	if (epoll_fd < 0) {
+		return;
+	}
+
+	int n = epoll_wait(epoll_fd, events, EXPORTER_MAX_CLIENTS + 1,
+			   timeout_ms);
+	/* Before accepting, so stale connections free their slots */
+	expire_scrapers();
+	for (int i = 0; i < n; i++) {
+		scraper_t *scraper = events[i].data.ptr;
+		if (!scraper) {
+			accept_scrapers();
+		} else if (scraper->fd < 0) {
+			continue;
+		} else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			scraper_close(scraper);
+		} else if (scraper->out) {
+			scraper_flush(scraper);
+		} else {
+			scraper_read(scraper, plist, generation);
+		}
+	}
+}
+
+/**
+ * @brief Render a snapshot, re-encoding only for a new generation.
+ *
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @param length Output for the payload length.
+ * @return Payload.
+ */
+const char *exporter_render(const proc_list_t *plist,
+			    unsigned long long generation, size_t *length) {
+	if (payload_length == 0 || generation != payload_generation) {
+		encode(plist);
+		payload_generation = generation;
+	}
+	*length = payload_length;
+	return payload;
+}
+
+/**
+ * @brief Disconnect scrapers and stop listening.
+ */
+void exporter_close(void) {
+	for (int i = 0; i < EXPORTER_MAX_CLIENTS; i++) {
+		if (scrapers[i].fd >= 0 && epoll_fd >= 0) {
+			scraper_close(&scrapers[i]);
+		}
+	}
+	if (epoll_fd >= 0) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		listen_fd = -1;
+	}
+	bound_port = 0;
+	payload_length = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "proc.h"
+#include <stddef.h>
+
+/**
+ * @brief Default TCP port of the metrics endpoint (bound to 127.0.0.1).
+ */
+#define EXPORTER_PORT 9257
+
+/**
+ * @brief Processes exported individually: the top N by CPU and the top N
+ *        by resident memory. All others are summed into pb_other_* series.
+ */
+#define EXPORTER_TOP_PROCESSES 50
+
+/**
+ * @brief Users and cgroups exported individually (largest CPU first); the
+ *        rest are summed under the label value "__other__".
+ */
+#define EXPORTER_TOP_GROUPS 50
+
+/**
+ * @brief Maximum number of simultaneously connected scrapers.
+ */
+#define EXPORTER_MAX_CLIENTS 16
+
+/**
+ * @brief Seconds a scraper has to send its request and read the response
+ *        before its connection is closed.
+ */
+#define EXPORTER_TIMEOUT 5.0
+
+/**
+ * @brief Starts listening on 127.0.0.1.
+ *
+ * @param port TCP port (0 picks a free port, see exporter_port()).
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int exporter_open(int port);
+
+/**
+ * @brief Gets the port actually bound.
+ *
+ * @return Port number, or 0 if not listening.
+ */
+int exporter_port(void);
+
+/**
+ * @brief Gets a descriptor that becomes readable when exporter_poll() has
+ *        work, for waiting on several servers at once.
+ *
+ * @return Pollable descriptor, or -1 if not listening.
+ */
+int exporter_fd(void);
+
+/**
+ * @brief Serves scrapes of GET /metrics until the timeout expires.
+ *
+ * Connections older than EXPORTER_TIMEOUT are closed first.
+ *
+ * @param plist Current snapshot.
+ * @param generation Snapshot number.
+ * @param timeout_ms Time to wait for events (0 to only handle ready ones).
+ */
+void exporter_poll(const proc_list_t *plist, unsigned long long generation,
+		   int timeout_ms);
+
+/**
+ * @brief Renders the OpenMetrics text of a snapshot.
+ *
+ * The payload is kept in a reusable buffer and only re-encoded when the
+ * generation changes.
+ *
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @param length Output for the payload length.
+ * @return Payload, valid until the generation changes.
+ */
+const char *exporter_render(const proc_list_t *plist,
+			    unsigned long long generation, size_t *length);
+
+/**
+ * @brief Disconnects scrapers and stops listening.
+ */
+void exporter_close(void);
+
+#endif // EXPORTER_H
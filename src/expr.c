@@ -0,0 +1,744 @@
+/**
+ * @file expr.c
+ * @brief Compiler and evaluator of process filter expressions.
+ *
+ * Expressions are parsed once by recursive descent into a postfix program
+ * of fixed-size nodes, so matching thousands of processes per refresh
+ * needs no parsing and no allocation.
+ */
+
+#include "expr.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+enum { NODE_CMP, NODE_AND, NODE_OR, NODE_NOT };
+enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE, CMP_MATCH, CMP_NOMATCH };
+
+typedef enum { TOK_END, TOK_WORD, TOK_STRING, TOK_OP } TokenType;
+
+typedef struct {
+	TokenType type;
+	char text[EXPR_MAX_TEXT];
+} token_t;
+
+typedef struct {
+	const char *pos;            /* Next character to lex */
+	expr_t *expr;               /* Program being emitted */
+	char *error;                /* Message buffer (may be NULL) */
+	size_t error_size;
+	int failed;                 /* Set on the first error */
+} parser_t;
+
+static const struct {
+	const char *name;
+	ExprField field;
+	int is_string;
+} fields[] = {
+	{ "pid", EXPR_FIELD_PID, 0 },
+	{ "name", EXPR_FIELD_NAME, 1 },
+	{ "user", EXPR_FIELD_USER, 1 },
+	{ "mem", EXPR_FIELD_MEM, 0 },
+	{ "rss", EXPR_FIELD_MEM, 0 },
+	{ "cpu", EXPR_FIELD_CPU, 0 },
+	{ "fds", EXPR_FIELD_FDS, 0 },
+	{ "socks", EXPR_FIELD_SOCKS, 0 },
+	{ "net", EXPR_FIELD_NET, 0 },
+	{ "state", EXPR_FIELD_STATE, 1 },
+	{ "nspid", EXPR_FIELD_NSPID, 0 },
+	{ "pidns", EXPR_FIELD_PIDNS, 0 },
+	{ "mntns", EXPR_FIELD_MNTNS, 0 },
+	{ "container", EXPR_FIELD_CONTAINER, 1 },
+};
+
+static const char *const comparisons[] = {
+	"==", "!=", "<", "<=", ">", ">=", "~", "!~"
+};
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Record the first error of a parse.
+ *
+ * @param parser Parser.
+ * @param message Error message.
+ * @param detail Offending token (may be empty).
+ */
+static void fail(parser_t *parser, const char *message, const char *detail) {
+	if (parser->failed) {
+		return;
+	}
+	parser->failed = 1;
+	if (parser->error && parser->error_size > 0) {
+		snprintf(parser->error, parser->error_size, "%s%s%s%s", message,
+			 detail[0] ? " '" : "", detail, detail[0] ? "'" : "");
+	}
+}
+
+/**
+ * @brief Lex the next token.
+ *
+ * @param parser Parser.
+ * @param token Output token.
+ * @param consume If zero, the position is left unchanged (peek).
+ */
+static void lex(parser_t *parser, token_t *token, int consume) {
+	const char *p = parser->pos;
+	size_t len = 0;
+
+	while (isspace((unsigned char)*p)) {
+		p++;
+	}
+	token->text[0] = '\0';
+
+	if (!*p) {
+		token->type = TOK_END;
+	} else if (*p == '"' || *p == '\'') {
+		char quote = *p++;
+		token->type = TOK_STRING;
+		while (*p && *p != quote) {
+			if (len < sizeof(token->text) - 1) {
+				token->text[len++] = *p;
+			}
+			p++;
+		}
+		if (*p == quote) {
+			p++;
+		}
+		token->text[len] = '\0';
+	} else if (strchr("=!<>~&|()", *p)) {
+		token->type = TOK_OP;
+		token->text[len++] = *p++;
+		/* Two-character operators */
+		if ((token->text[0] == '=' && *p == '=') ||
+		    (strchr("!<>", token->text[0]) && *p == '=') ||
+		    (token->text[0] == '!' && *p == '~') ||
+		    (token->text[0] == '&' && *p == '&') ||
+		    (token->text[0] == '|' && *p == '|')) {
+			token->text[len++] = *p++;
+		}
+		token->text[len] = '\0';
+	} else {
+		token->type = TOK_WORD;
+		while (*p && !isspace((unsigned char)*p) &&
+		       !strchr("=!<>~&|()\"'", *p)) {
+			if (len < sizeof(token->text) - 1) {
+				token->text[len++] = *p;
+			}
+			p++;
+		}
+		token->text[len] = '\0';
+	}
+
+	if (consume) {
+		parser->pos = p;
+	}
+}
+
+/**
+ * @brief Check whether a token is a given keyword or operator.
+ *
+ * @param token Token.
+ * @param word Keyword (compared case-insensitively).
+ * @param op Equivalent operator.
+ * @return 1 on match.
+ */
+static int token_is(const token_t *token, const char *word, const char *op) {
+	if (token->type == TOK_WORD) {
+		return strcasecmp(token->text, word) == 0;
+	}
+	return token->type == TOK_OP && strcmp(token->text, op) == 0;
+}
+
+/**
+ * @brief Append a node to the program.
+ *
+ * @param parser Parser.
+ * @param node Node to append.
+ */
+static void emit(parser_t *parser, const expr_node_t *node) {
+	if (parser->expr->count >= EXPR_MAX_NODES) {
+		fail(parser, "expression too long", "");
+		return;
+	}
+	parser->expr->nodes[parser->expr->count++] = *node;
+}
+
+static void emit_op(parser_t *parser, int op) {
+	expr_node_t node;
+	memset(&node, 0, sizeof(node));
+	node.op = op;
+	emit(parser, &node);
+}
+
+static void parse_expr(parser_t *parser);
+
+/**
+ * @brief Parse "field op value".
+ *
+ * @param parser Parser.
+ */
+static void parse_comparison(parser_t *parser) {
+	token_t token;
+	expr_node_t node;
+	memset(&node, 0, sizeof(node));
+	node.op = NODE_CMP;
+
+	lex(parser, &token, 1);
+	if (token.type != TOK_WORD) {
+		fail(parser, "expected field name", token.text);
+		return;
+	}
+	int is_string;
+	int field = expr_field(token.text, &is_string);
+	if (field < 0) {
+		fail(parser, "unknown field", token.text);
+		return;
+	}
+	node.field = field;
+
+	lex(parser, &token, 1);
+	int cmp = -1;
+	for (size_t i = 0; token.type == TOK_OP &&
+			   i < sizeof(comparisons) / sizeof(comparisons[0]);
+	     i++) {
+		if (strcmp(token.text, comparisons[i]) == 0) {
+			cmp = (int)i;
+		}
+	}
+	if (cmp < 0) {
+		fail(parser, "expected comparison", token.text);
+		return;
+	}
+	node.cmp = cmp;
+
+	lex(parser, &token, 1);
+	if (token.type != TOK_WORD && token.type != TOK_STRING) {
+		fail(parser, "expected value", token.text);
+		return;
+	}
+
+	if (is_string) {
+		if (cmp != CMP_EQ && cmp != CMP_NE && cmp != CMP_MATCH &&
+		    cmp != CMP_NOMATCH) {
+			fail(parser, "invalid comparison for text",
+			     comparisons[cmp]);
+			return;
+		}
+		snprintf(node.text, sizeof(node.text), "%s", token.text);
+	} else {
+		if (cmp == CMP_MATCH || cmp == CMP_NOMATCH) {
+			fail(parser, "invalid comparison for number",
+			     comparisons[cmp]);
+			return;
+		}
+		if (expr_number(node.field, token.text, &node.number) < 0) {
+			fail(parser, "expected number", token.text);
+			return;
+		}
+	}
+	emit(parser, &node);
+}
+
+/**
+ * @brief Parse a negation, a parenthesized expression or a comparison.
+ *
+ * @param parser Parser.
+ */
+static void parse_unary(parser_t *parser) {
+	token_t token;
+	lex(parser, &token, 0);
+
+	if (token_is(&token, "not", "!")) {
+		lex(parser, &token, 1);
+		parse_unary(parser);
+		emit_op(parser, NODE_NOT);
+	} else if (token.type == TOK_OP && strcmp(token.text, "(") == 0) {
+		lex(parser, &token, 1);
+		parse_expr(parser);
+		lex(parser, &token, 1);
+		if (token.type != TOK_OP || strcmp(token.text, ")") != 0) {
+			fail(parser, "expected ')'", token.text);
+		}
+	} else {
+		parse_comparison(parser);
+	}
+}
+
+/**
+ * @brief Parse a chain of "and" operands.
+ *
+ * @param parser Parser.
+ */
+static void parse_term(parser_t *parser) {
+	token_t token;
+
+	parse_unary(parser);
+	for (lex(parser, &token, 0); !parser->failed &&
+				     token_is(&token, "and", "&&");
+	     lex(parser, &token, 0)) {
+		lex(parser, &token, 1);
+		parse_unary(parser);
+		emit_op(parser, NODE_AND);
+	}
+}
+
+/**
+ * @brief Parse a chain of "or" operands.
+ *
+ * @param parser Parser.
+ */
+static void parse_expr(parser_t *parser) {
+	token_t token;
+
+	parse_term(parser);
+	for (lex(parser, &token, 0); !parser->failed &&
+				     token_is(&token, "or", "||");
+	     lex(parser, &token, 0)) {
+		lex(parser, &token, 1);
+		parse_term(parser);
+		emit_op(parser, NODE_OR);
+	}
+}
+
+/**
+ * @brief Get a numeric field of a process.
+ *
+ * @param proc Process.
+ * @param field Field.
+ * @return Field value.
+ */
+static double number_of(const proc_info_t *proc, int field) {
+	switch (field) {
+	case EXPR_FIELD_PID:
+		return proc->pid;
+	case EXPR_FIELD_MEM:
+		return proc->memory;
+	case EXPR_FIELD_CPU:
+		return proc->cpu_usage;
+	case EXPR_FIELD_FDS:
+		return proc->fd_count;
+	case EXPR_FIELD_SOCKS:
+		return proc->sock_count;
+	case EXPR_FIELD_NET:
+		return proc->net_rate;
+	case EXPR_FIELD_NSPID:
+		return proc->ns_pid;
+	case EXPR_FIELD_PIDNS:
+		return proc->pid_ns;
+	case EXPR_FIELD_MNTNS:
+		return proc->mnt_ns;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Get a string field of a process.
+ *
+ * @param proc Process.
+ * @param field Field.
+ * @param state Buffer holding the state letter as a string.
+ * @return Field value, or NULL if the field is numeric.
+ */
+static const char *text_of(const proc_info_t *proc, int field,
+			   const char *state) {
+	switch (field) {
+	case EXPR_FIELD_NAME:
+		return proc->name;
+	case EXPR_FIELD_USER:
+		return proc->user;
+	case EXPR_FIELD_STATE:
+		return state;
+	case EXPR_FIELD_CONTAINER:
+		return proc->container;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * @brief Evaluate one comparison node.
+ *
+ * @param node Comparison node.
+ * @param proc Process.
+ * @return 1 if true.
+ */
+static int compare(const expr_node_t *node, const proc_info_t *proc) {
+	char state[2] = { proc->state, '\0' };
+	const char *text = text_of(proc, node->field, state);
+	if (text) {
+		switch (node->cmp) {
+		case CMP_EQ:
+			return strcmp(text, node->text) == 0;
+		case CMP_NE:
+			return strcmp(text, node->text) != 0;
+		case CMP_MATCH:
+			return strcasestr(text, node->text) != NULL;
+		default:
+			return strcasestr(text, node->text) == NULL;
+		}
+	}
+
+	double value = number_of(proc, node->field);
+	switch (node->cmp) {
+	case CMP_EQ:
+		return value == node->number;
+	case CMP_NE:
+		return value != node->number;
+	case CMP_LT:
+		return value < node->number;
+	case CMP_LE:
+		return value <= node->number;
+	case CMP_GT:
+		return value > node->number;
+	default:
+		return value >= node->number;
+	}
+}
+
+/**
+ * @brief Check whether a field holds text.
+ *
+ * @param field Field.
+ * @return 1 for string fields, 0 for numeric ones.
+ */
+static int is_text(int field) {
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if ((int)fields[i].field == field) {
+			return fields[i].is_string;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Get the results of a text comparison for every row.
+ *
+ * Results are looked up by field, operator and operand, and computed
+ * (into the frame arena) only the first time.
+ *
+ * @param columns Columns.
+ * @param node Comparison node of a text field.
+ * @return Result per row, or NULL if the arena is full.
+ */
+static const unsigned char *text_rows(expr_columns_t *columns,
+				      const expr_node_t *node) {
+	for (int i = 0; i < columns->text_count; i++) {
+		if (columns->text_results[i].field == node->field &&
+		    columns->text_results[i].cmp == node->cmp &&
+		    strcmp(columns->text_results[i].text, node->text) == 0) {
+			return columns->text_results[i].rows;
+		}
+	}
+
+	unsigned char *rows = arena_alloc(frame_arena(), columns->count + 1);
+	if (!rows) {
+		return NULL;
+	}
+	for (int row = 0; row < columns->count; row++) {
+		rows[row] = compare(node, &columns->plist->list[row]);
+	}
+	if (columns->text_count < EXPR_TEXT_RESULTS) {
+		int i = columns->text_count++;
+		columns->text_results[i].field = node->field;
+		columns->text_results[i].cmp = node->cmp;
+		memcpy(columns->text_results[i].text, node->text,
+		       sizeof(node->text));
+		columns->text_results[i].rows = rows;
+	}
+	return rows;
+}
+
+/**
+ * @brief Evaluate one comparison node for every row.
+ *
+ * Numeric fields compare a whole column in one loop per operator; string
+ * fields fall back to the per-process comparison.
+ *
+ * @param node Comparison node.
+ * @param columns Columns (numeric columns already extracted).
+ * @param out Output: 1 per row where the comparison holds.
+ */
+static void compare_rows(const expr_node_t *node, expr_columns_t *columns,
+			 unsigned char *out) {
+	int count = columns->count;
+	const double *values = columns->values[node->field];
+	double limit = node->number;
+
+	if (!values) {
+		const unsigned char *rows = text_rows(columns, node);
+		for (int row = 0; row < count; row++) {
+			out[row] = rows[row];
+		}
+		return;
+	}
+	switch (node->cmp) {
+	case CMP_EQ:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] == limit;
+		break;
+	case CMP_NE:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] != limit;
+		break;
+	case CMP_LT:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] < limit;
+		break;
+	case CMP_LE:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] <= limit;
+		break;
+	case CMP_GT:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] > limit;
+		break;
+	default:
+		for (int row = 0; row < count; row++)
+			out[row] = values[row] >= limit;
+		break;
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Look up a field by name.
+ *
+ * @param name Field name (case-insensitive).
+ * @param is_string Output: 1 for string fields (may be NULL).
+ * @return ExprField, or -1 if unknown.
+ */
+int expr_field(const char *name, int *is_string) {
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if (strcasecmp(name, fields[i].name) == 0) {
+			if (is_string) {
+				*is_string = fields[i].is_string;
+			}
+			return fields[i].field;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Parse a numeric operand of a field.
+ *
+ * @param field Field the number is compared with.
+ * @param text Operand text.
+ * @param value Output value.
+ * @return 0 on success, -1 if text is not a number.
+ */
+int expr_number(ExprField field, const char *text, double *value) {
+	static const char units[] = "KMGT";
+	char *end;
+
+	*value = strtod(text, &end);
+	if (end == text) {
+		return -1;
+	}
+	/* Sizes in kB may be given with a binary unit: 8G */
+	const char *unit = field == EXPR_FIELD_MEM && *end ?
+				   strchr(units, toupper((unsigned char)*end)) : NULL;
+	if (unit && end[1] == '\0') {
+		for (long i = unit - units; i > 0; i--) {
+			*value *= 1024;
+		}
+		end++;
+	}
+	return *end ? -1 : 0;
+}
+
+/**
+ * @brief Compile an expression into a postfix program.
+ *
+ * @param text Source text.
+ * @param expr Output program.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on a syntax error.
+ */
+int expr_compile(const char *text, expr_t *expr, char *error,
+		 size_t error_size) {
+	parser_t parser = { text ? text : "", expr, error, error_size, 0 };
+	token_t token;
+
+	expr->count = 0;
+	lex(&parser, &token, 0);
+	if (token.type == TOK_END) {
+		return 0;
+	}
+
+	parse_expr(&parser);
+	lex(&parser, &token, 1);
+	if (!parser.failed && token.type != TOK_END) {
+		fail(&parser, "unexpected", token.text);
+	}
+	if (parser.failed) {
+		expr->count = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Evaluate a compiled expression.
+ *
+ * @param expr Compiled expression.
+ * @param proc Process to test.
+ * @return 1 if the process matches, 0 otherwise.
+ */
+int expr_match(const expr_t *expr, const proc_info_t *proc) {
+	unsigned char stack[EXPR_MAX_NODES];
+	int depth = 0;
+
+	if (expr->count == 0) {
+		return 1;
+	}
+
+	for (int i = 0; i < expr->count; i++) {
+		const expr_node_t *node = &expr->nodes[i];
+		switch (node->op) {
+		case NODE_CMP:
+			stack[depth++] = compare(node, proc);
+			break;
+		case NODE_NOT:
+			stack[depth - 1] = !stack[depth - 1];
+			break;
+		case NODE_AND:
+			depth--;
+			stack[depth - 1] = stack[depth - 1] && stack[depth];
+			break;
+		default:
+			depth--;
+			stack[depth - 1] = stack[depth - 1] || stack[depth];
+			break;
+		}
+	}
+	return stack[0];
+}
+
+/**
+ * @brief Prepare the columns of a list.
+ *
+ * @param columns Columns to set up.
+ * @param plist Process list.
+ */
+void expr_columns_init(expr_columns_t *columns, const proc_list_t *plist) {
+	columns->plist = plist;
+	memset(columns->values, 0, sizeof(columns->values));
+	columns->text_count = 0;
+	columns->count = plist->count;
+}
+
+/**
+ * @brief Get the column of a numeric field.
+ *
+ * @param columns Columns.
+ * @param field Numeric field.
+ * @return One value per row, or NULL.
+ */
+const double *expr_column(expr_columns_t *columns, ExprField field) {
+	if (field >= EXPR_FIELD_COUNT || is_text(field)) {
+		return NULL;
+	}
+	if (!columns->values[field]) {
+		double *values = arena_alloc(frame_arena(), (columns->count + 1) *
+						    sizeof(double));
+		if (!values) {
+			return NULL;
+		}
+		for (int i = 0; i < columns->count; i++) {
+			values[i] = number_of(&columns->plist->list[i], field);
+		}
+		columns->values[field] = values;
+	}
+	return columns->values[field];
+}
+
+/**
+ * @brief Evaluate an expression against every row at once.
+ *
+ * @param expr Compiled expression.
+ * @param columns Columns of the list.
+ * @param out Output: 1 per matching row.
+ * @return Number of matching rows, or -1 if the frame arena is full.
+ */
+int expr_match_columns(const expr_t *expr, expr_columns_t *columns,
+		       unsigned char *out) {
+	int count = columns->count;
+	int depth = 0;
+	int max_depth = 0;
+
+	if (expr->count == 0 || count == 0) {
+		memset(out, expr->count == 0, count);
+		return expr->count == 0 ? count : 0;
+	}
+
+	/* Columns and text results first: they outlive the scratch stack */
+	for (int i = 0; i < expr->count; i++) {
+		const expr_node_t *node = &expr->nodes[i];
+		if (node->op == NODE_CMP) {
+			if (is_text(node->field) ? !text_rows(columns, node) :
+						   !expr_column(columns, node->field)) {
+				return -1;
+			}
+			if (++depth > max_depth) {
+				max_depth = depth;
+			}
+		} else if (node->op != NODE_NOT) {
+			depth--;
+		}
+	}
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	unsigned char *stack = arena_alloc(arena, (size_t)max_depth * count);
+	if (!stack) {
+		return -1;
+	}
+
+	depth = 0;
+	for (int i = 0; i < expr->count; i++) {
+		const expr_node_t *node = &expr->nodes[i];
+		unsigned char *top = stack + (size_t)depth * count;
+		unsigned char *below = top - count;
+		switch (node->op) {
+		case NODE_CMP:
+			compare_rows(node, columns, top);
+			depth++;
+			break;
+		case NODE_NOT:
+			for (int row = 0; row < count; row++) {
+				below[row] ^= 1;
+			}
+			break;
+		case NODE_AND:
+			depth--;
+			below -= count;
+			for (int row = 0; row < count; row++) {
+				below[row] &= below[row + count];
+			}
+			break;
+		default:
+			depth--;
+			below -= count;
+			for (int row = 0; row < count; row++) {
+				below[row] |= below[row + count];
+			}
+			break;
+		}
+	}
+
+	int matches = 0;
+	for (int row = 0; row < count; row++) {
+		out[row] = stack[row];
+		matches += stack[row];
+	}
+	arena_rewind(arena, mark);
+	return matches;
+}
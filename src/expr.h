@@ -0,0 +1,171 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "proc.h"
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of nodes in a compiled expression.
+ */
+#define EXPR_MAX_NODES 64
+
+/**
+ * @brief Maximum length of a string operand.
+ */
+#define EXPR_MAX_TEXT 64
+
+/**
+ * @brief Text comparisons whose results are shared between expressions.
+ */
+#define EXPR_TEXT_RESULTS 32
+
+/**
+ * @brief Process fields an expression can test.
+ */
+typedef enum {
+	EXPR_FIELD_PID,     /**< pid */
+	EXPR_FIELD_NAME,    /**< name (string) */
+	EXPR_FIELD_USER,    /**< user (string) */
+	EXPR_FIELD_MEM,     /**< mem, RSS in kB */
+	EXPR_FIELD_CPU,     /**< cpu, percent */
+	EXPR_FIELD_FDS,     /**< fds, open descriptors */
+	EXPR_FIELD_SOCKS,   /**< socks, open sockets */
+	EXPR_FIELD_NET,     /**< net, kB/s */
+	EXPR_FIELD_STATE,   /**< state, letter from /proc/[pid]/stat (string) */
+	EXPR_FIELD_NSPID,   /**< nspid, PID inside its own PID namespace */
+	EXPR_FIELD_PIDNS,   /**< pidns, PID namespace inode */
+	EXPR_FIELD_MNTNS,   /**< mntns, mount namespace inode */
+	EXPR_FIELD_CONTAINER, /**< container, short container id (string) */
+	EXPR_FIELD_COUNT    /**< Number of fields */
+} ExprField;
+
+/**
+ * @brief One node of a compiled expression (postfix order).
+ */
+typedef struct {
+	unsigned char op;           /**< Comparison, and, or, not */
+	unsigned char field;        /**< ExprField of a comparison */
+	unsigned char cmp;          /**< Comparison operator */
+	double number;              /**< Numeric operand */
+	char text[EXPR_MAX_TEXT];   /**< String operand */
+} expr_node_t;
+
+/**
+ * @brief Compiled filter expression.
+ *
+ * Grammar (keywords are case-insensitive):
+ *
+ *     expr  := term { ("or" | "||") term }
+ *     term  := unary { ("and" | "&&") unary }
+ *     unary := ("not" | "!") unary | "(" expr ")" | field op value
+ *     op    := "==" | "!=" | "<" | "<=" | ">" | ">=" | "~" | "!~"
+ *
+ * Fields: pid name user mem (alias rss) cpu fds socks net state nspid
+ * pidns mntns container. String fields support ==, != (exact) and ~, !~
+ * (case-insensitive substring); values may be quoted. mem is in kB and
+ * accepts K, M, G and T suffixes ("mem > 8G"). An empty expression
+ * matches every process.
+ */
+typedef struct {
+	expr_node_t nodes[EXPR_MAX_NODES];  /**< Program in postfix order */
+	int count;                          /**< Number of nodes */
+} expr_t;
+
+/**
+ * @brief Compiles an expression.
+ *
+ * @param text Source text.
+ * @param expr Output program.
+ * @param error Output for a message on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on a syntax error.
+ */
+int expr_compile(const char *text, expr_t *expr, char *error,
+		 size_t error_size);
+
+/**
+ * @brief Looks up a field by name.
+ *
+ * @param name Field name as written in expressions.
+ * @param is_string Output: 1 for string fields (may be NULL).
+ * @return ExprField, or -1 if there is no such field.
+ */
+int expr_field(const char *name, int *is_string);
+
+/**
+ * @brief Parses a numeric operand of a field.
+ *
+ * mem accepts a K, M, G or T suffix (binary multiples of its kB unit).
+ *
+ * @param field Field the number is compared with.
+ * @param text Operand text.
+ * @param value Output value.
+ * @return 0 on success, -1 if text is not a number.
+ */
+int expr_number(ExprField field, const char *text, double *value);
+
+/**
+ * @brief Evaluates a compiled expression against a process.
+ *
+ * @param expr Compiled expression.
+ * @param proc Process to test.
+ * @return 1 if the process matches, 0 otherwise.
+ */
+int expr_match(const expr_t *expr, const proc_info_t *proc);
+
+/**
+ * @brief Numeric fields of a process list, one contiguous array per field.
+ *
+ * A column is extracted from the list on its first use and then shared by
+ * every expression evaluated over the same columns, so many expressions
+ * cost one pass over the list per field plus tight loops over arrays.
+ * Results of text comparisons are kept the same way, so rules repeating
+ * "user == build" compare the strings once.
+ * Arrays live in the frame arena and are valid until it is reset.
+ */
+typedef struct {
+	const proc_list_t *plist;            /**< Source list */
+	int count;                           /**< Rows (plist->count) */
+	double *values[EXPR_FIELD_COUNT];    /**< Extracted columns (or NULL) */
+	struct {
+		unsigned char field;         /**< ExprField */
+		unsigned char cmp;           /**< Comparison */
+		char text[EXPR_MAX_TEXT];    /**< Operand */
+		unsigned char *rows;         /**< Result per row */
+	} text_results[EXPR_TEXT_RESULTS];  /**< Evaluated text comparisons */
+	int text_count;                      /**< Entries in text_results */
+} expr_columns_t;
+
+/**
+ * @brief Prepares columns of a list (nothing is extracted yet).
+ *
+ * @param columns Columns to set up.
+ * @param plist Process list.
+ */
+void expr_columns_init(expr_columns_t *columns, const proc_list_t *plist);
+
+/**
+ * @brief Gets the column of a numeric field, extracting it if needed.
+ *
+ * @param columns Columns.
+ * @param field Numeric field.
+ * @return One value per row, or NULL for a string field or a full arena.
+ */
+const double *expr_column(expr_columns_t *columns, ExprField field);
+
+/**
+ * @brief Evaluates an expression against every row at once.
+ *
+ * Each node of the program runs over all rows before the next one, so a
+ * comparison is a loop over one column instead of a walk of the program
+ * per process. Gives the same result as expr_match() on each row.
+ *
+ * @param expr Compiled expression.
+ * @param columns Columns of the list.
+ * @param out Output: 1 per matching row, 0 otherwise (columns->count bytes).
+ * @return Number of matching rows, or -1 if the frame arena is full.
+ */
+int expr_match_columns(const expr_t *expr, expr_columns_t *columns,
+		       unsigned char *out);
+
+#endif // EXPR_H
@@ -0,0 +1,289 @@
+/**
+ * @file fdscan.c
+ * @brief Budgeted, rotating sampling of open descriptor and socket counts.
+ */
+
+#include "fdscan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/* Reused for every directory, so counting never allocates */
+static char dents_buffer[32768];
+
+static pid_t cursor = 0;   /* Last PID sampled by the rotation */
+
+/* Sockets seen by the last fdscan_update(), in walk order */
+static fdscan_socket_t found[FDSCAN_SOCKETS];
+static int found_count = 0;
+
+/* A walk stopped by the budget, resumed on the next refresh */
+static struct {
+	int dir_fd;                     /* -1 if none */
+	pid_t pid;
+	unsigned long long start_time;  /* Detects a reused PID */
+	int count;                      /* Descriptors counted so far */
+	int sockets;                    /* Sockets counted so far */
+} partial = { .dir_fd = -1 };
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Find the list position where the rotation resumes.
+ *
+ * @param plist Process list (sorted by PID).
+ * @return Index of the first process after the cursor, 0 to wrap around.
+ */
+static int rotation_start(const proc_list_t *plist) {
+	for (int i = 0; i < plist->count; i++) {
+		if (plist->list[i].pid > cursor) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Open the descriptor directory of a process.
+ *
+ * @param pid Process ID.
+ * @return Directory descriptor, or -1 if not permitted.
+ */
+static int open_fd_dir(pid_t pid) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/fd", proc_root(), pid);
+	return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/**
+ * @brief Read entries of an open descriptor directory, counting them.
+ *
+ * Reads whole getdents64 chunks until the directory ends or at least
+ * @p budget entries were read, so a walk stopped by the budget can go on
+ * from the directory offset later.
+ *
+ * @param dir_fd Directory opened by open_fd_dir().
+ * @param count In/out: descriptors counted so far.
+ * @param sockets In/out: sockets counted so far (NULL to skip readlinkat).
+ * @param owner Process whose sockets are added to found[] (0: none).
+ * @param budget Entries to read at most (rounded up to a chunk, -1: all).
+ * @return 1 when the directory was read to the end, 0 if the budget ran out.
+ */
+static int walk_entries(int dir_fd, int *count, int *sockets, pid_t owner,
+			long budget) {
+	long read = 0;
+	long n;
+	while (budget < 0 || read < budget) {
+		n = getdents64(dir_fd, dents_buffer, sizeof(dents_buffer));
+		if (n <= 0) {
+			return 1;
+		}
+		for (long off = 0; off < n;) {
+			struct dirent64 *entry =
+				(struct dirent64 *)(dents_buffer + off);
+			off += entry->d_reclen;
+
+			if (entry->d_name[0] == '.') {
+				continue;
+			}
+			(*count)++;
+			read++;
+
+			if (!sockets) {
+				continue;
+			}
+
+			/* Target is "socket:[inode]" */
+			char link[32];
+			ssize_t len = readlinkat(dir_fd, entry->d_name,
+						 link, sizeof(link) - 1);
+			if (len < 7 || memcmp(link, "socket:", 7) != 0) {
+				continue;
+			}
+			if (owner && found_count < FDSCAN_SOCKETS) {
+				link[len] = '\0';
+				found[found_count].inode =
+					strtoul(link + 8, NULL, 10);
+				found[found_count].pid = owner;
+				found_count++;
+			}
+			(*sockets)++;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Walk /proc/[pid]/fd, counting descriptors and sockets.
+ *
+ * @param pid Process ID.
+ * @param sockets Output for the number of sockets (NULL to skip readlinkat).
+ * @return Number of open descriptors, or -1 if not permitted.
+ */
+static int walk_fds(pid_t pid, int *sockets) {
+	int dir_fd = open_fd_dir(pid);
+	if (dir_fd < 0) {
+		return -1;
+	}
+
+	int count = 0;
+	int sock_count = 0;
+	walk_entries(dir_fd, &count, sockets ? &sock_count : NULL, 0, -1);
+	close(dir_fd);
+
+	if (sockets) {
+		*sockets = sock_count;
+	}
+	return count;
+}
+
+/**
+ * @brief Forget an unfinished walk.
+ */
+static void drop_partial(void) {
+	if (partial.dir_fd >= 0) {
+		close(partial.dir_fd);
+	}
+	partial.dir_fd = -1;
+}
+
+/**
+ * @brief Go on with a walk for up to a budget of entries.
+ *
+ * On completion the counts are stored in the process's row. Sockets
+ * read on the way are added to found[].
+ *
+ * @param proc Process of the walk.
+ * @param budget Entries to read at most.
+ * @param now Current time.
+ * @return Entries read.
+ */
+static long continue_partial(proc_info_t *proc, long budget, time_t now) {
+	int before = partial.count;
+	int done = walk_entries(partial.dir_fd, &partial.count,
+				&partial.sockets, proc->pid, budget);
+	long spent = partial.count - before;
+
+	if (done) {
+		proc->fd_count = partial.count;
+		proc->sock_count = partial.sockets;
+		proc->fd_sampled = now;
+		drop_partial();
+	}
+	cursor = proc->pid;
+	return spent;
+}
+
+/**
+ * @brief Find a process of the list by PID.
+ *
+ * @param plist Process list (sorted by PID).
+ * @param pid Process ID.
+ * @return Entry, or NULL if not listed.
+ */
+static proc_info_t *find_process(proc_list_t *plist, pid_t pid) {
+	int low = 0, high = plist->count - 1;
+	while (low <= high) {
+		int mid = low + (high - low) / 2;
+		if (plist->list[mid].pid == pid) {
+			return &plist->list[mid];
+		}
+		if (plist->list[mid].pid < pid) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return NULL;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Count open descriptors and sockets of a process.
+ *
+ * @param pid Process ID.
+ * @param sockets Output for the number of sockets (may be NULL).
+ * @return Number of open descriptors, or -1 if not permitted.
+ */
+int fdscan_count(pid_t pid, int *sockets) {
+	return walk_fds(pid, sockets);
+}
+
+/**
+ * @brief Return the sockets seen by the last fdscan_update().
+ *
+ * @param count Output for the number of entries.
+ * @return Sockets with the PID holding them, in walk order.
+ */
+const fdscan_socket_t *fdscan_sockets(int *count) {
+	*count = found_count;
+	return found;
+}
+
+/**
+ * @brief Restart the rotation.
+ */
+void fdscan_init(void) {
+	cursor = 0;
+	found_count = 0;
+	drop_partial();
+}
+
+/**
+ * @brief Sample the next processes in rotation and update fd ages.
+ *
+ * Samples are stored in the list entries themselves; the collector carries
+ * them forward for surviving processes.
+ *
+ * @param plist Freshly updated process list.
+ */
+void fdscan_update(proc_list_t *plist) {
+	time_t now = time(NULL);
+	long spent = 0;
+
+	found_count = 0;
+
+	/* First finish the walk the previous refresh ran out of budget in */
+	if (partial.dir_fd >= 0) {
+		proc_info_t *proc = find_process(plist, partial.pid);
+		if (proc && proc->start_time == partial.start_time) {
+			spent = continue_partial(proc, FDSCAN_BUDGET, now);
+		} else {
+			drop_partial();
+		}
+	}
+
+	/* Rotating schedule: continue after the last sampled PID */
+	int start = rotation_start(plist);
+	for (int k = 0; k < plist->count && partial.dir_fd < 0 &&
+			spent < FDSCAN_BUDGET; k++) {
+		proc_info_t *proc = &plist->list[(start + k) % plist->count];
+		/* Opening the directory counts as one entry */
+		spent++;
+		int dir_fd = open_fd_dir(proc->pid);
+		if (dir_fd < 0) {
+			proc->fd_count = -1;
+			proc->sock_count = -1;
+			proc->fd_sampled = now;
+			cursor = proc->pid;
+			continue;
+		}
+		partial.dir_fd = dir_fd;
+		partial.pid = proc->pid;
+		partial.start_time = proc->start_time;
+		partial.count = 0;
+		partial.sockets = 0;
+		spent += continue_partial(proc, FDSCAN_BUDGET - spent, now);
+	}
+
+	for (int i = 0; i < plist->count; i++) {
+		proc_info_t *proc = &plist->list[i];
+		proc->fd_age = proc->fd_sampled ?
+			       (int)(now - proc->fd_sampled) : -1;
+	}
+}
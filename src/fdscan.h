@@ -0,0 +1,76 @@
+#ifndef FDSCAN_H
+#define FDSCAN_H
+
+#include "proc.h"
+
+/**
+ * @brief Maximum number of descriptor entries inspected per refresh.
+ *
+ * Counting is spread over several refreshes on a rotating schedule so a
+ * handful of processes with 100k descriptors cannot stall the UI. The
+ * budget is also checked inside a process's directory, after every
+ * getdents64 chunk: a walk that runs out goes on where it stopped on the
+ * next refresh, so one refresh reads at most the budget plus one chunk.
+ */
+#define FDSCAN_BUDGET 20000
+
+/**
+ * @brief Maximum number of sockets reported by one fdscan_update().
+ *
+ * One refresh reads at most the budget plus one getdents64 chunk, so this
+ * covers every socket it can see.
+ */
+#define FDSCAN_SOCKETS 32768
+
+/**
+ * @brief A socket seen by the rotation and the process holding it.
+ */
+typedef struct {
+	unsigned long inode;        /**< Socket inode */
+	pid_t pid;                  /**< Process holding a descriptor to it */
+} fdscan_socket_t;
+
+/**
+ * @brief Counts open descriptors and sockets of a process.
+ *
+ * Reads /proc/[pid]/fd with getdents64 into a reusable buffer and checks
+ * each entry with a single readlinkat (no stat per entry).
+ *
+ * @param pid Process ID.
+ * @param sockets Output for the number of sockets (may be NULL).
+ * @return Number of open descriptors, or -1 if the directory cannot be read.
+ */
+int fdscan_count(pid_t pid, int *sockets);
+
+/**
+ * @brief Returns the sockets seen by the last fdscan_update().
+ *
+ * Every socket descriptor the rotation read in that call (up to
+ * FDSCAN_SOCKETS), with the PID holding it. A socket shared by several
+ * processes appears once per holder.
+ *
+ * @param count Output for the number of entries.
+ * @return Sockets in walk order (valid until the next fdscan_update()).
+ */
+const fdscan_socket_t *fdscan_sockets(int *count);
+
+/**
+ * @brief Restarts the rotation from the lowest PID.
+ */
+void fdscan_init(void);
+
+/**
+ * @brief Samples the next processes in rotation and fills fd columns.
+ *
+ * Spends up to FDSCAN_BUDGET descriptor entries, first on the walk left
+ * unfinished by the previous call (dropped if that process exited), then
+ * on the next processes in rotation. fd_count, sock_count and fd_sampled
+ * are written when a walk completes; fd_age is then updated for every
+ * process. The sockets read are kept for fdscan_sockets(). Entries not sampled keep the values carried forward from the
+ * previous frame by the collector.
+ *
+ * @param plist Freshly updated process list (sorted by PID).
+ */
+void fdscan_update(proc_list_t *plist);
+
+#endif // FDSCAN_H
@@ -0,0 +1,165 @@
+/**
+ * @file group.c
+ * @brief Per-frame aggregation of processes by name.
+ */
+
+#include "group.h"
+#include "sort.h"
+#include <string.h>
+
+/* Open-addressing table; holds group index + 1, 0 marks a free slot */
+#define GROUP_INDEX_SIZE (2 * MAX_PROCESSES)
+
+static unsigned short group_index[GROUP_INDEX_SIZE];
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Comparator for Name sorting (alphabetical).
+ *
+ * @param a Pointer to first group.
+ * @param b Pointer to second group.
+ * @return Result of strcmp (negative, zero, or positive).
+ */
+static int compare_name(const void *a, const void *b) {
+	return strcmp(((const proc_group_t *)a)->name,
+		      ((const proc_group_t *)b)->name);
+}
+
+/**
+ * @brief Comparator for process count sorting (descending).
+ *
+ * @param a Pointer to first group.
+ * @param b Pointer to second group.
+ * @return Positive if b has more processes, negative if fewer, zero if equal.
+ */
+static int compare_count(const void *a, const void *b) {
+	return ((const proc_group_t *)b)->count -
+	       ((const proc_group_t *)a)->count;
+}
+
+/**
+ * @brief Comparator for Memory sorting (descending).
+ *
+ * @param a Pointer to first group.
+ * @param b Pointer to second group.
+ * @return Positive if b > a (larger first), negative if b < a, zero if equal.
+ */
+static int compare_mem(const void *a, const void *b) {
+	long ma = ((const proc_group_t *)a)->memory;
+	long mb = ((const proc_group_t *)b)->memory;
+	return (mb > ma) - (mb < ma);
+}
+
+/**
+ * @brief Comparator for CPU usage sorting (descending).
+ *
+ * @param a Pointer to first group.
+ * @param b Pointer to second group.
+ * @return Positive if b > a (larger first), negative if b < a, zero if equal.
+ */
+static int compare_cpu(const void *a, const void *b) {
+	double ca = ((const proc_group_t *)a)->cpu_usage;
+	double cb = ((const proc_group_t *)b)->cpu_usage;
+	return (cb > ca) - (cb < ca);
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Collapse processes with the same name into groups.
+ *
+ * @param plist Processes to group.
+ * @param groups Output groups.
+ */
+void group_by_name(const proc_list_t *plist, group_list_t *groups) {
+	memset(group_index, 0, sizeof(group_index));
+	groups->count = 0;
+
+	for (int i = 0; i < plist->count; i++) {
+		const proc_info_t *proc = &plist->list[i];
+		unsigned int slot = proc->name_hash % GROUP_INDEX_SIZE;
+		proc_group_t *group = NULL;
+
+		while (group_index[slot]) {
+			proc_group_t *candidate =
+				&groups->list[group_index[slot] - 1];
+			if (candidate->name_hash == proc->name_hash &&
+			    strcmp(candidate->name, proc->name) == 0) {
+				group = candidate;
+				break;
+			}
+			slot = (slot + 1) % GROUP_INDEX_SIZE;
+		}
+
+		if (!group) {
+			group = &groups->list[groups->count++];
+			group_index[slot] = (unsigned short)groups->count;
+			memset(group, 0, sizeof(*group));
+			group->name = proc->name;
+			group->name_hash = proc->name_hash;
+			group->memory_min = proc->memory;
+			group->memory_max = proc->memory;
+			group->cpu_min = proc->cpu_usage;
+			group->cpu_max = proc->cpu_usage;
+		}
+
+		group->count++;
+		group->threads += proc->threads;
+		group->memory += proc->memory;
+		group->cpu_usage += proc->cpu_usage;
+		if (proc->memory < group->memory_min)
+			group->memory_min = proc->memory;
+		if (proc->memory > group->memory_max)
+			group->memory_max = proc->memory;
+		if (proc->cpu_usage < group->cpu_min)
+			group->cpu_min = proc->cpu_usage;
+		if (proc->cpu_usage > group->cpu_max)
+			group->cpu_max = proc->cpu_usage;
+	}
+}
+
+/**
+ * @brief Keep only the members of one group.
+ *
+ * @param plist List filtered in place.
+ * @param name_hash Hash of the group's name.
+ * @param name Name of the group.
+ */
+void group_members(proc_list_t *plist, unsigned int name_hash,
+		   const char *name) {
+	int kept = 0;
+	for (int i = 0; i < plist->count; i++) {
+		if (plist->list[i].name_hash == name_hash &&
+		    strcmp(plist->list[i].name, name) == 0) {
+			plist->list[kept++] = plist->list[i];
+		}
+	}
+	plist->count = kept;
+}
+
+/**
+ * @brief Sort groups in place.
+ *
+ * @param groups Groups to sort.
+ * @param type Sort criteria.
+ */
+void group_sort(group_list_t *groups, GroupSort type) {
+	int (*compare)(const void *, const void *);
+
+	switch (type) {
+	case GROUP_SORT_COUNT:
+		compare = compare_count;
+		break;
+	case GROUP_SORT_MEM:
+		compare = compare_mem;
+		break;
+	case GROUP_SORT_CPU:
+		compare = compare_cpu;
+		break;
+	default:
+		compare = compare_name;
+		break;
+	}
+	sort_array(groups->list, groups->count, sizeof(proc_group_t), compare);
+}
@@ -0,0 +1,69 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include "proc.h"
+
+/**
+ * @brief Enumeration defining sort criteria of the grouped view.
+ */
+typedef enum {
+	GROUP_SORT_NAME,   /**< Sort by name (Alphabetical) */
+	GROUP_SORT_COUNT,  /**< Sort by number of processes (Descending) */
+	GROUP_SORT_MEM,    /**< Sort by total RSS (Descending) */
+	GROUP_SORT_CPU     /**< Sort by total CPU usage (Descending) */
+} GroupSort;
+
+/**
+ * @brief Processes sharing one name.
+ */
+typedef struct {
+	const char *name;           /**< Name (points into the grouped list) */
+	unsigned int name_hash;     /**< Grouping key */
+	int count;                  /**< Number of processes */
+	int threads;                /**< Sum of thread counts */
+	long memory;                /**< Sum of RSS in kB */
+	long memory_min;            /**< Smallest RSS of a member */
+	long memory_max;            /**< Largest RSS of a member */
+	double cpu_usage;           /**< Sum of CPU usage percentages */
+	float cpu_min;              /**< Lowest CPU usage of a member */
+	float cpu_max;              /**< Highest CPU usage of a member */
+} proc_group_t;
+
+/**
+ * @brief Container structure for the groups of one frame.
+ */
+typedef struct {
+	proc_group_t list[MAX_PROCESSES]; /**< Groups in order of first member */
+	int count;                        /**< Number of groups */
+} group_list_t;
+
+/**
+ * @brief Collapses processes with the same name into groups.
+ *
+ * One pass over the list with a hash table keyed by name_hash (names are
+ * compared only when hashes are equal).
+ *
+ * @param plist Processes to group; must outlive groups (names point into it).
+ * @param groups Output groups.
+ */
+void group_by_name(const proc_list_t *plist, group_list_t *groups);
+
+/**
+ * @brief Keeps only the members of one group.
+ *
+ * @param plist List filtered in place.
+ * @param name_hash Hash of the group's name.
+ * @param name Name of the group.
+ */
+void group_members(proc_list_t *plist, unsigned int name_hash,
+		   const char *name);
+
+/**
+ * @brief Sorts groups in place.
+ *
+ * @param groups Groups to sort.
+ * @param type Sort criteria.
+ */
+void group_sort(group_list_t *groups, GroupSort type);
+
+#endif // GROUP_H
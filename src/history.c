@@ -0,0 +1,158 @@
+/**
+ * @file history.c
+ * @brief Per-process sample history stored in a pooled ring allocator.
+ */
+
+#include "history.h"
+#include "pidmap.h"
+#include "sort.h"
+#include <stdlib.h>
+#include <string.h>
+
+static history_ring_t pool[MAX_PROCESSES];
+static pidmap_t index_map;
+
+/* PIDs that own a ring, sorted; double-buffered between updates */
+static pid_t tracked_a[MAX_PROCESSES];
+static pid_t tracked_b[MAX_PROCESSES];
+static pid_t *tracked = tracked_a;
+static int tracked_count = 0;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Comparator for sorting PIDs (ascending).
+ *
+ * @param a Pointer to first PID.
+ * @param b Pointer to second PID.
+ * @return Negative if a < b, positive if a > b, zero if equal.
+ */
+static int compare_pid_value(const void *a, const void *b) {
+	pid_t pa = *(const pid_t *)a;
+	pid_t pb = *(const pid_t *)b;
+	return (pa > pb) - (pa < pb);
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Release every ring and clear the PID index.
+ */
+void history_init(void) {
+	memset(pool, 0, sizeof(pool));
+	pidmap_init(&index_map);
+	tracked_count = 0;
+}
+
+/**
+ * @brief Append current samples of all processes to their rings.
+ *
+ * The PIDs of the list (already sorted when coming from the collector) are
+ * merge-joined with the PIDs tracked last time, so rings of exited
+ * processes are released in one linear pass before new PIDs need a slot.
+ *
+ * @param plist Freshly updated process list.
+ */
+void history_update(const proc_list_t *plist) {
+	pid_t *current = (tracked == tracked_a) ? tracked_b : tracked_a;
+	int sorted = 1;
+
+	for (int i = 0; i < plist->count; i++) {
+		current[i] = plist->list[i].pid;
+		if (i > 0 && current[i] < current[i - 1]) {
+			sorted = 0;
+		}
+	}
+	if (!sorted) {
+		sort_array(current, plist->count, sizeof(pid_t),
+			   compare_pid_value);
+	}
+
+	int t = 0;
+	for (int i = 0; i < plist->count; i++) {
+		while (t < tracked_count && tracked[t] < current[i]) {
+			pidmap_release(&index_map, tracked[t++]);
+		}
+		if (t < tracked_count && tracked[t] == current[i]) {
+			t++;
+		}
+	}
+	while (t < tracked_count) {
+		pidmap_release(&index_map, tracked[t++]);
+	}
+	tracked = current;
+	tracked_count = plist->count;
+
+	for (int i = 0; i < plist->count; i++) {
+		const proc_info_t *proc = &plist->list[i];
+		int created;
+		int slot = pidmap_acquire(&index_map, proc->pid, &created);
+		if (slot < 0) {
+			continue;
+		}
+
+		history_ring_t *ring = &pool[slot];
+		if (created) {
+			memset(ring, 0, sizeof(*ring));
+			ring->pid = proc->pid;
+		}
+		ring->cpu[ring->head] = proc->cpu_usage;
+		ring->memory[ring->head] = proc->memory;
+		ring->head = (ring->head + 1) % HISTORY_LEN;
+		if (ring->count < HISTORY_LEN) {
+			ring->count++;
+		}
+	}
+}
+
+/**
+ * @brief Look up the ring of a process.
+ *
+ * @param pid Process ID.
+ * @return Pointer to the ring, or NULL if the PID has no history.
+ */
+const history_ring_t *history_lookup(pid_t pid) {
+	int slot = pidmap_find(&index_map, pid);
+	return (slot >= 0) ? &pool[slot] : NULL;
+}
+
+/**
+ * @brief Copy ring samples oldest-first, normalized to 0..1.
+ *
+ * @param ring Ring to read.
+ * @param kind Metric to extract.
+ * @param out Output array of at least HISTORY_LEN elements.
+ * @return Number of samples written.
+ */
+int history_samples(const history_ring_t *ring, HistoryKind kind, float *out) {
+	if (!ring || kind == HISTORY_NONE) {
+		return 0;
+	}
+
+	int start = (ring->head - ring->count + HISTORY_LEN) % HISTORY_LEN;
+	long mem_peak = 1;
+
+	if (kind == HISTORY_MEM) {
+		for (int i = 0; i < ring->count; i++) {
+			long value = ring->memory[(start + i) % HISTORY_LEN];
+			if (value > mem_peak) {
+				mem_peak = value;
+			}
+		}
+	}
+
+	for (int i = 0; i < ring->count; i++) {
+		int idx = (start + i) % HISTORY_LEN;
+		float value = (kind == HISTORY_CPU) ?
+			      ring->cpu[idx] / 100.0f :
+			      (float)ring->memory[idx] / (float)mem_peak;
+		if (value < 0.0f) {
+			value = 0.0f;
+		}
+		if (value > 1.0f) {
+			value = 1.0f;
+		}
+		out[i] = value;
+	}
+	return ring->count;
+}
@@ -0,0 +1,68 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "proc.h"
+
+/**
+ * @brief Number of samples kept per process (one per refresh).
+ */
+#define HISTORY_LEN 16
+
+/**
+ * @brief Enumeration of metrics that can be drawn as a sparkline.
+ */
+typedef enum {
+	HISTORY_NONE, /**< Sparkline column hidden */
+	HISTORY_CPU,  /**< CPU usage history */
+	HISTORY_MEM   /**< Resident memory history */
+} HistoryKind;
+
+/**
+ * @brief Fixed-capacity ring of recent samples for one process.
+ *
+ * Rings live in a preallocated pool, so recording history never calls malloc.
+ */
+typedef struct {
+	pid_t pid;                  /**< Owner PID, 0 if the slot is free */
+	int head;                   /**< Index of the next sample to write */
+	int count;                  /**< Number of valid samples (<= HISTORY_LEN) */
+	float cpu[HISTORY_LEN];     /**< CPU usage samples (percent) */
+	long memory[HISTORY_LEN];   /**< RSS samples (kB) */
+} history_ring_t;
+
+/**
+ * @brief Releases every ring and clears the PID index.
+ */
+void history_init(void);
+
+/**
+ * @brief Appends the current sample of every process to its ring.
+ *
+ * Rings of processes that are no longer present are returned to the pool.
+ *
+ * @param plist Freshly updated process list.
+ */
+void history_update(const proc_list_t *plist);
+
+/**
+ * @brief Looks up the ring of a process.
+ *
+ * @param pid Process ID.
+ * @return Pointer to the ring, or NULL if the PID has no history.
+ */
+const history_ring_t *history_lookup(pid_t pid);
+
+/**
+ * @brief Copies samples of a ring in chronological order, normalized to 0..1.
+ *
+ * CPU samples are scaled against 100%, memory samples against the largest
+ * sample in the ring.
+ *
+ * @param ring Ring to read.
+ * @param kind Metric to extract.
+ * @param out Output array of at least HISTORY_LEN elements.
+ * @return Number of samples written.
+ */
+int history_samples(const history_ring_t *ring, HistoryKind kind, float *out);
+
+#endif // HISTORY_H
@@ -9,47 +9,547 @@
 #include "proc.h"
 #include "ui.h"
 #include "sort.h"
+#include "history.h"
+#include "detail.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "query.h"
+#include "exporter.h"
+#include "rollup.h"
+#include "group.h"
+#include "columns.h"
+#include "rules.h"
+#include "policy.h"
+#include "budget.h"
+#include "recording.h"
+#include "diff.h"
+#include "clock.h"
 #include <ncurses.h>
 #include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include <limits.h>
+
+/* Seconds between refreshes of the browser (keys do not refresh) */
+#define TUI_REFRESH_INTERVAL 1.0
+
+/* Set by SIGINT/SIGTERM in --serve mode */
+static volatile sig_atomic_t stop_serving = 0;
 
 /**
- * @brief Main application function
+ * @brief Signal handler requesting a clean daemon shutdown.
+ *
+ * @param sig Signal number (unused).
+ */
+static void handle_stop(int sig) {
+	(void)sig;
+	stop_serving = 1;
+}
+
+/**
+ * @brief Read the wall clock.
+ *
+ * @return Milliseconds since the epoch.
+ */
+static int64_t wall_clock_ms(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Print command-line usage.
+ *
+ * @param out Stream to print to.
+ */
+static void usage(FILE *out) {
+	fprintf(out,
+		"Usage: pb [--serve] [--exporter] [--attach | --query REQUEST]\n"
+		"          [--socket PATH] [--port N] [--columns LIST] [--ansi]\n"
+		"          [--rules FILE] [--policy FILE [--dry-run] [--audit FILE]]\n"
+		"          [--cpu-budget PCT] [--proc-root DIR]\n"
+		"          [--record FILE [--record-interval DUR]]\n"
+		"       pb --diff FILE[@TIME] [FILE]@TIME [--text] [--ansi]\n"
+		"  (no option)  interactive process browser\n"
+		"  --serve      collect once per second, publish snapshots to\n"
+		"               shared memory (%s) and answer queries\n"
+		"  --attach     browse the snapshots of a running --serve\n"
+		"               instead of reading /proc\n"
+		"  --query REQ  send a request to a running --serve and print\n"
+		"               the JSON response, e.g. \"top 5 cpu\",\n"
+		"               \"filter cpu > 10 and user == root\", \"pid 1\",\n"
+		"               \"history 1\"\n"
+		"  --socket P   query socket path (default %s)\n"
+		"  --exporter   serve Prometheus metrics on 127.0.0.1 (can be\n"
+		"               combined with --serve)\n"
+		"  --port N     metrics port (default %d)\n"
+		"  --columns L  visible columns in order, comma-separated\n"
+		"               (default %s; available: %s)\n"
+		"  --ansi       draw with plain ANSI escapes instead of ncurses\n"
+		"  --rules F    watch rules, one per line, e.g.\n"
+		"               \"bigrss: any rss > 8G for 30s\"\n"
+		"  --policy F   act on processes, one policy per line, e.g.\n"
+		"               \"rsscap: kill rss > 4G for 3 limit 2/1m\"\n"
+		"  --dry-run    audit policy actions without taking them\n"
+		"  --audit F    append policy actions to F (default: stderr\n"
+		"               with --serve or --exporter, none otherwise)\n"
+		"  --cpu-budget P  keep collection under P%% of a core by\n"
+		"               spacing passes (1 to %gs), at low priority\n"
+		"  --proc-root D   read processes from D instead of /proc\n"
+		"  --record F   append a frame of all processes to F every\n"
+		"               --record-interval (default %gs)\n"
+		"  --diff A B   compare two recorded frames: appeared and\n"
+		"               disappeared processes, biggest CPU, RSS and\n"
+		"               network deltas; TIME is unix seconds,\n"
+		"               2026-10-17T10:30[:00][Z] or -DUR before the\n"
+		"               last frame (default: the last frame)\n"
+		"  --text       print the diff as text (default when stdout\n"
+		"               is not a terminal)\n",
+		PB_SHM_NAME, query_default_path(), EXPORTER_PORT, COLUMNS_DEFAULT,
+		columns_all(), BUDGET_MAX_INTERVAL, RECORDING_INTERVAL);
+}
+
+/**
+ * @brief Collector daemon loop: scan /proc once per second and serve it.
+ *
+ * @param serve Publish to shared memory and answer socket queries.
+ * @param socket_path Query socket path (with serve).
+ * @param exporter_port Metrics port, or -1 without the exporter.
+ * @param cpu_budget Allowed CPU percent of collection (0 for none).
+ * @return Process exit status.
+ */
+static int run_daemon(int serve, const char *socket_path, int exporter_port,
+		      double cpu_budget) {
+	static proc_list_t all_processes;
+	unsigned long long generation = 0;
+
+	if (serve && snapshot_publish_open(PB_SHM_NAME) < 0) {
+		fprintf(stderr, "pb: cannot publish %s: %s\n", PB_SHM_NAME,
+			errno == EBUSY ? "another pb --serve is running"
+				       : strerror(errno));
+		return 1;
+	}
+	if (serve && query_open(socket_path) < 0) {
+		fprintf(stderr, "pb: cannot listen on %s: %s\n", socket_path,
+			strerror(errno));
+		snapshot_publish_close();
+		return 1;
+	}
+	if (exporter_port >= 0 && exporter_open(exporter_port) < 0) {
+		fprintf(stderr, "pb: cannot listen on 127.0.0.1:%d: %s\n",
+			exporter_port, strerror(errno));
+		query_close();
+		snapshot_publish_close();
+		return 1;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = handle_stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	rules_set_log(stderr);
+	budget_init(cpu_budget);
+
+	proc_list_init(&all_processes);
+	history_init();
+	while (!stop_serving) {
+		arena_reset(frame_arena());
+		budget_pass_begin();
+		proc_list_update(&all_processes);
+		history_update(&all_processes);
+		rules_evaluate(&all_processes, monotonic_seconds());
+		policy_evaluate(&all_processes, monotonic_seconds());
+		snapshot_publish(&all_processes);
+		recording_update(&all_processes, wall_clock_ms());
+		generation++;
+		double next = monotonic_seconds() + budget_pass_end();
+
+		/* All clients share this pass until the next one is due */
+		do {
+			long remaining = (long)((next - monotonic_seconds()) *
+						1000);
+			if (remaining <= 0) {
+				break;
+			}
+
+			struct pollfd fds[2] = {
+				{ query_fd(), POLLIN, 0 },
+				{ exporter_fd(), POLLIN, 0 },
+			};
+			if (poll(fds, 2, (int)remaining) > 0) {
+				query_poll(&all_processes, generation, 0);
+			}
+			/* Also when idle: it closes timed-out scrapers */
+			exporter_poll(&all_processes, generation, 0);
+		} while (!stop_serving);
+	}
+
+	exporter_close();
+	query_close();
+	snapshot_publish_close();
+	return 0;
+}
+
+/**
+ * @brief Keep only the processes of one user.
+ *
+ * @param plist List filtered in place.
+ * @param uid Owner to keep.
+ */
+static void keep_user(proc_list_t *plist, uid_t uid) {
+	int kept = 0;
+	for (int i = 0; i < plist->count; i++) {
+		if (plist->list[i].uid == uid) {
+			plist->list[kept++] = plist->list[i];
+		}
+	}
+	plist->count = kept;
+}
+
+/**
+ * @brief Keep only processes in uninterruptible sleep (D) or zombies (Z).
+ *
+ * @param plist List filtered in place.
+ */
+static void keep_stuck(proc_list_t *plist) {
+	int kept = 0;
+	for (int i = 0; i < plist->count; i++) {
+		char state = plist->list[i].state;
+		if (state == 'D' || state == 'Z') {
+			plist->list[kept++] = plist->list[i];
+		}
+	}
+	plist->count = kept;
+}
+
+/**
+ * @brief Keep only processes of one PID namespace (e.g. one container).
+ *
+ * @param plist List filtered in place.
+ * @param pid_ns PID namespace inode.
+ */
+static void keep_namespace(proc_list_t *plist, unsigned long pid_ns) {
+	int kept = 0;
+	for (int i = 0; i < plist->count; i++) {
+		if (plist->list[i].pid_ns == pid_ns) {
+			plist->list[kept++] = plist->list[i];
+		}
+	}
+	plist->count = kept;
+}
+
+/**
+ * @brief Keep a selection inside its list and on screen.
+ *
+ * @param selected Selected row.
+ * @param scroll First visible row.
+ * @param count Number of rows.
+ * @param height Number of visible rows.
+ */
+static void clamp_view(int *selected, int *scroll, int count, int height) {
+	if (height < 1) {
+		height = 1;
+	}
+	if (*selected >= count) {
+		*selected = count > 0 ? count - 1 : 0;
+	}
+	if (*scroll > count - height) {
+		*scroll = count - height;
+	}
+	if (*selected >= *scroll + height) {
+		*scroll = *selected - height + 1;
+	}
+	if (*scroll > *selected) {
+		*scroll = *selected;
+	}
+	if (*scroll < 0) {
+		*scroll = 0;
+	}
+}
+
+/**
+ * @brief Interactive browser: main event loop.
  *
  * Initializes process list and UI, then enters main event loop.
  * Handles user input, updates process data, filters, sorts, and renders UI.
  *
+ * @param attach If non-zero, data comes from the shared-memory snapshot
+ *               instead of /proc.
+ * @param backend Terminal output (ncurses or plain ANSI escapes).
  * @return 0 on successful execution
  */
-int main() {
-	proc_list_t all_processes;
-	proc_list_t visible_processes;
+static int run_tui(int attach, RenderBackend backend) {
+	/* Static: two full tables would take over 1 MB of stack */
+	static proc_list_t all_processes;
+	static proc_list_t visible_processes;
+	static user_rollup_t users[ROLLUP_MAX_USERS];
+	static group_list_t groups;
 
 	int running = 1;
 	int selected = 0;
 	int scroll_offset = 0;
 	SortType current_sort = SORT_PID;
+	HistoryKind spark_mode = HISTORY_NONE;
 
 	char filter[50] = {0};
 	int search_mode = 0;
 
+	/* Only D-state and zombie processes are listed */
+	int stuck_only = 0;
+
+	/* Only processes of this PID namespace are listed (0: all) */
+	unsigned long scope_ns = 0;
+
 	/* Flag to trigger confirmation dialog overlay */
 	int kill_confirm_mode = 0;
 
-	/* Initialization */
-	proc_list_init(&all_processes);
-	ui_init();
+	/* Process the dialog asks about (the list may refresh meanwhile) */
+	pid_t kill_pid = 0;
+	unsigned long long kill_start = 0;
+	char kill_name[sizeof(all_processes.list[0].name)] = {0};
+
+	/* Refreshes are timed; policies get at least one interval per sample */
+	double next_refresh = 0;
+	double policy_sampled = -TUI_REFRESH_INTERVAL;
+
+	/* Flag to show the detail pane of the selected process */
+	int detail_mode = 0;
+
+	/* Per-user view and drill-down into one user's processes */
+	int user_mode = 0;
+	int user_count = 0;
+	int user_selected = 0;
+	int user_scroll = 0;
+	RollupSort user_sort = ROLLUP_SORT_CPU;
+	int drilled = 0;
+	uid_t drill_uid = 0;
+
+	/* Group-by-name view and expansion of one group */
+	int group_mode = 0;
+	int group_selected = 0;
+	int group_scroll = 0;
+	GroupSort group_sort_type = GROUP_SORT_COUNT;
+	int expanded = 0;
+	unsigned int expand_hash = 0;
+	char expand_name[sizeof(all_processes.list[0].name)] = {0};
+
+	/* Initialization (an attached browser never reads /proc itself) */
+	if (!attach) {
+		proc_list_init(&all_processes);
+	}
+	history_init();
+	detail_start();
+	ui_init(backend);
+	int last_height = ui_list_height(0);
 
 	while (running) {
+		/* Scratch data of the previous cycle is dropped in one go */
+		arena_reset(frame_arena());
+
 		/*
-		 * Update Model (only if not searching or in dialog
-		 * to prevent UI jitter)
+		 * Update Model on the timer only, also while searching or in
+		 * the dialog, so key presses never shorten a sample
 		 */
-		if (!search_mode && !kill_confirm_mode) {
-			proc_list_update(&all_processes);
+		double now = monotonic_seconds();
+		if (now >= next_refresh) {
+			if (attach) {
+				/* Snapshots carry no deltas: totals are rebuilt */
+				snapshot_read(&all_processes);
+				rollup_rebuild(&all_processes);
+			} else {
+				proc_list_update(&all_processes);
+				if (now - policy_sampled >= TUI_REFRESH_INTERVAL) {
+					policy_evaluate(&all_processes, now);
+					policy_sampled = now;
+				}
+				recording_update(&all_processes,
+						 wall_clock_ms());
+			}
+			history_update(&all_processes);
+			rules_evaluate(&all_processes, now);
+			next_refresh = now + TUI_REFRESH_INTERVAL;
+		}
+		ui_set_timeout((int)((next_refresh - now) * 1000) + 1);
+
+		/* Views are re-clamped only when the visible rows changed */
+		int list_height = ui_list_height(detail_mode);
+		if (list_height != last_height) {
+			clamp_view(&selected, &scroll_offset,
+				   visible_processes.count, list_height);
+			clamp_view(&user_selected, &user_scroll, user_count,
+				   list_height);
+			clamp_view(&group_selected, &group_scroll, groups.count,
+				   list_height);
+			last_height = list_height;
+		}
+
+		if (user_mode) {
+			user_count = rollup_users(users, ROLLUP_MAX_USERS);
+			rollup_sort(users, user_count, user_sort);
+			if (user_selected >= user_count) {
+				user_selected = user_count > 0 ? user_count - 1 : 0;
+			}
+			ui_draw_users(users, user_count, user_selected,
+				      user_scroll, all_processes.count);
+
+			int ch = ui_handle_input();
+			switch (ch) {
+			case 'q':
+				running = 0;
+				break;
+
+			case 'u':
+			case 27:
+				user_mode = 0;
+				break;
+
+			case '\n':
+			case KEY_ENTER: /* Drill into the user's processes */
+				if (user_count > 0) {
+					drilled = 1;
+					drill_uid = users[user_selected].uid;
+					user_mode = 0;
+					selected = 0;
+					scroll_offset = 0;
+				}
+				break;
+
+			case 'p':
+				user_sort = ROLLUP_SORT_UID;
+				break;
+
+			case 'n':
+				user_sort = ROLLUP_SORT_USER;
+				break;
+
+			case 'o':
+				user_sort = ROLLUP_SORT_PROCS;
+				break;
+
+			case 't':
+				user_sort = ROLLUP_SORT_THREADS;
+				break;
+
+			case 'm':
+				user_sort = ROLLUP_SORT_MEM;
+				break;
+
+			case 'c':
+				user_sort = ROLLUP_SORT_CPU;
+				break;
+
+			case KEY_UP:
+				if (user_selected > 0) {
+					user_selected--;
+					if (user_selected < user_scroll)
+						user_scroll = user_selected;
+				}
+				break;
+
+			case KEY_DOWN:
+				if (user_selected < user_count - 1) {
+					user_selected++;
+					if (user_selected >= user_scroll + list_height)
+						user_scroll++;
+				}
+				break;
+			}
+			continue;
 		}
 
 		/* Filter -> Sort */
 		proc_list_filter(&all_processes, &visible_processes, filter);
+		if (drilled) {
+			keep_user(&visible_processes, drill_uid);
+		}
+		if (stuck_only) {
+			keep_stuck(&visible_processes);
+		}
+		if (scope_ns) {
+			keep_namespace(&visible_processes, scope_ns);
+		}
+
+		if (group_mode) {
+			group_by_name(&visible_processes, &groups);
+			group_sort(&groups, group_sort_type);
+			if (group_selected >= groups.count) {
+				group_selected = groups.count > 0 ?
+						 groups.count - 1 : 0;
+			}
+			ui_draw_groups(&groups, group_selected, group_scroll,
+				       visible_processes.count);
+
+			int ch = ui_handle_input();
+			switch (ch) {
+			case 'q':
+				running = 0;
+				break;
+
+			case 'g':
+			case 27:
+				group_mode = 0;
+				break;
+
+			case '\n':
+			case KEY_ENTER: /* Expand: list the group's members */
+				if (groups.count > 0) {
+					const proc_group_t *group =
+						&groups.list[group_selected];
+					expanded = 1;
+					expand_hash = group->name_hash;
+					snprintf(expand_name, sizeof(expand_name),
+						 "%s", group->name);
+					group_mode = 0;
+					selected = 0;
+					scroll_offset = 0;
+				}
+				break;
+
+			case 'n':
+				group_sort_type = GROUP_SORT_NAME;
+				break;
+
+			case 'o':
+				group_sort_type = GROUP_SORT_COUNT;
+				break;
+
+			case 'm':
+				group_sort_type = GROUP_SORT_MEM;
+				break;
+
+			case 'c':
+				group_sort_type = GROUP_SORT_CPU;
+				break;
+
+			case KEY_UP:
+				if (group_selected > 0) {
+					group_selected--;
+					if (group_selected < group_scroll)
+						group_scroll = group_selected;
+				}
+				break;
+
+			case KEY_DOWN:
+				if (group_selected < groups.count - 1) {
+					group_selected++;
+					if (group_selected >= group_scroll + list_height)
+						group_scroll++;
+				}
+				break;
+			}
+			continue;
+		}
+
+		if (expanded) {
+			group_members(&visible_processes, expand_hash,
+				      expand_name);
+		}
 		sort_processes(&visible_processes, current_sort);
 
 		/* Bounds checking for selection */
@@ -61,13 +561,22 @@ int main() {
 
 		/* Render View */
 		ui_draw(&visible_processes, selected, scroll_offset, filter,
-			search_mode);
+			search_mode, spark_mode, stuck_only, scope_ns != 0);
+
+		/*
+		 * Detail pane follows the selection; selecting another PID
+		 * cancels the read in progress for the previous one.
+		 */
+		if (detail_mode && visible_processes.count > 0) {
+			proc_detail_t detail;
+			detail_select(visible_processes.list[selected].pid);
+			int ready = detail_get(&detail);
+			ui_draw_detail(&detail, ready);
+		}
 
 		/* If in confirmation mode, draw overlay dialog */
-		if (kill_confirm_mode && visible_processes.count > 0) {
-			ui_show_confirm_dialog(
-				visible_processes.list[selected].name,
-				visible_processes.list[selected].pid);
+		if (kill_confirm_mode) {
+			ui_show_confirm_dialog(kill_name, kill_pid);
 		}
 
 		/* Handle Input */
@@ -76,14 +585,12 @@ int main() {
 		/* Kill Confirmation Mode */
 		if (kill_confirm_mode) {
 			if (ch == 'y' || ch == 'Y') {
-				/* User confirmed kill */
-				if (visible_processes.count > 0) {
-					proc_kill_process(
-					    visible_processes.list[selected].pid);
-				}
+				/* User confirmed kill (only if not gone since) */
+				proc_signal_process(kill_pid, kill_start,
+						    SIGTERM);
 				kill_confirm_mode = 0;
-				/* Reduce timeout to update list immediately */
-				timeout(100);
+				/* Refresh soon to show the list without it */
+				next_refresh = monotonic_seconds() + 0.1;
 			} else if (ch == 'n' || ch == 'N' || ch == 27) {
 				/* ESC or N */
 				kill_confirm_mode = 0;
@@ -97,7 +604,6 @@ int main() {
 			/* ESC or Enter to exit search */
 			if (ch == 27 || ch == '\n') {
 				search_mode = 0;
-				timeout(1000); /* Restore normal update rate */
 			} else if (ch == KEY_BACKSPACE || ch == 127) {
 				int len = strlen(filter);
 				if (len > 0)
@@ -114,9 +620,6 @@ int main() {
 		}
 
 		/* Normal Navigation */
-		int max_y = getmaxy(stdscr);
-		int list_height = max_y - 2;
-
 		switch (ch) {
 		case 'q':
 			running = 0;
@@ -124,17 +627,86 @@ int main() {
 
 		case 'k':          /* Vim style kill */
 		case KEY_F(9):     /* Htop style kill */
-			if (visible_processes.count > 0)
+			if (visible_processes.count > 0) {
+				const proc_info_t *proc =
+					&visible_processes.list[selected];
 				kill_confirm_mode = 1;
+				kill_pid = proc->pid;
+				kill_start = proc->start_time;
+				snprintf(kill_name, sizeof(kill_name), "%s",
+					 proc->name);
+			}
 			break;
 
 		case '/':
 			search_mode = 1;
-			timeout(-1); /* Disable timeout while typing */
 			break;
 
-		case 27: /* ESC clears filter */
-			filter[0] = 0;
+		case '\n':
+		case KEY_ENTER: /* Toggle detail pane */
+			detail_mode = !detail_mode;
+			if (!detail_mode) {
+				detail_select(0);
+			} else if (selected >= scroll_offset + list_height -
+						UI_DETAIL_HEIGHT) {
+				/* Keep selection above the pane */
+				scroll_offset = selected - list_height +
+						UI_DETAIL_HEIGHT + 1;
+			}
+			break;
+
+		case 27: /* ESC closes detail pane, then clears filter */
+			if (detail_mode) {
+				detail_mode = 0;
+				detail_select(0);
+			} else if (expanded) {
+				/* Collapse back to the grouped view */
+				expanded = 0;
+				group_mode = 1;
+			} else if (drilled) {
+				/* Back to the per-user view */
+				drilled = 0;
+				user_mode = 1;
+			} else {
+				filter[0] = 0;
+				stuck_only = 0;
+				scope_ns = 0;
+			}
+			break;
+
+		case 'D': /* Only D-state and zombie processes */
+			stuck_only = !stuck_only;
+			selected = 0;
+			scroll_offset = 0;
+			break;
+
+		case 'N': /* Only the selected process's PID namespace */
+			if (scope_ns) {
+				scope_ns = 0;
+			} else if (visible_processes.count > 0) {
+				scope_ns = visible_processes.list[selected].pid_ns;
+			}
+			selected = 0;
+			scroll_offset = 0;
+			break;
+
+		case 'u': /* Per-user totals */
+			if (detail_mode) {
+				detail_mode = 0;
+				detail_select(0);
+			}
+			drilled = 0;
+			expanded = 0;
+			user_mode = 1;
+			break;
+
+		case 'g': /* Group processes by name */
+			if (detail_mode) {
+				detail_mode = 0;
+				detail_select(0);
+			}
+			expanded = 0;
+			group_mode = 1;
 			break;
 
 		/* Sorting shortcuts */
@@ -162,6 +734,52 @@ int main() {
 			scroll_offset = 0;
 			break;
 
+		case 'b':
+			current_sort = SORT_NET;
+			selected = 0;
+			scroll_offset = 0;
+			break;
+
+		/* Column layout: focus, move, hide, show, sort by focus */
+		case '[':
+			columns_focus(-1);
+			break;
+
+		case ']':
+			columns_focus(1);
+			break;
+
+		case '{':
+			columns_move(-1);
+			break;
+
+		case '}':
+			columns_move(1);
+			break;
+
+		case 'x':
+			columns_hide();
+			break;
+
+		case '+':
+			columns_show_next();
+			break;
+
+		case 'U': /* Scaled units <-> raw kB */
+			columns_toggle_unit();
+			break;
+
+		case 's':
+			if (columns_sort_key(&current_sort) == 0) {
+				selected = 0;
+				scroll_offset = 0;
+			}
+			break;
+
+		case 'h':  /* Cycle sparkline: none -> CPU -> MEM */
+			spark_mode = (spark_mode + 1) % (HISTORY_MEM + 1);
+			break;
+
 		/* Navigation */
 		case KEY_UP:
 			if (selected > 0) {
@@ -181,6 +799,295 @@ int main() {
 		}
 	}
 
+	detail_stop();
 	ui_close();
+	if (attach) {
+		snapshot_detach();
+	}
 	return 0;
+}
+
+/**
+ * @brief Read the frame named by FILE[@TIME].
+ *
+ * @param spec Frame specification.
+ * @param default_path File used when spec is only "@TIME" (may be NULL).
+ * @param path Output: the file read.
+ * @param frame Output frame.
+ * @return 0 on success, -1 after printing an error.
+ */
+static int load_frame(const char *spec, const char *default_path,
+		      char path[PATH_MAX], recording_frame_t *frame) {
+	const char *at = strrchr(spec, '@');
+	size_t length = at ? (size_t)(at - spec) : strlen(spec);
+	if (length == 0 && default_path) {
+		snprintf(path, PATH_MAX, "%s", default_path);
+	} else {
+		snprintf(path, PATH_MAX, "%.*s", (int)length, spec);
+	}
+
+	char error[256];
+	if (recording_read(path, at ? at + 1 : NULL, frame, error,
+			   sizeof(error)) < 0) {
+		fprintf(stderr, "pb: %s: %s\n", spec, error);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Compare two recorded frames, as text or in a browsable view.
+ *
+ * @param from First frame, FILE[@TIME].
+ * @param to Second frame, [FILE]@TIME or FILE.
+ * @param text Print text instead of opening the view.
+ * @param backend Terminal output of the view.
+ * @return Process exit status.
+ */
+static int run_diff(const char *from, const char *to, int text,
+		    RenderBackend backend) {
+	static char from_path[PATH_MAX], to_path[PATH_MAX];
+	recording_frame_t frames[2];
+	diff_result_t result;
+
+	if (load_frame(from, NULL, from_path, &frames[0]) < 0) {
+		return 1;
+	}
+	if (load_frame(to, from_path, to_path, &frames[1]) < 0) {
+		recording_frame_free(&frames[0]);
+		return 1;
+	}
+	if (diff_frames(&frames[0], &frames[1], &result) < 0) {
+		fprintf(stderr, "pb: out of memory\n");
+		recording_frame_free(&frames[0]);
+		recording_frame_free(&frames[1]);
+		return 1;
+	}
+
+	if (text) {
+		diff_print(&result, stdout);
+	} else {
+		DiffSection section = DIFF_APPEARED;
+		int selected = 0;
+		int scroll = 0;
+		int running = 1;
+
+		ui_init(backend);
+		ui_set_timeout(-1);
+		while (running) {
+			int count = result.counts[section];
+			clamp_view(&selected, &scroll, count,
+				   ui_list_height(0) - 1);
+			ui_draw_diff(&result, section, selected, scroll);
+
+			int ch = ui_handle_input();
+			switch (ch) {
+			case 'q':
+			case 27:
+				running = 0;
+				break;
+
+			case '\t':
+				section = (section + 1) % DIFF_SECTIONS;
+				selected = 0;
+				scroll = 0;
+				break;
+
+			case KEY_BTAB:
+				section = (section + DIFF_SECTIONS - 1) %
+					  DIFF_SECTIONS;
+				selected = 0;
+				scroll = 0;
+				break;
+
+			case '1': case '2': case '3': case '4': case '5':
+			case '6':
+				section = ch - '1';
+				selected = 0;
+				scroll = 0;
+				break;
+
+			case KEY_UP:
+				if (selected > 0) {
+					selected--;
+				}
+				break;
+
+			case KEY_DOWN:
+				if (selected < count - 1) {
+					selected++;
+				}
+				break;
+			}
+		}
+		ui_close();
+	}
+
+	diff_free(&result);
+	recording_frame_free(&frames[0]);
+	recording_frame_free(&frames[1]);
+	return 0;
+}
+
+/**
+ * @brief Main application function
+ *
+ * Parses the command line and starts the browser or the collector daemon.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @return Process exit status.
+ */
+int main(int argc, char **argv) {
+	int serve = 0;
+	int attach = 0;
+	const char *query = NULL;
+	const char *socket_path = query_default_path();
+	int exporter = 0;
+	int port = EXPORTER_PORT;
+	RenderBackend backend = RENDER_NCURSES;
+	const char *audit_path = NULL;
+	double cpu_budget = 0;
+	const char *record_path = NULL;
+	double record_interval = RECORDING_INTERVAL;
+	const char *diff_from = NULL;
+	const char *diff_to = NULL;
+	int diff_text = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--serve") == 0) {
+			serve = 1;
+		} else if (strcmp(argv[i], "--attach") == 0) {
+			attach = 1;
+		} else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) {
+			query = argv[++i];
+		} else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+			socket_path = argv[++i];
+		} else if (strcmp(argv[i], "--exporter") == 0) {
+			exporter = 1;
+		} else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+			char *end;
+			errno = 0;
+			long value = strtol(argv[++i], &end, 10);
+			if (errno || end == argv[i] || *end || value < 0 ||
+			    value > 65535) {
+				fprintf(stderr, "pb: --port takes a number "
+					"between 0 and 65535\n");
+				return 2;
+			}
+			port = (int)value;
+		} else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc) {
+			if (columns_select(argv[++i]) < 0) {
+				fprintf(stderr, "pb: bad column list '%s' "
+					"(available: %s)\n", argv[i],
+					columns_all());
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+			char error[256];
+			if (rules_load(argv[++i], error, sizeof(error)) < 0) {
+				fprintf(stderr, "pb: %s: %s\n", argv[i], error);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+			char error[256];
+			if (policy_load(argv[++i], error, sizeof(error)) < 0) {
+				fprintf(stderr, "pb: %s: %s\n", argv[i], error);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--dry-run") == 0) {
+			policy_set_dry_run(1);
+		} else if (strcmp(argv[i], "--audit") == 0 && i + 1 < argc) {
+			audit_path = argv[++i];
+		} else if (strcmp(argv[i], "--cpu-budget") == 0 && i + 1 < argc) {
+			cpu_budget = atof(argv[++i]);
+			if (cpu_budget <= 0 || cpu_budget > 100) {
+				fprintf(stderr, "pb: --cpu-budget takes a percent "
+					"between 0 and 100\n");
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--proc-root") == 0 && i + 1 < argc) {
+			if (proc_set_root(argv[++i]) < 0) {
+				fprintf(stderr, "pb: %s: path too long\n", argv[i]);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (strcmp(argv[i], "--record-interval") == 0 &&
+			   i + 1 < argc) {
+			if (rules_duration(argv[++i], &record_interval) < 0 ||
+			    record_interval <= 0) {
+				fprintf(stderr, "pb: bad interval '%s'\n", argv[i]);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--diff") == 0 && i + 2 < argc) {
+			diff_from = argv[++i];
+			diff_to = argv[++i];
+		} else if (strcmp(argv[i], "--text") == 0) {
+			diff_text = 1;
+		} else if (strcmp(argv[i], "--ansi") == 0) {
+			backend = RENDER_ANSI;
+		} else if (strcmp(argv[i], "-h") == 0 ||
+			   strcmp(argv[i], "--help") == 0) {
+			usage(stdout);
+			return 0;
+		} else {
+			usage(stderr);
+			return 2;
+		}
+	}
+
+	if ((serve || exporter) + attach + (query != NULL) +
+		    (diff_from != NULL) > 1) {
+		usage(stderr);
+		return 2;
+	}
+	if (diff_from) {
+		return run_diff(diff_from, diff_to,
+				diff_text || !isatty(STDOUT_FILENO), backend);
+	}
+	if (record_path && (attach || query)) {
+		fprintf(stderr, "pb: --record needs local collection "
+			"(not --attach or --query)\n");
+		return 2;
+	}
+	if (policy_count() > 0 && (attach || query)) {
+		fprintf(stderr, "pb: --policy needs local collection "
+			"(not --attach or --query)\n");
+		return 2;
+	}
+	if (audit_path && policy_open_audit(audit_path) < 0) {
+		fprintf(stderr, "pb: cannot open %s: %s\n", audit_path,
+			strerror(errno));
+		return 1;
+	}
+	if (record_path && recording_open(record_path, record_interval) < 0) {
+		fprintf(stderr, "pb: cannot record to %s: %s\n", record_path,
+			errno == EINVAL ? "not a pb recording" : strerror(errno));
+		return 1;
+	}
+	if (query) {
+		if (query_client(socket_path, query) < 0) {
+			fprintf(stderr, "pb: no answer from %s\n", socket_path);
+			return 1;
+		}
+		return 0;
+	}
+	if (serve || exporter) {
+		if (!audit_path) {
+			policy_set_audit(STDERR_FILENO);
+		}
+		int status = run_daemon(serve, socket_path,
+					exporter ? port : -1, cpu_budget);
+		recording_close();
+		return status;
+	}
+	if (attach && snapshot_attach(PB_SHM_NAME) < 0) {
+		fprintf(stderr, "pb: no snapshot at %s (start pb --serve)\n",
+			PB_SHM_NAME);
+		return 1;
+	}
+	int status = run_tui(attach, backend);
+	recording_close();
+	return status;
 }
\ No newline at end of file
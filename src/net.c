@@ -0,0 +1,530 @@
+/**
+ * @file net.c
+ * @brief Per-process network throughput attribution via socket inodes.
+ *
+ * Every refresh dumps the kernel socket tables once, sorted by inode, and
+ * merge-joins them with the previous dump to get per-socket byte deltas.
+ * Deltas are charged to the owning PID through a sorted inode->PID map,
+ * maintained incrementally: the sockets the budgeted fdscan rotation read
+ * this refresh are merged in, and sockets gone from the dump drop out.
+ * Only TCP keeps byte counters (tcp_info), so only TCP sockets are dumped.
+ */
+
+#include "net.h"
+#include "fdscan.h"
+#include "pidmap.h"
+#include "sort.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/tcp.h>
+
+/**
+ * @brief Byte counter of one socket in a dump.
+ */
+typedef struct {
+	unsigned long inode;        /**< Socket inode */
+	unsigned long long bytes;   /**< TCP bytes acked + received */
+} sock_sample_t;
+
+/**
+ * @brief Entry of the inode->PID map.
+ */
+typedef struct {
+	unsigned long inode;        /**< Socket inode */
+	pid_t pid;                  /**< Owner */
+} sock_owner_t;
+
+static sock_sample_t dump_a[NET_MAX_SOCKETS];
+static sock_sample_t dump_b[NET_MAX_SOCKETS];
+static sock_sample_t *cur = dump_a;
+static sock_sample_t *prev = dump_b;
+static int cur_count = 0;
+static int prev_count = 0;
+
+static sock_owner_t owners_a[NET_MAX_SOCKETS];
+static sock_owner_t owners_b[NET_MAX_SOCKETS];
+static sock_owner_t *owners = owners_a;
+static int owner_count = 0;
+
+/* Sockets reported by fdscan this refresh, sorted by inode */
+static sock_owner_t fresh[FDSCAN_SOCKETS];
+
+static time_t last_ns_scan = 0;
+
+static net_ns_stat_t namespaces[NET_MAX_NAMESPACES];
+static int ns_count = 0;
+
+/* -1 = not opened yet, -2 = sock_diag unavailable (rates unknown) */
+static int diag_fd = -1;
+static char nl_buffer[65536];
+
+static pidmap_t rate_map;
+static unsigned long long rate_bytes[MAX_PROCESSES];
+static struct timespec prev_time;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Comparator for sorting dump samples by inode.
+ *
+ * @param a Pointer to first sample.
+ * @param b Pointer to second sample.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_sample(const void *a, const void *b) {
+	const sock_sample_t *sa = (const sock_sample_t *)a;
+	const sock_sample_t *sb = (const sock_sample_t *)b;
+	return (sa->inode > sb->inode) - (sa->inode < sb->inode);
+}
+
+/**
+ * @brief Comparator for sorting owners by inode.
+ *
+ * @param a Pointer to first owner.
+ * @param b Pointer to second owner.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_owner(const void *a, const void *b) {
+	const sock_owner_t *oa = (const sock_owner_t *)a;
+	const sock_owner_t *ob = (const sock_owner_t *)b;
+	return (oa->inode > ob->inode) - (oa->inode < ob->inode);
+}
+
+/**
+ * @brief Find the owner entry of a socket inode (binary search).
+ *
+ * @param inode Socket inode.
+ * @return Pointer to the entry, or NULL if the inode is unknown.
+ */
+static const sock_owner_t *find_owner(unsigned long inode) {
+	sock_owner_t key = { inode, 0 };
+	return bsearch(&key, owners, owner_count, sizeof(sock_owner_t),
+		       compare_owner);
+}
+
+/**
+ * @brief Append a socket to the current dump.
+ *
+ * @param inode Socket inode.
+ * @param bytes Byte counter of the socket.
+ */
+static void add_sample(unsigned long inode, unsigned long long bytes) {
+	if (inode == 0 || cur_count >= NET_MAX_SOCKETS) {
+		return;
+	}
+	cur[cur_count].inode = inode;
+	cur[cur_count].bytes = bytes;
+	cur_count++;
+}
+
+/**
+ * @brief Dump one socket family/protocol through netlink sock_diag.
+ *
+ * TCP sockets carry tcp_info, whose bytes_acked/bytes_received counters
+ * give the traffic of the socket.
+ *
+ * @param family AF_INET or AF_INET6.
+ * @param protocol IPPROTO_TCP.
+ * @return 0 on success, -1 on error.
+ */
+static int diag_dump(int family, int protocol) {
+	struct {
+		struct nlmsghdr nlh;
+		struct inet_diag_req_v2 req;
+	} msg;
+	struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+
+	memset(&msg, 0, sizeof(msg));
+	msg.nlh.nlmsg_len = sizeof(msg);
+	msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	msg.req.sdiag_family = family;
+	msg.req.sdiag_protocol = protocol;
+	msg.req.idiag_states = ~0U;
+	msg.req.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+
+	if (sendto(diag_fd, &msg, sizeof(msg), 0, (struct sockaddr *)&kernel,
+		   sizeof(kernel)) < 0) {
+		return -1;
+	}
+
+	for (;;) {
+		int len = (int)recv(diag_fd, nl_buffer, sizeof(nl_buffer), 0);
+		if (len <= 0) {
+			return -1;
+		}
+
+		struct nlmsghdr *nlh = (struct nlmsghdr *)nl_buffer;
+		for (; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+			if (nlh->nlmsg_type == NLMSG_DONE) {
+				return 0;
+			}
+			if (nlh->nlmsg_type == NLMSG_ERROR) {
+				return -1;
+			}
+
+			struct inet_diag_msg *diag = NLMSG_DATA(nlh);
+			int attr_len = nlh->nlmsg_len -
+				       NLMSG_LENGTH(sizeof(*diag));
+			struct rtattr *attr = (struct rtattr *)(diag + 1);
+			unsigned long long bytes = 0;
+
+			for (; RTA_OK(attr, attr_len);
+			     attr = RTA_NEXT(attr, attr_len)) {
+				size_t need = offsetof(struct tcp_info,
+						       tcpi_bytes_received) +
+					      sizeof(__u64);
+				if (attr->rta_type != INET_DIAG_INFO ||
+				    RTA_PAYLOAD(attr) < need) {
+					continue;
+				}
+				/* Payload may be unaligned; copy it out */
+				struct tcp_info info;
+				memcpy(&info, RTA_DATA(attr), need);
+				bytes = info.tcpi_bytes_acked +
+					info.tcpi_bytes_received;
+			}
+			add_sample(diag->idiag_inode, bytes);
+		}
+	}
+}
+
+/**
+ * @brief Dump all TCP sockets into cur, sorted by inode.
+ *
+ * Leaves cur empty once sock_diag turned out to be unavailable.
+ */
+static void collect_sockets(void) {
+	cur_count = 0;
+
+	if (diag_fd == -1) {
+		diag_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+				 NETLINK_SOCK_DIAG);
+		if (diag_fd < 0) {
+			diag_fd = -2;
+		}
+	}
+
+	if (diag_fd >= 0) {
+		if (diag_dump(AF_INET, IPPROTO_TCP) < 0 ||
+		    diag_dump(AF_INET6, IPPROTO_TCP) < 0) {
+			/* Not permitted here; rates are unknown from now on */
+			close(diag_fd);
+			diag_fd = -2;
+			cur_count = 0;
+		}
+	}
+
+	sort_array(cur, cur_count, sizeof(sock_sample_t), compare_sample);
+}
+
+/**
+ * @brief Resolve the network namespace inode of a process.
+ *
+ * @param pid Process ID.
+ * @return Namespace inode, or 0 if not readable.
+ */
+static unsigned long read_net_ns(pid_t pid) {
+	char path[PROC_PATH_MAX], link[64];
+	snprintf(path, sizeof(path), "%s/%d/ns/net", proc_root(), pid);
+
+	ssize_t len = readlink(path, link, sizeof(link) - 1);
+	if (len < 0) {
+		return 0;
+	}
+	link[len] = '\0';
+
+	/* Link looks like "net:[4026531840]" */
+	const char *bracket = strchr(link, '[');
+	return bracket ? strtoul(bracket + 1, NULL, 10) : 0;
+}
+
+/**
+ * @brief Remember a namespace discovered during a scan.
+ *
+ * Counters of namespaces known before the scan are kept so rates do
+ * not jump.
+ *
+ * @param found Namespaces found so far in this scan.
+ * @param found_count Number of entries in found.
+ * @param inode Namespace inode.
+ * @param pid Process living in the namespace.
+ * @return New number of entries in found.
+ */
+static int remember_ns(net_ns_stat_t *found, int found_count,
+		       unsigned long inode, pid_t pid) {
+	for (int i = 0; i < found_count; i++) {
+		if (found[i].inode == inode) {
+			return found_count;
+		}
+	}
+	if (found_count >= NET_MAX_NAMESPACES) {
+		return found_count;
+	}
+
+	net_ns_stat_t *ns = &found[found_count];
+	memset(ns, 0, sizeof(*ns));
+	ns->inode = inode;
+	ns->pid = pid;
+	const net_ns_stat_t *old = net_ns_lookup(inode);
+	if (old) {
+		ns->rx = old->rx;
+		ns->tx = old->tx;
+	}
+	return found_count + 1;
+}
+
+/**
+ * @brief Merge the sockets fdscan read this refresh into the owner map.
+ *
+ * Walks the dump, the previous map and the fresh sockets (all sorted by
+ * inode) together. A socket keeps its fresh owner if fdscan saw it, its
+ * previous owner otherwise; sockets no longer in the dump are dropped, so
+ * the map never outgrows the dump.
+ */
+static void merge_owners(void) {
+	int fresh_count;
+	const fdscan_socket_t *seen = fdscan_sockets(&fresh_count);
+	for (int i = 0; i < fresh_count; i++) {
+		fresh[i].inode = seen[i].inode;
+		fresh[i].pid = seen[i].pid;
+	}
+	sort_array(fresh, fresh_count, sizeof(sock_owner_t), compare_owner);
+
+	sock_owner_t *next = (owners == owners_a) ? owners_b : owners_a;
+	int next_count = 0;
+	int j = 0, k = 0;
+	for (int i = 0; i < cur_count; i++) {
+		unsigned long inode = cur[i].inode;
+		while (j < owner_count && owners[j].inode < inode) {
+			j++;
+		}
+		while (k < fresh_count && fresh[k].inode < inode) {
+			k++;
+		}
+
+		pid_t pid = 0;
+		if (k < fresh_count && fresh[k].inode == inode) {
+			pid = fresh[k].pid;
+		} else if (j < owner_count && owners[j].inode == inode) {
+			pid = owners[j].pid;
+		}
+		if (pid) {
+			next[next_count].inode = inode;
+			next[next_count].pid = pid;
+			next_count++;
+		}
+	}
+	owners = next;
+	owner_count = next_count;
+}
+
+/**
+ * @brief Rediscover network namespaces from /proc/[pid]/ns/net.
+ *
+ * @param plist Current process list.
+ */
+static void scan_namespaces(const proc_list_t *plist) {
+	static net_ns_stat_t found[NET_MAX_NAMESPACES];
+	int found_count = 0;
+
+	for (int i = 0; i < plist->count; i++) {
+		pid_t pid = plist->list[i].pid;
+		unsigned long ns = read_net_ns(pid);
+		if (ns != 0) {
+			found_count = remember_ns(found, found_count, ns, pid);
+		}
+	}
+
+	memcpy(namespaces, found, found_count * sizeof(net_ns_stat_t));
+	ns_count = found_count;
+	last_ns_scan = time(NULL);
+}
+
+/**
+ * @brief Sum non-loopback traffic from /proc/[pid]/net/dev.
+ *
+ * @param pid Process inside the namespace.
+ * @param rx Output for received bytes.
+ * @param tx Output for transmitted bytes.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+static int read_net_dev(pid_t pid, unsigned long long *rx,
+			unsigned long long *tx) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/net/dev", proc_root(), pid);
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	char *contents = arena_read_file(arena, path, 65536, NULL);
+	if (!contents) {
+		return -1;
+	}
+
+	*rx = 0;
+	*tx = 0;
+	char *save = NULL;
+	for (char *line = strtok_r(contents, "\n", &save); line;
+	     line = strtok_r(NULL, "\n", &save)) {
+		/* Interface lines look like "  eth0: rx_bytes ... tx_bytes ..." */
+		char *colon = strchr(line, ':');
+		if (!colon) {
+			continue;
+		}
+		*colon = '\0';
+
+		char *name = line + strspn(line, " ");
+		if (strcmp(name, "lo") == 0) {
+			continue;
+		}
+
+		unsigned long long r, t;
+		if (sscanf(colon + 1, "%llu %*u %*u %*u %*u %*u %*u %*u %llu",
+			   &r, &t) == 2) {
+			*rx += r;
+			*tx += t;
+		}
+	}
+	arena_rewind(arena, mark);
+	return 0;
+}
+
+/**
+ * @brief Refresh totals and rates of all known namespaces.
+ *
+ * @param elapsed Seconds since the previous refresh (0 on first call).
+ */
+static void update_namespaces(double elapsed) {
+	for (int i = 0; i < ns_count; i++) {
+		net_ns_stat_t *ns = &namespaces[i];
+		unsigned long long rx, tx;
+
+		if (read_net_dev(ns->pid, &rx, &tx) < 0) {
+			/* Representative exited; next scan picks another */
+			ns->rx_rate = 0.0f;
+			ns->tx_rate = 0.0f;
+			continue;
+		}
+
+		if (elapsed > 0 && ns->rx > 0 && rx >= ns->rx && tx >= ns->tx) {
+			ns->rx_rate = (float)((rx - ns->rx) / 1024.0 / elapsed);
+			ns->tx_rate = (float)((tx - ns->tx) / 1024.0 / elapsed);
+		}
+		ns->rx = rx;
+		ns->tx = tx;
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Forget all sockets, owners and namespaces.
+ */
+void net_init(void) {
+	cur_count = 0;
+	prev_count = 0;
+	owner_count = 0;
+	ns_count = 0;
+	last_ns_scan = 0;
+	prev_time.tv_sec = 0;
+	prev_time.tv_nsec = 0;
+}
+
+/**
+ * @brief Attribute socket traffic since the last call to processes.
+ *
+ * @param plist Freshly updated process list.
+ */
+void net_update(proc_list_t *plist) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	double elapsed = 0.0;
+	if (prev_time.tv_sec != 0 || prev_time.tv_nsec != 0) {
+		elapsed = (double)(now.tv_sec - prev_time.tv_sec) +
+			  (now.tv_nsec - prev_time.tv_nsec) / 1e9;
+	}
+	prev_time = now;
+
+	if (last_ns_scan == 0 || time(NULL) - last_ns_scan >= NET_NS_INTERVAL) {
+		scan_namespaces(plist);
+	}
+
+	/* Previous dump becomes the baseline for deltas */
+	sock_sample_t *swap = prev;
+	prev = cur;
+	cur = swap;
+	prev_count = cur_count;
+	collect_sockets();
+
+	/* Without sock_diag there are no byte counters: unknown, not zero */
+	if (diag_fd == -2) {
+		owner_count = 0;
+		for (int i = 0; i < plist->count; i++) {
+			plist->list[i].net_rate = -1.0f;
+		}
+		update_namespaces(elapsed);
+		return;
+	}
+	merge_owners();
+
+	pidmap_init(&rate_map);
+	for (int i = 0; i < plist->count; i++) {
+		int slot = pidmap_acquire(&rate_map, plist->list[i].pid, NULL);
+		if (slot >= 0) {
+			rate_bytes[slot] = 0;
+		}
+	}
+
+	/* Merge-join both dumps (sorted by inode) to get byte deltas */
+	int j = 0;
+	for (int i = 0; i < cur_count; i++) {
+		while (j < prev_count && prev[j].inode < cur[i].inode) {
+			j++;
+		}
+		if (j >= prev_count || prev[j].inode != cur[i].inode ||
+		    cur[i].bytes <= prev[j].bytes) {
+			continue;
+		}
+
+		const sock_owner_t *owner = find_owner(cur[i].inode);
+		int slot = owner ? pidmap_find(&rate_map, owner->pid) : -1;
+		if (slot >= 0) {
+			rate_bytes[slot] += cur[i].bytes - prev[j].bytes;
+		}
+	}
+
+	for (int i = 0; i < plist->count; i++) {
+		int slot = pidmap_find(&rate_map, plist->list[i].pid);
+		plist->list[i].net_rate = (slot >= 0 && elapsed > 0) ?
+			(float)(rate_bytes[slot] / 1024.0 / elapsed) : 0.0f;
+	}
+
+	update_namespaces(elapsed);
+}
+
+/**
+ * @brief Look up traffic totals of a network namespace.
+ *
+ * @param inode Namespace inode.
+ * @return Pointer to totals, or NULL if unknown.
+ */
+const net_ns_stat_t *net_ns_lookup(unsigned long inode) {
+	for (int i = 0; i < ns_count; i++) {
+		if (namespaces[i].inode == inode) {
+			return &namespaces[i];
+		}
+	}
+	return NULL;
+}
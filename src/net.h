@@ -0,0 +1,60 @@
+#ifndef NET_H
+#define NET_H
+
+#include "proc.h"
+
+/**
+ * @brief Maximum number of sockets tracked per refresh.
+ */
+#define NET_MAX_SOCKETS 65536
+
+/**
+ * @brief Maximum number of network namespaces with totals.
+ */
+#define NET_MAX_NAMESPACES 64
+
+/**
+ * @brief Seconds between two scans for network namespaces.
+ */
+#define NET_NS_INTERVAL 5
+
+/**
+ * @brief Traffic totals of one network namespace.
+ */
+typedef struct {
+	unsigned long inode;        /**< Namespace inode (from /proc/[pid]/ns/net) */
+	pid_t pid;                  /**< Process used to read /proc/[pid]/net/dev */
+	unsigned long long rx;      /**< Received bytes on non-loopback interfaces */
+	unsigned long long tx;      /**< Transmitted bytes on non-loopback interfaces */
+	float rx_rate;              /**< Receive rate in kB/s */
+	float tx_rate;              /**< Transmit rate in kB/s */
+} net_ns_stat_t;
+
+/**
+ * @brief Forgets all sockets, owners and namespaces.
+ */
+void net_init(void);
+
+/**
+ * @brief Attributes socket traffic since the last call to processes.
+ *
+ * Dumps TCP sockets through netlink sock_diag, maps their inodes to PIDs
+ * and fills net_rate of every process. The inode->PID map is fed by the
+ * sockets fdscan_update() read in the same refresh, so it costs no
+ * descriptor walks of its own; a new socket is charged once the rotation
+ * has reached its owner. Without sock_diag there are no byte counters and
+ * net_rate is -1 (unknown).
+ *
+ * @param plist Freshly updated process list, after fdscan_update().
+ */
+void net_update(proc_list_t *plist);
+
+/**
+ * @brief Looks up traffic totals of a network namespace.
+ *
+ * @param inode Namespace inode.
+ * @return Pointer to totals, or NULL if the namespace is unknown.
+ */
+const net_ns_stat_t *net_ns_lookup(unsigned long inode);
+
+#endif // NET_H
@@ -0,0 +1,137 @@
+/**
+ * @file pidmap.c
+ * @brief Open-addressing PID index with a fixed pool of slots.
+ */
+
+#include "pidmap.h"
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Hash a PID into the bucket array (Fibonacci hashing).
+ *
+ * @param pid Process ID.
+ * @return Home bucket of the PID.
+ */
+static unsigned int hash_pid(pid_t pid) {
+	return ((unsigned int)pid * 2654435761u) % PIDMAP_BUCKETS;
+}
+
+/**
+ * @brief Find the bucket holding a PID.
+ *
+ * @param map Map to search.
+ * @param pid Process ID.
+ * @return Bucket position, or -1 if absent.
+ */
+static int find_bucket(const pidmap_t *map, pid_t pid) {
+	unsigned int pos = hash_pid(pid);
+
+	for (int probes = 0; probes < PIDMAP_BUCKETS; probes++) {
+		if (map->keys[pos] == 0) {
+			return -1;
+		}
+		if (map->keys[pos] == pid) {
+			return (int)pos;
+		}
+		pos = (pos + 1) % PIDMAP_BUCKETS;
+	}
+	return -1;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Empty the map and return every slot to the free stack.
+ *
+ * @param map Map to reset.
+ */
+void pidmap_init(pidmap_t *map) {
+	for (int i = 0; i < PIDMAP_BUCKETS; i++) {
+		map->keys[i] = 0;
+	}
+	/* Hand out low slots first */
+	map->free_count = 0;
+	for (int slot = MAX_PROCESSES - 1; slot >= 0; slot--) {
+		map->free_slots[map->free_count++] = slot;
+	}
+}
+
+/**
+ * @brief Find the slot of a PID.
+ *
+ * @param map Map to search.
+ * @param pid Process ID.
+ * @return Slot number, or -1 if absent.
+ */
+int pidmap_find(const pidmap_t *map, pid_t pid) {
+	int pos = find_bucket(map, pid);
+	return (pos >= 0) ? map->slots[pos] : -1;
+}
+
+/**
+ * @brief Find the slot of a PID, assigning a new one if needed.
+ *
+ * @param map Map to update.
+ * @param pid Process ID (must be positive).
+ * @param created Set to 1 if a new slot was assigned (may be NULL).
+ * @return Slot number, or -1 if the pool is exhausted.
+ */
+int pidmap_acquire(pidmap_t *map, pid_t pid, int *created) {
+	unsigned int pos = hash_pid(pid);
+
+	if (created) {
+		*created = 0;
+	}
+	while (map->keys[pos] != 0) {
+		if (map->keys[pos] == pid) {
+			return map->slots[pos];
+		}
+		pos = (pos + 1) % PIDMAP_BUCKETS;
+	}
+
+	if (map->free_count == 0) {
+		return -1;
+	}
+	map->keys[pos] = pid;
+	map->slots[pos] = map->free_slots[--map->free_count];
+	if (created) {
+		*created = 1;
+	}
+	return map->slots[pos];
+}
+
+/**
+ * @brief Remove a PID using backward-shift deletion.
+ *
+ * Keeps linear probe chains intact without tombstones.
+ *
+ * @param map Map to update.
+ * @param pid Process ID.
+ */
+void pidmap_release(pidmap_t *map, pid_t pid) {
+	int found = find_bucket(map, pid);
+	if (found < 0) {
+		return;
+	}
+
+	unsigned int pos = (unsigned int)found;
+	unsigned int next = (pos + 1) % PIDMAP_BUCKETS;
+
+	map->free_slots[map->free_count++] = map->slots[pos];
+	map->keys[pos] = 0;
+	while (map->keys[next] != 0) {
+		unsigned int home = hash_pid(map->keys[next]);
+
+		/* Move entry back if its home is not in (pos, next] */
+		int movable = (pos <= next) ? (home <= pos || home > next)
+					    : (home <= pos && home > next);
+		if (movable) {
+			map->keys[pos] = map->keys[next];
+			map->slots[pos] = map->slots[next];
+			map->keys[next] = 0;
+			pos = next;
+		}
+		next = (next + 1) % PIDMAP_BUCKETS;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef PIDMAP_H
+#define PIDMAP_H
+
+#include "proc.h"
+
+/**
+ * @brief Number of index buckets (load factor at most 0.5).
+ */
+#define PIDMAP_BUCKETS (MAX_PROCESSES * 2)
+
+/**
+ * @brief PID-keyed slot allocator.
+ *
+ * Hands out slot numbers in [0, MAX_PROCESSES) for PIDs and finds them again
+ * through an open-addressing index. Callers keep their per-PID records in
+ * a static array indexed by slot, so no per-process malloc is needed.
+ */
+typedef struct {
+	pid_t keys[PIDMAP_BUCKETS];     /**< PID stored in bucket, 0 if empty */
+	int slots[PIDMAP_BUCKETS];      /**< Slot assigned to the bucket's PID */
+	int free_slots[MAX_PROCESSES];  /**< Stack of unassigned slots */
+	int free_count;                 /**< Number of entries in free_slots */
+} pidmap_t;
+
+/**
+ * @brief Empties the map and returns every slot to the free stack.
+ *
+ * @param map Map to reset.
+ */
+void pidmap_init(pidmap_t *map);
+
+/**
+ * @brief Finds the slot of a PID.
+ *
+ * @param map Map to search.
+ * @param pid Process ID.
+ * @return Slot number, or -1 if the PID is not in the map.
+ */
+int pidmap_find(const pidmap_t *map, pid_t pid);
+
+/**
+ * @brief Finds the slot of a PID, assigning a new one if needed.
+ *
+ * @param map Map to update.
+ * @param pid Process ID (must be positive).
+ * @param created Set to 1 if a new slot was assigned, 0 otherwise (may be NULL).
+ * @return Slot number, or -1 if all slots are in use.
+ */
+int pidmap_acquire(pidmap_t *map, pid_t pid, int *created);
+
+/**
+ * @brief Removes a PID and returns its slot to the free stack.
+ *
+ * @param map Map to update.
+ * @param pid Process ID. Unknown PIDs are ignored.
+ */
+void pidmap_release(pidmap_t *map, pid_t pid);
+
+#endif // PIDMAP_H
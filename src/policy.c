@@ -0,0 +1,593 @@
+/**
+ * @file policy.c
+ * @brief Action policies: renice or kill processes that keep matching.
+ *
+ * Policies are opt-in (--policy). Like watch rules they are compiled filter
+ * expressions evaluated over one columnar view of each refresh; matching
+ * processes are tracked per policy by PID and start time, so a count of
+ * consecutive samples or a pending SIGKILL never carries over to a process
+ * that reused the PID.
+ */
+
+#include "policy.h"
+#include "expr.h"
+#include "rules.h"
+#include "arena.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/* One process matched (or condemned) by a policy */
+typedef struct {
+	pid_t pid;
+	unsigned long long start_time;
+	int samples;                /* Consecutive matching samples */
+	double term_at;             /* SIGTERM sent at (< 0: not sent) */
+	unsigned char done;         /* Nothing left to do for it */
+	unsigned char limited;      /* Rate limit already audited */
+} policy_track_t;
+
+typedef struct {
+	char name[POLICY_NAME];
+	PolicyAction action;
+	int nice;
+	expr_t where;
+	int samples;
+	double grace;
+	int limit;
+	double window;
+
+	double window_start;        /* Start of the current rate window */
+	int window_actions;         /* Actions in the current window */
+	int matches;
+	unsigned long actions;
+	unsigned long suppressed;
+	int track_count;
+} policy_t;
+
+static policy_t policies[POLICY_MAX];
+static int policy_total = 0;
+
+/* Tracked processes of each policy, sorted by PID, and a merge buffer */
+static policy_track_t tracks[POLICY_MAX][POLICY_TRACKED];
+static policy_track_t merged[POLICY_TRACKED];
+
+static int dry_run = 0;
+static int audit_fd = -1;
+static int audit_owned = 0;
+
+/* Audit lines of one evaluation, appended to the log at once */
+static char audit_text[POLICY_AUDIT_SIZE];
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Parse an integer that must fill the whole text.
+ *
+ * @param text Text.
+ * @param low Smallest accepted value.
+ * @param high Largest accepted value.
+ * @param value Output.
+ * @return 0 on success, -1 if invalid or out of range.
+ */
+static int parse_int(const char *text, int low, int high, int *value) {
+	char *end;
+	long number = strtol(text, &end, 10);
+	if (end == text || *end || number < low || number > high) {
+		return -1;
+	}
+	*value = (int)number;
+	return 0;
+}
+
+/**
+ * @brief Parse one trailing clause ("for", "grace" or "limit").
+ *
+ * @param policy Policy being built.
+ * @param clause Clause index (0 for, 1 grace, 2 limit).
+ * @param text Clause argument.
+ * @param error Message buffer.
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on an error.
+ */
+static int parse_clause(policy_t *policy, int clause, char *text, char *error,
+			size_t error_size) {
+	if (clause == 0) {
+		/* for N [samples] */
+		char *unit = text + strcspn(text, " \t");
+		if (*unit) {
+			*unit++ = '\0';
+			if (strcasecmp(rules_trim(unit), "samples") != 0) {
+				return rules_error(error, error_size,
+						   "expected 'samples'", unit);
+			}
+		}
+		if (parse_int(text, 1, 1000000, &policy->samples) < 0) {
+			return rules_error(error, error_size,
+					   "expected number of samples", text);
+		}
+	} else if (clause == 1) {
+		if (policy->action != POLICY_KILL) {
+			return rules_error(error, error_size,
+					   "grace applies to kill only", "");
+		}
+		if (rules_duration(text, &policy->grace) < 0) {
+			return rules_error(error, error_size,
+					   "expected duration", text);
+		}
+	} else {
+		/* limit N/DURATION */
+		char *slash = strchr(text, '/');
+		if (slash) {
+			*slash = '\0';
+		}
+		if (!slash || parse_int(rules_trim(text), 1, 1000000,
+					&policy->limit) < 0 ||
+		    rules_duration(rules_trim(slash + 1), &policy->window) < 0 ||
+		    policy->window <= 0) {
+			return rules_error(error, error_size,
+					   "expected limit N/DURATION", text);
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Take one action from the policy's rate budget.
+ *
+ * @param policy Policy.
+ * @param now Current time.
+ * @return 1 if the action may go ahead, 0 if the window is used up.
+ */
+static int rate_allows(policy_t *policy, double now) {
+	if (policy->window_actions == 0 ||
+	    now - policy->window_start >= policy->window) {
+		policy->window_start = now;
+		policy->window_actions = 0;
+	}
+	if (policy->window_actions >= policy->limit) {
+		return 0;
+	}
+	policy->window_actions++;
+	return 1;
+}
+
+/**
+ * @brief Append one audit line.
+ *
+ * User, result and name are quoted and escaped: a process can rename
+ * itself, and must not be able to end its line or forge fields.
+ *
+ * @param sb Audit text of this evaluation.
+ * @param stamp UTC time stamp.
+ * @param policy Policy.
+ * @param action Action name ("SIGTERM", "SIGKILL", "renice 10").
+ * @param proc Process acted on.
+ * @param result "ok", "dry-run", "rate-limited" or an error message.
+ */
+static void audit(strbuf_t *sb, const char *stamp, const policy_t *policy,
+		  const char *action, const proc_info_t *proc,
+		  const char *result) {
+	strbuf_printf(sb, "%s policy=%s action=\"%s\" pid=%d user=\"", stamp,
+		      policy->name, action, proc->pid);
+	strbuf_put_quoted(sb, proc->user);
+	strbuf_printf(sb, "\" rss_kb=%ld cpu=%.1f result=\"", proc->memory,
+		      proc->cpu_usage);
+	strbuf_put_quoted(sb, result);
+	strbuf_printf(sb, "\" name=\"");
+	strbuf_put_quoted(sb, proc->name);
+	strbuf_printf(sb, "\"\n");
+}
+
+/**
+ * @brief Signal or renice one process and audit the outcome.
+ *
+ * @param sb Audit text.
+ * @param stamp UTC time stamp.
+ * @param policy Policy.
+ * @param proc Process.
+ * @param sig Signal to send (0 to renice instead).
+ * @return 0 on success (or in dry-run mode), -1 on failure.
+ */
+static int act(strbuf_t *sb, const char *stamp, policy_t *policy,
+	       const proc_info_t *proc, int sig) {
+	char action[32];
+	if (sig) {
+		snprintf(action, sizeof(action), "%s",
+			 sig == SIGKILL ? "SIGKILL" : "SIGTERM");
+	} else {
+		snprintf(action, sizeof(action), "renice %d", policy->nice);
+	}
+
+	int rc = 0;
+	if (!dry_run) {
+		rc = sig ? proc_signal_process(proc->pid, proc->start_time, sig) :
+			   proc_renice_process(proc->pid, proc->start_time,
+					       policy->nice);
+	}
+	audit(sb, stamp, policy, action, proc,
+	      dry_run ? "dry-run" : rc == 0 ? "ok" : strerror(errno));
+	policy->actions++;
+	return rc;
+}
+
+/**
+ * @brief Decide what a tracked process gets at this sample.
+ *
+ * @param sb Audit text.
+ * @param stamp UTC time stamp.
+ * @param policy Policy.
+ * @param track Process state.
+ * @param proc Process.
+ * @param match Whether it matches at this sample.
+ * @param now Current time.
+ * @return Number of actions taken (0 or 1).
+ */
+static int decide(strbuf_t *sb, const char *stamp, policy_t *policy,
+		  policy_track_t *track, const proc_info_t *proc, int match,
+		  double now) {
+	if (track->done) {
+		return 0;
+	}
+
+	/* Escalation of a SIGTERM that was not obeyed is never limited */
+	if (track->term_at >= 0) {
+		if (now - track->term_at < policy->grace) {
+			return 0;
+		}
+		track->done = 1;
+		act(sb, stamp, policy, proc, SIGKILL);
+		return 1;
+	}
+	if (!match || track->samples < policy->samples) {
+		return 0;
+	}
+
+	if (!rate_allows(policy, now)) {
+		policy->suppressed++;
+		if (!track->limited) {
+			track->limited = 1;
+			audit(sb, stamp, policy, policy->action == POLICY_KILL ?
+			      "SIGTERM" : "renice", proc, "rate-limited");
+		}
+		return 0;
+	}
+	if (policy->action == POLICY_RENICE) {
+		track->done = 1;
+		act(sb, stamp, policy, proc, 0);
+	} else if (act(sb, stamp, policy, proc, SIGTERM) == 0) {
+		track->term_at = now;
+	} else {
+		track->done = 1;
+	}
+	return 1;
+}
+
+/**
+ * @brief Track and act on the processes of one policy.
+ *
+ * The sorted matches are merge-joined with the previous tracks. Processes
+ * that got SIGTERM stay tracked while they are listed, matching or not,
+ * so they are escalated to SIGKILL after the grace time.
+ *
+ * @param index Policy index.
+ * @param plist Processes (sorted by PID).
+ * @param match Match flag of every row.
+ * @param sb Audit text.
+ * @param stamp UTC time stamp.
+ * @param now Current time.
+ * @return Number of actions taken.
+ */
+static int apply(int index, const proc_list_t *plist,
+		 const unsigned char *match, strbuf_t *sb, const char *stamp,
+		 double now) {
+	policy_t *policy = &policies[index];
+	policy_track_t *old = tracks[index];
+	pid_t self = getpid();
+	int old_idx = 0;
+	int count = 0;
+	int actions = 0;
+
+	for (int row = 0; row < plist->count && count < POLICY_TRACKED; row++) {
+		const proc_info_t *proc = &plist->list[row];
+		while (old_idx < policy->track_count &&
+		       old[old_idx].pid < proc->pid) {
+			old_idx++;
+		}
+		const policy_track_t *previous = NULL;
+		if (old_idx < policy->track_count &&
+		    old[old_idx].pid == proc->pid &&
+		    old[old_idx].start_time == proc->start_time) {
+			previous = &old[old_idx];
+		}
+		int condemned = previous && previous->term_at >= 0 &&
+				!previous->done;
+		if ((!match[row] && !condemned) || proc->pid <= 1 ||
+		    proc->pid == self) {
+			continue;
+		}
+
+		policy_track_t *track = &merged[count++];
+		if (previous) {
+			*track = *previous;
+		} else {
+			memset(track, 0, sizeof(*track));
+			track->pid = proc->pid;
+			track->start_time = proc->start_time;
+			track->term_at = -1;
+		}
+		track->samples = match[row] ? track->samples + 1 : 0;
+		actions += decide(sb, stamp, policy, track, proc, match[row],
+				  now);
+	}
+	memcpy(old, merged, count * sizeof(policy_track_t));
+	policy->track_count = count;
+	return actions;
+}
+
+/**
+ * @brief Append the audit text of one evaluation to the log.
+ *
+ * @param sb Audit text.
+ */
+static void flush_audit(strbuf_t *sb) {
+	if (audit_fd < 0 || sb->length == 0) {
+		return;
+	}
+	if (sb->overflow) {
+		/* Room was kept for this line (see policy_evaluate()) */
+		sb->capacity = sizeof(audit_text);
+		sb->overflow = 0;
+		strbuf_printf(sb, "audit lines dropped: buffer full\n");
+	}
+	ssize_t written;
+	do {
+		written = write(audit_fd, sb->buffer, sb->length);
+	} while (written < 0 && errno == EINTR);
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Add a policy from its text form.
+ *
+ * @param line Policy text.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return 1 if a policy was added, 0 for a blank line, -1 on an error.
+ */
+int policy_add(const char *line, char *error, size_t error_size) {
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer), "%s", line);
+	char *text = rules_trim(buffer);
+	if (!*text || *text == '#') {
+		return 0;
+	}
+	if (policy_total >= POLICY_MAX) {
+		return rules_error(error, error_size, "too many policies", "");
+	}
+
+	policy_t *policy = &policies[policy_total];
+	memset(policy, 0, sizeof(*policy));
+	policy->samples = 1;
+	policy->grace = POLICY_GRACE;
+	policy->limit = POLICY_LIMIT;
+	policy->window = POLICY_WINDOW;
+
+	/* name: */
+	text = rules_name(text, policy->name, sizeof(policy->name), error,
+			  error_size);
+	if (!text) {
+		return -1;
+	}
+
+	/* Action keyword */
+	size_t word_len = strcspn(text, " \t");
+	if (word_len == 4 && strncasecmp(text, "kill", 4) == 0) {
+		policy->action = POLICY_KILL;
+		text = rules_trim(text + word_len);
+	} else if (word_len == 6 && strncasecmp(text, "renice", 6) == 0) {
+		policy->action = POLICY_RENICE;
+		text = rules_trim(text + word_len);
+		char *nice = text;
+		text += strcspn(text, " \t");
+		if (*text) {
+			*text++ = '\0';
+		}
+		if (parse_int(nice, -20, 19, &policy->nice) < 0) {
+			return rules_error(error, error_size,
+					   "expected nice value", nice);
+		}
+	} else {
+		return rules_error(error, error_size, "expected kill or renice",
+				   text);
+	}
+
+	/* Trailing clauses, in any order: cut the rightmost one each time */
+	static const char *const clauses[] = { " for ", " grace ", " limit " };
+	int seen = 0;
+	for (;;) {
+		char *last = NULL;
+		int clause = -1;
+		for (int i = 0; i < 3; i++) {
+			for (char *p = strstr(text, clauses[i]); p;
+			     p = strstr(p + 1, clauses[i])) {
+				if (p > last) {
+					last = p;
+					clause = i;
+				}
+			}
+		}
+		if (!last) {
+			break;
+		}
+		if (seen & (1 << clause)) {
+			return rules_error(error, error_size, "repeated clause",
+					   rules_trim(last));
+		}
+		seen |= 1 << clause;
+		*last = '\0';
+		if (parse_clause(policy, clause,
+				 rules_trim(last + strlen(clauses[clause])), error,
+				 error_size) < 0) {
+			return -1;
+		}
+	}
+
+	if (expr_compile(rules_trim(text), &policy->where, error, error_size) < 0) {
+		return -1;
+	}
+	policy_total++;
+	return 1;
+}
+
+/**
+ * @brief Add every policy of a file.
+ *
+ * @param path Policy file.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of policies added, or -1.
+ */
+int policy_load(const char *path, char *error, size_t error_size) {
+	int first = policy_total;
+	int rc = rules_read_file(path, policy_add, error, error_size);
+	if (rc < 0) {
+		policy_total = first;
+	}
+	return rc;
+}
+
+/**
+ * @brief Remove every policy.
+ */
+void policy_clear(void) {
+	policy_total = 0;
+}
+
+/**
+ * @brief Get the number of loaded policies.
+ *
+ * @return Number of policies.
+ */
+int policy_count(void) {
+	return policy_total;
+}
+
+/**
+ * @brief Turn dry-run mode on or off.
+ *
+ * @param enabled Non-zero to only audit.
+ */
+void policy_set_dry_run(int enabled) {
+	dry_run = enabled;
+}
+
+/**
+ * @brief Send the audit log to a descriptor.
+ *
+ * @param fd Descriptor, or -1 for none.
+ */
+void policy_set_audit(int fd) {
+	if (audit_owned && audit_fd >= 0) {
+		close(audit_fd);
+	}
+	audit_fd = fd;
+	audit_owned = 0;
+}
+
+/**
+ * @brief Open an audit log file for appending.
+ *
+ * @param path Log file.
+ * @return 0 on success, -1 on failure.
+ */
+int policy_open_audit(const char *path) {
+	int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		return -1;
+	}
+	policy_set_audit(fd);
+	audit_owned = 1;
+	return 0;
+}
+
+/**
+ * @brief Evaluate every policy against a new list of processes.
+ *
+ * @param plist Processes sorted by PID.
+ * @param now Monotonic time in seconds.
+ * @return Number of actions taken.
+ */
+int policy_evaluate(const proc_list_t *plist, double now) {
+	if (policy_total == 0) {
+		return 0;
+	}
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	unsigned char *match = arena_alloc(arena, plist->count + 1);
+	if (!match) {
+		return 0;
+	}
+
+	char stamp[32];
+	time_t wall = time(NULL);
+	struct tm utc;
+	gmtime_r(&wall, &utc);
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+	/* The last line is kept free for the overflow note */
+	strbuf_t sb;
+	strbuf_init(&sb, audit_text, sizeof(audit_text) - 64);
+
+	expr_columns_t columns;
+	expr_columns_init(&columns, plist);
+
+	int actions = 0;
+	for (int i = 0; i < policy_total; i++) {
+		int matches = expr_match_columns(&policies[i].where, &columns,
+						 match);
+		if (matches < 0) {
+			continue;
+		}
+		policies[i].matches = matches;
+		actions += apply(i, plist, match, &sb, stamp, now);
+	}
+
+	flush_audit(&sb);
+	arena_rewind(arena, mark);
+	return actions;
+}
+
+/**
+ * @brief Get the state of a policy.
+ *
+ * @param index Policy index.
+ * @param status Output.
+ * @return 0 on success, -1 if index is out of range.
+ */
+int policy_status(int index, policy_status_t *status) {
+	if (index < 0 || index >= policy_total) {
+		return -1;
+	}
+	const policy_t *policy = &policies[index];
+	status->name = policy->name;
+	status->action = policy->action;
+	status->nice = policy->nice;
+	status->samples = policy->samples;
+	status->grace = policy->grace;
+	status->limit = policy->limit;
+	status->window = policy->window;
+	status->matches = policy->matches;
+	status->actions = policy->actions;
+	status->suppressed = policy->suppressed;
+	return 0;
+}
@@ -0,0 +1,160 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "proc.h"
+
+/**
+ * @brief Maximum number of loaded policies.
+ */
+#define POLICY_MAX 32
+
+/**
+ * @brief Processes tracked per policy.
+ */
+#define POLICY_TRACKED 256
+
+/**
+ * @brief Maximum length of a policy name.
+ */
+#define POLICY_NAME 32
+
+/**
+ * @brief Seconds between SIGTERM and SIGKILL unless "grace" is given.
+ */
+#define POLICY_GRACE 5.0
+
+/**
+ * @brief Actions per window unless "limit" is given.
+ */
+#define POLICY_LIMIT 5
+
+/**
+ * @brief Window of the default rate limit, in seconds.
+ */
+#define POLICY_WINDOW 60.0
+
+/**
+ * @brief Size of the audit text collected during one evaluation.
+ */
+#define POLICY_AUDIT_SIZE 16384
+
+/**
+ * @brief What a policy does to a matching process.
+ */
+typedef enum {
+	POLICY_KILL,    /**< SIGTERM, then SIGKILL after the grace time */
+	POLICY_RENICE   /**< Set the nice value once */
+} PolicyAction;
+
+/**
+ * @brief Read-only view of a policy.
+ */
+typedef struct {
+	const char *name;        /**< Policy name */
+	PolicyAction action;     /**< What it does */
+	int nice;                /**< Nice value (renice) */
+	int samples;             /**< Consecutive matching samples required */
+	double grace;            /**< Seconds between SIGTERM and SIGKILL */
+	int limit;               /**< Actions allowed per window */
+	double window;           /**< Rate limit window in seconds */
+	int matches;             /**< Processes matching at the last sample */
+	unsigned long actions;   /**< Actions taken (or simulated) so far */
+	unsigned long suppressed;/**< Actions held back by the rate limit */
+} policy_status_t;
+
+/**
+ * @brief Adds a policy from its text form.
+ *
+ * One policy per line:
+ *
+ *     name: kill EXPR [for N [samples]] [grace DURATION] [limit N/DURATION]
+ *     name: renice NICE EXPR [for N [samples]] [limit N/DURATION]
+ *
+ * EXPR is a filter expression (see expr.h). A process is acted on once it
+ * matched N refreshes in a row (default 1); "kill" sends SIGTERM and, if
+ * the same process is still alive after the grace time (default
+ * POLICY_GRACE), SIGKILL. At most "limit" processes are acted on per
+ * window (default POLICY_LIMIT per POLICY_WINDOW); escalations to SIGKILL
+ * are not limited. PID 1 and pb itself are never acted on. Examples:
+ *
+ *     rsscap: kill rss > 4G and user == batch for 3 grace 10s limit 2/1m
+ *     hogs: renice 10 cpu > 90 for 5
+ *
+ * Blank lines and lines starting with '#' are accepted and ignored.
+ *
+ * @param line Policy text.
+ * @param error Output for a message on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return 1 if a policy was added, 0 for a blank line, -1 on an error.
+ */
+int policy_add(const char *line, char *error, size_t error_size);
+
+/**
+ * @brief Adds every policy of a file.
+ *
+ * @param path Policy file.
+ * @param error Output for "line N: message" on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of policies added, or -1 (nothing is added on an error).
+ */
+int policy_load(const char *path, char *error, size_t error_size);
+
+/**
+ * @brief Removes every policy and forgets tracked processes.
+ */
+void policy_clear(void);
+
+/**
+ * @brief Gets the number of loaded policies.
+ *
+ * @return Number of policies.
+ */
+int policy_count(void);
+
+/**
+ * @brief Turns dry-run mode on or off.
+ *
+ * In dry-run mode every action is decided, rate limited and audited as
+ * usual, but no signal is sent and no priority changed.
+ *
+ * @param dry_run Non-zero to only audit.
+ */
+void policy_set_dry_run(int dry_run);
+
+/**
+ * @brief Sends the audit log to a descriptor.
+ *
+ * @param fd Descriptor (not closed by the policy engine), or -1 for none.
+ */
+void policy_set_audit(int fd);
+
+/**
+ * @brief Opens (appends to) an audit log file.
+ *
+ * @param path Log file, created with mode 0600 if needed.
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int policy_open_audit(const char *path);
+
+/**
+ * @brief Evaluates every policy against a new list of processes.
+ *
+ * Each refresh counts as one sample. The audit lines of all actions taken
+ * are collected in memory and appended to the log with a single write.
+ *
+ * @param plist Processes sorted by PID (as from proc_list_update()).
+ * @param now Monotonic time in seconds.
+ * @return Number of actions taken (or simulated in dry-run mode).
+ */
+int policy_evaluate(const proc_list_t *plist, double now);
+
+/**
+ * @brief Gets the state of a policy.
+ *
+ * @param index Policy index (0 to policy_count() - 1).
+ * @param status Output.
+ * @return 0 on success, -1 if index is out of range.
+ */
+int policy_status(int index, policy_status_t *status);
+
+#endif // POLICY_H
@@ -4,100 +4,224 @@
  */
 
 #include "proc.h"
+#include "fdscan.h"
+#include "net.h"
+#include "procio.h"
+#include "sort.h"
+#include "arena.h"
+#include "rollup.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
 #include <dirent.h>
-#include <ctype.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <errno.h>
 #include <pwd.h>
 
+static unsigned long long prev_system_time = 0;
+
 /*
- * Max PID value to track history. Usually goes up to 32768,
- * but 131072 is safe for modern systems.
+ * Previous frame's table, sorted by PID. New frames are merge-joined
+ * against it, so surviving processes keep their cached fields.
  */
-static unsigned long long cpu_history[131072] = {0};
-static unsigned long long prev_system_time = 0;
+static proc_info_t previous[MAX_PROCESSES];
+static int previous_count = 0;
+static proc_events_t events;
+
+/* Enumeration state: /proc stays open and is rewound for every scan */
+static char root_path[PROC_ROOT_MAX] = "/proc";
+static int proc_dir_fd = -1;
+static char proc_dents[131072];
+static pid_scan_t pid_scan;
+
+/* UID -> user name, so getpwuid (which allocates) runs once per user */
+#define USER_CACHE_SIZE 64
+static struct {
+	uid_t uid;
+	char name[32];
+} user_cache[USER_CACHE_SIZE];
+static int user_cache_count = 0;
+
+/* Batched reader of stat/statm (io_uring when available) */
+static procio_t *procio = NULL;
 
 /* HELPER FUNCTIONS */
 
 /**
- * @brief Read process name from /proc/[pid]/comm.
+ * @brief Parse Resident Set Size from /proc/[pid]/statm contents.
  *
- * @param pid Process ID.
- * @param buffer Output buffer.
- * @param buf_size Size of output buffer.
+ * @param statm Contents of statm (size resident shared ... in pages).
+ * @return Memory usage in kilobytes.
  */
-static void read_process_name(pid_t pid, char *buffer, size_t buf_size) {
-	char path[256];
-	snprintf(path, sizeof(path), "/proc/%d/comm", pid);
-	FILE *f = fopen(path, "r");
-
-	if (f) {
-		if (fgets(buffer, buf_size, f)) {
-			/* Remove trailing newline */
-			buffer[strcspn(buffer, "\n")] = 0;
+static long parse_process_memory(const char *statm) {
+	static long page_kb = 0;
+	long resident = 0;
+
+	if (page_kb == 0) {
+		page_kb = sysconf(_SC_PAGESIZE) / 1024;
+		if (page_kb < 1) {
+			page_kb = 4;
 		}
-		fclose(f);
-	} else {
-		snprintf(buffer, buf_size, "unknown");
 	}
+	if (sscanf(statm, "%*d %ld", &resident) != 1) {
+		return 0;
+	}
+	return resident * page_kb;
 }
 
 /**
- * @brief Read Resident Set Size memory from /proc/[pid]/status.
+ * @brief Resolve username owner of process via /proc/[pid] stats.
+ *
+ * Falls back to numeric UID if username lookup fails. Names are cached per
+ * UID, so the passwd database is consulted once per user.
  *
  * @param pid Process ID.
- * @return Memory usage in kilobytes.
+ * @param uid Output for the owner UID ((uid_t)-1 if unknown).
+ * @param buffer Output buffer for username.
+ * @param buf_size Size of buffer.
  */
-static long read_process_memory(pid_t pid) {
-	char path[256];
-	char line[256];
-	long memory = 0;
-
-	snprintf(path, sizeof(path), "/proc/%d/status", pid);
-	FILE *f = fopen(path, "r");
+static void read_process_user(pid_t pid, uid_t *uid, char *buffer,
+			      size_t buf_size) {
+	char path[16];
+	struct stat info;
 
-	if (!f) {
-		return 0;
+	snprintf(path, sizeof(path), "%d", pid);
+	if (fstatat(proc_dir_fd, path, &info, 0) != 0) {
+		*uid = (uid_t)-1;
+		snprintf(buffer, buf_size, "?");
+		return;
 	}
+	*uid = info.st_uid;
 
-	while (fgets(line, sizeof(line), f)) {
-		if (strncmp(line, "VmRSS:", 6) == 0) {
-			sscanf(line, "VmRSS: %ld", &memory);
-			break;
+	for (int i = 0; i < user_cache_count; i++) {
+		if (user_cache[i].uid == info.st_uid) {
+			snprintf(buffer, buf_size, "%s", user_cache[i].name);
+			return;
 		}
 	}
-	fclose(f);
-	return memory;
+
+	struct passwd *pw = getpwuid(info.st_uid);
+	if (pw) {
+		strncpy(buffer, pw->pw_name, buf_size - 1);
+		buffer[buf_size - 1] = 0;
+	} else {
+		/* Fallback to UID if name not found */
+		snprintf(buffer, buf_size, "%d", info.st_uid);
+	}
+
+	if (user_cache_count < USER_CACHE_SIZE) {
+		user_cache[user_cache_count].uid = info.st_uid;
+		snprintf(user_cache[user_cache_count].name,
+			 sizeof(user_cache[0].name), "%s", buffer);
+		user_cache_count++;
+	}
 }
 
 /**
- * @brief Resolve username owner of process via /proc/[pid] stats.
+ * @brief Read the cgroup path of a process from /proc/[pid]/cgroup.
  *
- * Falls back to numeric UID if username lookup fails.
+ * Uses the unified hierarchy ("0::path") or the first line on cgroup v1.
+ * The container id is taken from the whole path, before it is cut to the
+ * buffer (Kubernetes paths are longer than proc_info_t.cgroup).
  *
  * @param pid Process ID.
- * @param buffer Output buffer for username.
+ * @param buffer Output buffer for the path ("" if unreadable).
  * @param buf_size Size of buffer.
+ * @param container Output buffer for the container id.
+ * @param container_size Size of container.
  */
-static void read_process_user(pid_t pid, char *buffer, size_t buf_size) {
-	char path[256];
-	struct stat info;
+static void read_process_cgroup(pid_t pid, char *buffer, size_t buf_size,
+				char *container, size_t container_size) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/cgroup", root_path, pid);
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	char *contents = arena_read_file(arena, path, 4096, NULL);
+	buffer[0] = '\0';
+	container[0] = '\0';
+	if (contents) {
+		/* Format is "id:controllers:path" */
+		char *line = strstr(contents, "0::/");
+		if (line != contents && (!line || line[-1] != '\n')) {
+			line = contents;
+		}
+		line[strcspn(line, "\n")] = '\0';
+		const char *group = strrchr(line, ':');
+		group = group ? group + 1 : line;
+		snprintf(buffer, buf_size, "%.*s", (int)buf_size - 1, group);
+		proc_container_id(group, container, container_size);
+	}
+	arena_rewind(arena, mark);
+}
 
-	snprintf(path, sizeof(path), "/proc/%d", pid);
-	if (stat(path, &info) == 0) {
-		struct passwd *pw = getpwuid(info.st_uid);
-		if (pw) {
-			strncpy(buffer, pw->pw_name, buf_size - 1);
-			buffer[buf_size - 1] = 0;
-			return;
+/**
+ * @brief Read the PID and mount namespace of a process.
+ *
+ * NStgid (or NSpid on kernels without it) of /proc/[pid]/status lists the
+ * process's PID in every namespace from the one of /proc down to its own;
+ * the last value is what the process sees as its PID. Both lines come
+ * from one read of status.
+ *
+ * @param pid Process ID.
+ * @param proc Output: ns_pid, ns_level, pid_ns and mnt_ns.
+ */
+static void read_process_namespaces(pid_t pid, proc_info_t *proc) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/status", root_path, pid);
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	char *contents = arena_read_file(arena, path, 4096, NULL);
+	const char *nstgid = NULL;
+	const char *nspid = NULL;
+	for (char *line = contents; line && *line; ) {
+		if (strncmp(line, "NStgid:", 7) == 0) {
+			nstgid = line + 7;
+		} else if (strncmp(line, "NSpid:", 6) == 0) {
+			nspid = line + 6;
+		}
+		line = strchr(line, '\n');
+		if (line) {
+			line++;
+		}
+	}
+
+	/* Last number of the line, one level per number */
+	const char *ids = nstgid ? nstgid : nspid;
+	proc->ns_pid = 0;
+	proc->ns_level = 0;
+	while (ids) {
+		char *end;
+		long value = strtol(ids, &end, 10);
+		if (end == ids) {
+			break;
 		}
+		if (proc->ns_pid) {
+			proc->ns_level++;
+		}
+		proc->ns_pid = (pid_t)value;
+		ids = *end == '\n' ? NULL : end;
+	}
+	arena_rewind(arena, mark);
+
+	/* Links read "pid:[4026531836]" */
+	const char *kinds[] = { "pid", "mnt" };
+	unsigned long *inodes[] = { &proc->pid_ns, &proc->mnt_ns };
+	for (int i = 0; i < 2; i++) {
+		char link[64];
+		snprintf(path, sizeof(path), "%d/ns/%s", pid, kinds[i]);
+		ssize_t len = readlinkat(proc_dir_fd, path, link,
+					 sizeof(link) - 1);
+		link[len > 0 ? len : 0] = '\0';
+		const char *bracket = strchr(link, '[');
+		*inodes[i] = bracket ? strtoul(bracket + 1, NULL, 10) : 0;
 	}
-	/* Fallback to UID if name not found */
-	snprintf(buffer, buf_size, "%d", info.st_uid);
 }
 
 /**
@@ -108,107 +232,355 @@ static void read_process_user(pid_t pid, char *buffer, size_t buf_size) {
  * @return Total system CPU ticks.
  */
 static unsigned long long get_system_time() {
-	FILE *f = fopen("/proc/stat", "r");
-
-	if (!f) {
-		return 0;
-	}
-
-	char line[256];
-	if (fgets(line, sizeof(line), f)) {
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	unsigned long long total = 0;
+
+	/* Only the first line (aggregate CPU usage) is needed */
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/stat", root_path);
+	char *line = arena_read_file(arena, path, 512, NULL);
+	if (line) {
 		unsigned long long user, nice, system, idle;
 		unsigned long long iowait, irq, softirq, steal;
 
-		/* Read first line (aggregate CPU usage) */
 		if (sscanf(line, "cpu  %llu %llu %llu %llu %llu %llu "
 			   "%llu %llu", &user, &nice, &system, &idle,
 			   &iowait, &irq, &softirq, &steal) >= 4) {
-			fclose(f);
-			return user + nice + system + idle + iowait +
-			       irq + softirq + steal;
+			total = user + nice + system + idle + iowait +
+				irq + softirq + steal;
 		}
 	}
-	fclose(f);
-	return 0;
+	arena_rewind(arena, mark);
+	return total;
 }
 
 /**
- * @brief Read total CPU time spent by specific process.
+ * @brief Parse name, state, threads, CPU and start time from /proc/[pid]/stat.
  *
- * Parses /proc/[pid]/stat to retrieve utime and stime.
- * Handles process names with spaces correctly.
+ * The name is taken from the parenthesized comm field (same content as
+ * /proc/[pid]/comm), so no separate file has to be opened for it.
+ * Handles process names with spaces and parentheses correctly.
  *
- * @param pid Process ID.
- * @return Total process CPU ticks (user + system).
+ * @param buffer Contents of stat.
+ * @param proc Process entry whose name, state and thread count are filled.
+ * @param ticks Output for total process CPU ticks (user + system).
+ * @param start_time Output for start time in ticks since boot.
+ * @return 0 on success, -1 if the contents are malformed.
  */
-static unsigned long long get_process_time(pid_t pid) {
-	char path[256];
-	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
-	FILE *f = fopen(path, "r");
+static int parse_process_stat(const char *buffer, proc_info_t *proc,
+			      unsigned long long *ticks,
+			      unsigned long long *start_time) {
+	/*
+	 * Find end of process name (last closing parenthesis)
+	 * to handle names with spaces like "(Web Content)".
+	 */
+	const char *lpar = strchr(buffer, '(');
+	const char *rpar = strrchr(buffer, ')');
+	if (!lpar || !rpar || rpar < lpar) {
+		return -1;
+	}
 
-	if (!f) {
-		return 0;
+	size_t len = rpar - lpar - 1;
+	if (len >= sizeof(proc->name)) {
+		len = sizeof(proc->name) - 1;
 	}
+	memcpy(proc->name, lpar + 1, len);
+	proc->name[len] = '\0';
+	proc->name_hash = proc_name_hash(proc->name);
 
+	/*
+	 * Parsing format based on `man proc`.
+	 * state is 3rd, utime is 14th, stime is 15th, num_threads is 20th,
+	 * starttime is 22nd.
+	 */
 	unsigned long long utime = 0, stime = 0;
-	char buffer[1024];
+	int ok = sscanf(rpar + 2, "%c %*d %*d %*d %*d %*d %*u "
+			"%*u %*u %*u %*u %llu %llu %*d %*d %*d "
+			"%*d %d %*d %llu", &proc->state, &utime, &stime,
+			&proc->threads, start_time) == 5;
+	*ticks = utime + stime;
+	return ok ? 0 : -1;
+}
 
-	if (fgets(buffer, sizeof(buffer), f)) {
-		/*
-		 * Find end of process name (last closing parenthesis)
-		 * to handle names with spaces like "(Web Content)".
-		 */
-		char *rpar = strrchr(buffer, ')');
-		if (rpar) {
-			/* Data starts after the parenthesis */
-			char *token = rpar + 2;
-			unsigned long long temp;
-			char c_temp;
-			int i_temp;
+/**
+ * @brief Parse a directory name as PID, checking digits on the fly.
+ *
+ * @param name Entry name.
+ * @return PID, or -1 if the name is not purely numeric.
+ */
+static pid_t parse_pid(const char *name) {
+	pid_t pid = 0;
 
-			/*
-			 * Parsing format based on `man proc`.
-			 * utime is 14th, stime is 15th.
-			 */
-			sscanf(token, "%c %d %d %d %d %d %u %llu %llu "
-			       "%llu %llu %llu %llu", &c_temp, &i_temp,
-			       &i_temp, &i_temp, &i_temp, &i_temp,
-			       (unsigned *)&i_temp, &temp, &temp, &temp,
-			       &temp, &utime, &stime);
+	if (!name[0]) {
+		return -1;
+	}
+	for (const char *p = name; *p; p++) {
+		unsigned int digit = (unsigned int)(*p - '0');
+		if (digit > 9) {
+			return -1;
 		}
+		pid = pid * 10 + (pid_t)digit;
+	}
+	return pid;
+}
+
+/**
+ * @brief Comparator for sorting PIDs (ascending).
+ *
+ * @param a Pointer to first PID.
+ * @param b Pointer to second PID.
+ * @return Negative if a < b, positive if a > b, zero if equal.
+ */
+static int compare_pid_value(const void *a, const void *b) {
+	pid_t pa = *(const pid_t *)a;
+	pid_t pb = *(const pid_t *)b;
+	return (pa > pb) - (pa < pb);
+}
+
+/**
+ * @brief Make sure the scan buffer can hold at least the given number of PIDs.
+ *
+ * @param scan Scan buffer.
+ * @param needed Required capacity.
+ * @return 0 on success, -1 if memory is exhausted.
+ */
+static int reserve_pids(pid_scan_t *scan, int needed) {
+	if (needed <= scan->capacity) {
+		return 0;
 	}
-	fclose(f);
-	return utime + stime;
+
+	pid_t *grown = realloc(scan->pids, needed * sizeof(pid_t));
+	if (!grown) {
+		return -1;
+	}
+	scan->pids = grown;
+	scan->capacity = needed;
+	return 0;
+}
+
+/**
+ * @brief Check that a PID still belongs to the process started at a time.
+ *
+ * @param pid Process ID.
+ * @param start_time Expected start time in ticks since boot.
+ * @return 1 if it does, 0 if the process is gone or the PID was reused.
+ */
+static int process_started_at(pid_t pid, unsigned long long start_time) {
+	char path[32];
+	char buffer[1024];
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return 0;
+	}
+	ssize_t len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (len <= 0) {
+		return 0;
+	}
+	buffer[len] = '\0';
+
+	proc_info_t scratch;
+	unsigned long long ticks, started;
+	return parse_process_stat(buffer, &scratch, &ticks, &started) == 0 &&
+	       started == start_time;
 }
 
 /* MAIN FUNCTIONS */
 
+/**
+ * @brief Enumerate all PIDs in /proc with getdents64.
+ *
+ * @param scan Scan buffer (zero-initialized before first use).
+ * @param want_sorted If non-zero, PIDs are returned in ascending order.
+ * @return Number of PIDs found, or -1 if /proc cannot be read.
+ */
+int proc_scan_pids(pid_scan_t *scan, int want_sorted) {
+	if (proc_dir_fd < 0) {
+		proc_dir_fd = open(root_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (proc_dir_fd < 0) {
+			return -1;
+		}
+	} else if (lseek(proc_dir_fd, 0, SEEK_SET) < 0) {
+		return -1;
+	}
+
+	/* Room for last frame's PIDs plus headroom for new ones */
+	if (reserve_pids(scan, scan->count + scan->count / 4 + 256) < 0) {
+		return -1;
+	}
+
+	scan->count = 0;
+	scan->sorted = 1;
+	long n;
+	while ((n = getdents64(proc_dir_fd, proc_dents,
+			       sizeof(proc_dents))) > 0) {
+		for (long off = 0; off < n;) {
+			struct dirent64 *entry =
+				(struct dirent64 *)(proc_dents + off);
+			off += entry->d_reclen;
+
+			if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+				continue;
+			}
+			pid_t pid = parse_pid(entry->d_name);
+			if (pid <= 0) {
+				continue;
+			}
+
+			if (scan->count == scan->capacity &&
+			    reserve_pids(scan, scan->capacity * 2) < 0) {
+				return -1;
+			}
+			if (scan->count > 0 && pid < scan->pids[scan->count - 1]) {
+				scan->sorted = 0;
+			}
+			scan->pids[scan->count++] = pid;
+		}
+	}
+
+	/* The kernel lists PIDs in ascending order, so this rarely sorts */
+	if (want_sorted && !scan->sorted) {
+		sort_array(scan->pids, scan->count, sizeof(pid_t),
+			   compare_pid_value);
+		scan->sorted = 1;
+	}
+	return scan->count;
+}
+
+/**
+ * @brief Release the memory of a scan buffer.
+ *
+ * @param scan Scan buffer to free.
+ */
+void proc_scan_free(pid_scan_t *scan) {
+	free(scan->pids);
+	scan->pids = NULL;
+	scan->count = 0;
+	scan->capacity = 0;
+}
+
+/**
+ * @brief Hash a process name (FNV-1a).
+ *
+ * @param name Process name.
+ * @return Hash value.
+ */
+unsigned int proc_name_hash(const char *name) {
+	unsigned int hash = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+		hash = (hash ^ *p) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief Extract a container id from a cgroup path.
+ *
+ * @param cgroup cgroup path.
+ * @param out Output buffer ("" if the path names no container).
+ * @param out_size Size of out.
+ */
+void proc_container_id(const char *cgroup, char *out, size_t out_size) {
+	const char *id = NULL;
+	const char *p = cgroup;
+
+	/* Last run of exactly 64 hex digits */
+	while (*p) {
+		size_t len = strspn(p, "0123456789abcdef");
+		if (len == 64) {
+			id = p;
+		}
+		p += len ? len : 1;
+	}
+	snprintf(out, out_size, "%.*s", id ? 12 : 0, id ? id : "");
+}
+
+/**
+ * @brief Map a state letter to its index in proc_list_t.states.
+ *
+ * @param state State letter from /proc/[pid]/stat.
+ * @return Index into PROC_STATES, or -1 if the state is not counted.
+ */
+int proc_state_index(char state) {
+	if (state == 't') {
+		/* Stopped by a tracer counts as stopped */
+		state = 'T';
+	}
+	const char *letter = state ? strchr(PROC_STATES, state) : NULL;
+	return letter ? (int)(letter - PROC_STATES) : -1;
+}
+
+/**
+ * @brief Read processes from another directory laid out like /proc.
+ *
+ * @param root Directory.
+ * @return 0 on success, -1 if the path is too long.
+ */
+int proc_set_root(const char *root) {
+	if (strlen(root) >= sizeof(root_path)) {
+		return -1;
+	}
+	snprintf(root_path, sizeof(root_path), "%s", root);
+	if (proc_dir_fd >= 0) {
+		close(proc_dir_fd);
+		proc_dir_fd = -1;
+	}
+	procio_close(procio);
+	procio = NULL;
+	return 0;
+}
+
+/**
+ * @brief Get the directory processes are read from.
+ *
+ * @return Root directory.
+ */
+const char *proc_root(void) {
+	return root_path;
+}
+
 /**
  * @brief Initialize process list structure.
  *
- * Resets count to zero and clears internal CPU history buffers.
+ * Resets count to zero and clears the previous frame's table,
+ * descriptor samples and socket tables.
  *
  * @param plist Pointer to process list to initialize.
  */
 void proc_list_init(proc_list_t *plist) {
 	plist->count = 0;
+	plist->total = 0;
+	memset(plist->states, 0, sizeof(plist->states));
 	/* Clear history on startup */
-	memset(cpu_history, 0, sizeof(cpu_history));
+	previous_count = 0;
+	events.added_count = 0;
+	events.exited_count = 0;
+	fdscan_init();
+	net_init();
+	rollup_reset();
+	if (!procio) {
+		procio = procio_open(MAX_PROCESSES, PROCIO_AUTO);
+	}
 }
 
 /**
  * @brief Update process list by reading /proc directory.
  *
- * Scans /proc for running processes, calculates CPU usage since last update,
- * and populates list with current data. CPU calculation uses delta method
- * comparing process ticks against system ticks between updates.
+ * Enumerates /proc with getdents64 (PIDs in ascending order), reads
+ * stat and statm of all PIDs in one procio batch (io_uring when the kernel
+ * allows it) and merge-joins the result with the previous frame's table. Surviving
+ * processes keep cached static fields (user) and their CPU tick baseline;
+ * new and exited PIDs are recorded as events (see proc_list_events()).
+ * CPU calculation uses delta method comparing process ticks against system
+ * ticks between updates. If more than MAX_PROCESSES exist, the lowest PIDs
+ * are kept and total reports the real number; a process pushed past the
+ * cap is not reported as exited (it is reported as new if it returns).
  *
  * @param plist Pointer to process list to update.
  */
 void proc_list_update(proc_list_t *plist) {
-	DIR *dir;
-	struct dirent *entry;
-
 	/* Calculate system time NOW */
 	unsigned long long current_system_time = get_system_time();
 	unsigned long long system_delta = 0;
@@ -223,72 +595,165 @@ void proc_list_update(proc_list_t *plist) {
 		num_cores = 1;
 	}
 
-	dir = opendir("/proc");
-	if (!dir) {
+	if (!procio || proc_scan_pids(&pid_scan, 1) < 0) {
 		return;
 	}
 
+	/* stat and statm of every PID in one batch before the merge */
+	int read_count = procio_read(procio, pid_scan.pids, pid_scan.count);
+
+	/*
+	 * Merge-join the sorted PID list with the previous frame's table:
+	 * one linear pass classifies new, surviving and exited processes.
+	 */
+	int prev_idx = 0;
+	events.added_count = 0;
+	events.exited_count = 0;
 	plist->count = 0;
-	while ((entry = readdir(dir)) != NULL) {
-		if (plist->count >= MAX_PROCESSES) {
-			break;
+	plist->total = pid_scan.count;
+	memset(plist->states, 0, sizeof(plist->states));
+
+	for (int n = 0; n < read_count; n++) {
+		pid_t pid = pid_scan.pids[n];
+		proc_info_t *proc = &plist->list[plist->count];
+
+		while (prev_idx < previous_count &&
+		       previous[prev_idx].pid < pid) {
+			rollup_apply(&previous[prev_idx], NULL);
+			events.exited[events.exited_count++] =
+				previous[prev_idx++].pid;
 		}
 
-		/* Processes are directories with numeric names */
-		if (isdigit(entry->d_name[0])) {
-			int pid = atoi(entry->d_name);
-			proc_info_t *proc = &plist->list[plist->count];
+		int survivor = (prev_idx < previous_count &&
+				previous[prev_idx].pid == pid);
+		if (survivor) {
+			/* Carry cached fields (user, fd samples, ...) forward */
+			*proc = previous[prev_idx++];
+		}
+
+		unsigned long long ticks, start_time;
+		const char *stat = procio_stat(procio, n);
+		const char *statm = procio_statm(procio, n);
+		if (!stat || !statm ||
+		    parse_process_stat(stat, proc, &ticks, &start_time) < 0) {
+			/* Exited between enumeration and read */
+			if (survivor) {
+				rollup_apply(&previous[prev_idx - 1], NULL);
+				events.exited[events.exited_count++] = pid;
+			}
+			continue;
+		}
 
-			/* Fill basic info */
+		/* Same PID but different start time: PID was reused */
+		if (survivor && start_time != proc->start_time) {
+			rollup_apply(&previous[prev_idx - 1], NULL);
+			events.exited[events.exited_count++] = pid;
+			survivor = 0;
+		}
+
+		if (!survivor) {
+			char name[sizeof(proc->name)];
+			int threads = proc->threads;
+			char state = proc->state;
+			memcpy(name, proc->name, sizeof(name));
+			memset(proc, 0, sizeof(*proc));
+			memcpy(proc->name, name, sizeof(name));
+			proc->name_hash = proc_name_hash(name);
+			proc->threads = threads;
+			proc->state = state;
 			proc->pid = pid;
-			read_process_name(pid, proc->name,
-					  sizeof(proc->name));
-			proc->memory = read_process_memory(pid);
-			read_process_user(pid, proc->user,
+			proc->fd_count = -1;
+			proc->sock_count = -1;
+			proc->fd_age = -1;
+			read_process_user(pid, &proc->uid, proc->user,
 					  sizeof(proc->user));
+			read_process_cgroup(pid, proc->cgroup,
+					    sizeof(proc->cgroup), proc->container,
+					    sizeof(proc->container));
+			read_process_namespaces(pid, proc);
+			events.added[events.added_count++] = pid;
+		}
 
-			/* CPU CALCULATION */
-			unsigned long long current_proc_time =
-				get_process_time(pid);
-			unsigned long long proc_delta = 0;
-
-			/* Check bounds for history array */
-			if (pid < 131072) {
-				/*
-				 * If we have history for this PID
-				 * and time is valid
-				 */
-				if (cpu_history[pid] > 0 &&
-				    current_proc_time >= cpu_history[pid]) {
-					proc_delta = current_proc_time -
-						     cpu_history[pid];
-				}
-				/* Save current time for next update frame */
-				cpu_history[pid] = current_proc_time;
-			}
+		proc->memory = parse_process_memory(statm);
 
-			/* Calculate percentage */
-			if (system_delta > 0) {
-				/*
-				 * Formula: (Process Delta / System Delta)
-				 * * 100 * Cores
-				 */
-				proc->cpu_usage = (float)proc_delta /
-						  (float)system_delta *
-						  100.0 * num_cores;
-			} else {
-				proc->cpu_usage = 0.0;
-			}
+		/* CPU CALCULATION (new processes have no baseline yet) */
+		unsigned long long proc_delta = 0;
+		if (survivor && ticks >= proc->cpu_ticks) {
+			proc_delta = ticks - proc->cpu_ticks;
+		}
+		proc->cpu_ticks = ticks;
+		proc->start_time = start_time;
+
+		/* Calculate percentage */
+		if (system_delta > 0) {
+			/*
+			 * Formula: (Process Delta / System Delta)
+			 * * 100 * Cores
+			 */
+			proc->cpu_usage = (float)proc_delta /
+					  (float)system_delta *
+					  100.0 * num_cores;
+		} else {
+			proc->cpu_usage = 0.0;
+		}
+
+		/* Per-user totals move by this process's change only */
+		rollup_apply(survivor ? &previous[prev_idx - 1] : NULL, proc);
+		int state = proc_state_index(proc->state);
+		if (state >= 0) {
+			plist->states[state]++;
+		}
+		plist->count++;
+	}
 
-			plist->count++;
+	/*
+	 * PIDs past the cap were scanned but not read: continue the merge over
+	 * them without filling rows, so only PIDs missing from the scan exit.
+	 */
+	for (int n = read_count; n < pid_scan.count && prev_idx < previous_count;
+	     n++) {
+		pid_t pid = pid_scan.pids[n];
+		while (prev_idx < previous_count &&
+		       previous[prev_idx].pid < pid) {
+			rollup_apply(&previous[prev_idx], NULL);
+			events.exited[events.exited_count++] =
+				previous[prev_idx++].pid;
+		}
+		if (prev_idx < previous_count && previous[prev_idx].pid == pid) {
+			/* Still running, only no longer listed */
+			rollup_apply(&previous[prev_idx++], NULL);
 		}
 	}
-	closedir(dir);
+
+	while (prev_idx < previous_count) {
+		rollup_apply(&previous[prev_idx], NULL);
+		events.exited[events.exited_count++] = previous[prev_idx++].pid;
+	}
+
+	/* Direct descriptors of exited PIDs are released in one submission */
+	procio_forget(procio, events.exited, events.exited_count);
+
+	/* Descriptor counts are sampled on a rotating, budgeted schedule */
+	fdscan_update(plist);
+	net_update(plist);
+
+	/* Keep this frame (sorted by PID) as the next merge-join input */
+	memcpy(previous, plist->list, plist->count * sizeof(proc_info_t));
+	previous_count = plist->count;
 
 	/* Save system time for next update */
 	prev_system_time = current_system_time;
 }
 
+/**
+ * @brief Get add/exit events produced by the last update.
+ *
+ * @return Pointer to the events of the last proc_list_update() call.
+ */
+const proc_events_t *proc_list_events(void) {
+	return &events;
+}
+
 /**
  * @brief Filter process list based on search string.
  *
@@ -302,11 +767,17 @@ void proc_list_update(proc_list_t *plist) {
 void proc_list_filter(const proc_list_t *src, proc_list_t *dest,
 		      const char *filter_str) {
 	if (!filter_str || strlen(filter_str) == 0) {
-		*dest = *src;
+		/* Copy only the used entries, not the whole fixed-size table */
+		memcpy(dest->list, src->list, src->count * sizeof(proc_info_t));
+		dest->count = src->count;
+		dest->total = src->total;
+		memcpy(dest->states, src->states, sizeof(dest->states));
 		return;
 	}
 
 	dest->count = 0;
+	dest->total = src->total;
+	memcpy(dest->states, src->states, sizeof(dest->states));
 	for (int i = 0; i < src->count; i++) {
 		/*
 		 * Use strcasestr (non-standard GNU extension,
@@ -332,5 +803,58 @@ int proc_kill_process(pid_t pid) {
 	 * Send SIGTERM (15) for graceful shutdown.
 	 * Could use SIGKILL (9) for forced termination.
 	 */
-	return kill(pid, SIGTERM);
+	return proc_signal_process(pid, 0, SIGTERM);
+}
+
+/**
+ * @brief Signal a process after checking that it is the listed one.
+ *
+ * @param pid Process ID.
+ * @param start_time Start time from the list (0 skips the check).
+ * @param sig Signal number.
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int proc_signal_process(pid_t pid, unsigned long long start_time, int sig) {
+	if (start_time == 0) {
+		return kill(pid, sig);
+	}
+
+	/* Pin the process first: the check then covers what is signalled */
+	int pidfd = -1;
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_send_signal)
+	pidfd = syscall(SYS_pidfd_open, pid, 0);
+	if (pidfd < 0 && errno != ENOSYS) {
+		return -1;
+	}
+#endif
+	int rc = -1;
+	if (!process_started_at(pid, start_time)) {
+		errno = ESRCH;
+	} else if (pidfd >= 0) {
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_send_signal)
+		rc = syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+#endif
+	} else {
+		rc = kill(pid, sig);
+	}
+	if (pidfd >= 0) {
+		close(pidfd);
+	}
+	return rc;
+}
+
+/**
+ * @brief Renice a process after checking that it is the listed one.
+ *
+ * @param pid Process ID.
+ * @param start_time Start time from the list (0 skips the check).
+ * @param nice New nice value.
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int proc_renice_process(pid_t pid, unsigned long long start_time, int nice) {
+	if (start_time != 0 && !process_started_at(pid, start_time)) {
+		errno = ESRCH;
+		return -1;
+	}
+	return setpriority(PRIO_PROCESS, pid, nice);
 }
\ No newline at end of file
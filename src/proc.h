@@ -3,35 +3,173 @@
 
 #include <sys/types.h>
 #include <signal.h>
+#include <time.h>
 
 /**
  * @brief Maximum number of processes that can be stored in the list.
  */
 #define MAX_PROCESSES 2048
 
+/**
+ * @brief Longest directory accepted by proc_set_root().
+ */
+#define PROC_ROOT_MAX 192
+
+/**
+ * @brief Size of path buffers for files below the proc root.
+ */
+#define PROC_PATH_MAX (PROC_ROOT_MAX + 64)
+
 /**
  * @brief Structure representing a single process information.
  */
 typedef struct {
     pid_t pid;                  /**< Process ID */
     char name[256];             /**< Process command name */
+    unsigned int name_hash;     /**< Hash of name (grouping key, see proc_name_hash()) */
     char user[32];              /**< Name of the user who owns the process */
+    uid_t uid;                  /**< Owner user ID */
+    int threads;                /**< Number of threads */
+    char state;                 /**< State letter from stat (R, S, D, Z, T, ...) */
+    char cgroup[128];           /**< cgroup path (read once when the process appears) */
+    char container[13];         /**< Container id from the cgroup path ("" if none) */
+    pid_t ns_pid;               /**< PID inside its own PID namespace (0 if unknown) */
+    int ns_level;               /**< PID namespace depth (0 = initial namespace) */
+    unsigned long pid_ns;       /**< PID namespace inode (0 if unreadable) */
+    unsigned long mnt_ns;       /**< Mount namespace inode (0 if unreadable) */
     long memory;                /**< Resident Set Size (RSS) memory usage in Kilobytes */
     float cpu_usage;            /**< CPU usage percentage (0.0 to 100.0 * cores) */
+    int fd_count;               /**< Open file descriptors (-1 if unknown) */
+    int sock_count;             /**< Open sockets (-1 if unknown) */
+    int fd_age;                 /**< Seconds since fd_count was sampled (-1 if never) */
+    float net_rate;             /**< TCP throughput (sent + received) in kB/s (-1 if unknown) */
+    time_t fd_sampled;          /**< Time fd_count was sampled (0 if never) */
+    unsigned long long cpu_ticks;  /**< utime + stime at the last update */
+    unsigned long long start_time; /**< Start time in clock ticks after boot */
 } proc_info_t;
 
+/**
+ * @brief State letters counted per list, in the order of proc_list_t.states.
+ *
+ * R running, S sleeping, D uninterruptible sleep, Z zombie, T stopped
+ * (or traced). Other states (idle kernel threads, ...) are not counted.
+ */
+#define PROC_STATES "RSDZT"
+#define PROC_STATE_COUNT 5
+
 /**
  * @brief Container structure for a list of processes.
  */
 typedef struct {
     proc_info_t list[MAX_PROCESSES]; /**< Array of process structures */
     int count;                       /**< Current number of processes in the list */
+    int total;                       /**< PIDs found in /proc (may exceed MAX_PROCESSES) */
+    int states[PROC_STATE_COUNT];    /**< Processes per state (see PROC_STATES) */
 } proc_list_t;
 
+/**
+ * @brief Processes that appeared or exited during the last update.
+ *
+ * A reused PID (same number, different start time) appears in both arrays.
+ */
+typedef struct {
+    pid_t added[MAX_PROCESSES];      /**< PIDs new in this frame */
+    int added_count;                 /**< Number of entries in added */
+    pid_t exited[MAX_PROCESSES];     /**< PIDs gone since the previous frame */
+    int exited_count;                /**< Number of entries in exited */
+} proc_events_t;
+
+/**
+ * @brief Growable buffer of PIDs enumerated from /proc.
+ *
+ * The buffer is kept between scans, so steady-state enumeration does not
+ * allocate.
+ */
+typedef struct {
+    pid_t *pids;                     /**< Enumerated PIDs */
+    int count;                       /**< Number of valid entries in pids */
+    int capacity;                    /**< Allocated size of pids */
+    int sorted;                      /**< 1 if pids are in ascending order */
+} pid_scan_t;
+
+/**
+ * @brief Enumerates all PIDs in /proc.
+ *
+ * Reads /proc directly with getdents64 into a large reusable buffer and
+ * parses numeric names in a single pass. The PID buffer is preallocated
+ * from the previous scan's count and only grows when needed.
+ *
+ * @param scan Scan buffer (zero-initialized before first use).
+ * @param want_sorted If non-zero, PIDs are returned in ascending order.
+ * @return Number of PIDs found, or -1 if /proc cannot be read.
+ */
+int proc_scan_pids(pid_scan_t *scan, int want_sorted);
+
+/**
+ * @brief Releases the memory of a scan buffer.
+ *
+ * @param scan Scan buffer to free.
+ */
+void proc_scan_free(pid_scan_t *scan);
+
+/**
+ * @brief Hashes a process name (FNV-1a).
+ *
+ * Computed once while the name is parsed, so grouping by name compares
+ * integers instead of strings.
+ *
+ * @param name Process name.
+ * @return Hash value.
+ */
+unsigned int proc_name_hash(const char *name);
+
+/**
+ * @brief Extracts a container id from a cgroup path.
+ *
+ * Docker, containerd, CRI-O and Podman name a container's cgroup after its
+ * 64 hex digit id ("/docker/<id>", "docker-<id>.scope",
+ * "cri-containerd-<id>.scope", "libpod-<id>.scope", ...). The last such id
+ * in the path is shortened to 12 digits like `docker ps` does.
+ *
+ * @param cgroup cgroup path.
+ * @param out Output buffer ("" if the path names no container).
+ * @param out_size Size of out (13 holds a short id).
+ */
+void proc_container_id(const char *cgroup, char *out, size_t out_size);
+
+/**
+ * @brief Maps a state letter to its index in proc_list_t.states.
+ *
+ * @param state State letter from /proc/[pid]/stat.
+ * @return Index into PROC_STATES, or -1 if the state is not counted.
+ */
+int proc_state_index(char state);
+
+/**
+ * @brief Reads processes from another directory laid out like /proc.
+ *
+ * For a host's /proc mounted elsewhere, or a synthetic tree in tests. The
+ * open directory and batched reader are dropped, so callers should call
+ * proc_list_init() afterwards. Signals (proc_signal_process()) always
+ * check the live /proc.
+ *
+ * @param root Directory (without trailing slash).
+ * @return 0 on success, -1 if the path is longer than PROC_ROOT_MAX.
+ */
+int proc_set_root(const char *root);
+
+/**
+ * @brief Gets the directory processes are read from.
+ *
+ * @return "/proc" unless changed with proc_set_root().
+ */
+const char *proc_root(void);
+
 /**
  * @brief Initializes the process list structure.
  *
- * Resets the count to zero and clears internal history buffers.
+ * Resets the count to zero and forgets the previous frame, so every
+ * process is reported as new on the next update.
  *
  * @param plist Pointer to the process list to initialize.
  */
@@ -40,13 +178,26 @@ void proc_list_init(proc_list_t *plist);
 /**
  * @brief Updates the process list by reading the system /proc directory.
  *
- * Scans /proc for running processes, calculates CPU usage since the last update,
- * and populates the list with current data.
+ * Scans /proc for running processes and merge-joins them with the previous
+ * frame (both sorted by PID), so static fields are read only for new
+ * processes: user, cgroup and container id, the PID as seen inside the
+ * process's PID namespace (NStgid/NSpid of /proc/[pid]/status) and the PID
+ * and mount namespace inodes. Calculates CPU usage since the last update.
+ * The resulting list is sorted by PID. Descriptor counts are refreshed
+ * for a budgeted subset of processes per call (see fdscan.h), network
+ * throughput is attributed through socket inodes (see net.h).
  *
  * @param plist Pointer to the process list to update.
  */
 void proc_list_update(proc_list_t *plist);
 
+/**
+ * @brief Returns the add/exit events produced by the last update.
+ *
+ * @return Pointer to the events of the last proc_list_update() call.
+ */
+const proc_events_t *proc_list_events(void);
+
 /**
  * @brief Filters the process list based on a search string.
  *
@@ -69,4 +220,29 @@ void proc_list_filter(const proc_list_t *src, proc_list_t *dest, const char *fil
  */
 int proc_kill_process(pid_t pid);
 
+/**
+ * @brief Sends a signal to a process if it is still the one that was listed.
+ *
+ * The process is pinned with a pidfd and its start time compared with the
+ * listed one before signalling, so a PID reused since the last refresh is
+ * never hit. Kernels without pidfds fall back to kill(2) after the check.
+ *
+ * @param pid Process ID.
+ * @param start_time Start time from the list (0 skips the check).
+ * @param sig Signal number.
+ * @return 0 on success, -1 on failure (errno is set, ESRCH if the process
+ *         is gone or was replaced).
+ */
+int proc_signal_process(pid_t pid, unsigned long long start_time, int sig);
+
+/**
+ * @brief Changes the nice value of a process if it is still the listed one.
+ *
+ * @param pid Process ID.
+ * @param start_time Start time from the list (0 skips the check).
+ * @param nice New nice value (-20 to 19).
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int proc_renice_process(pid_t pid, unsigned long long start_time, int nice);
+
 #endif // PROC_H
\ No newline at end of file
@@ -0,0 +1,682 @@
+/**
+ * @file procio.c
+ * @brief Batched reads of per-process stat files (io_uring or synchronous).
+ */
+
+#include "procio.h"
+#include "pidmap.h"
+#include "proc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define RING_ENTRIES 1024
+
+/* Direct descriptor slots for uncached openat -> read -> close chains */
+#define SCRATCH_FILES 256
+
+/* Largest chain queued for one PID: two files, three operations each */
+#define SQES_PER_PID 6
+
+#define ENTRY_SIZE (PROCIO_STAT_SIZE + PROCIO_STATM_SIZE)
+
+enum { FILE_STAT, FILE_STATM };
+enum { OP_OPEN, OP_READ, OP_CLOSE };
+
+/* Result of a cached read that must be retried synchronously */
+#define LENGTH_RETRY (-2)
+
+struct procio {
+	ProcioBackend backend;
+	int capacity;
+	char *buffers;              /* capacity entries of stat + statm */
+	int *lengths;               /* Two per PID, -1 on failure */
+	char (*paths)[32];          /* Two per PID, referenced by OPENAT */
+	int dir_fd;                 /* Proc root the paths are relative to */
+	const pid_t *pids;          /* PIDs of the batch being read */
+
+	/* io_uring state */
+	int ring_fd;
+	unsigned sq_entries;
+	unsigned sq_tail;           /* Local tail, published on submit */
+	unsigned *sq_khead, *sq_ktail, *sq_mask, *sq_array;
+	unsigned *cq_khead, *cq_ktail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_map, *cq_map;
+	size_t sq_map_len, cq_map_len, sqes_len;
+	unsigned pending;           /* SQEs queued but not yet submitted */
+	int fixed_buffers;          /* Buffers registered: use READ_FIXED */
+	int cache_enabled;          /* File table large enough for caching */
+	int scratch_base;           /* First scratch slot in the file table */
+	int scratch_used;           /* Scratch slots used by the current batch */
+
+	/* PIDs whose descriptors stay open in the file table */
+	pidmap_t cache;
+	unsigned char cache_open[MAX_PROCESSES];  /* Bit per open file */
+};
+
+/* HELPER FUNCTIONS */
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned complete,
+		       unsigned flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, submit, complete, flags,
+			    NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg,
+			  unsigned nr_args) {
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static char *entry_buffer(const procio_t *io, int index, int file) {
+	return io->buffers + (size_t)index * ENTRY_SIZE +
+	       (file == FILE_STAT ? 0 : PROCIO_STAT_SIZE);
+}
+
+static unsigned entry_size(int file) {
+	return file == FILE_STAT ? PROCIO_STAT_SIZE : PROCIO_STATM_SIZE;
+}
+
+static const char *file_name(int file) {
+	return file == FILE_STAT ? "stat" : "statm";
+}
+
+/**
+ * @brief Read one file of a process with open/read/close.
+ *
+ * @param io Reader.
+ * @param index Position of the PID in the batch.
+ * @param pid Process ID.
+ * @param file FILE_STAT or FILE_STATM.
+ */
+static void read_sync(procio_t *io, int index, pid_t pid, int file) {
+	char path[32];
+	char *buffer = entry_buffer(io, index, file);
+	int *length = &io->lengths[index * 2 + file];
+
+	snprintf(path, sizeof(path), "%d/%s", pid, file_name(file));
+	int fd = openat(io->dir_fd, path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		*length = -1;
+		return;
+	}
+
+	ssize_t n = read(fd, buffer, entry_size(file) - 1);
+	close(fd);
+	*length = n < 0 ? -1 : (int)n;
+	if (n >= 0) {
+		buffer[n] = '\0';
+	}
+}
+
+/**
+ * @brief Unmap the rings and close the ring descriptor.
+ *
+ * @param io Reader.
+ */
+static void ring_teardown(procio_t *io) {
+	if (io->sqes) {
+		munmap(io->sqes, io->sqes_len);
+	}
+	if (io->cq_map && io->cq_map != io->sq_map) {
+		munmap(io->cq_map, io->cq_map_len);
+	}
+	if (io->sq_map) {
+		munmap(io->sq_map, io->sq_map_len);
+	}
+	if (io->ring_fd >= 0) {
+		close(io->ring_fd);
+	}
+	io->sqes = NULL;
+	io->sq_map = NULL;
+	io->cq_map = NULL;
+	io->ring_fd = -1;
+}
+
+/**
+ * @brief Create the ring and map its submission and completion queues.
+ *
+ * @param io Reader.
+ * @return 0 on success, -1 if io_uring is unavailable.
+ */
+static int ring_map(procio_t *io) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	io->ring_fd = uring_setup(RING_ENTRIES, &params);
+	if (io->ring_fd < 0) {
+		return -1;
+	}
+
+	io->sq_entries = params.sq_entries;
+	io->sq_map_len = params.sq_off.array +
+			 params.sq_entries * sizeof(unsigned);
+	io->cq_map_len = params.cq_off.cqes +
+			 params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (io->cq_map_len > io->sq_map_len) {
+			io->sq_map_len = io->cq_map_len;
+		}
+		io->cq_map_len = io->sq_map_len;
+	}
+
+	io->sq_map = mmap(NULL, io->sq_map_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, io->ring_fd,
+			  IORING_OFF_SQ_RING);
+	if (io->sq_map == MAP_FAILED) {
+		io->sq_map = NULL;
+		return -1;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		io->cq_map = io->sq_map;
+	} else {
+		io->cq_map = mmap(NULL, io->cq_map_len, PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_POPULATE, io->ring_fd,
+				  IORING_OFF_CQ_RING);
+		if (io->cq_map == MAP_FAILED) {
+			io->cq_map = NULL;
+			return -1;
+		}
+	}
+
+	io->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	io->sqes = mmap(NULL, io->sqes_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, io->ring_fd,
+			IORING_OFF_SQES);
+	if (io->sqes == MAP_FAILED) {
+		io->sqes = NULL;
+		return -1;
+	}
+
+	char *sq = io->sq_map;
+	char *cq = io->cq_map;
+	io->sq_khead = (unsigned *)(sq + params.sq_off.head);
+	io->sq_ktail = (unsigned *)(sq + params.sq_off.tail);
+	io->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	io->sq_array = (unsigned *)(sq + params.sq_off.array);
+	io->cq_khead = (unsigned *)(cq + params.cq_off.head);
+	io->cq_ktail = (unsigned *)(cq + params.cq_off.tail);
+	io->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	io->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	io->sq_tail = *io->sq_ktail;
+	return 0;
+}
+
+/**
+ * @brief Check that the kernel supports every opcode the reader uses.
+ *
+ * @param io Reader.
+ * @return 1 if supported, 0 otherwise.
+ */
+static int ring_probe_ops(procio_t *io) {
+	size_t size = sizeof(struct io_uring_probe) +
+		      256 * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe = calloc(1, size);
+	if (!probe) {
+		return 0;
+	}
+
+	int ok = 0;
+	if (uring_register(io->ring_fd, IORING_REGISTER_PROBE, probe,
+			   256) == 0) {
+		const int needed[] = { IORING_OP_OPENAT, IORING_OP_READ,
+				       IORING_OP_READ_FIXED,
+				       IORING_OP_CLOSE };
+		ok = 1;
+		for (size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); i++) {
+			if (needed[i] > probe->last_op ||
+			    !(probe->ops[needed[i]].flags &
+			      IO_URING_OP_SUPPORTED)) {
+				ok = 0;
+			}
+		}
+	}
+	free(probe);
+	return ok;
+}
+
+/**
+ * @brief Register an empty file table for direct descriptors.
+ *
+ * @param io Reader.
+ * @param slots Number of slots.
+ * @return 0 on success, -1 on failure.
+ */
+static int ring_register_files(procio_t *io, unsigned slots) {
+	/* Registered files count against RLIMIT_NOFILE */
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+	    limit.rlim_cur < slots + 64 && limit.rlim_max >= slots + 64) {
+		limit.rlim_cur = slots + 64;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	struct io_uring_rsrc_register reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.nr = slots;
+	reg.flags = IORING_RSRC_REGISTER_SPARSE;
+	if (uring_register(io->ring_fd, IORING_REGISTER_FILES2, &reg,
+			   sizeof(reg)) == 0) {
+		return 0;
+	}
+
+	/* Older kernels: an array of -1 also leaves the slots empty */
+	int *empty = malloc(slots * sizeof(int));
+	if (!empty) {
+		return -1;
+	}
+	for (unsigned i = 0; i < slots; i++) {
+		empty[i] = -1;
+	}
+	int ret = uring_register(io->ring_fd, IORING_REGISTER_FILES, empty,
+				 slots);
+	free(empty);
+	return ret;
+}
+
+/**
+ * @brief Get the next free submission entry, zeroed.
+ *
+ * @param io Reader (caller guarantees room, see queue_pid()).
+ * @return Submission entry.
+ */
+static struct io_uring_sqe *next_sqe(procio_t *io) {
+	unsigned index = io->sq_tail & *io->sq_mask;
+	struct io_uring_sqe *sqe = &io->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	io->sq_array[index] = index;
+	io->sq_tail++;
+	io->pending++;
+	return sqe;
+}
+
+static unsigned long long make_tag(int index, int file, int op) {
+	return ((unsigned long long)index << 4) | (unsigned)(file << 2) |
+	       (unsigned)op;
+}
+
+static void queue_open(procio_t *io, int index, int file, int slot) {
+	struct io_uring_sqe *sqe = next_sqe(io);
+
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = io->dir_fd;
+	sqe->addr = (unsigned long)io->paths[index * 2 + file];
+	sqe->open_flags = O_RDONLY;
+	sqe->file_index = slot + 1;
+	sqe->flags = IOSQE_IO_HARDLINK;
+	sqe->user_data = make_tag(index, file, OP_OPEN);
+}
+
+static void queue_read(procio_t *io, int index, int file, int slot,
+		       int linked) {
+	struct io_uring_sqe *sqe = next_sqe(io);
+
+	sqe->opcode = io->fixed_buffers ? IORING_OP_READ_FIXED
+					: IORING_OP_READ;
+	sqe->fd = slot;
+	sqe->flags = IOSQE_FIXED_FILE | (linked ? IOSQE_IO_HARDLINK : 0);
+	sqe->addr = (unsigned long)entry_buffer(io, index, file);
+	sqe->len = entry_size(file) - 1;
+	sqe->off = 0;
+	sqe->buf_index = 0;
+	sqe->user_data = make_tag(index, file, OP_READ);
+}
+
+static void queue_close(procio_t *io, int index, int file, int slot) {
+	struct io_uring_sqe *sqe = next_sqe(io);
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->file_index = slot + 1;
+	sqe->user_data = make_tag(index, file, OP_CLOSE);
+}
+
+/**
+ * @brief Record the outcome of one completion.
+ *
+ * @param io Reader.
+ * @param cqe Completion entry.
+ */
+static void complete(procio_t *io, const struct io_uring_cqe *cqe) {
+	int index = (int)(cqe->user_data >> 4);
+	int file = (int)((cqe->user_data >> 2) & 3);
+	int op = (int)(cqe->user_data & 3);
+
+	if (op != OP_READ || !io->pids) {
+		return;
+	}
+
+	int *length = &io->lengths[index * 2 + file];
+	if (cqe->res >= 0) {
+		entry_buffer(io, index, file)[cqe->res] = '\0';
+		*length = cqe->res;
+		return;
+	}
+
+	*length = -1;
+	int slot = pidmap_find(&io->cache, io->pids[index]);
+	if (slot >= 0 && (io->cache_open[slot] & (1 << file))) {
+		/*
+		 * A cached descriptor stopped working (process exited or the
+		 * open in this chain failed): reopen it on the next frame and
+		 * fall back to a plain read now.
+		 */
+		io->cache_open[slot] &= ~(1 << file);
+		*length = LENGTH_RETRY;
+	}
+}
+
+/**
+ * @brief Submit queued entries and wait until all of them completed.
+ *
+ * @param io Reader.
+ * @return 0 on success, -1 if the ring failed.
+ */
+static int flush(procio_t *io) {
+	unsigned to_submit = io->pending;
+	unsigned outstanding = io->pending;
+
+	__atomic_store_n(io->sq_ktail, io->sq_tail, __ATOMIC_RELEASE);
+	while (outstanding > 0) {
+		int ret = uring_enter(io->ring_fd, to_submit, outstanding,
+				      IORING_ENTER_GETEVENTS);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			return -1;
+		}
+		to_submit -= (unsigned)ret < to_submit ? (unsigned)ret
+						       : to_submit;
+
+		unsigned head = *io->cq_khead;
+		unsigned tail = __atomic_load_n(io->cq_ktail, __ATOMIC_ACQUIRE);
+		while (head != tail && outstanding > 0) {
+			complete(io, &io->cqes[head & *io->cq_mask]);
+			head++;
+			outstanding--;
+		}
+		__atomic_store_n(io->cq_khead, head, __ATOMIC_RELEASE);
+	}
+
+	io->pending = 0;
+	io->scratch_used = 0;
+	return 0;
+}
+
+/**
+ * @brief Queue the reads of both files of one PID.
+ *
+ * @param io Reader.
+ * @param index Position of the PID in the batch.
+ * @param pid Process ID.
+ * @return 0 on success, -1 if the ring failed.
+ */
+static int queue_pid(procio_t *io, int index, pid_t pid) {
+	int created = 0;
+	int slot = io->cache_enabled ? pidmap_acquire(&io->cache, pid, &created)
+				     : -1;
+	if (created) {
+		io->cache_open[slot] = 0;
+	}
+
+	if (io->pending + SQES_PER_PID > io->sq_entries ||
+	    (slot < 0 && io->scratch_used + 2 > SCRATCH_FILES)) {
+		if (flush(io) < 0) {
+			return -1;
+		}
+	}
+
+	for (int file = FILE_STAT; file <= FILE_STATM; file++) {
+		io->lengths[index * 2 + file] = -1;
+		snprintf(io->paths[index * 2 + file], sizeof(io->paths[0]),
+			 "%d/%s", pid, file_name(file));
+
+		if (slot >= 0) {
+			int fixed = slot * 2 + file;
+			if (!(io->cache_open[slot] & (1 << file))) {
+				queue_open(io, index, file, fixed);
+				io->cache_open[slot] |= 1 << file;
+			}
+			queue_read(io, index, file, fixed, 0);
+		} else {
+			int fixed = io->scratch_base + io->scratch_used++;
+			queue_open(io, index, file, fixed);
+			queue_read(io, index, file, fixed, 1);
+			queue_close(io, index, file, fixed);
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Set up io_uring and check it can actually read /proc.
+ *
+ * @param io Reader.
+ * @return 0 if the ring is usable, -1 otherwise.
+ */
+static int ring_init(procio_t *io) {
+	if (ring_map(io) < 0 || !ring_probe_ops(io)) {
+		return -1;
+	}
+
+	/*
+	 * Cache descriptors of every trackable PID when the file table can
+	 * be that large; otherwise every read is a self-closing chain.
+	 */
+	io->scratch_base = MAX_PROCESSES * 2;
+	io->cache_enabled = 1;
+	if (ring_register_files(io, io->scratch_base + SCRATCH_FILES) < 0) {
+		io->scratch_base = 0;
+		io->cache_enabled = 0;
+		if (ring_register_files(io, SCRATCH_FILES) < 0) {
+			return -1;
+		}
+	}
+
+	/* Pinned buffers may exceed RLIMIT_MEMLOCK: plain READ then */
+	struct iovec iov = {
+		.iov_base = io->buffers,
+		.iov_len = (size_t)io->capacity * ENTRY_SIZE,
+	};
+	io->fixed_buffers = uring_register(io->ring_fd,
+					   IORING_REGISTER_BUFFERS,
+					   &iov, 1) == 0;
+
+	/* Trial read through an uncached chain */
+	int cache_enabled = io->cache_enabled;
+	pid_t self = getpid();
+	io->cache_enabled = 0;
+	io->pids = &self;
+	int ok = queue_pid(io, 0, self) == 0 && flush(io) == 0 &&
+		 io->lengths[0] > 0 && io->lengths[1] > 0;
+	io->pids = NULL;
+	io->cache_enabled = cache_enabled;
+	return ok ? 0 : -1;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Create a reader, probing io_uring when requested.
+ *
+ * @param capacity Maximum number of PIDs per batch.
+ * @param backend Requested backend.
+ * @return New reader, or NULL if memory is exhausted.
+ */
+procio_t *procio_open(int capacity, ProcioBackend backend) {
+	procio_t *io = calloc(1, sizeof(*io));
+	if (!io) {
+		return NULL;
+	}
+
+	io->capacity = capacity > 0 ? capacity : 1;
+	io->ring_fd = -1;
+	io->dir_fd = open(proc_root(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	io->buffers = malloc((size_t)io->capacity * ENTRY_SIZE);
+	io->lengths = malloc((size_t)io->capacity * 2 * sizeof(int));
+	io->paths = malloc((size_t)io->capacity * 2 * sizeof(io->paths[0]));
+	if (io->dir_fd < 0 || !io->buffers || !io->lengths || !io->paths) {
+		procio_close(io);
+		return NULL;
+	}
+	pidmap_init(&io->cache);
+
+	io->backend = PROCIO_SYNC;
+	if (backend != PROCIO_SYNC) {
+		if (ring_init(io) == 0) {
+			io->backend = PROCIO_URING;
+		} else {
+			ring_teardown(io);
+		}
+	}
+	return io;
+}
+
+/**
+ * @brief Release the ring (closing every direct descriptor) and buffers.
+ *
+ * @param io Reader (may be NULL).
+ */
+void procio_close(procio_t *io) {
+	if (!io) {
+		return;
+	}
+	ring_teardown(io);
+	if (io->dir_fd >= 0) {
+		close(io->dir_fd);
+	}
+	free(io->buffers);
+	free(io->lengths);
+	free(io->paths);
+	free(io);
+}
+
+/**
+ * @brief Report the backend in use.
+ *
+ * @param io Reader.
+ * @return PROCIO_SYNC or PROCIO_URING.
+ */
+ProcioBackend procio_backend(const procio_t *io) {
+	return io->backend;
+}
+
+/**
+ * @brief Read stat and statm of a batch of PIDs.
+ *
+ * @param io Reader.
+ * @param pids PIDs to read.
+ * @param count Number of PIDs.
+ * @return Number of PIDs processed.
+ */
+int procio_read(procio_t *io, const pid_t *pids, int count) {
+	if (count > io->capacity) {
+		count = io->capacity;
+	}
+
+	if (io->backend == PROCIO_URING) {
+		io->pids = pids;
+		int failed = 0;
+		for (int i = 0; i < count && !failed; i++) {
+			failed = queue_pid(io, i, pids[i]) < 0;
+		}
+		failed = failed || flush(io) < 0;
+		io->pids = NULL;
+
+		if (!failed) {
+			for (int i = 0; i < count * 2; i++) {
+				if (io->lengths[i] == LENGTH_RETRY) {
+					read_sync(io, i / 2, pids[i / 2], i % 2);
+				}
+			}
+			return count;
+		}
+
+		/* The ring broke: stay on the synchronous path from now on */
+		ring_teardown(io);
+		pidmap_init(&io->cache);
+		io->pending = 0;
+		io->backend = PROCIO_SYNC;
+	}
+
+	for (int i = 0; i < count; i++) {
+		read_sync(io, i, pids[i], FILE_STAT);
+		read_sync(io, i, pids[i], FILE_STATM);
+	}
+	return count;
+}
+
+/**
+ * @brief Get stat contents of the index-th PID of the last batch.
+ *
+ * @param io Reader.
+ * @param index Position of the PID.
+ * @return Contents, or NULL if the read failed.
+ */
+const char *procio_stat(const procio_t *io, int index) {
+	if (index < 0 || index >= io->capacity || io->lengths[index * 2] <= 0) {
+		return NULL;
+	}
+	return entry_buffer(io, index, FILE_STAT);
+}
+
+/**
+ * @brief Get statm contents of the index-th PID of the last batch.
+ *
+ * @param io Reader.
+ * @param index Position of the PID.
+ * @return Contents, or NULL if the read failed.
+ */
+const char *procio_statm(const procio_t *io, int index) {
+	if (index < 0 || index >= io->capacity ||
+	    io->lengths[index * 2 + 1] <= 0) {
+		return NULL;
+	}
+	return entry_buffer(io, index, FILE_STATM);
+}
+
+/**
+ * @brief Close cached descriptors of exited processes.
+ *
+ * @param io Reader.
+ * @param pids Exited PIDs.
+ * @param count Number of PIDs.
+ */
+void procio_forget(procio_t *io, const pid_t *pids, int count) {
+	if (io->backend != PROCIO_URING) {
+		return;
+	}
+
+	for (int i = 0; i < count; i++) {
+		int slot = pidmap_find(&io->cache, pids[i]);
+		if (slot < 0) {
+			continue;
+		}
+		if (io->pending + 2 > io->sq_entries && flush(io) < 0) {
+			return;
+		}
+		for (int file = FILE_STAT; file <= FILE_STATM; file++) {
+			if (io->cache_open[slot] & (1 << file)) {
+				queue_close(io, 0, file, slot * 2 + file);
+			}
+		}
+		io->cache_open[slot] = 0;
+		pidmap_release(&io->cache, pids[i]);
+	}
+	flush(io);
+}
@@ -0,0 +1,102 @@
+#ifndef PROCIO_H
+#define PROCIO_H
+
+#include <sys/types.h>
+
+/**
+ * @brief Bytes reserved for /proc/[pid]/stat of one process.
+ */
+#define PROCIO_STAT_SIZE 1024
+
+/**
+ * @brief Bytes reserved for /proc/[pid]/statm of one process.
+ */
+#define PROCIO_STATM_SIZE 128
+
+/**
+ * @brief I/O strategies for reading per-process files.
+ */
+typedef enum {
+	PROCIO_AUTO,   /**< Use io_uring if the runtime probe succeeds, else sync */
+	PROCIO_SYNC,   /**< open/read/close per file */
+	PROCIO_URING   /**< Batched, linked io_uring submissions */
+} ProcioBackend;
+
+/**
+ * @brief Batched reader of /proc/[pid]/stat and /proc/[pid]/statm.
+ */
+typedef struct procio procio_t;
+
+/**
+ * @brief Creates a reader able to read up to capacity processes per batch.
+ *
+ * With PROCIO_AUTO or PROCIO_URING the io_uring backend is probed at run
+ * time (ring setup, supported opcodes, direct descriptors); on failure the
+ * reader silently uses the synchronous backend. Files are opened relative
+ * to proc_root(), which is opened once here.
+ *
+ * @param capacity Maximum number of PIDs per procio_read() call.
+ * @param backend Requested backend.
+ * @return New reader, or NULL if memory is exhausted or the root cannot be
+ *         opened.
+ */
+procio_t *procio_open(int capacity, ProcioBackend backend);
+
+/**
+ * @brief Closes cached descriptors, tears down the ring and frees the reader.
+ *
+ * @param io Reader (may be NULL).
+ */
+void procio_close(procio_t *io);
+
+/**
+ * @brief Reports the backend actually in use.
+ *
+ * @param io Reader.
+ * @return PROCIO_SYNC or PROCIO_URING.
+ */
+ProcioBackend procio_backend(const procio_t *io);
+
+/**
+ * @brief Reads stat and statm of every PID.
+ *
+ * With io_uring, descriptors of up to MAX_PROCESSES PIDs are kept open in
+ * the ring's registered file table, so repeated reads of the same PID only
+ * cost a single READ submission. Other PIDs use a linked
+ * openat -> read -> close chain.
+ *
+ * @param io Reader.
+ * @param pids PIDs to read (at most the reader's capacity).
+ * @param count Number of PIDs.
+ * @return Number of PIDs processed.
+ */
+int procio_read(procio_t *io, const pid_t *pids, int count);
+
+/**
+ * @brief Gets the stat contents read for the index-th PID.
+ *
+ * @param io Reader.
+ * @param index Position of the PID in the last procio_read() call.
+ * @return NUL-terminated contents, or NULL if the read failed.
+ */
+const char *procio_stat(const procio_t *io, int index);
+
+/**
+ * @brief Gets the statm contents read for the index-th PID.
+ *
+ * @param io Reader.
+ * @param index Position of the PID in the last procio_read() call.
+ * @return NUL-terminated contents, or NULL if the read failed.
+ */
+const char *procio_statm(const procio_t *io, int index);
+
+/**
+ * @brief Drops cached descriptors of processes that exited.
+ *
+ * @param io Reader.
+ * @param pids Exited PIDs.
+ * @param count Number of PIDs.
+ */
+void procio_forget(procio_t *io, const pid_t *pids, int count);
+
+#endif // PROCIO_H
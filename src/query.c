@@ -0,0 +1,745 @@
+/**
+ * @file query.c
+ * @brief Unix-socket query API of the collector daemon.
+ *
+ * One epoll loop serves every client between two collection passes. All
+ * requests are answered from the snapshot of the last pass, and responses
+ * are cached per snapshot generation in an arena that is reset when the
+ * generation changes, so repeated identical queries cost a lookup.
+ */
+
+#include "query.h"
+#include "arena.h"
+#include "detail.h"
+#include "expr.h"
+#include "history.h"
+#include "sort.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define CACHE_ARENA_SIZE (8 * 1024 * 1024)
+
+/**
+ * @brief Connection state of one client.
+ */
+typedef struct {
+	int fd;                     /**< Socket, -1 if the slot is free */
+	char in[QUERY_LINE_MAX];    /**< Partial request line */
+	size_t in_len;              /**< Bytes in in */
+	char *out;                  /**< Pending response bytes */
+	size_t out_len;             /**< Bytes in out */
+	size_t out_cap;             /**< Allocated size of out */
+	size_t out_off;             /**< Bytes of out already sent */
+} client_t;
+
+/**
+ * @brief Cached response of one request.
+ */
+typedef struct {
+	char request[QUERY_LINE_MAX];
+	const char *response;
+	size_t length;
+} cache_entry_t;
+
+static int listen_fd = -1;
+static int epoll_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static client_t clients[QUERY_MAX_CLIENTS];
+
+static cache_entry_t cache[QUERY_CACHE_SIZE];
+static int cache_count = 0;
+static unsigned long long cache_generation = 0;
+static arena_t cache_arena;
+
+static char response_buffer[QUERY_RESPONSE_MAX];
+static proc_list_t scratch_list;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Append a JSON string literal (quoted and escaped).
+ *
+ * @param w Writer.
+ * @param text Raw text.
+ */
+static void put_string(strbuf_t *w, const char *text) {
+	strbuf_putc(w, '"');
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		if (*p < 0x20) {
+			strbuf_printf(w, "\\u%04x", *p);
+		} else {
+			if (*p == '"' || *p == '\\') {
+				strbuf_putc(w, '\\');
+			}
+			strbuf_putc(w, (char)*p);
+		}
+	}
+	strbuf_putc(w, '"');
+}
+
+/**
+ * @brief Append one process as a JSON object.
+ *
+ * @param w Writer.
+ * @param proc Process.
+ */
+static void put_process(strbuf_t *w, const proc_info_t *proc) {
+	strbuf_printf(w, "{\"pid\":%d,\"name\":", proc->pid);
+	put_string(w, proc->name);
+	strbuf_printf(w, ",\"user\":");
+	put_string(w, proc->user);
+	strbuf_printf(w, ",\"mem\":%ld,\"cpu\":%.1f,\"fds\":%d,\"socks\":%d,"
+	       "\"net\":%.1f}",
+	    proc->memory, proc->cpu_usage, proc->fd_count, proc->sock_count,
+	    proc->net_rate);
+}
+
+/**
+ * @brief Find a process of the snapshot by PID.
+ *
+ * @param plist Snapshot (sorted by PID).
+ * @param pid Process ID.
+ * @return Process, or NULL.
+ */
+static const proc_info_t *find_process(const proc_list_t *plist, pid_t pid) {
+	int lo = 0, hi = plist->count - 1;
+
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (plist->list[mid].pid == pid) {
+			return &plist->list[mid];
+		}
+		if (plist->list[mid].pid < pid) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Answer "top <n> <key>": the first n processes sorted by key.
+ *
+ * @param w Response writer.
+ * @param args Text after the verb.
+ * @param plist Snapshot.
+ */
+static void answer_top(strbuf_t *w, const char *args,
+		       const proc_list_t *plist) {
+	static const struct {
+		const char *name;
+		SortType type;
+	} keys[] = {
+		{ "pid", SORT_PID }, { "name", SORT_NAME }, { "mem", SORT_MEM },
+		{ "cpu", SORT_CPU }, { "net", SORT_NET },
+	};
+	int n = 0;
+	char key[16];
+
+	if (sscanf(args, "%d %15s", &n, key) != 2 || n < 0) {
+		strbuf_printf(w, "\"error\":\"usage: top <n> <key>\"");
+		return;
+	}
+
+	int found = -1;
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+		if (strcmp(key, keys[i].name) == 0) {
+			found = (int)i;
+		}
+	}
+	if (found < 0) {
+		strbuf_printf(w, "\"error\":\"unknown key\"");
+		return;
+	}
+
+	proc_list_filter(plist, &scratch_list, NULL);
+	sort_processes(&scratch_list, keys[found].type);
+	strbuf_printf(w, "\"processes\":[");
+	for (int i = 0; i < n && i < scratch_list.count; i++) {
+		strbuf_printf(w, i ? "," : "");
+		put_process(w, &scratch_list.list[i]);
+	}
+	strbuf_printf(w, "]");
+}
+
+/**
+ * @brief Answer "filter <expr>": every process matching the expression.
+ *
+ * @param w Response writer.
+ * @param args Expression text.
+ * @param plist Snapshot.
+ */
+static void answer_filter(strbuf_t *w, const char *args,
+			  const proc_list_t *plist) {
+	static expr_t expr;
+	char error[128];
+
+	if (expr_compile(args, &expr, error, sizeof(error)) < 0) {
+		strbuf_printf(w, "\"error\":");
+		put_string(w, error);
+		return;
+	}
+
+	int matched = 0;
+	strbuf_printf(w, "\"processes\":[");
+	for (int i = 0; i < plist->count; i++) {
+		if (expr_match(&expr, &plist->list[i])) {
+			strbuf_printf(w, matched++ ? "," : "");
+			put_process(w, &plist->list[i]);
+		}
+	}
+	strbuf_printf(w, "]");
+}
+
+/**
+ * @brief Answer "pid <pid>": one process with cmdline, paths and namespaces.
+ *
+ * @param w Response writer.
+ * @param args PID text.
+ * @param plist Snapshot.
+ */
+static void answer_pid(strbuf_t *w, const char *args,
+		       const proc_list_t *plist) {
+	static proc_detail_t detail;
+	pid_t pid = (pid_t)atoi(args);
+	const proc_info_t *proc = find_process(plist, pid);
+
+	/* Bounded reads only: this runs inside the collector's loop */
+	if (!proc || detail_read_brief(pid, &detail) < 0) {
+		strbuf_printf(w, "\"error\":\"no such process\"");
+		return;
+	}
+
+	strbuf_printf(w, "\"process\":");
+	put_process(w, proc);
+	strbuf_printf(w, ",\"cmdline\":");
+	put_string(w, detail.cmdline);
+	strbuf_printf(w, ",\"cwd\":");
+	put_string(w, detail.cwd);
+	strbuf_printf(w, ",\"exe\":");
+	put_string(w, detail.exe);
+	strbuf_printf(w, ",\"cgroup\":");
+	put_string(w, detail.cgroup);
+	strbuf_printf(w, ",\"threads\":%d", detail.threads);
+	strbuf_printf(w, ",\"nspid\":%d,\"pidns\":%lu,\"mntns\":%lu,"
+	       "\"container\":", proc->ns_pid, proc->pid_ns, proc->mnt_ns);
+	put_string(w, proc->container);
+}
+
+/**
+ * @brief Answer "history <pid>": the recorded CPU and memory samples.
+ *
+ * @param w Response writer.
+ * @param args PID text.
+ */
+static void answer_history(strbuf_t *w, const char *args) {
+	pid_t pid = (pid_t)atoi(args);
+	const history_ring_t *ring = history_lookup(pid);
+
+	if (!ring) {
+		strbuf_printf(w, "\"error\":\"no history\"");
+		return;
+	}
+
+	/* Oldest sample first */
+	int first = (ring->head - ring->count + HISTORY_LEN) % HISTORY_LEN;
+	strbuf_printf(w, "\"pid\":%d,\"cpu\":[", pid);
+	for (int i = 0; i < ring->count; i++) {
+		strbuf_printf(w, "%s%.1f", i ? "," : "",
+		    ring->cpu[(first + i) % HISTORY_LEN]);
+	}
+	strbuf_printf(w, "],\"mem\":[");
+	for (int i = 0; i < ring->count; i++) {
+		strbuf_printf(w, "%s%ld", i ? "," : "",
+		    ring->memory[(first + i) % HISTORY_LEN]);
+	}
+	strbuf_printf(w, "]");
+}
+
+/**
+ * @brief Evaluate a request into response_buffer.
+ *
+ * @param request Request text.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @return Response length.
+ */
+static size_t evaluate(const char *request, const proc_list_t *plist,
+		       unsigned long long generation) {
+	strbuf_t w;
+	char verb[16] = "";
+	int consumed = 0;
+
+	strbuf_init(&w, response_buffer, sizeof(response_buffer));
+	sscanf(request, " %15s %n", verb, &consumed);
+	const char *args = request + consumed;
+
+	strbuf_printf(&w, "{\"generation\":%llu,", generation);
+	if (strcmp(verb, "top") == 0) {
+		answer_top(&w, args, plist);
+	} else if (strcmp(verb, "filter") == 0) {
+		answer_filter(&w, args, plist);
+	} else if (strcmp(verb, "pid") == 0) {
+		answer_pid(&w, args, plist);
+	} else if (strcmp(verb, "history") == 0) {
+		answer_history(&w, args);
+	} else {
+		strbuf_printf(&w, "\"error\":\"unknown request\"");
+	}
+	strbuf_printf(&w, "}\n");
+
+	if (w.overflow) {
+		w.length = (size_t)snprintf(response_buffer,
+					    sizeof(response_buffer),
+					    "{\"generation\":%llu,\"error\":"
+					    "\"response too large\"}\n",
+					    generation);
+	}
+	return w.length;
+}
+
+/**
+ * @brief Queue bytes for a client.
+ *
+ * @param client Client.
+ * @param data Bytes.
+ * @param length Number of bytes.
+ * @return 0 on success, -1 if memory is exhausted.
+ */
+static int client_queue(client_t *client, const char *data, size_t length) {
+	if (client->out_off == client->out_len) {
+		client->out_off = 0;
+		client->out_len = 0;
+	}
+	if (client->out_len - client->out_off + length > QUERY_PENDING_MAX) {
+		return -1;
+	}
+	if (client->out_len + length > client->out_cap) {
+		size_t cap = client->out_cap ? client->out_cap : 4096;
+		while (cap < client->out_len + length) {
+			cap *= 2;
+		}
+		char *grown = realloc(client->out, cap);
+		if (!grown) {
+			return -1;
+		}
+		client->out = grown;
+		client->out_cap = cap;
+	}
+	memcpy(client->out + client->out_len, data, length);
+	client->out_len += length;
+	return 0;
+}
+
+/**
+ * @brief Disconnect a client and free its slot.
+ *
+ * @param client Client.
+ */
+static void client_close(client_t *client) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	free(client->out);
+	memset(client, 0, sizeof(*client));
+	client->fd = -1;
+}
+
+/**
+ * @brief Send pending output; wait for EPOLLOUT if the socket is full.
+ *
+ * While output is pending the client is not read (no EPOLLIN), so a
+ * client that sends requests without reading answers stalls itself
+ * instead of growing the daemon.
+ *
+ * @param client Client.
+ * @return 0 if the client is still connected, -1 if it was closed.
+ */
+static int client_flush(client_t *client) {
+	while (client->out_off < client->out_len) {
+		ssize_t n = send(client->fd, client->out + client->out_off,
+				 client->out_len - client->out_off,
+				 MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			client_close(client);
+			return -1;
+		}
+		client->out_off += (size_t)n;
+	}
+
+	int pending = client->out_off < client->out_len;
+	if (!pending && client->out_cap > QUERY_KEEP_BUFFER) {
+		/* Give back the room of a large response once it is sent */
+		free(client->out);
+		client->out = NULL;
+		client->out_cap = 0;
+		client->out_len = 0;
+		client->out_off = 0;
+	}
+
+	struct epoll_event event = { 0 };
+	event.events = pending ? EPOLLOUT : EPOLLIN;
+	event.data.ptr = client;
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+	return 0;
+}
+
+/**
+ * @brief Answer the complete request lines already read, one at a time.
+ *
+ * The next line is answered only once the previous response is sent.
+ *
+ * @param client Client.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @return 0 if the client is still connected, -1 if it was closed.
+ */
+static int client_answer(client_t *client, const proc_list_t *plist,
+			 unsigned long long generation) {
+	char *newline;
+	while (client->out_off == client->out_len &&
+	       (newline = memchr(client->in, '\n', client->in_len))) {
+		*newline = '\0';
+		if (newline > client->in && newline[-1] == '\r') {
+			newline[-1] = '\0';
+		}
+
+		size_t length;
+		const char *response = query_execute(client->in, plist,
+						     generation, &length);
+		if (client_queue(client, response, length) < 0) {
+			client_close(client);
+			return -1;
+		}
+
+		size_t used = (size_t)(newline - client->in) + 1;
+		memmove(client->in, newline + 1, client->in_len - used);
+		client->in_len -= used;
+		if (client_flush(client) < 0) {
+			return -1;
+		}
+	}
+
+	if (client->out_off == client->out_len &&
+	    client->in_len == sizeof(client->in)) {
+		/* Line longer than QUERY_LINE_MAX */
+		client_close(client);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Read requests of a client and queue their responses.
+ *
+ * @param client Client.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ */
+static void client_read(client_t *client, const proc_list_t *plist,
+			unsigned long long generation) {
+	if (client_answer(client, plist, generation) < 0) {
+		return;
+	}
+	while (client->out_off == client->out_len) {
+		ssize_t n = recv(client->fd, client->in + client->in_len,
+				 sizeof(client->in) - client->in_len, 0);
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			client_close(client);
+			return;
+		}
+		if (n < 0) {
+			break;
+		}
+		client->in_len += (size_t)n;
+		if (client_answer(client, plist, generation) < 0) {
+			return;
+		}
+	}
+	client_flush(client);
+}
+
+/**
+ * @brief Check whether a server is accepting on a socket path.
+ *
+ * @param addr Socket address.
+ * @return 1 if a connection succeeded.
+ */
+static int socket_alive(const struct sockaddr_un *addr) {
+	int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (probe < 0) {
+		return 0;
+	}
+	int alive = connect(probe, (const struct sockaddr *)addr,
+			    sizeof(*addr)) == 0;
+	close(probe);
+	errno = EADDRINUSE;
+	return alive;
+}
+
+/**
+ * @brief Accept all pending connections.
+ */
+static void accept_clients(void) {
+	int fd;
+	while ((fd = accept4(listen_fd, NULL, NULL,
+			     SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		client_t *client = NULL;
+		for (int i = 0; i < QUERY_MAX_CLIENTS && !client; i++) {
+			if (clients[i].fd < 0) {
+				client = &clients[i];
+			}
+		}
+		if (!client) {
+			close(fd);
+			continue;
+		}
+
+		client->fd = fd;
+		struct epoll_event event = { 0 };
+		event.events = EPOLLIN;
+		event.data.ptr = client;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			close(fd);
+			client->fd = -1;
+		}
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Get the default socket path.
+ *
+ * @return Static path.
+ */
+const char *query_default_path(void) {
+	static char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+
+	if (runtime && runtime[0] == '/' &&
+	    snprintf(path, sizeof(path), "%s/%s", runtime, QUERY_SOCKET_NAME) <
+		    (int)sizeof(path)) {
+		return path;
+	}
+	return QUERY_SOCKET_DIR "/" QUERY_SOCKET_NAME;
+}
+
+/**
+ * @brief Create the listening socket and epoll instance.
+ *
+ * @param path Socket path.
+ * @return 0 on success, -1 on failure.
+ */
+int query_open(const char *path) {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if (strncmp(path, QUERY_SOCKET_DIR "/", strlen(QUERY_SOCKET_DIR) + 1) == 0 &&
+	    mkdir(QUERY_SOCKET_DIR, 0755) < 0 && errno != EEXIST) {
+		return -1;
+	}
+
+	for (int i = 0; i < QUERY_MAX_CLIENTS; i++) {
+		clients[i].fd = -1;
+	}
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		return -1;
+	}
+
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		/* Replace the socket file only if nobody is accepting on it */
+		int stale = errno == EADDRINUSE && !socket_alive(&addr);
+		if (!stale || unlink(path) < 0 ||
+		    bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			close(listen_fd);
+			listen_fd = -1;
+			return -1;
+		}
+	}
+
+	snprintf(socket_path, sizeof(socket_path), "%s", path);
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event event = { 0 };
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (listen(listen_fd, 64) < 0 || epoll_fd < 0 ||
+	    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0) {
+		query_close();
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Get the epoll descriptor (readable when events are pending).
+ *
+ * @return Descriptor, or -1.
+ */
+int query_fd(void) {
+	return epoll_fd;
+}
+
+/**
+ * @brief Serve clients until the timeout expires.
+ *
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @param timeout_ms Time to wait for events.
+ */
+void query_poll(const proc_list_t *plist, unsigned long long generation,
+		int timeout_ms) {
+	struct epoll_event events[QUERY_MAX_CLIENTS + 1];
+
+	if (epoll_fd < 0) {
+		return;
+	}
+
+	int n = epoll_wait(epoll_fd, events, QUERY_MAX_CLIENTS + 1, timeout_ms);
+	for (int i = 0; i < n; i++) {
+		client_t *client = events[i].data.ptr;
+		if (!client) {
+			accept_clients();
+			continue;
+		}
+		if (client->fd < 0) {
+			continue;
+		}
+		if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			client_close(client);
+			continue;
+		}
+		if (events[i].events & EPOLLOUT && client_flush(client) < 0) {
+			continue;
+		}
+		/* Drained output resumes the requests read meanwhile */
+		if (events[i].events & (EPOLLIN | EPOLLOUT)) {
+			client_read(client, plist, generation);
+		}
+	}
+}
+
+/**
+ * @brief Answer a request, from the cache if possible.
+ *
+ * @param request Request text.
+ * @param plist Snapshot.
+ * @param generation Snapshot number.
+ * @param length Output for the response length.
+ * @return Response.
+ */
+const char *query_execute(const char *request, const proc_list_t *plist,
+			  unsigned long long generation, size_t *length) {
+	if (!cache_arena.base) {
+		/* Without the arena every request is simply evaluated */
+		arena_init(&cache_arena, CACHE_ARENA_SIZE);
+	}
+	if (generation != cache_generation) {
+		cache_count = 0;
+		cache_generation = generation;
+		arena_reset(&cache_arena);
+	}
+
+	for (int i = 0; i < cache_count; i++) {
+		if (strcmp(cache[i].request, request) == 0) {
+			*length = cache[i].length;
+			return cache[i].response;
+		}
+	}
+
+	*length = evaluate(request, plist, generation);
+	if (cache_count == QUERY_CACHE_SIZE ||
+	    strlen(request) >= sizeof(cache[0].request)) {
+		return response_buffer;
+	}
+
+	char *stored = arena_alloc(&cache_arena, *length);
+	if (!stored) {
+		return response_buffer;
+	}
+	memcpy(stored, response_buffer, *length);
+	strcpy(cache[cache_count].request, request);
+	cache[cache_count].response = stored;
+	cache[cache_count].length = *length;
+	cache_count++;
+	return stored;
+}
+
+/**
+ * @brief Disconnect clients and remove the socket.
+ */
+void query_close(void) {
+	for (int i = 0; i < QUERY_MAX_CLIENTS; i++) {
+		if (clients[i].fd >= 0 && epoll_fd >= 0) {
+			client_close(&clients[i]);
+		}
+	}
+	if (epoll_fd >= 0) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		unlink(socket_path);
+	}
+	arena_free(&cache_arena);
+	cache_count = 0;
+	cache_generation = 0;
+}
+
+/**
+ * @brief Send one request to a server and copy the response to stdout.
+ *
+ * @param path Socket path.
+ * @param request Request text.
+ * @return 0 on success, -1 on failure.
+ */
+int query_client(const char *path, const char *request) {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    send(fd, request, strlen(request), MSG_NOSIGNAL) < 0 ||
+	    send(fd, "\n", 1, MSG_NOSIGNAL) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	/* A response is exactly one line */
+	char buffer[4096];
+	ssize_t n;
+	int done = 0;
+	while (!done && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+		fwrite(buffer, 1, (size_t)n, stdout);
+		done = buffer[n - 1] == '\n';
+	}
+	close(fd);
+	return done ? 0 : -1;
+}
@@ -0,0 +1,131 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "proc.h"
+#include <stddef.h>
+
+/**
+ * @brief Name of the query socket in $XDG_RUNTIME_DIR.
+ */
+#define QUERY_SOCKET_NAME "pb.sock"
+
+/**
+ * @brief Directory of the query socket without $XDG_RUNTIME_DIR.
+ */
+#define QUERY_SOCKET_DIR "/run/pb"
+
+/**
+ * @brief Maximum number of simultaneously connected clients.
+ */
+#define QUERY_MAX_CLIENTS 64
+
+/**
+ * @brief Maximum length of one request line.
+ */
+#define QUERY_LINE_MAX 512
+
+/**
+ * @brief Maximum number of distinct requests cached per generation.
+ */
+#define QUERY_CACHE_SIZE 64
+
+/**
+ * @brief Maximum size of one response.
+ */
+#define QUERY_RESPONSE_MAX (1024 * 1024)
+
+/**
+ * @brief Maximum unsent output per client; a client over it is dropped.
+ *
+ * Requests of a client are answered one at a time, each after the
+ * previous response was sent, so pending output stays within one
+ * response.
+ */
+#define QUERY_PENDING_MAX QUERY_RESPONSE_MAX
+
+/**
+ * @brief Output buffer a client keeps between responses (larger ones
+ *        are freed once sent).
+ */
+#define QUERY_KEEP_BUFFER (64 * 1024)
+
+/**
+ * @brief Gets the default query socket path.
+ *
+ * $XDG_RUNTIME_DIR/pb.sock when the variable holds an absolute path (a
+ * directory only its user can write), otherwise /run/pb/pb.sock. Never a
+ * world-writable directory, where another user could create the socket
+ * first.
+ *
+ * @return Static path.
+ */
+const char *query_default_path(void);
+
+/**
+ * @brief Creates the listening Unix socket and the epoll instance.
+ *
+ * A stale socket file (nobody accepting) is replaced. QUERY_SOCKET_DIR is
+ * created (mode 0755) when the path lies in it.
+ *
+ * @param path Socket path.
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int query_open(const char *path);
+
+/**
+ * @brief Gets a descriptor that becomes readable when query_poll() has
+ *        work, for waiting on several servers at once.
+ *
+ * @return Pollable descriptor, or -1 if not listening.
+ */
+int query_fd(void);
+
+/**
+ * @brief Serves clients until the timeout expires.
+ *
+ * Every request is answered from the given snapshot. Requests are
+ * newline-terminated text, responses one line of JSON:
+ *
+ *     top <n> <pid|name|mem|cpu|net>   n processes with the largest key
+ *     filter <expression>              processes matching (see expr.h)
+ *     pid <pid>                        detail of one process
+ *     history <pid>                    recorded CPU/memory samples
+ *
+ * @param plist Current snapshot.
+ * @param generation Snapshot number; cached responses of older
+ *                   generations are dropped.
+ * @param timeout_ms Time to wait for events.
+ */
+void query_poll(const proc_list_t *plist, unsigned long long generation,
+		int timeout_ms);
+
+/**
+ * @brief Answers one request (without the trailing newline).
+ *
+ * Identical requests against the same generation are answered from the
+ * cache without being evaluated again.
+ *
+ * @param request Request text.
+ * @param plist Current snapshot.
+ * @param generation Snapshot number.
+ * @param length Output for the response length, newline included.
+ * @return Response, valid until the next call.
+ */
+const char *query_execute(const char *request, const proc_list_t *plist,
+			  unsigned long long generation, size_t *length);
+
+/**
+ * @brief Disconnects all clients, closes and removes the socket.
+ */
+void query_close(void);
+
+/**
+ * @brief Sends one request to a running server and prints the response.
+ *
+ * @param path Socket path.
+ * @param request Request text.
+ * @return 0 on success, -1 if the server cannot be reached.
+ */
+int query_client(const char *path, const char *request);
+
+#endif // QUERY_H
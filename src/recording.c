@@ -0,0 +1,479 @@
+/**
+ * @file recording.c
+ * @brief Append-only recording of process lists, read back frame by frame.
+ *
+ * A recording is a header followed by frames; each frame is a small
+ * header and the processes of one refresh sorted by PID, so two frames
+ * can be compared with a single merge-join (see diff.c).
+ */
+
+#include "recording.h"
+#include "rules.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+static int record_fd = -1;
+static double record_interval = RECORDING_INTERVAL;
+static off_t file_size = 0;
+
+/* Records of the last refresh, double-buffered to carry traffic forward */
+static recording_record_t records_a[MAX_PROCESSES];
+static recording_record_t records_b[MAX_PROCESSES];
+static recording_record_t *current = records_a;
+static int current_count = 0;
+static int current_total = 0;
+static int64_t current_ms = -1;
+static int64_t written_ms = -1;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Record why a recording could not be read.
+ *
+ * @param error Message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @param message Message.
+ * @param detail Offending text (may be empty).
+ * @return -1.
+ */
+static int read_error(char *error, size_t error_size, const char *message,
+		      const char *detail) {
+	if (error && error_size > 0) {
+		snprintf(error, error_size, "%s%s%s%s", message,
+			 detail[0] ? " '" : "", detail, detail[0] ? "'" : "");
+	}
+	return -1;
+}
+
+/**
+ * @brief Comparator for records (ascending PID).
+ *
+ * @param a Pointer to first record.
+ * @param b Pointer to second record.
+ * @return Negative if a < b, positive if a > b, zero if equal.
+ */
+static int compare_record_pid(const void *a, const void *b) {
+	int32_t pa = ((const recording_record_t *)a)->pid;
+	int32_t pb = ((const recording_record_t *)b)->pid;
+	return (pa > pb) - (pa < pb);
+}
+
+/**
+ * @brief Check the file header of a recording.
+ *
+ * @param fd Open recording.
+ * @return 0 if it is a recording of this version, -1 otherwise.
+ */
+static int check_header(int fd) {
+	recording_header_t header;
+	if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+	    header.magic != RECORDING_MAGIC ||
+	    header.version != RECORDING_VERSION ||
+	    header.record_size != sizeof(recording_record_t)) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Read the header of the frame at an offset.
+ *
+ * @param fd Open recording.
+ * @param offset Offset of the frame.
+ * @param size File size.
+ * @param header Output.
+ * @return 1 if a complete frame starts at offset, 0 otherwise.
+ */
+static int frame_at(int fd, off_t offset, off_t size,
+		    recording_frame_header_t *header) {
+	if (offset + (off_t)sizeof(*header) > size ||
+	    pread(fd, header, sizeof(*header), offset) !=
+		    (ssize_t)sizeof(*header)) {
+		return 0;
+	}
+	if (header->magic != RECORDING_FRAME_MAGIC || header->count < 0 ||
+	    header->count > RECORDING_MAX_RECORDS) {
+		return 0;
+	}
+	off_t length = sizeof(*header) +
+		       (off_t)header->count * sizeof(recording_record_t);
+	return offset + length <= size;
+}
+
+/**
+ * @brief Offset of the frame following the one at offset.
+ *
+ * @param offset Offset of a frame.
+ * @param header Its header.
+ * @return Offset of the next frame.
+ */
+static off_t next_frame(off_t offset, const recording_frame_header_t *header) {
+	return offset + sizeof(*header) +
+	       (off_t)header->count * sizeof(recording_record_t);
+}
+
+/**
+ * @brief Read the storage I/O counters of a process.
+ *
+ * @param record Record of the process (read_bytes and write_bytes are set,
+ *        to -1 if /proc/[pid]/io cannot be read).
+ */
+static void read_io(recording_record_t *record) {
+	char path[PROC_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d/io", proc_root(), record->pid);
+
+	record->read_bytes = -1;
+	record->write_bytes = -1;
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	char *contents = arena_read_file(arena, path, 1024, NULL);
+	if (contents) {
+		/* At line starts: "cancelled_write_bytes:" follows */
+		char *read = strstr(contents, "\nread_bytes:");
+		char *write = strstr(contents, "\nwrite_bytes:");
+		if (read && write) {
+			record->read_bytes = strtoll(read + 12, NULL, 10);
+			record->write_bytes = strtoll(write + 13, NULL, 10);
+		}
+	}
+	arena_rewind(arena, mark);
+}
+
+/**
+ * @brief Append the records of the last refresh as one frame.
+ *
+ * I/O counters are read here, so only for frames that are written. A
+ * short write is cut off again, so the file never ends in a torn frame.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int write_frame(void) {
+	for (int i = 0; i < current_count; i++) {
+		read_io(&current[i]);
+	}
+
+	recording_frame_header_t header = {
+		.magic = RECORDING_FRAME_MAGIC,
+		.count = current_count,
+		.total = current_total,
+		.timestamp_ms = current_ms,
+	};
+	struct iovec parts[2] = {
+		{ &header, sizeof(header) },
+		{ current, current_count * sizeof(recording_record_t) },
+	};
+	ssize_t length = parts[0].iov_len + parts[1].iov_len;
+	if (writev(record_fd, parts, 2) != length) {
+		if (ftruncate(record_fd, file_size) < 0) {
+			/* Nothing better to do: the reader skips torn frames */
+		}
+		return -1;
+	}
+	file_size += length;
+	written_ms = current_ms;
+	return 0;
+}
+
+/**
+ * @brief Convert a time selector to a timestamp.
+ *
+ * @param when Unix seconds, local ISO time (UTC with Z) or -DURATION.
+ * @param last_ms Time of the last frame.
+ * @param target_ms Output.
+ * @return 0 on success, -1 if the text is not a time.
+ */
+static int parse_when(const char *when, int64_t last_ms, int64_t *target_ms) {
+	char *end;
+	if (when[0] == '-') {
+		double seconds;
+		if (rules_duration(when + 1, &seconds) < 0) {
+			return -1;
+		}
+		*target_ms = last_ms - (int64_t)(seconds * 1000);
+		return 0;
+	}
+
+	long long seconds = strtoll(when, &end, 10);
+	if (end != when && *end == '\0') {
+		*target_ms = seconds * 1000;
+		return 0;
+	}
+
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	end = strptime(when, "%Y-%m-%dT%H:%M", &tm);
+	if (end && *end == ':') {
+		end = strptime(end, ":%S", &tm);
+	}
+	if (!end || (*end && strcmp(end, "Z") != 0)) {
+		return -1;
+	}
+	time_t at;
+	if (*end == 'Z') {
+		at = timegm(&tm);
+	} else {
+		tm.tm_isdst = -1;
+		at = mktime(&tm);
+	}
+	*target_ms = (int64_t)at * 1000;
+	return 0;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Open a recording for appending.
+ *
+ * @param path Recording file.
+ * @param interval Seconds between frames.
+ * @return 0 on success, -1 on failure.
+ */
+int recording_open(const char *path, double interval) {
+	recording_close();
+
+	int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		return -1;
+	}
+	struct stat info;
+	if (fstat(fd, &info) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	off_t size = info.st_size;
+	if (size == 0) {
+		recording_header_t header = {
+			.magic = RECORDING_MAGIC,
+			.version = RECORDING_VERSION,
+			.record_size = sizeof(recording_record_t),
+		};
+		if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+			close(fd);
+			return -1;
+		}
+		size = sizeof(header);
+	} else if (check_header(fd) < 0) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	} else {
+		/* Cut off a frame torn by a crash before appending after it */
+		off_t offset = sizeof(recording_header_t);
+		recording_frame_header_t frame;
+		while (frame_at(fd, offset, size, &frame)) {
+			offset = next_frame(offset, &frame);
+		}
+		if (offset < size && ftruncate(fd, offset) < 0) {
+			close(fd);
+			return -1;
+		}
+		size = offset;
+	}
+
+	record_fd = fd;
+	record_interval = interval > 0 ? interval : RECORDING_INTERVAL;
+	file_size = size;
+	current_count = 0;
+	current_ms = -1;
+	written_ms = -1;
+	return 0;
+}
+
+/**
+ * @brief Account one refresh and append a frame when one is due.
+ *
+ * @param plist Processes sorted by PID.
+ * @param timestamp_ms Wall-clock time of the refresh.
+ * @return 1 if a frame was written, 0 if not due, -1 on a write error.
+ */
+int recording_update(const proc_list_t *plist, int64_t timestamp_ms) {
+	if (record_fd < 0) {
+		return 0;
+	}
+
+	double elapsed = 0;
+	if (current_ms >= 0 && timestamp_ms > current_ms) {
+		elapsed = (timestamp_ms - current_ms) / 1000.0;
+	}
+
+	/* Merge-join with the previous refresh to carry traffic totals */
+	const recording_record_t *previous = current;
+	int previous_count = current_count;
+	recording_record_t *next = current == records_a ? records_b : records_a;
+	int count = plist->count < MAX_PROCESSES ? plist->count : MAX_PROCESSES;
+	int j = 0;
+	for (int i = 0; i < count; i++) {
+		const proc_info_t *proc = &plist->list[i];
+		recording_record_t *record = &next[i];
+
+		while (j < previous_count && previous[j].pid < proc->pid) {
+			j++;
+		}
+		double carried = 0;
+		if (j < previous_count && previous[j].pid == proc->pid &&
+		    previous[j].start_time == proc->start_time) {
+			carried = previous[j].net_kb;
+		}
+
+		memset(record, 0, sizeof(*record));
+		record->pid = proc->pid;
+		record->uid = proc->uid;
+		record->start_time = proc->start_time;
+		record->cpu_ticks = proc->cpu_ticks;
+		record->memory = proc->memory;
+		record->net_kb = carried + (proc->net_rate > 0 ?
+					    proc->net_rate * elapsed : 0);
+		record->fd_count = proc->fd_count;
+		record->threads = proc->threads;
+		record->state = proc->state;
+		snprintf(record->name, sizeof(record->name), "%.*s",
+			 (int)sizeof(record->name) - 1, proc->name);
+		snprintf(record->user, sizeof(record->user), "%s", proc->user);
+	}
+	current = next;
+	current_count = count;
+	current_total = plist->total;
+	current_ms = timestamp_ms;
+
+	if (written_ms >= 0 &&
+	    timestamp_ms - written_ms < (int64_t)(record_interval * 1000)) {
+		return 0;
+	}
+	return write_frame() < 0 ? -1 : 1;
+}
+
+/**
+ * @brief Write the last refresh if needed and close the recording.
+ */
+void recording_close(void) {
+	if (record_fd < 0) {
+		return;
+	}
+	if (current_ms >= 0 && current_ms != written_ms) {
+		write_frame();
+	}
+	close(record_fd);
+	record_fd = -1;
+	current_count = 0;
+	current_ms = -1;
+	written_ms = -1;
+}
+
+/**
+ * @brief Read one frame of a recording.
+ *
+ * @param path Recording file.
+ * @param when Time of the frame (NULL or "" for the last one).
+ * @param frame Output.
+ * @param error Output for a message on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on failure.
+ */
+int recording_read(const char *path, const char *when,
+		   recording_frame_t *frame, char *error, size_t error_size) {
+	memset(frame, 0, sizeof(*frame));
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return read_error(error, error_size, strerror(errno), "");
+	}
+	struct stat info;
+	if (fstat(fd, &info) < 0 || check_header(fd) < 0) {
+		close(fd);
+		return read_error(error, error_size, "not a pb recording", "");
+	}
+
+	/* Headers only: records are skipped */
+	off_t size = info.st_size;
+	off_t offset = sizeof(recording_header_t);
+	off_t last = -1;
+	int64_t last_ms = 0;
+	recording_frame_header_t header;
+	for (; frame_at(fd, offset, size, &header);
+	     offset = next_frame(offset, &header)) {
+		last = offset;
+		last_ms = header.timestamp_ms;
+	}
+	if (last < 0) {
+		close(fd);
+		return read_error(error, error_size, "no frames recorded", "");
+	}
+
+	off_t chosen = last;
+	if (when && *when) {
+		int64_t target_ms;
+		if (parse_when(when, last_ms, &target_ms) < 0) {
+			close(fd);
+			return read_error(error, error_size, "bad time", when);
+		}
+
+		/* Newest frame not after the target */
+		chosen = -1;
+		int64_t chosen_ms = 0;
+		offset = sizeof(recording_header_t);
+		for (; frame_at(fd, offset, size, &header);
+		     offset = next_frame(offset, &header)) {
+			if (header.timestamp_ms <= target_ms &&
+			    (chosen < 0 || header.timestamp_ms >= chosen_ms)) {
+				chosen = offset;
+				chosen_ms = header.timestamp_ms;
+			}
+		}
+		if (chosen < 0) {
+			close(fd);
+			return read_error(error, error_size,
+					  "no frame at or before", when);
+		}
+	}
+
+	frame_at(fd, chosen, size, &header);
+	size_t length = (size_t)header.count * sizeof(recording_record_t);
+	frame->records = malloc(length ? length : 1);
+	if (!frame->records ||
+	    pread(fd, frame->records, length, chosen + sizeof(header)) !=
+		    (ssize_t)length) {
+		free(frame->records);
+		frame->records = NULL;
+		close(fd);
+		return read_error(error, error_size, "cannot read frame", "");
+	}
+	close(fd);
+
+	frame->timestamp_ms = header.timestamp_ms;
+	frame->count = header.count;
+	frame->total = header.total;
+	for (int i = 0; i < frame->count; i++) {
+		frame->records[i].name[sizeof(frame->records[i].name) - 1] = '\0';
+		frame->records[i].user[sizeof(frame->records[i].user) - 1] = '\0';
+	}
+
+	/* Frames written by pb are sorted already; others are tolerated */
+	for (int i = 1; i < frame->count; i++) {
+		if (frame->records[i - 1].pid > frame->records[i].pid) {
+			qsort(frame->records, frame->count,
+			      sizeof(recording_record_t), compare_record_pid);
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Release the records of a frame.
+ *
+ * @param frame Frame read by recording_read().
+ */
+void recording_frame_free(recording_frame_t *frame) {
+	free(frame->records);
+	frame->records = NULL;
+	frame->count = 0;
+}
@@ -0,0 +1,140 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "proc.h"
+#include <stdint.h>
+
+/**
+ * @brief File magic ("PBRC") and layout version of a recording.
+ */
+#define RECORDING_MAGIC 0x50425243u
+#define RECORDING_VERSION 2u
+
+/**
+ * @brief Frame magic ("PBFR").
+ */
+#define RECORDING_FRAME_MAGIC 0x50424652u
+
+/**
+ * @brief Seconds between recorded frames unless --record-interval is given.
+ */
+#define RECORDING_INTERVAL 60.0
+
+/**
+ * @brief Largest frame accepted when reading (records).
+ */
+#define RECORDING_MAX_RECORDS (1 << 22)
+
+/**
+ * @brief One process in a recorded frame.
+ *
+ * Counters are cumulative, so two frames of the same process give the CPU
+ * time, storage I/O and traffic between them.
+ */
+typedef struct {
+	int32_t pid;                /**< Process ID */
+	uint32_t uid;               /**< Owner user ID */
+	uint64_t start_time;        /**< Start time in ticks after boot */
+	uint64_t cpu_ticks;         /**< utime + stime in clock ticks */
+	int64_t memory;             /**< RSS in kB */
+	double net_kb;              /**< TCP traffic in kB since first recorded */
+	int64_t read_bytes;         /**< Bytes read from storage (-1 if unknown) */
+	int64_t write_bytes;        /**< Bytes written to storage (-1 if unknown) */
+	int32_t fd_count;           /**< Open descriptors (-1 if unknown) */
+	int32_t threads;            /**< Number of threads */
+	char state;                 /**< State letter (R, S, D, Z, ...) */
+	char reserved[7];           /**< Zero */
+	char name[64];              /**< Command name */
+	char user[32];              /**< Owner user name */
+} recording_record_t;
+
+/**
+ * @brief File header, written once at the start of a recording.
+ */
+typedef struct {
+	uint32_t magic;             /**< RECORDING_MAGIC */
+	uint32_t version;           /**< RECORDING_VERSION */
+	uint32_t record_size;       /**< sizeof(recording_record_t) */
+	uint32_t reserved;          /**< Zero */
+} recording_header_t;
+
+/**
+ * @brief Frame header, followed by count records sorted by PID.
+ */
+typedef struct {
+	uint32_t magic;             /**< RECORDING_FRAME_MAGIC */
+	int32_t count;              /**< Number of records */
+	int32_t total;              /**< Processes found (may exceed count) */
+	uint32_t reserved;          /**< Zero */
+	int64_t timestamp_ms;       /**< Wall-clock time of the frame */
+} recording_frame_header_t;
+
+/**
+ * @brief A frame read back from a recording.
+ */
+typedef struct {
+	int64_t timestamp_ms;       /**< Wall-clock time of the frame */
+	int count;                  /**< Number of records */
+	int total;                  /**< Processes found when recorded */
+	recording_record_t *records;/**< Records sorted by PID (malloc'd) */
+} recording_frame_t;
+
+/**
+ * @brief Opens a recording for appending frames.
+ *
+ * A new file gets a header; an existing one must be a recording of this
+ * version, and a frame left incomplete by a crash is cut off.
+ *
+ * @param path Recording file, created with mode 0600 if needed.
+ * @param interval Seconds between frames (see recording_update()).
+ * @return 0 on success, -1 on failure (errno is set, EINVAL for a file
+ *         that is not a recording).
+ */
+int recording_open(const char *path, double interval);
+
+/**
+ * @brief Accounts one refresh and appends a frame when one is due.
+ *
+ * Called after every collection pass. Traffic is integrated over every
+ * pass (rate times elapsed time), so frames can be far apart. The first
+ * update writes a frame, later ones every interval. Storage I/O counters
+ * are read from /proc/[pid]/io only for frames that are written (-1 where
+ * not permitted). Each frame goes out in a single write.
+ *
+ * @param plist Processes sorted by PID (as from proc_list_update()).
+ * @param timestamp_ms Wall-clock time of the refresh.
+ * @return 1 if a frame was written, 0 if none was due, -1 on a write error.
+ */
+int recording_update(const proc_list_t *plist, int64_t timestamp_ms);
+
+/**
+ * @brief Writes the last refresh (if not yet written) and closes the file.
+ */
+void recording_close(void);
+
+/**
+ * @brief Reads one frame of a recording.
+ *
+ * @p when selects the frame: NULL or "" for the last one, otherwise the
+ * newest frame not after a time given as unix seconds ("1760690000"),
+ * local time ("2026-10-17T10:30", seconds optional, UTC with a trailing
+ * Z) or a duration before the last frame ("-1h", see rules_duration()).
+ *
+ * @param path Recording file.
+ * @param when Time of the frame.
+ * @param frame Output (release with recording_frame_free()).
+ * @param error Output for a message on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on failure.
+ */
+int recording_read(const char *path, const char *when,
+		   recording_frame_t *frame, char *error, size_t error_size);
+
+/**
+ * @brief Releases the records of a frame.
+ *
+ * @param frame Frame read by recording_read().
+ */
+void recording_frame_free(recording_frame_t *frame);
+
+#endif // RECORDING_H
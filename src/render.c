@@ -0,0 +1,833 @@
+/**
+ * @file render.c
+ * @brief Screen grid with per-frame diffing and three output backends.
+ *
+ * The UI draws every frame into an in-memory grid of cells. Presenting a
+ * frame compares it line by line with the previously presented one and
+ * hands only the runs of changed cells to the backend: ncursesw, plain
+ * ANSI escapes, or nothing at all (the grid backend used by tests and
+ * benchmarks, which read the presented cells back).
+ */
+
+#include "render.h"
+#include "textwidth.h"
+#include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <locale.h>
+#include <limits.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/* Escape output is collected and written in chunks of this size */
+#define ANSI_OUT_SIZE 65536
+
+/* Time to wait for the rest of an escape sequence after ESC */
+#define ANSI_ESC_WAIT_MS 25
+
+static RenderBackend backend = RENDER_GRID;
+static int rows = 0;
+static int cols = 0;
+static int grid_rows = RENDER_GRID_ROWS;
+static int grid_cols = RENDER_GRID_COLS;
+
+static render_cell_t *frame = NULL;   /* Frame being drawn */
+static render_cell_t *shown = NULL;   /* Last presented frame */
+static int repaint = 1;               /* shown is unknown: send every cell */
+
+/* ncurses backend */
+static attr_t curses_attrs[STYLE_COUNT];
+static cchar_t *curses_row = NULL;    /* One run converted for ncursesw */
+
+/* ANSI backend */
+static const char *const ansi_sgr[STYLE_COUNT] = {
+	[STYLE_NORMAL] = "0",
+	[STYLE_HEADER] = "0;1;30;46",
+	[STYLE_FOCUS] = "0;1;7;30;46",
+	[STYLE_SELECTED] = "0;30;47",
+	[STYLE_DIALOG] = "0;1;37;41",
+	[STYLE_DETAIL] = "0;37;44",
+	[STYLE_DETAIL_TITLE] = "0;1;37;44",
+	[STYLE_WARN] = "0;33",
+	[STYLE_CRIT] = "0;1;31",
+	[STYLE_TOP] = "0;35",
+	[STYLE_DIM] = "0;2",
+	[STYLE_ALERT] = "0;1;37;41",
+};
+static char ansi_out[ANSI_OUT_SIZE];
+static size_t ansi_len = 0;
+static int ansi_style = -1;            /* Style of the terminal cursor */
+static int ansi_raw = 0;               /* stdin switched to raw mode */
+static struct termios ansi_saved;
+static volatile sig_atomic_t ansi_winch = 0;
+static volatile sig_atomic_t ansi_active = 0; /* Terminal taken over */
+static struct sigaction ansi_saved_int;
+static struct sigaction ansi_saved_term;
+
+/* Resets style, shows the cursor and leaves the alternate screen */
+#define ANSI_RESTORE "\033[0m\033[?25h\033[?1049l"
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Query the size of the output device.
+ *
+ * @param out_rows Output for lines.
+ * @param out_cols Output for columns.
+ */
+static void device_size(int *out_rows, int *out_cols) {
+	struct winsize ws;
+
+	switch (backend) {
+	case RENDER_NCURSES:
+		getmaxyx(stdscr, *out_rows, *out_cols);
+		break;
+	case RENDER_ANSI:
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 &&
+		    ws.ws_row > 0 && ws.ws_col > 0) {
+			*out_rows = ws.ws_row;
+			*out_cols = ws.ws_col;
+		} else {
+			*out_rows = RENDER_GRID_ROWS;
+			*out_cols = RENDER_GRID_COLS;
+		}
+		break;
+	default:
+		*out_rows = grid_rows;
+		*out_cols = grid_cols;
+		break;
+	}
+	if (*out_rows < 0) {
+		*out_rows = 0;
+	}
+	if (*out_cols < 0) {
+		*out_cols = 0;
+	}
+}
+
+/**
+ * @brief Set up colors and the style table of the ncurses backend.
+ */
+static void curses_open(void) {
+	initscr();
+	cbreak();
+	noecho();
+	curs_set(0);
+	keypad(stdscr, TRUE);
+
+	if (has_colors()) {
+		start_color();
+		use_default_colors();                    /* -1: terminal background */
+		init_pair(1, COLOR_BLACK, COLOR_CYAN);   /* Header */
+		init_pair(2, COLOR_WHITE, COLOR_RED);    /* Dialog, alert row */
+		init_pair(3, COLOR_BLACK, COLOR_WHITE);  /* Selected row */
+		init_pair(4, COLOR_WHITE, COLOR_BLUE);   /* Detail pane */
+		init_pair(5, COLOR_YELLOW, -1);          /* Warning cell */
+		init_pair(6, COLOR_RED, -1);             /* Critical cell */
+		init_pair(7, COLOR_MAGENTA, -1);         /* Top percentile */
+		curses_attrs[STYLE_HEADER] = COLOR_PAIR(1) | A_BOLD;
+		curses_attrs[STYLE_FOCUS] = COLOR_PAIR(1) | A_BOLD | A_REVERSE;
+		curses_attrs[STYLE_SELECTED] = COLOR_PAIR(3);
+		curses_attrs[STYLE_DIALOG] = COLOR_PAIR(2) | A_BOLD;
+		curses_attrs[STYLE_DETAIL] = COLOR_PAIR(4);
+		curses_attrs[STYLE_DETAIL_TITLE] = COLOR_PAIR(4) | A_BOLD;
+		curses_attrs[STYLE_WARN] = COLOR_PAIR(5);
+		curses_attrs[STYLE_CRIT] = COLOR_PAIR(6) | A_BOLD;
+		curses_attrs[STYLE_TOP] = COLOR_PAIR(7);
+		curses_attrs[STYLE_ALERT] = COLOR_PAIR(2) | A_BOLD;
+	} else {
+		curses_attrs[STYLE_HEADER] = A_BOLD | A_REVERSE;
+		curses_attrs[STYLE_FOCUS] = A_BOLD;
+		curses_attrs[STYLE_SELECTED] = A_REVERSE;
+		curses_attrs[STYLE_DIALOG] = A_BOLD | A_REVERSE;
+		curses_attrs[STYLE_DETAIL_TITLE] = A_BOLD;
+		curses_attrs[STYLE_WARN] = A_BOLD;
+		curses_attrs[STYLE_CRIT] = A_BOLD;
+		curses_attrs[STYLE_TOP] = A_UNDERLINE;
+		curses_attrs[STYLE_ALERT] = A_BOLD | A_REVERSE;
+	}
+	curses_attrs[STYLE_DIM] = A_DIM;
+}
+
+/**
+ * @brief Send one run of cells to ncurses.
+ *
+ * Continuation cells are skipped; ncursesw advances two columns for the
+ * double-width character itself.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param cells Cells of the run.
+ * @param count Number of cells.
+ */
+static void curses_run(int y, int x, const render_cell_t *cells, int count) {
+	int n = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (cells[i].ch == TEXT_CONTINUATION) {
+			continue;
+		}
+		attr_t attr = curses_attrs[cells[i].style];
+		wchar_t wc[2] = { cells[i].ch, L'\0' };
+		setcchar(&curses_row[n++], wc, attr & ~A_COLOR,
+			 PAIR_NUMBER(attr), NULL);
+	}
+	mvadd_wchnstr(y, x, curses_row, n);
+}
+
+/**
+ * @brief Write the collected escape output to stdout.
+ */
+static void ansi_flush(void) {
+	size_t done = 0;
+	while (done < ansi_len) {
+		ssize_t n = write(STDOUT_FILENO, ansi_out + done,
+				  ansi_len - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	ansi_len = 0;
+}
+
+/**
+ * @brief Append bytes to the escape output.
+ *
+ * @param text Bytes.
+ * @param len Number of bytes.
+ */
+static void ansi_put(const char *text, size_t len) {
+	if (ansi_len + len > sizeof(ansi_out)) {
+		ansi_flush();
+	}
+	memcpy(ansi_out + ansi_len, text, len);
+	ansi_len += len;
+}
+
+/**
+ * @brief Append a string to the escape output.
+ *
+ * @param text NUL-terminated text.
+ */
+static void ansi_puts(const char *text) {
+	ansi_put(text, strlen(text));
+}
+
+/**
+ * @brief Send one run of cells as cursor movement, SGR and UTF-8.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param cells Cells of the run.
+ * @param count Number of cells.
+ */
+static void ansi_run(int y, int x, const render_cell_t *cells, int count) {
+	char seq[32];
+	int len = snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1);
+	ansi_put(seq, len);
+
+	for (int i = 0; i < count; i++) {
+		if (cells[i].ch == TEXT_CONTINUATION) {
+			continue;
+		}
+		if (cells[i].style != ansi_style) {
+			ansi_style = cells[i].style;
+			len = snprintf(seq, sizeof(seq), "\033[%sm",
+				       ansi_sgr[ansi_style]);
+			ansi_put(seq, len);
+		}
+		if (cells[i].ch < 0x80) {
+			char c = (char)cells[i].ch;
+			ansi_put(&c, 1);
+			continue;
+		}
+		char mb[MB_LEN_MAX];
+		mbstate_t state;
+		memset(&state, 0, sizeof(state));
+		size_t n = wcrtomb(mb, cells[i].ch, &state);
+		if (n == (size_t)-1) {
+			ansi_put("?", 1);
+		} else {
+			ansi_put(mb, n);
+		}
+	}
+}
+
+/**
+ * @brief Note a terminal resize for the ANSI backend.
+ *
+ * @param sig Unused.
+ */
+static void ansi_on_winch(int sig) {
+	(void)sig;
+	ansi_winch = 1;
+}
+
+/**
+ * @brief Restore the terminal on SIGINT/SIGTERM, then die of the signal.
+ *
+ * Only async-signal-safe calls: a fixed escape string and tcsetattr().
+ *
+ * @param sig Signal received.
+ */
+static void ansi_on_fatal(int sig) {
+	if (ansi_active) {
+		ssize_t ignored = write(STDOUT_FILENO, ANSI_RESTORE,
+					sizeof(ANSI_RESTORE) - 1);
+		(void)ignored;
+		if (ansi_raw) {
+			tcsetattr(STDIN_FILENO, TCSANOW, &ansi_saved);
+		}
+	}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+/**
+ * @brief Give the terminal back after the ANSI backend.
+ */
+static void ansi_close(void) {
+	ansi_puts(ANSI_RESTORE);
+	ansi_flush();
+	if (ansi_raw) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &ansi_saved);
+		ansi_raw = 0;
+	}
+	ansi_active = 0;
+	signal(SIGWINCH, SIG_DFL);
+	sigaction(SIGINT, &ansi_saved_int, NULL);
+	sigaction(SIGTERM, &ansi_saved_term, NULL);
+}
+
+/**
+ * @brief Restore the terminal if the program exits without render_close().
+ */
+static void ansi_at_exit(void) {
+	if (ansi_active) {
+		ansi_close();
+	}
+}
+
+/**
+ * @brief Take over the terminal for the ANSI backend.
+ */
+static void ansi_open(void) {
+	static int exit_hooked = 0;
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = ansi_on_winch;
+	sigemptyset(&sa.sa_mask);
+	/* No SA_RESTART: a resize must interrupt poll() */
+	sigaction(SIGWINCH, &sa, NULL);
+
+	/* Interrupted or killed, the terminal must not stay raw */
+	sa.sa_handler = ansi_on_fatal;
+	sigaction(SIGINT, &sa, &ansi_saved_int);
+	sigaction(SIGTERM, &sa, &ansi_saved_term);
+	if (!exit_hooked) {
+		exit_hooked = atexit(ansi_at_exit) == 0;
+	}
+
+	if (tcgetattr(STDIN_FILENO, &ansi_saved) == 0) {
+		struct termios raw = ansi_saved;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		ansi_raw = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+	}
+
+	/* Alternate screen, hidden cursor */
+	ansi_active = 1;
+	ansi_puts("\033[?1049h\033[?25l\033[0m\033[2J");
+	ansi_style = STYLE_NORMAL;
+	ansi_flush();
+}
+
+/**
+ * @brief Read one byte of input.
+ *
+ * @param timeout_ms Time to wait (-1 blocks).
+ * @return Byte, -1 on timeout or error, KEY_RESIZE on a resize.
+ */
+static int ansi_byte(int timeout_ms) {
+	struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+
+	if (ansi_winch) {
+		ansi_winch = 0;
+		return KEY_RESIZE;
+	}
+	int rc = poll(&pfd, 1, timeout_ms);
+	if (rc < 0 && errno == EINTR && ansi_winch) {
+		ansi_winch = 0;
+		return KEY_RESIZE;
+	}
+	unsigned char c;
+	if (rc <= 0 || read(STDIN_FILENO, &c, 1) != 1) {
+		return -1;
+	}
+	return c;
+}
+
+/**
+ * @brief Read a key, decoding the escape sequences of common terminals.
+ *
+ * @param timeout_ms Time to wait (-1 blocks).
+ * @return Key code in ncurses terms, or -1 on timeout.
+ */
+static int ansi_key(int timeout_ms) {
+	static const struct {
+		const char *seq;
+		int key;
+	} sequences[] = {
+		{ "[A", KEY_UP }, { "[B", KEY_DOWN },
+		{ "[C", KEY_RIGHT }, { "[D", KEY_LEFT },
+		{ "OA", KEY_UP }, { "OB", KEY_DOWN },
+		{ "OC", KEY_RIGHT }, { "OD", KEY_LEFT },
+		{ "[20~", KEY_F(9) },
+	};
+
+	int c = ansi_byte(timeout_ms);
+	if (c == '\r') {
+		return '\n';
+	}
+	if (c == 127 || c == 8) {
+		return KEY_BACKSPACE;
+	}
+	if (c != 27) {
+		return c;
+	}
+
+	/* A lone ESC is the key itself; a sequence follows immediately */
+	char seq[8];
+	int len = 0;
+	while (len < (int)sizeof(seq) - 1) {
+		int next = ansi_byte(ANSI_ESC_WAIT_MS);
+		if (next < 0 || next == KEY_RESIZE) {
+			if (next == KEY_RESIZE) {
+				ansi_winch = 1;
+			}
+			break;
+		}
+		seq[len++] = (char)next;
+		if (len > 1 && next >= 0x40 && next <= 0x7e) {
+			break;
+		}
+	}
+	seq[len] = '\0';
+	if (len == 0) {
+		return 27;
+	}
+	for (size_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++) {
+		if (strcmp(seq, sequences[i].seq) == 0) {
+			return sequences[i].key;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Get a cell of the frame being drawn.
+ *
+ * @param y Line.
+ * @param x Column.
+ * @return Cell, or NULL if outside the screen.
+ */
+static render_cell_t *cell_at(int y, int x) {
+	if (y < 0 || y >= rows || x < 0 || x >= cols) {
+		return NULL;
+	}
+	return &frame[y * cols + x];
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Open a backend and size the screen.
+ *
+ * @param which Output device.
+ * @return 0 on success, -1 on failure.
+ */
+int render_open(RenderBackend which) {
+	backend = which;
+	/*
+	 * Needed for wide characters (UTF-8 names, sparkline blocks). Only
+	 * LC_CTYPE: LC_NUMERIC must stay "C" so logged numbers keep a '.'.
+	 */
+	if (backend != RENDER_GRID) {
+		setlocale(LC_CTYPE, "");
+	}
+	if (backend == RENDER_NCURSES) {
+		curses_open();
+	} else if (backend == RENDER_ANSI) {
+		ansi_open();
+	}
+
+	rows = 0;
+	cols = 0;
+	render_resize();
+	return frame ? 0 : -1;
+}
+
+/**
+ * @brief Restore the terminal and free the screen.
+ */
+void render_close(void) {
+	if (backend == RENDER_NCURSES) {
+		endwin();
+	} else if (backend == RENDER_ANSI) {
+		ansi_close();
+	}
+	free(frame);
+	free(shown);
+	free(curses_row);
+	frame = NULL;
+	shown = NULL;
+	curses_row = NULL;
+	rows = 0;
+	cols = 0;
+	grid_rows = RENDER_GRID_ROWS;
+	grid_cols = RENDER_GRID_COLS;
+	backend = RENDER_GRID;
+}
+
+/**
+ * @brief Report the backend in use.
+ *
+ * @return Backend passed to render_open().
+ */
+RenderBackend render_backend(void) {
+	return backend;
+}
+
+/**
+ * @brief Adopt the current size of the output device.
+ *
+ * @return 1 if the size changed, 0 otherwise.
+ */
+int render_resize(void) {
+	int new_rows, new_cols;
+	device_size(&new_rows, &new_cols);
+	if (frame && new_rows == rows && new_cols == cols) {
+		return 0;
+	}
+
+	size_t count = (size_t)new_rows * new_cols + 1;
+	free(frame);
+	free(shown);
+	free(curses_row);
+	frame = malloc(count * sizeof(render_cell_t));
+	shown = malloc(count * sizeof(render_cell_t));
+	curses_row = malloc((new_cols + 1) * sizeof(cchar_t));
+	if (!frame || !shown || !curses_row) {
+		free(frame);
+		free(shown);
+		free(curses_row);
+		frame = NULL;
+		shown = NULL;
+		curses_row = NULL;
+		new_rows = 0;
+		new_cols = 0;
+	}
+
+	rows = new_rows;
+	cols = new_cols;
+	repaint = 1;
+	render_erase();
+	if (frame) {
+		memcpy(shown, frame, (size_t)rows * cols * sizeof(render_cell_t));
+	}
+	if (backend == RENDER_NCURSES) {
+		clearok(curscr, TRUE);
+	} else if (backend == RENDER_ANSI) {
+		ansi_puts("\033[0m\033[2J");
+		ansi_style = STYLE_NORMAL;
+	}
+	return 1;
+}
+
+/**
+ * @brief Change the size of the grid backend.
+ *
+ * @param new_rows Lines.
+ * @param new_cols Columns.
+ */
+void render_grid_resize(int new_rows, int new_cols) {
+	grid_rows = new_rows;
+	grid_cols = new_cols;
+}
+
+/**
+ * @brief Get the number of lines.
+ *
+ * @return Lines of the screen.
+ */
+int render_rows(void) {
+	return rows;
+}
+
+/**
+ * @brief Get the number of columns.
+ *
+ * @return Columns of the screen.
+ */
+int render_cols(void) {
+	return cols;
+}
+
+/**
+ * @brief Start a frame with blank cells.
+ */
+void render_erase(void) {
+	for (int i = 0; frame && i < rows * cols; i++) {
+		frame[i].ch = L' ';
+		frame[i].style = STYLE_NORMAL;
+	}
+}
+
+/**
+ * @brief Fill part of a line with blanks.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells.
+ * @param style Style of the blanks.
+ */
+void render_fill(int y, int x, int width, RenderStyle style) {
+	for (int i = 0; i < width; i++) {
+		render_cell_t *cell = cell_at(y, x + i);
+		if (!cell) {
+			break;
+		}
+		cell->ch = L' ';
+		cell->style = style;
+	}
+}
+
+/**
+ * @brief Change the style of cells.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells.
+ * @param style New style.
+ */
+void render_restyle(int y, int x, int width, RenderStyle style) {
+	for (int i = 0; i < width; i++) {
+		render_cell_t *cell = cell_at(y, x + i);
+		if (!cell) {
+			break;
+		}
+		cell->style = style;
+	}
+}
+
+/**
+ * @brief Copy screen cells onto a line.
+ *
+ * A double-width character cut by the right edge becomes a blank.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param cells Cells.
+ * @param count Number of cells.
+ * @param style Style of the cells.
+ * @param classes Class of every cell, or NULL.
+ * @param class_styles Style of every class.
+ */
+void render_cells(int y, int x, const wchar_t *cells, int count,
+		  RenderStyle style, const unsigned char *classes,
+		  const unsigned char *class_styles) {
+	render_cell_t *line = cell_at(y, x);
+	if (!line) {
+		return;
+	}
+	int clipped = count > cols - x;
+	if (clipped) {
+		count = cols - x;
+	}
+
+	for (int i = 0; i < count; i++) {
+		line[i].ch = cells[i];
+		line[i].style = (classes && classes[i]) ?
+				class_styles[classes[i]] : style;
+	}
+	if (clipped && cells[count] == TEXT_CONTINUATION) {
+		line[count - 1].ch = L' ';
+	}
+}
+
+/**
+ * @brief Write UTF-8 text truncated to a display width.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells available.
+ * @param text UTF-8 text.
+ * @param style Style of the text.
+ * @return Number of cells used.
+ */
+int render_text(int y, int x, int width, const char *text, RenderStyle style) {
+	wchar_t cells[512];
+
+	if (width > cols - x) {
+		width = cols - x;
+	}
+	if (width > (int)(sizeof(cells) / sizeof(cells[0]))) {
+		width = sizeof(cells) / sizeof(cells[0]);
+	}
+	if (width <= 0 || y < 0 || y >= rows) {
+		return 0;
+	}
+	int used = text_cells(text, cells, width);
+	render_cells(y, x, cells, used, style, NULL, NULL);
+	return used;
+}
+
+/**
+ * @brief Write formatted text, clipped at the right edge.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param style Style of the text.
+ * @param format printf format.
+ * @return Number of cells used.
+ */
+int render_printf(int y, int x, RenderStyle style, const char *format, ...) {
+	char text[1024];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	return render_text(y, x, cols - x, text, style);
+}
+
+/**
+ * @brief Send the cells that changed since the last frame.
+ *
+ * @return Number of cells sent.
+ */
+int render_present(void) {
+	int sent = 0;
+
+	for (int y = 0; y < rows; y++) {
+		render_cell_t *now = &frame[y * cols];
+		render_cell_t *old = &shown[y * cols];
+		int x = 0;
+
+		while (x < cols) {
+			if (!repaint && now[x].ch == old[x].ch &&
+			    now[x].style == old[x].style) {
+				x++;
+				continue;
+			}
+			int start = x;
+			while (x < cols &&
+			       (repaint || now[x].ch != old[x].ch ||
+				now[x].style != old[x].style)) {
+				x++;
+			}
+			/* A run never starts on the second half of a wide character */
+			if (start > 0 && now[start].ch == TEXT_CONTINUATION) {
+				start--;
+			}
+
+			if (backend == RENDER_NCURSES) {
+				curses_run(y, start, now + start, x - start);
+			} else if (backend == RENDER_ANSI) {
+				ansi_run(y, start, now + start, x - start);
+			}
+			sent += x - start;
+		}
+		memcpy(old, now, cols * sizeof(render_cell_t));
+	}
+	repaint = 0;
+
+	if (backend == RENDER_NCURSES) {
+		refresh();
+	} else if (backend == RENDER_ANSI) {
+		ansi_flush();
+	}
+	return sent;
+}
+
+/**
+ * @brief Get a presented line.
+ *
+ * @param y Line.
+ * @return Cells of the line, or NULL if out of range.
+ */
+const render_cell_t *render_line(int y) {
+	if (y < 0 || y >= rows) {
+		return NULL;
+	}
+	return &shown[y * cols];
+}
+
+/**
+ * @brief Convert a presented line to UTF-8 text.
+ *
+ * @param y Line.
+ * @param out Output buffer.
+ * @param size Size of out.
+ * @return Length of the text, or -1 if y is out of range.
+ */
+int render_line_text(int y, char *out, size_t size) {
+	const render_cell_t *line = render_line(y);
+	size_t len = 0;
+
+	if (!line || size == 0) {
+		return -1;
+	}
+	for (int x = 0; x < cols; x++) {
+		char mb[MB_LEN_MAX];
+		size_t n = 1;
+		mb[0] = (char)line[x].ch;
+		if (line[x].ch == TEXT_CONTINUATION) {
+			continue;
+		} else if (line[x].ch >= 0x80) {
+			mbstate_t state;
+			memset(&state, 0, sizeof(state));
+			n = wcrtomb(mb, line[x].ch, &state);
+			if (n == (size_t)-1) {
+				mb[0] = '?';
+				n = 1;
+			}
+		}
+		if (len + n >= size) {
+			break;
+		}
+		memcpy(out + len, mb, n);
+		len += n;
+	}
+	out[len] = '\0';
+	return (int)len;
+}
+
+/**
+ * @brief Wait for a key.
+ *
+ * @param timeout_ms Time to wait (-1 blocks).
+ * @return Key code, or -1 on timeout.
+ */
+int render_key(int timeout_ms) {
+	if (backend == RENDER_NCURSES) {
+		timeout(timeout_ms);
+		int ch = getch();
+		return ch == ERR ? -1 : ch;
+	}
+	if (backend == RENDER_ANSI) {
+		return ansi_key(timeout_ms);
+	}
+	return -1;
+}
@@ -0,0 +1,216 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+#include <wchar.h>
+
+/**
+ * @brief Rows of the grid backend until render_grid_resize() is called.
+ */
+#define RENDER_GRID_ROWS 24
+
+/**
+ * @brief Columns of the grid backend until render_grid_resize() is called.
+ */
+#define RENDER_GRID_COLS 80
+
+/**
+ * @brief Output devices the screen can be presented on.
+ */
+typedef enum {
+	RENDER_NCURSES,  /**< ncursesw (terminfo, colors, keypad) */
+	RENDER_ANSI,     /**< Plain VT100/ANSI escapes on stdout, raw stdin */
+	RENDER_GRID      /**< In memory only (tests, benchmarks) */
+} RenderBackend;
+
+/**
+ * @brief Appearance of a cell, mapped to attributes by each backend.
+ */
+typedef enum {
+	STYLE_NORMAL,        /**< Default colors */
+	STYLE_HEADER,        /**< Header and search prompt */
+	STYLE_FOCUS,         /**< Focused column header */
+	STYLE_SELECTED,      /**< Selected row */
+	STYLE_DIALOG,        /**< Kill confirmation */
+	STYLE_DETAIL,        /**< Detail pane */
+	STYLE_DETAIL_TITLE,  /**< Title line of the detail pane */
+	STYLE_WARN,          /**< Above a warning threshold */
+	STYLE_CRIT,          /**< Above a critical threshold */
+	STYLE_TOP,           /**< In the top percentile */
+	STYLE_DIM,           /**< Inactive (zombie, D-state) row */
+	STYLE_ALERT,         /**< Row flagged by a firing watch rule */
+	STYLE_COUNT          /**< Number of styles */
+} RenderStyle;
+
+/**
+ * @brief One screen cell.
+ */
+typedef struct {
+	wchar_t ch;             /**< Character, or TEXT_CONTINUATION */
+	unsigned char style;    /**< RenderStyle */
+} render_cell_t;
+
+/**
+ * @brief Opens a backend and sizes the screen.
+ *
+ * The ncurses and ANSI backends take over the terminal; the grid backend
+ * starts with RENDER_GRID_ROWS x RENDER_GRID_COLS cells.
+ *
+ * @param backend Output device.
+ * @return 0 on success, -1 on failure.
+ */
+int render_open(RenderBackend backend);
+
+/**
+ * @brief Restores the terminal and frees the screen.
+ */
+void render_close(void);
+
+/**
+ * @brief Reports the backend in use.
+ *
+ * @return Backend passed to render_open().
+ */
+RenderBackend render_backend(void);
+
+/**
+ * @brief Adopts the current size of the output device.
+ *
+ * Both buffers are reallocated only if the size changed; the next
+ * render_present() then repaints every cell.
+ *
+ * @return 1 if the size changed, 0 otherwise.
+ */
+int render_resize(void);
+
+/**
+ * @brief Changes the size of the grid backend (simulated terminal resize).
+ *
+ * Takes effect at the next render_resize().
+ *
+ * @param rows Lines.
+ * @param cols Columns.
+ */
+void render_grid_resize(int rows, int cols);
+
+/**
+ * @brief Gets the number of lines.
+ *
+ * @return Lines of the screen.
+ */
+int render_rows(void);
+
+/**
+ * @brief Gets the number of columns.
+ *
+ * @return Columns of the screen.
+ */
+int render_cols(void);
+
+/**
+ * @brief Starts a frame: every cell becomes a blank in STYLE_NORMAL.
+ */
+void render_erase(void);
+
+/**
+ * @brief Fills part of a line with blanks.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells (clipped to the screen).
+ * @param style Style of the blanks.
+ */
+void render_fill(int y, int x, int width, RenderStyle style);
+
+/**
+ * @brief Changes the style of cells without touching their characters.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells (clipped to the screen).
+ * @param style New style.
+ */
+void render_restyle(int y, int x, int width, RenderStyle style);
+
+/**
+ * @brief Copies screen cells (see textwidth.h) onto a line.
+ *
+ * With classes, a cell of class 0 gets style and a cell of class c gets
+ * class_styles[c], so callers can color cells without a second pass.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param cells Cells.
+ * @param count Number of cells (clipped to the screen).
+ * @param style Style of the cells.
+ * @param classes Class of every cell, or NULL.
+ * @param class_styles Style of every class (used with classes).
+ */
+void render_cells(int y, int x, const wchar_t *cells, int count,
+		  RenderStyle style, const unsigned char *classes,
+		  const unsigned char *class_styles);
+
+/**
+ * @brief Writes UTF-8 text truncated to a display width.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param width Number of cells available.
+ * @param text UTF-8 text.
+ * @param style Style of the text.
+ * @return Number of cells used.
+ */
+int render_text(int y, int x, int width, const char *text, RenderStyle style);
+
+/**
+ * @brief Writes formatted text, clipped at the right edge.
+ *
+ * @param y Line.
+ * @param x First column.
+ * @param style Style of the text.
+ * @param format printf format.
+ * @return Number of cells used.
+ */
+int render_printf(int y, int x, RenderStyle style, const char *format, ...)
+	__attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Sends the cells that changed since the last frame to the device.
+ *
+ * The frame is diffed line by line against the previously presented one;
+ * each backend only receives the runs of changed cells.
+ *
+ * @return Number of cells sent.
+ */
+int render_present(void);
+
+/**
+ * @brief Gets a presented line.
+ *
+ * @param y Line.
+ * @return Cells of the line as last presented, or NULL if out of range.
+ */
+const render_cell_t *render_line(int y);
+
+/**
+ * @brief Converts a presented line to UTF-8 text (for tests and dumps).
+ *
+ * @param y Line.
+ * @param out Output buffer.
+ * @param size Size of out.
+ * @return Length of the text, or -1 if y is out of range.
+ */
+int render_line_text(int y, char *out, size_t size);
+
+/**
+ * @brief Waits for a key.
+ *
+ * Keys use the ncurses codes (KEY_UP, KEY_ENTER, KEY_RESIZE, ...) for
+ * every backend. The grid backend never has input.
+ *
+ * @param timeout_ms Time to wait (-1 blocks).
+ * @return Key code, or -1 on timeout.
+ */
+int render_key(int timeout_ms);
+
+#endif // RENDER_H
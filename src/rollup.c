@@ -0,0 +1,287 @@
+/**
+ * @file rollup.c
+ * @brief Per-user totals maintained incrementally from process deltas.
+ */
+
+#include "rollup.h"
+#include "sort.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Open-addressing UID index; holds entry index + 1, 0 marks a free slot */
+#define ROLLUP_INDEX_SIZE (2 * ROLLUP_MAX_USERS)
+
+static user_rollup_t entries[ROLLUP_MAX_USERS];
+static int entry_count = 0;
+static unsigned short uid_index[ROLLUP_INDEX_SIZE];
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Home slot of a UID in the index.
+ *
+ * @param uid User ID.
+ * @return Slot number.
+ */
+static unsigned int home_slot(uid_t uid) {
+	return ((unsigned int)uid * 2654435761u) % ROLLUP_INDEX_SIZE;
+}
+
+/**
+ * @brief Insert an entry into the index (the UID must not be present).
+ *
+ * @param idx Entry index.
+ */
+static void index_insert(int idx) {
+	unsigned int slot = home_slot(entries[idx].uid);
+	while (uid_index[slot]) {
+		slot = (slot + 1) % ROLLUP_INDEX_SIZE;
+	}
+	uid_index[slot] = (unsigned short)(idx + 1);
+}
+
+/**
+ * @brief Drop users without processes and rebuild the index.
+ *
+ * Runs only when the table is full, so users that come and go never
+ * exhaust it.
+ */
+static void compact(void) {
+	int kept = 0;
+	for (int i = 0; i < entry_count; i++) {
+		if (entries[i].processes > 0) {
+			entries[kept++] = entries[i];
+		}
+	}
+	entry_count = kept;
+	memset(uid_index, 0, sizeof(uid_index));
+	for (int i = 0; i < entry_count; i++) {
+		index_insert(i);
+	}
+}
+
+/**
+ * @brief Find the entry of a user, creating it if needed.
+ *
+ * @param proc Process whose owner is looked up.
+ * @return Entry, or NULL if the table is full of live users.
+ */
+static user_rollup_t *entry_for(const proc_info_t *proc) {
+	unsigned int slot = home_slot(proc->uid);
+	while (uid_index[slot]) {
+		user_rollup_t *entry = &entries[uid_index[slot] - 1];
+		if (entry->uid == proc->uid) {
+			return entry;
+		}
+		slot = (slot + 1) % ROLLUP_INDEX_SIZE;
+	}
+
+	if (entry_count == ROLLUP_MAX_USERS) {
+		compact();
+		if (entry_count == ROLLUP_MAX_USERS) {
+			return NULL;
+		}
+	}
+	user_rollup_t *entry = &entries[entry_count];
+	memset(entry, 0, sizeof(*entry));
+	entry->uid = proc->uid;
+	snprintf(entry->user, sizeof(entry->user), "%s", proc->user);
+	index_insert(entry_count++);
+	return entry;
+}
+
+/**
+ * @brief Add (sign 1) or remove (sign -1) one process from its user.
+ *
+ * @param proc Process.
+ * @param sign 1 or -1.
+ */
+static void account(const proc_info_t *proc, int sign) {
+	user_rollup_t *entry = entry_for(proc);
+	if (!entry) {
+		return;
+	}
+	entry->processes += sign;
+	entry->threads += sign * proc->threads;
+	entry->memory += sign * proc->memory;
+	entry->cpu_usage += sign * (double)proc->cpu_usage;
+	if (entry->processes == 0) {
+		/* No rounding residue left behind by floating-point sums */
+		entry->threads = 0;
+		entry->memory = 0;
+		entry->cpu_usage = 0;
+	}
+}
+
+/**
+ * @brief Comparator for UID sorting (ascending).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compare_uid(const void *a, const void *b) {
+	const user_rollup_t *ua = a, *ub = b;
+	return (ua->uid > ub->uid) - (ua->uid < ub->uid);
+}
+
+/**
+ * @brief Comparator for user name sorting (alphabetical).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Result of strcmp (negative, zero, or positive).
+ */
+static int compare_user(const void *a, const void *b) {
+	return strcmp(((const user_rollup_t *)a)->user,
+		      ((const user_rollup_t *)b)->user);
+}
+
+/**
+ * @brief Comparator for process count sorting (descending).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Positive if b has more processes, negative if fewer, zero if equal.
+ */
+static int compare_procs(const void *a, const void *b) {
+	return ((const user_rollup_t *)b)->processes -
+	       ((const user_rollup_t *)a)->processes;
+}
+
+/**
+ * @brief Comparator for thread count sorting (descending).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Positive if b has more threads, negative if fewer, zero if equal.
+ */
+static int compare_threads(const void *a, const void *b) {
+	return ((const user_rollup_t *)b)->threads -
+	       ((const user_rollup_t *)a)->threads;
+}
+
+/**
+ * @brief Comparator for Memory sorting (descending).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Positive if b > a (larger first), negative if b < a, zero if equal.
+ */
+static int compare_mem(const void *a, const void *b) {
+	long ma = ((const user_rollup_t *)a)->memory;
+	long mb = ((const user_rollup_t *)b)->memory;
+	return (mb > ma) - (mb < ma);
+}
+
+/**
+ * @brief Comparator for CPU usage sorting (descending).
+ *
+ * @param a Pointer to first user.
+ * @param b Pointer to second user.
+ * @return Positive if b > a (larger first), negative if b < a, zero if equal.
+ */
+static int compare_cpu(const void *a, const void *b) {
+	double ca = ((const user_rollup_t *)a)->cpu_usage;
+	double cb = ((const user_rollup_t *)b)->cpu_usage;
+	return (cb > ca) - (cb < ca);
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Forget every user.
+ */
+void rollup_reset(void) {
+	entry_count = 0;
+	memset(uid_index, 0, sizeof(uid_index));
+}
+
+/**
+ * @brief Apply the change of one process to its user's totals.
+ *
+ * A surviving process that changed owner (setuid) moves between users.
+ *
+ * @param before Process as last accounted, or NULL if new.
+ * @param after Process as it is now, or NULL if exited.
+ */
+void rollup_apply(const proc_info_t *before, const proc_info_t *after) {
+	if (before && after && before->uid == after->uid) {
+		user_rollup_t *entry = entry_for(after);
+		if (entry) {
+			entry->threads += after->threads - before->threads;
+			entry->memory += after->memory - before->memory;
+			entry->cpu_usage += (double)after->cpu_usage -
+					    before->cpu_usage;
+		}
+		return;
+	}
+	if (before) {
+		account(before, -1);
+	}
+	if (after) {
+		account(after, 1);
+	}
+}
+
+/**
+ * @brief Recompute all totals from a complete list.
+ *
+ * @param plist Process list.
+ */
+void rollup_rebuild(const proc_list_t *plist) {
+	rollup_reset();
+	for (int i = 0; i < plist->count; i++) {
+		account(&plist->list[i], 1);
+	}
+}
+
+/**
+ * @brief Copy the users that currently own processes.
+ *
+ * @param out Output array.
+ * @param max Capacity of out.
+ * @return Number of users written.
+ */
+int rollup_users(user_rollup_t *out, int max) {
+	int count = 0;
+	for (int i = 0; i < entry_count && count < max; i++) {
+		if (entries[i].processes > 0) {
+			out[count++] = entries[i];
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Sort per-user totals in place.
+ *
+ * @param users Array from rollup_users().
+ * @param count Number of entries.
+ * @param type Sort criteria.
+ */
+void rollup_sort(user_rollup_t *users, int count, RollupSort type) {
+	int (*compare)(const void *, const void *);
+
+	switch (type) {
+	case ROLLUP_SORT_USER:
+		compare = compare_user;
+		break;
+	case ROLLUP_SORT_PROCS:
+		compare = compare_procs;
+		break;
+	case ROLLUP_SORT_THREADS:
+		compare = compare_threads;
+		break;
+	case ROLLUP_SORT_MEM:
+		compare = compare_mem;
+		break;
+	case ROLLUP_SORT_CPU:
+		compare = compare_cpu;
+		break;
+	default:
+		compare = compare_uid;
+		break;
+	}
+	sort_array(users, count, sizeof(user_rollup_t), compare);
+}
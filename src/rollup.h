@@ -0,0 +1,82 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include "proc.h"
+
+/**
+ * @brief Maximum number of users tracked at once.
+ *
+ * Equal to MAX_PROCESSES, so every owner of a listed process fits.
+ */
+#define ROLLUP_MAX_USERS MAX_PROCESSES
+
+/**
+ * @brief Enumeration defining sort criteria of the per-user view.
+ */
+typedef enum {
+	ROLLUP_SORT_UID,      /**< Sort by UID (Ascending) */
+	ROLLUP_SORT_USER,     /**< Sort by user name (Alphabetical) */
+	ROLLUP_SORT_PROCS,    /**< Sort by process count (Descending) */
+	ROLLUP_SORT_THREADS,  /**< Sort by thread count (Descending) */
+	ROLLUP_SORT_MEM,      /**< Sort by total RSS (Descending) */
+	ROLLUP_SORT_CPU       /**< Sort by total CPU usage (Descending) */
+} RollupSort;
+
+/**
+ * @brief Totals of all processes owned by one UID.
+ */
+typedef struct {
+	uid_t uid;                  /**< User ID */
+	char user[32];              /**< User name (from the first process seen) */
+	int processes;              /**< Number of processes */
+	int threads;                /**< Sum of thread counts */
+	long memory;                /**< Sum of RSS in kB */
+	double cpu_usage;           /**< Sum of CPU usage percentages */
+} user_rollup_t;
+
+/**
+ * @brief Forgets every user.
+ */
+void rollup_reset(void);
+
+/**
+ * @brief Applies the change of one process to its user's totals.
+ *
+ * Called by the collector for every delta of the merge-join: before is the
+ * previous frame's entry (NULL for a new process), after the current one
+ * (NULL for an exited process). Totals are never recomputed from a full
+ * pass.
+ *
+ * @param before Process as last accounted, or NULL.
+ * @param after Process as it is now, or NULL.
+ */
+void rollup_apply(const proc_info_t *before, const proc_info_t *after);
+
+/**
+ * @brief Recomputes all totals from a complete list.
+ *
+ * Only for sources without deltas (an attached snapshot).
+ *
+ * @param plist Process list.
+ */
+void rollup_rebuild(const proc_list_t *plist);
+
+/**
+ * @brief Copies the users that currently own processes.
+ *
+ * @param out Output array.
+ * @param max Capacity of out.
+ * @return Number of users written.
+ */
+int rollup_users(user_rollup_t *out, int max);
+
+/**
+ * @brief Sorts a copy of the per-user totals in place.
+ *
+ * @param users Array from rollup_users().
+ * @param count Number of entries.
+ * @param type Sort criteria.
+ */
+void rollup_sort(user_rollup_t *users, int count, RollupSort type);
+
+#endif // ROLLUP_H
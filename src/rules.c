@@ -0,0 +1,748 @@
+/**
+ * @file rules.c
+ * @brief Watch rules: per-rule state machines evaluated on every refresh.
+ *
+ * Rule predicates are compiled filter expressions (expr.h) evaluated over
+ * one columnar view of the process list, so a refresh with many rules
+ * costs a few tight loops per rule and no allocation.
+ */
+
+#include "rules.h"
+#include "expr.h"
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/* Hold time of one process for an "any" rule */
+typedef struct {
+	pid_t pid;
+	unsigned long long start_time;
+	double since;               /* First time it matched */
+} rule_track_t;
+
+typedef struct {
+	char name[RULES_NAME];
+	RuleKind kind;
+	expr_t where;               /* Predicate (any) or member filter */
+	ExprField field;            /* Aggregated field (sum, max) */
+	int cmp;                    /* Index into comparisons */
+	double limit;
+	double hold;                /* Seconds before firing */
+	char hook[RULES_HOOK];      /* Command run when firing ("" for none) */
+
+	RuleState state;
+	double since;               /* Condition true since (< 0: false) */
+	double value;
+	int matches;
+	double held;
+	pid_t hook_pid;             /* Running hook (0 if none) */
+	int track_count;
+} rule_t;
+
+static const char *const comparisons[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+static rule_t rules[RULES_MAX];
+static int rule_count = 0;
+
+/* Tracked processes of each rule, sorted by PID, and a merge buffer */
+static rule_track_t tracks[RULES_MAX][RULES_TRACKED];
+static rule_track_t merged[RULES_TRACKED];
+
+/* PIDs flagged by firing rules (sorted) */
+static pid_t alerted[MAX_PROCESSES];
+static int alerted_count = 0;
+static int firing_count = 0;
+
+static FILE *log_stream = NULL;
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Find the last occurrence of a keyword surrounded by spaces.
+ *
+ * @param text Text.
+ * @param word Keyword with its spaces (" for ").
+ * @return Position of the keyword, or NULL.
+ */
+static char *find_last(char *text, const char *word) {
+	char *found = NULL;
+	for (char *p = strstr(text, word); p; p = strstr(p + 1, word)) {
+		found = p;
+	}
+	return found;
+}
+
+/**
+ * @brief Compare an aggregate with the rule's limit.
+ *
+ * @param rule Rule.
+ * @param value Aggregate.
+ * @return 1 if the condition holds.
+ */
+static int holds(const rule_t *rule, double value) {
+	switch (rule->cmp) {
+	case 0:
+		return value == rule->limit;
+	case 1:
+		return value != rule->limit;
+	case 2:
+		return value < rule->limit;
+	case 3:
+		return value <= rule->limit;
+	case 4:
+		return value > rule->limit;
+	default:
+		return value >= rule->limit;
+	}
+}
+
+/**
+ * @brief Parse "[FIELD] [where EXPR] OP NUMBER" of an aggregate rule.
+ *
+ * @param rule Rule being built (kind set).
+ * @param text Text after the aggregate keyword.
+ * @param error Message buffer.
+ * @param error_size Size of error.
+ * @return 0 on success, -1 on an error.
+ */
+static int parse_aggregate(rule_t *rule, char *text, char *error,
+			   size_t error_size) {
+	/* Limit and operator are the last two tokens */
+	char *end = text + strlen(text);
+	char *number = end;
+	while (number > text && !isspace((unsigned char)number[-1]) &&
+	       !strchr("<>=!", number[-1])) {
+		number--;
+	}
+	char *op_end = number;
+	while (op_end > text && isspace((unsigned char)op_end[-1])) {
+		op_end--;
+	}
+	char *op = op_end;
+	while (op > text && strchr("<>=!", op[-1])) {
+		op--;
+	}
+	char op_text[3] = { 0 };
+	if (op_end - op < 1 || op_end - op > 2) {
+		return rules_error(error, error_size, "expected comparison",
+				   number);
+	}
+	memcpy(op_text, op, op_end - op);
+	rule->cmp = -1;
+	for (int i = 0; i < (int)(sizeof(comparisons) / sizeof(comparisons[0]));
+	     i++) {
+		if (strcmp(op_text, comparisons[i]) == 0) {
+			rule->cmp = i;
+		}
+	}
+	if (rule->cmp < 0) {
+		return rules_error(error, error_size, "expected comparison",
+				   op_text);
+	}
+	*op = '\0';
+
+	/* Aggregated field */
+	char *rest = rules_trim(text);
+	if (rule->kind != RULE_COUNT) {
+		char *field = rest;
+		rest += strcspn(rest, " \t");
+		if (*rest) {
+			*rest++ = '\0';
+		}
+		int is_string;
+		int id = expr_field(field, &is_string);
+		if (id < 0 || is_string) {
+			return rules_error(error, error_size,
+					   "expected numeric field", field);
+		}
+		rule->field = id;
+		rest = rules_trim(rest);
+	}
+	if (expr_number(rule->field, number, &rule->limit) < 0) {
+		return rules_error(error, error_size, "expected number",
+				   number);
+	}
+
+	/* Optional member filter */
+	if (*rest) {
+		if (strncasecmp(rest, "where", 5) != 0 ||
+		    !isspace((unsigned char)rest[5])) {
+			return rules_error(error, error_size, "expected 'where'",
+					   rest);
+		}
+		rest += 5;
+	}
+	return expr_compile(rest, &rule->where, error, error_size);
+}
+
+/**
+ * @brief Start the hook of a rule that started firing.
+ *
+ * The command runs through /bin/sh with its output discarded; a hook that
+ * is still running is not started again. Its environment is built before
+ * the fork, so the child only redirects and calls execve().
+ *
+ * @param rule Rule.
+ * @param pids PIDs involved.
+ * @param count Number of PIDs.
+ */
+static void run_hook(rule_t *rule, const pid_t *pids, int count) {
+	if (!rule->hook[0] || rule->hook_pid > 0) {
+		return;
+	}
+
+	char name[RULES_NAME + 8];
+	char value[48];
+	char pid_list[256];
+	size_t len = snprintf(pid_list, sizeof(pid_list), "PB_PIDS=");
+	snprintf(name, sizeof(name), "PB_RULE=%s", rule->name);
+	snprintf(value, sizeof(value), "PB_VALUE=%g", rule->value);
+	for (int i = 0; i < count && len + 12 < sizeof(pid_list); i++) {
+		len += snprintf(pid_list + len, sizeof(pid_list) - len, "%s%d",
+				i ? " " : "", pids[i]);
+	}
+
+	/* Inherited environment minus older values of our three variables */
+	size_t inherited = 0;
+	while (environ[inherited]) {
+		inherited++;
+	}
+	char **envp = malloc((inherited + 4) * sizeof(char *));
+	if (!envp) {
+		return;
+	}
+	size_t vars = 0;
+	for (size_t i = 0; i < inherited; i++) {
+		if (strncmp(environ[i], "PB_RULE=", 8) != 0 &&
+		    strncmp(environ[i], "PB_VALUE=", 9) != 0 &&
+		    strncmp(environ[i], "PB_PIDS=", 8) != 0) {
+			envp[vars++] = environ[i];
+		}
+	}
+	envp[vars++] = name;
+	envp[vars++] = value;
+	envp[vars++] = pid_list;
+	envp[vars] = NULL;
+	char *argv[] = { "sh", "-c", rule->hook, NULL };
+
+	pid_t child = fork();
+	if (child == 0) {
+		int null = open("/dev/null", O_RDWR);
+		if (null >= 0) {
+			dup2(null, STDIN_FILENO);
+			dup2(null, STDOUT_FILENO);
+			dup2(null, STDERR_FILENO);
+		}
+		execve("/bin/sh", argv, envp);
+		_exit(127);
+	}
+	free(envp);
+	if (child > 0) {
+		rule->hook_pid = child;
+	}
+}
+
+/**
+ * @brief Track the matching processes of an "any" rule.
+ *
+ * The sorted matches are merge-joined with the previous tracks, so a
+ * process keeps its first match time for as long as it keeps matching.
+ *
+ * @param index Rule index.
+ * @param plist Processes (sorted by PID).
+ * @param match Match flag of every row.
+ * @param now Current time.
+ * @return Number of processes that matched for the hold time.
+ */
+static int track_matches(int index, const proc_list_t *plist,
+			 const unsigned char *match, double now) {
+	rule_t *rule = &rules[index];
+	rule_track_t *old = tracks[index];
+	int old_idx = 0;
+	int count = 0;
+	int held = 0;
+
+	rule->held = 0;
+	for (int row = 0; row < plist->count && count < RULES_TRACKED; row++) {
+		if (!match[row]) {
+			continue;
+		}
+		const proc_info_t *proc = &plist->list[row];
+		while (old_idx < rule->track_count && old[old_idx].pid < proc->pid) {
+			old_idx++;
+		}
+		rule_track_t *track = &merged[count++];
+		track->pid = proc->pid;
+		track->start_time = proc->start_time;
+		track->since = now;
+		if (old_idx < rule->track_count && old[old_idx].pid == proc->pid &&
+		    old[old_idx].start_time == proc->start_time) {
+			track->since = old[old_idx].since;
+		}
+		if (now - track->since > rule->held) {
+			rule->held = now - track->since;
+		}
+		if (now - track->since >= rule->hold) {
+			held++;
+		}
+	}
+	memcpy(old, merged, count * sizeof(rule_track_t));
+	rule->track_count = count;
+	return held;
+}
+
+/**
+ * @brief Move a rule to a new state, logging and running its hook.
+ *
+ * @param rule Rule.
+ * @param state New state.
+ * @param pids PIDs involved.
+ * @param count Number of PIDs.
+ */
+static void set_state(rule_t *rule, RuleState state, const pid_t *pids,
+		      int count) {
+	if (state == RULE_FIRING && rule->state != RULE_FIRING) {
+		if (log_stream) {
+			fprintf(log_stream, "pb: rule %s firing (value %g, %d "
+				"processes)\n", rule->name, rule->value,
+				rule->matches);
+		}
+		run_hook(rule, pids, count);
+	} else if (state == RULE_OK && rule->state == RULE_FIRING &&
+		   log_stream) {
+		fprintf(log_stream, "pb: rule %s resolved\n", rule->name);
+	}
+	rule->state = state;
+}
+
+/**
+ * @brief Collect finished hooks.
+ */
+static void reap_hooks(void) {
+	for (int i = 0; i < rule_count; i++) {
+		if (rules[i].hook_pid > 0 &&
+		    waitpid(rules[i].hook_pid, NULL, WNOHANG) != 0) {
+			rules[i].hook_pid = 0;
+		}
+	}
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Record a parse error.
+ *
+ * @param error Message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @param message Message.
+ * @param detail Offending text (may be empty).
+ * @return -1.
+ */
+int rules_error(char *error, size_t error_size, const char *message,
+		const char *detail) {
+	if (error && error_size > 0) {
+		snprintf(error, error_size, "%s%s%s%s", message,
+			 detail[0] ? " '" : "", detail, detail[0] ? "'" : "");
+	}
+	return -1;
+}
+
+/**
+ * @brief Strip leading and trailing white space in place.
+ *
+ * @param text Text.
+ * @return First non-space character.
+ */
+char *rules_trim(char *text) {
+	while (isspace((unsigned char)*text)) {
+		text++;
+	}
+	size_t len = strlen(text);
+	while (len > 0 && isspace((unsigned char)text[len - 1])) {
+		text[--len] = '\0';
+	}
+	return text;
+}
+
+/**
+ * @brief Split the leading "name:" off a rule or policy.
+ *
+ * @param text Trimmed text.
+ * @param name Output for the name.
+ * @param name_size Size of name.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Trimmed text after the colon, or NULL on an error.
+ */
+char *rules_name(char *text, char *name, size_t name_size, char *error,
+		 size_t error_size) {
+	char *colon = strchr(text, ':');
+	size_t name_len = colon ? (size_t)(colon - text) : 0;
+	if (!colon || name_len == 0 || name_len >= name_size ||
+	    strspn(text, "abcdefghijklmnopqrstuvwxyz"
+		   "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.") != name_len) {
+		rules_error(error, error_size, "expected 'name:'", text);
+		return NULL;
+	}
+	memcpy(name, text, name_len);
+	name[name_len] = '\0';
+	return rules_trim(colon + 1);
+}
+
+/**
+ * @brief Pass every line of a file to a parser.
+ *
+ * @param path File.
+ * @param add Parser of one line (rules_add, policy_add).
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of lines the parser added, or -1.
+ */
+int rules_read_file(const char *path,
+		    int (*add)(const char *line, char *error,
+			       size_t error_size),
+		    char *error, size_t error_size) {
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return rules_error(error, error_size, "cannot open", path);
+	}
+
+	int added = 0;
+	int number = 0;
+	char line[512];
+	char message[256];
+	while (fgets(line, sizeof(line), file)) {
+		number++;
+		int rc = add(line, message, sizeof(message));
+		if (rc < 0) {
+			if (error && error_size > 0) {
+				snprintf(error, error_size, "line %d: %s", number,
+					 message);
+			}
+			fclose(file);
+			return -1;
+		}
+		added += rc;
+	}
+	fclose(file);
+	return added;
+}
+
+/**
+ * @brief Parse a duration ("30", "30s", "5m", "2h").
+ *
+ * @param text Duration text.
+ * @param seconds Output.
+ * @return 0 on success, -1 if invalid.
+ */
+int rules_duration(const char *text, double *seconds) {
+	char *end;
+	*seconds = strtod(text, &end);
+	if (end == text || *seconds < 0) {
+		return -1;
+	}
+	if (*end == 'm') {
+		*seconds *= 60;
+		end++;
+	} else if (*end == 'h') {
+		*seconds *= 3600;
+		end++;
+	} else if (*end == 's') {
+		end++;
+	}
+	return *end ? -1 : 0;
+}
+
+/**
+ * @brief Add a rule from its text form.
+ *
+ * @param line Rule text.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return 1 if a rule was added, 0 for a blank line, -1 on an error.
+ */
+int rules_add(const char *line, char *error, size_t error_size) {
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer), "%s", line);
+	char *text = rules_trim(buffer);
+	if (!*text || *text == '#') {
+		return 0;
+	}
+	if (rule_count >= RULES_MAX) {
+		return rules_error(error, error_size, "too many rules", "");
+	}
+
+	rule_t *rule = &rules[rule_count];
+	memset(rule, 0, sizeof(*rule));
+	rule->since = -1;
+
+	/* name: */
+	text = rules_name(text, rule->name, sizeof(rule->name), error,
+			  error_size);
+	if (!text) {
+		return -1;
+	}
+
+	/* run COMMAND (rest of the line) */
+	char *run = strstr(text, " run ");
+	if (run) {
+		*run = '\0';
+		snprintf(rule->hook, sizeof(rule->hook), "%s", rules_trim(run + 5));
+	}
+
+	/* for DURATION (last word before run) */
+	char *hold = find_last(text, " for ");
+	if (hold) {
+		*hold = '\0';
+		if (rules_duration(rules_trim(hold + 5), &rule->hold) < 0) {
+			return rules_error(error, error_size,
+					   "expected duration", hold + 5);
+		}
+	}
+	text = rules_trim(text);
+
+	/* Kind keyword */
+	static const struct {
+		const char *word;
+		RuleKind kind;
+	} kinds[] = {
+		{ "any", RULE_ANY }, { "count", RULE_COUNT },
+		{ "sum", RULE_SUM }, { "max", RULE_MAX },
+	};
+	size_t word_len = strcspn(text, " \t");
+	int found = 0;
+	for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+		if (strlen(kinds[i].word) == word_len &&
+		    strncasecmp(text, kinds[i].word, word_len) == 0) {
+			rule->kind = kinds[i].kind;
+			found = 1;
+		}
+	}
+	if (!found) {
+		return rules_error(error, error_size,
+				   "expected any, count, sum or max", text);
+	}
+	text = rules_trim(text + word_len);
+
+	int rc = rule->kind == RULE_ANY ?
+			 expr_compile(text, &rule->where, error, error_size) :
+			 parse_aggregate(rule, text, error, error_size);
+	if (rc < 0) {
+		return -1;
+	}
+	rule_count++;
+	return 1;
+}
+
+/**
+ * @brief Add every rule of a file.
+ *
+ * @param path Rules file.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of rules added, or -1.
+ */
+int rules_load(const char *path, char *error, size_t error_size) {
+	int first = rule_count;
+	int rc = rules_read_file(path, rules_add, error, error_size);
+	if (rc < 0) {
+		rule_count = first;
+	}
+	return rc;
+}
+
+/**
+ * @brief Remove every rule.
+ */
+void rules_clear(void) {
+	rule_count = 0;
+	alerted_count = 0;
+	firing_count = 0;
+}
+
+/**
+ * @brief Get the number of loaded rules.
+ *
+ * @return Number of rules.
+ */
+int rules_count(void) {
+	return rule_count;
+}
+
+/**
+ * @brief Set the stream for firing and resolved lines.
+ *
+ * @param log Stream, or NULL.
+ */
+void rules_set_log(FILE *log) {
+	log_stream = log;
+}
+
+/**
+ * @brief Evaluate every rule against a new list of processes.
+ *
+ * @param plist Processes sorted by PID.
+ * @param now Monotonic time in seconds.
+ * @return Number of firing rules.
+ */
+int rules_evaluate(const proc_list_t *plist, double now) {
+	reap_hooks();
+	if (rule_count == 0) {
+		return 0;
+	}
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	unsigned char *match = arena_alloc(arena, plist->count + 1);
+	unsigned char *flag = arena_alloc(arena, plist->count + 1);
+	pid_t *pids = arena_alloc(arena, (plist->count + 1) * sizeof(pid_t));
+	if (!match || !flag || !pids) {
+		arena_rewind(arena, mark);
+		return firing_count;
+	}
+	memset(flag, 0, plist->count);
+
+	/* Numeric columns are extracted once and shared by all rules */
+	expr_columns_t columns;
+	expr_columns_init(&columns, plist);
+
+	firing_count = 0;
+	for (int i = 0; i < rule_count; i++) {
+		rule_t *rule = &rules[i];
+		int matches = expr_match_columns(&rule->where, &columns, match);
+		if (matches < 0) {
+			continue;
+		}
+		rule->matches = matches;
+
+		int condition;
+		int held;
+		if (rule->kind == RULE_ANY) {
+			/* Per process: the same process must match throughout */
+			rule->value = track_matches(i, plist, match, now);
+			condition = matches > 0;
+			held = rule->value > 0;
+		} else {
+			const double *values = expr_column(&columns, rule->field);
+			double value = 0;
+			for (int row = 0; row < plist->count; row++) {
+				if (!match[row]) {
+					continue;
+				}
+				double x = rule->kind == RULE_COUNT ? 1 : values[row];
+				if (rule->kind == RULE_MAX) {
+					value = (x > value) ? x : value;
+				} else {
+					value += x;
+				}
+			}
+			rule->value = value;
+			condition = holds(rule, value);
+			if (!condition) {
+				rule->since = -1;
+			} else if (rule->since < 0) {
+				rule->since = now;
+			}
+			rule->held = condition ? now - rule->since : 0;
+			held = condition && rule->held >= rule->hold;
+		}
+
+		/* Processes behind the rule: held ones, or all members */
+		int count = 0;
+		int t = 0;
+		for (int row = 0; held && row < plist->count; row++) {
+			if (!match[row]) {
+				continue;
+			}
+			if (rule->kind == RULE_ANY) {
+				/* Tracks are in row order too */
+				const rule_track_t *track = tracks[i];
+				while (t < rule->track_count &&
+				       track[t].pid < plist->list[row].pid) {
+					t++;
+				}
+				if (t == rule->track_count ||
+				    track[t].pid != plist->list[row].pid ||
+				    now - track[t].since < rule->hold) {
+					continue;
+				}
+			}
+			flag[row] = 1;
+			pids[count++] = plist->list[row].pid;
+		}
+
+		set_state(rule, held ? RULE_FIRING :
+				condition ? RULE_PENDING : RULE_OK, pids, count);
+		firing_count += rule->state == RULE_FIRING;
+	}
+
+	alerted_count = 0;
+	for (int row = 0; row < plist->count; row++) {
+		if (flag[row]) {
+			alerted[alerted_count++] = plist->list[row].pid;
+		}
+	}
+	arena_rewind(arena, mark);
+	return firing_count;
+}
+
+/**
+ * @brief Get the state of a rule.
+ *
+ * @param index Rule index.
+ * @param status Output.
+ * @return 0 on success, -1 if index is out of range.
+ */
+int rules_status(int index, rule_status_t *status) {
+	if (index < 0 || index >= rule_count) {
+		return -1;
+	}
+	const rule_t *rule = &rules[index];
+	status->name = rule->name;
+	status->kind = rule->kind;
+	status->state = rule->state;
+	status->value = rule->value;
+	status->matches = rule->matches;
+	status->held = rule->held;
+	status->hold = rule->hold;
+	return 0;
+}
+
+/**
+ * @brief Get the number of firing rules.
+ *
+ * @return Number of firing rules.
+ */
+int rules_firing(void) {
+	return firing_count;
+}
+
+/**
+ * @brief Check whether a process is flagged by a firing rule.
+ *
+ * @param pid Process ID.
+ * @return 1 if flagged, 0 otherwise.
+ */
+int rules_alerted(pid_t pid) {
+	int low = 0;
+	int high = alerted_count - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		if (alerted[mid] == pid) {
+			return 1;
+		}
+		if (alerted[mid] < pid) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return 0;
+}
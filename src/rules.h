@@ -0,0 +1,220 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "proc.h"
+#include <stdio.h>
+
+/**
+ * @brief Maximum number of loaded rules.
+ */
+#define RULES_MAX 128
+
+/**
+ * @brief Processes whose hold time is tracked per "any" rule: every
+ *        listed one, so a match is never left untracked.
+ */
+#define RULES_TRACKED MAX_PROCESSES
+
+/**
+ * @brief Maximum length of a rule name.
+ */
+#define RULES_NAME 32
+
+/**
+ * @brief Maximum length of a hook command.
+ */
+#define RULES_HOOK 256
+
+/**
+ * @brief What a rule tests.
+ */
+typedef enum {
+	RULE_ANY,    /**< Some process matches the expression */
+	RULE_COUNT,  /**< Number of matching processes */
+	RULE_SUM,    /**< Sum of a field over the matching processes */
+	RULE_MAX     /**< Largest value of a field among them */
+} RuleKind;
+
+/**
+ * @brief State machine of one rule.
+ */
+typedef enum {
+	RULE_OK,       /**< Condition false */
+	RULE_PENDING,  /**< Condition true, not yet for the hold time */
+	RULE_FIRING    /**< Condition held for the hold time */
+} RuleState;
+
+/**
+ * @brief Read-only view of a rule.
+ */
+typedef struct {
+	const char *name;           /**< Rule name */
+	RuleKind kind;              /**< What the rule tests */
+	RuleState state;            /**< Current state */
+	double value;               /**< Count, sum or max of the last evaluation */
+	int matches;                /**< Processes matching the expression */
+	double held;                /**< Seconds the condition has held */
+	double hold;                /**< Seconds required before firing */
+} rule_status_t;
+
+/**
+ * @brief Records a parse error as "message 'detail'".
+ *
+ * Shared with the policy parser, like the other text helpers below.
+ *
+ * @param error Message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @param message Message.
+ * @param detail Offending text (may be empty).
+ * @return -1.
+ */
+int rules_error(char *error, size_t error_size, const char *message,
+		const char *detail);
+
+/**
+ * @brief Strips leading and trailing white space in place.
+ *
+ * @param text Text.
+ * @return First non-space character.
+ */
+char *rules_trim(char *text);
+
+/**
+ * @brief Splits the leading "name:" off a rule or policy.
+ *
+ * Names are letters, digits, '_', '-' and '.'.
+ *
+ * @param text Trimmed text.
+ * @param name Output for the name.
+ * @param name_size Size of name.
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Trimmed text after the colon, or NULL on an error.
+ */
+char *rules_name(char *text, char *name, size_t name_size, char *error,
+		 size_t error_size);
+
+/**
+ * @brief Passes every line of a file to a parser.
+ *
+ * Stops at the first line the parser rejects; the error then starts with
+ * "line N: ". Entries added before it are left for the caller to drop.
+ *
+ * @param path File.
+ * @param add Parser of one line (rules_add, policy_add).
+ * @param error Output message buffer (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of lines the parser added, or -1.
+ */
+int rules_read_file(const char *path,
+		    int (*add)(const char *line, char *error,
+			       size_t error_size),
+		    char *error, size_t error_size);
+
+/**
+ * @brief Parses a duration: seconds with an optional s, m or h suffix.
+ *
+ * @param text Duration text ("30", "30s", "5m", "2h").
+ * @param seconds Output.
+ * @return 0 on success, -1 if invalid.
+ */
+int rules_duration(const char *text, double *seconds);
+
+/**
+ * @brief Adds a rule from its text form.
+ *
+ * One rule per line:
+ *
+ *     name: any EXPR [for DURATION] [run COMMAND]
+ *     name: count [where EXPR] OP NUMBER [for DURATION] [run COMMAND]
+ *     name: sum|max FIELD [where EXPR] OP NUMBER [for DURATION] [run COMMAND]
+ *
+ * EXPR is a filter expression (see expr.h), DURATION a number of seconds
+ * with an optional s, m or h suffix. "any" rules hold per process: the
+ * same process (PID and start time) must match for the whole duration.
+ * Examples:
+ *
+ *     bigrss: any rss > 8G for 30s
+ *     build: sum cpu where user == build > 90 for 1m run notify-send build
+ *
+ * Blank lines and lines starting with '#' are accepted and ignored.
+ *
+ * @param line Rule text.
+ * @param error Output for a message on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return 1 if a rule was added, 0 for a blank line, -1 on an error.
+ */
+int rules_add(const char *line, char *error, size_t error_size);
+
+/**
+ * @brief Adds every rule of a file.
+ *
+ * @param path Rules file.
+ * @param error Output for "line N: message" on failure (may be NULL).
+ * @param error_size Size of error.
+ * @return Number of rules added, or -1 (nothing is added on an error).
+ */
+int rules_load(const char *path, char *error, size_t error_size);
+
+/**
+ * @brief Removes every rule (running hooks are left alone).
+ */
+void rules_clear(void);
+
+/**
+ * @brief Gets the number of loaded rules.
+ *
+ * @return Number of rules.
+ */
+int rules_count(void);
+
+/**
+ * @brief Sets a stream that receives one line per firing or resolved rule.
+ *
+ * @param log Stream, or NULL for none.
+ */
+void rules_set_log(FILE *log);
+
+/**
+ * @brief Evaluates every rule against a new list of processes.
+ *
+ * All expressions run over one columnar view of the list (see
+ * expr_match_columns()), so each numeric field is extracted once per
+ * call however many rules use it. A rule that starts firing runs its
+ * hook in the background with PB_RULE, PB_VALUE and PB_PIDS in the
+ * environment.
+ *
+ * @param plist Processes sorted by PID (as from proc_list_update()).
+ * @param now Monotonic time in seconds.
+ * @return Number of firing rules.
+ */
+int rules_evaluate(const proc_list_t *plist, double now);
+
+/**
+ * @brief Gets the state of a rule.
+ *
+ * @param index Rule index (0 to rules_count() - 1).
+ * @param status Output.
+ * @return 0 on success, -1 if index is out of range.
+ */
+int rules_status(int index, rule_status_t *status);
+
+/**
+ * @brief Gets the number of firing rules of the last evaluation.
+ *
+ * @return Number of firing rules.
+ */
+int rules_firing(void);
+
+/**
+ * @brief Checks whether a process is flagged by a firing rule.
+ *
+ * Flagged are the held processes of firing "any" rules and every matching
+ * process of firing count, sum and max rules.
+ *
+ * @param pid Process ID.
+ * @return 1 if flagged, 0 otherwise.
+ */
+int rules_alerted(pid_t pid);
+
+#endif // RULES_H
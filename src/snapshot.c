@@ -0,0 +1,297 @@
+/**
+ * @file snapshot.c
+ * @brief Shared-memory snapshot publisher (pb --serve) and TUI reader.
+ *
+ * The segment holds two snapshot buffers guarded by per-buffer sequence
+ * counters. The publisher always writes the buffer that is not active and
+ * flips the active index afterwards; readers use the active buffer in
+ * place and check its sequence afterwards (see snapshot_client.h).
+ */
+
+#include "snapshot.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/file.h>
+
+/* Publisher state */
+static pb_shm_header_t *segment = NULL;
+static size_t segment_size = 0;
+static char segment_name[64];
+static int segment_fd = -1;   /* Kept open and locked while publishing */
+static uint64_t generation = 0;
+
+/* Reader state */
+static pb_shm_t attached = { NULL, 0 };
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Get a writable pointer to buffer 0 or 1.
+ *
+ * @param index Buffer index.
+ * @return Buffer.
+ */
+static pb_snapshot_t *writable_buffer(uint32_t index) {
+	return (pb_snapshot_t *)pb_shm_buffer(segment, index);
+}
+
+/**
+ * @brief Remove a segment left behind by a publisher that is gone.
+ *
+ * Every publisher holds an exclusive lock on its segment until it exits,
+ * so getting the lock proves the owner is dead. It is held across the
+ * unlink, so no other process can take the segment over meanwhile.
+ *
+ * @param name Shared-memory object name.
+ * @return 0 if removed (or already gone), -1 if a live publisher holds it
+ *         (errno EBUSY) or on an error.
+ */
+static int remove_stale(const char *name) {
+	int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+	if (fd < 0) {
+		return errno == ENOENT ? 0 : -1;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+		int saved = errno == EWOULDBLOCK ? EBUSY : errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	shm_unlink(name);
+	close(fd);
+	return 0;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Create the segment and initialize its header.
+ *
+ * @param name Shared-memory object name.
+ * @return 0 on success, -1 on failure.
+ */
+int snapshot_publish_open(const char *name) {
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		if (remove_stale(name) < 0) {
+			return -1;
+		}
+		fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+		if (fd < 0 && errno == EEXIST) {
+			/* Another publisher created it in the meantime */
+			errno = EBUSY;
+		}
+	}
+	if (fd < 0) {
+		return -1;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+		close(fd);
+		errno = EBUSY;
+		return -1;
+	}
+
+	uint64_t buffer_size = sizeof(pb_snapshot_t) +
+			       (uint64_t)MAX_PROCESSES * sizeof(pb_record_t);
+	size_t size = sizeof(pb_shm_header_t) + 2 * buffer_size;
+
+	void *map = MAP_FAILED;
+	if (ftruncate(fd, size) == 0) {
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+			   0);
+	}
+	if (map == MAP_FAILED) {
+		int saved = errno;
+		shm_unlink(name);
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+
+	segment = map;
+	segment_fd = fd;
+	segment_size = size;
+	snprintf(segment_name, sizeof(segment_name), "%s", name);
+	generation = 0;
+
+	segment->record_size = sizeof(pb_record_t);
+	segment->capacity = MAX_PROCESSES;
+	segment->buffer_size = buffer_size;
+	segment->active = 0;
+	segment->publisher = getpid();
+	segment->version = PB_SHM_VERSION;
+	/* Magic last: attaching readers only accept a complete header */
+	__atomic_store_n(&segment->magic, PB_SHM_MAGIC, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * @brief Write a process list into the inactive buffer and activate it.
+ *
+ * @param plist Process list.
+ */
+void snapshot_publish(const proc_list_t *plist) {
+	if (!segment) {
+		return;
+	}
+
+	uint32_t target = !(__atomic_load_n(&segment->active,
+					    __ATOMIC_RELAXED) & 1);
+	pb_snapshot_t *snap = writable_buffer(target);
+	uint32_t seq = snap->seq;
+
+	/* Odd sequence: readers still on this buffer will retry */
+	__atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	int count = plist->count < (int)segment->capacity ?
+			    plist->count : (int)segment->capacity;
+	for (int i = 0; i < count; i++) {
+		const proc_info_t *proc = &plist->list[i];
+		pb_record_t *record = &snap->records[i];
+
+		memset(record, 0, sizeof(*record));
+		record->pid = proc->pid;
+		record->fd_count = proc->fd_count;
+		record->sock_count = proc->sock_count;
+		record->cpu_usage = proc->cpu_usage;
+		record->net_rate = proc->net_rate;
+		record->memory = proc->memory;
+		record->start_time = proc->start_time;
+		record->uid = proc->uid;
+		record->threads = proc->threads;
+		record->state = proc->state;
+		record->ns_pid = proc->ns_pid;
+		record->ns_level = proc->ns_level;
+		record->pid_ns = proc->pid_ns;
+		record->mnt_ns = proc->mnt_ns;
+		memcpy(record->container, proc->container,
+		       sizeof(proc->container));
+		snprintf(record->name, sizeof(record->name), "%.*s",
+			 (int)sizeof(record->name) - 1, proc->name);
+		snprintf(record->user, sizeof(record->user), "%s", proc->user);
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	snap->count = count;
+	snap->total = plist->total;
+	snap->generation = ++generation;
+	snap->timestamp_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+
+	__atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&segment->active, target, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Unmap and unlink the published segment.
+ */
+void snapshot_publish_close(void) {
+	if (!segment) {
+		return;
+	}
+	munmap(segment, segment_size);
+	shm_unlink(segment_name);
+	close(segment_fd);
+	segment_fd = -1;
+	segment = NULL;
+	segment_size = 0;
+}
+
+/**
+ * @brief Map a published segment for reading.
+ *
+ * @param name Shared-memory object name.
+ * @return 0 on success, -1 otherwise.
+ */
+int snapshot_attach(const char *name) {
+	snapshot_detach();
+	return pb_shm_attach(&attached, name);
+}
+
+/**
+ * @brief Copy the newest consistent snapshot into a process list.
+ *
+ * @param plist Output list.
+ * @return Snapshot generation, or 0 if unavailable.
+ */
+unsigned long long snapshot_read(proc_list_t *plist) {
+	if (!attached.header) {
+		return 0;
+	}
+
+	const pb_snapshot_t *snap;
+	uint32_t seq;
+	unsigned long long gen;
+	do {
+		snap = pb_snapshot_begin(&attached, &seq);
+		gen = snap->generation;
+
+		int count = snap->count;
+		if (count < 0 || count > MAX_PROCESSES ||
+		    count > (int)attached.header->capacity) {
+			count = 0;
+		}
+		plist->count = 0;
+		plist->total = snap->total;
+		memset(plist->states, 0, sizeof(plist->states));
+		for (int i = 0; i < count; i++) {
+			const pb_record_t *record = &snap->records[i];
+			proc_info_t *proc = &plist->list[plist->count++];
+
+			memset(proc, 0, sizeof(*proc));
+			proc->pid = record->pid;
+			proc->fd_count = record->fd_count;
+			proc->sock_count = record->sock_count;
+			proc->fd_age = -1;
+			proc->cpu_usage = record->cpu_usage;
+			proc->net_rate = record->net_rate;
+			proc->memory = record->memory;
+			proc->start_time = record->start_time;
+			proc->uid = record->uid;
+			proc->threads = record->threads;
+			proc->state = record->state;
+			proc->ns_pid = record->ns_pid;
+			proc->ns_level = record->ns_level;
+			proc->pid_ns = record->pid_ns;
+			proc->mnt_ns = record->mnt_ns;
+			memcpy(proc->container, record->container,
+			       sizeof(proc->container));
+			proc->container[sizeof(proc->container) - 1] = '\0';
+			int state = proc_state_index(proc->state);
+			if (state >= 0) {
+				plist->states[state]++;
+			}
+			memcpy(proc->name, record->name, sizeof(record->name));
+			proc->name[sizeof(record->name) - 1] = '\0';
+			proc->name_hash = proc_name_hash(proc->name);
+			memcpy(proc->user, record->user, sizeof(proc->user));
+			proc->user[sizeof(proc->user) - 1] = '\0';
+		}
+	} while (!pb_snapshot_valid(snap, seq));
+
+	return gen;
+}
+
+/**
+ * @brief Check whether the publisher of the attached segment still runs.
+ *
+ * @return 1 if alive, 0 otherwise.
+ */
+int snapshot_publisher_alive(void) {
+	if (!attached.header) {
+		return 0;
+	}
+	pid_t owner = attached.header->publisher;
+	return owner > 0 && (kill(owner, 0) == 0 || errno == EPERM);
+}
+
+/**
+ * @brief Unmap the attached segment.
+ */
+void snapshot_detach(void) {
+	pb_shm_detach(&attached);
+}
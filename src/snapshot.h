@@ -0,0 +1,64 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "proc.h"
+#include "snapshot_client.h"
+
+/**
+ * @brief Creates (or takes over) the shared-memory segment.
+ *
+ * The segment is created exclusively and stays locked (flock) until
+ * snapshot_publish_close() or exit. An existing segment is removed only
+ * if its lock is free, i.e. its publisher is dead; otherwise this fails
+ * with EBUSY.
+ *
+ * @param name Shared-memory object name (PB_SHM_NAME for the daemon).
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int snapshot_publish_open(const char *name);
+
+/**
+ * @brief Publishes a process list as the next snapshot.
+ *
+ * Writes into the buffer readers are not using, then flips the active
+ * index, so readers never wait for the publisher.
+ *
+ * @param plist Freshly updated process list.
+ */
+void snapshot_publish(const proc_list_t *plist);
+
+/**
+ * @brief Unmaps and removes the segment.
+ */
+void snapshot_publish_close(void);
+
+/**
+ * @brief Maps a published segment for snapshot_read().
+ *
+ * @param name Shared-memory object name.
+ * @return 0 on success, -1 if no compatible segment exists.
+ */
+int snapshot_attach(const char *name);
+
+/**
+ * @brief Copies the newest consistent snapshot into a process list.
+ *
+ * @param plist Output list (fd_age, cpu_ticks and fd_sampled are zeroed).
+ * @return Generation of the snapshot, or 0 if not attached or nothing
+ *         was published yet.
+ */
+unsigned long long snapshot_read(proc_list_t *plist);
+
+/**
+ * @brief Reports whether the publisher of the attached segment is alive.
+ *
+ * @return 1 if alive, 0 otherwise.
+ */
+int snapshot_publisher_alive(void);
+
+/**
+ * @brief Unmaps the segment mapped by snapshot_attach().
+ */
+void snapshot_detach(void);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,197 @@
+#ifndef SNAPSHOT_CLIENT_H
+#define SNAPSHOT_CLIENT_H
+
+/*
+ * Reader side of the shared-memory snapshot published by `pb --serve`.
+ *
+ * Self-contained (system headers only) so other local agents can copy or
+ * include it. Typical use:
+ *
+ *     pb_shm_t shm;
+ *     if (pb_shm_attach(&shm, PB_SHM_NAME) == 0) {
+ *         uint32_t seq;
+ *         const pb_snapshot_t *snap;
+ *         do {
+ *             snap = pb_snapshot_begin(&shm, &seq);
+ *             ... read snap->records[0 .. snap->count) in place ...
+ *         } while (!pb_snapshot_valid(snap, seq));
+ *         pb_shm_detach(&shm);
+ *     }
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Default POSIX shared-memory object name.
+ */
+#define PB_SHM_NAME "/pb-snapshot"
+
+/**
+ * @brief Segment magic ("PBSH") and layout version.
+ */
+#define PB_SHM_MAGIC 0x50425348u
+#define PB_SHM_VERSION 4u
+
+/**
+ * @brief One process in a snapshot.
+ */
+typedef struct {
+	int32_t pid;                /**< Process ID */
+	int32_t fd_count;           /**< Open descriptors (-1 if unknown) */
+	int32_t sock_count;         /**< Open sockets (-1 if unknown) */
+	float cpu_usage;            /**< CPU usage percentage */
+	float net_rate;             /**< TCP throughput in kB/s (-1 if unknown) */
+	uint32_t uid;               /**< Owner user ID */
+	int64_t memory;             /**< RSS in kB */
+	uint64_t start_time;        /**< Start time in ticks after boot */
+	int32_t threads;            /**< Number of threads */
+	char state;                 /**< State letter (R, S, D, Z, ...) */
+	char reserved[3];           /**< Zero */
+	int32_t ns_pid;             /**< PID inside its own PID namespace */
+	int32_t ns_level;           /**< PID namespace depth (0 = initial) */
+	uint64_t pid_ns;            /**< PID namespace inode */
+	uint64_t mnt_ns;            /**< Mount namespace inode */
+	char container[16];         /**< Short container id ("" if none) */
+	char name[64];              /**< Command name */
+	char user[32];              /**< Owner user name */
+} pb_record_t;
+
+/**
+ * @brief One of the two snapshot buffers.
+ *
+ * seq is odd while the publisher writes the buffer.
+ */
+typedef struct {
+	uint32_t seq;               /**< Per-buffer sequence (seqlock) */
+	int32_t count;              /**< Number of valid records */
+	int32_t total;              /**< Processes found (may exceed capacity) */
+	uint32_t reserved;          /**< Zero */
+	uint64_t generation;        /**< Snapshot number, starts at 1 */
+	int64_t timestamp_ms;       /**< Wall-clock time of the snapshot */
+	pb_record_t records[];      /**< capacity records */
+} pb_snapshot_t;
+
+/**
+ * @brief Segment header, followed by two pb_snapshot_t buffers.
+ */
+typedef struct {
+	uint32_t magic;             /**< PB_SHM_MAGIC */
+	uint32_t version;           /**< PB_SHM_VERSION */
+	uint32_t record_size;       /**< sizeof(pb_record_t) */
+	uint32_t capacity;          /**< Records per buffer */
+	uint32_t active;            /**< Index (0/1) of the newest buffer */
+	int32_t publisher;          /**< PID of the publishing process */
+	uint64_t buffer_size;       /**< Bytes per buffer */
+} pb_shm_header_t;
+
+/**
+ * @brief A mapped segment.
+ */
+typedef struct {
+	const pb_shm_header_t *header;  /**< Mapping (read-only) */
+	size_t size;                    /**< Mapping length */
+} pb_shm_t;
+
+/**
+ * @brief Gets buffer 0 or 1 of a segment.
+ */
+static inline const pb_snapshot_t *pb_shm_buffer(const pb_shm_header_t *header,
+						 uint32_t index) {
+	return (const pb_snapshot_t *)((const char *)header +
+				       sizeof(pb_shm_header_t) +
+				       index * header->buffer_size);
+}
+
+/**
+ * @brief Maps a published segment read-only.
+ *
+ * @param shm Output mapping.
+ * @param name Shared-memory object name (usually PB_SHM_NAME).
+ * @return 0 on success, -1 if missing or incompatible.
+ */
+static inline int pb_shm_attach(pb_shm_t *shm, const char *name) {
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) < 0 ||
+	    (size_t)info.st_size < sizeof(pb_shm_header_t)) {
+		close(fd);
+		return -1;
+	}
+
+	void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+
+	const pb_shm_header_t *header = map;
+	if (header->magic != PB_SHM_MAGIC || header->version != PB_SHM_VERSION ||
+	    header->record_size != sizeof(pb_record_t) ||
+	    sizeof(pb_shm_header_t) + 2 * header->buffer_size >
+		    (size_t)info.st_size) {
+		munmap(map, info.st_size);
+		return -1;
+	}
+
+	shm->header = header;
+	shm->size = info.st_size;
+	return 0;
+}
+
+/**
+ * @brief Unmaps a segment.
+ */
+static inline void pb_shm_detach(pb_shm_t *shm) {
+	if (shm->header) {
+		munmap((void *)shm->header, shm->size);
+	}
+	shm->header = NULL;
+	shm->size = 0;
+}
+
+/**
+ * @brief Starts reading the newest snapshot in place.
+ *
+ * Spins while the publisher is writing the newest buffer (rare: writes go
+ * to the other buffer first).
+ *
+ * @param shm Mapped segment.
+ * @param seq Output sequence to pass to pb_snapshot_valid().
+ * @return Snapshot to read.
+ */
+static inline const pb_snapshot_t *pb_snapshot_begin(const pb_shm_t *shm,
+						     uint32_t *seq) {
+	for (;;) {
+		uint32_t active = __atomic_load_n(&shm->header->active,
+						  __ATOMIC_ACQUIRE);
+		const pb_snapshot_t *snap = pb_shm_buffer(shm->header,
+							  active & 1);
+		*seq = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+		if (!(*seq & 1)) {
+			return snap;
+		}
+	}
+}
+
+/**
+ * @brief Checks that a snapshot was not rewritten while it was read.
+ *
+ * @param snap Snapshot from pb_snapshot_begin().
+ * @param seq Sequence from pb_snapshot_begin().
+ * @return 1 if everything read since begin is consistent, 0 to retry.
+ */
+static inline int pb_snapshot_valid(const pb_snapshot_t *snap, uint32_t seq) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&snap->seq, __ATOMIC_RELAXED) == seq;
+}
+
+#endif // SNAPSHOT_CLIENT_H
@@ -4,6 +4,7 @@
  */
 
 #include "sort.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
@@ -77,29 +78,127 @@ static int compare_cpu(const void *a, const void *b) {
 	return 0;
 }
 
+/**
+ * @brief Comparator for network throughput sorting (descending).
+ *
+ * @param a Pointer to first process.
+ * @param b Pointer to second process.
+ * @return Positive if b > a (larger first), negative if b < a, zero if equal.
+ */
+static int compare_net(const void *a, const void *b) {
+	const proc_info_t *pa = (const proc_info_t *)a;
+	const proc_info_t *pb = (const proc_info_t *)b;
+
+	if (pb->net_rate > pa->net_rate) {
+		return 1;
+	}
+	if (pb->net_rate < pa->net_rate) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Merge sort an array in place, using the frame arena as scratch.
+ *
+ * Sorts an array of element pointers (so large records are copied only
+ * once, when the result is written back) and falls back to qsort if the
+ * arena cannot hold the scratch arrays. Already sorted input is detected
+ * in one pass.
+ *
+ * @param base Array to sort.
+ * @param count Number of elements.
+ * @param size Size of one element.
+ * @param compare Comparator with qsort semantics.
+ */
+void sort_array(void *base, size_t count, size_t size,
+		int (*compare)(const void *, const void *)) {
+	char *elements = base;
+	size_t i;
+
+	for (i = 1; i < count; i++) {
+		if (compare(elements + (i - 1) * size, elements + i * size) > 0) {
+			break;
+		}
+	}
+	if (i >= count) {
+		return;
+	}
+
+	arena_t *arena = frame_arena();
+	size_t mark = arena_mark(arena);
+	char **order = arena_alloc(arena, count * sizeof(char *));
+	char **merged = arena_alloc(arena, count * sizeof(char *));
+	char *copy = arena_alloc(arena, count * size);
+	if (!order || !merged || !copy) {
+		arena_rewind(arena, mark);
+		qsort(base, count, size, compare);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		order[i] = elements + i * size;
+	}
+
+	/* Bottom-up merge passes (stable) */
+	for (size_t width = 1; width < count; width *= 2) {
+		for (size_t lo = 0; lo < count; lo += 2 * width) {
+			size_t mid = lo + width < count ? lo + width : count;
+			size_t hi = lo + 2 * width < count ? lo + 2 * width
+							   : count;
+			size_t a = lo, b = mid, k = lo;
+
+			while (a < mid && b < hi) {
+				merged[k++] = compare(order[b], order[a]) < 0
+						      ? order[b++]
+						      : order[a++];
+			}
+			while (a < mid) {
+				merged[k++] = order[a++];
+			}
+			while (b < hi) {
+				merged[k++] = order[b++];
+			}
+		}
+		char **swap = order;
+		order = merged;
+		merged = swap;
+	}
+
+	for (i = 0; i < count; i++) {
+		memcpy(copy + i * size, order[i], size);
+	}
+	memcpy(base, copy, count * size);
+	arena_rewind(arena, mark);
+}
+
 /**
  * @brief Sort the process list in place based on given criteria.
  *
  * @param plist Pointer to process list to sort.
- * @param type Sorting criteria (PID, NAME, MEM, or CPU).
+ * @param type Sorting criteria (PID, NAME, MEM, CPU, or NET).
  */
 void sort_processes(proc_list_t *plist, SortType type) {
 	switch (type) {
 	case SORT_PID:
-		qsort(plist->list, plist->count, sizeof(proc_info_t),
-		      compare_pid);
+		sort_array(plist->list, plist->count, sizeof(proc_info_t),
+			   compare_pid);
 		break;
 	case SORT_NAME:
-		qsort(plist->list, plist->count, sizeof(proc_info_t),
-		      compare_name);
+		sort_array(plist->list, plist->count, sizeof(proc_info_t),
+			   compare_name);
 		break;
 	case SORT_MEM:
-		qsort(plist->list, plist->count, sizeof(proc_info_t),
-		      compare_mem);
+		sort_array(plist->list, plist->count, sizeof(proc_info_t),
+			   compare_mem);
 		break;
 	case SORT_CPU:
-		qsort(plist->list, plist->count, sizeof(proc_info_t),
-		      compare_cpu);
+		sort_array(plist->list, plist->count, sizeof(proc_info_t),
+			   compare_cpu);
+		break;
+	case SORT_NET:
+		sort_array(plist->list, plist->count, sizeof(proc_info_t),
+			   compare_net);
 		break;
 	default:
 		break;
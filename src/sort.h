@@ -2,6 +2,7 @@
 #define SORT_H
 
 #include "proc.h"
+#include <stddef.h>
 
 /**
  * @brief Enumeration defining available sorting criteria.
@@ -10,16 +11,31 @@ typedef enum {
 	SORT_PID,   /**< Sort by Process ID (Ascending) */
 	SORT_NAME,  /**< Sort by Process Name (Alphabetical) */
 	SORT_MEM,   /**< Sort by Memory usage (Descending) */
-	SORT_CPU    /**< Sort by CPU usage (Descending) */
+	SORT_CPU,   /**< Sort by CPU usage (Descending) */
+	SORT_NET    /**< Sort by network throughput (Descending) */
 } SortType;
 
+/**
+ * @brief Sorts an array in place without calling malloc.
+ *
+ * Stable merge sort whose scratch space comes from the frame arena; falls
+ * back to qsort only if the arena is too small.
+ *
+ * @param base Array to sort.
+ * @param count Number of elements.
+ * @param size Size of one element.
+ * @param compare Comparator with qsort semantics.
+ */
+void sort_array(void *base, size_t count, size_t size,
+		int (*compare)(const void *, const void *));
+
 /**
  * @brief Sorts the process list in place.
  *
- * Uses standard qsort to order the process list based on the selected criteria.
+ * Uses sort_array() to order the process list based on the selected criteria.
  *
  * @param plist Pointer to the process list to sort.
- * @param type The sorting criteria (PID, NAME, MEM, or CPU).
+ * @param type The sorting criteria (PID, NAME, MEM, CPU, or NET).
  */
 void sort_processes(proc_list_t *plist, SortType type);
 
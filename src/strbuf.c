@@ -0,0 +1,82 @@
+/**
+ * @file strbuf.c
+ * @brief Bounded text writer used to build responses.
+ */
+
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+/**
+ * @brief Start writing into a buffer.
+ *
+ * @param sb Writer.
+ * @param buffer Destination.
+ * @param capacity Size of buffer.
+ */
+void strbuf_init(strbuf_t *sb, char *buffer, size_t capacity) {
+	sb->buffer = buffer;
+	sb->length = 0;
+	sb->capacity = capacity;
+	sb->overflow = 0;
+	buffer[0] = '\0';
+}
+
+/**
+ * @brief Append formatted text.
+ *
+ * @param sb Writer.
+ * @param format printf format.
+ */
+void strbuf_printf(strbuf_t *sb, const char *format, ...) {
+	if (sb->overflow) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(sb->buffer + sb->length, sb->capacity - sb->length,
+			  format, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= sb->capacity - sb->length) {
+		sb->overflow = 1;
+		sb->buffer[sb->length] = '\0';
+		return;
+	}
+	sb->length += (size_t)n;
+}
+
+/**
+ * @brief Append one character.
+ *
+ * @param sb Writer.
+ * @param c Character.
+ */
+void strbuf_putc(strbuf_t *sb, char c) {
+	if (sb->overflow || sb->length + 1 >= sb->capacity) {
+		sb->overflow = 1;
+		return;
+	}
+	sb->buffer[sb->length++] = c;
+	sb->buffer[sb->length] = '\0';
+}
+
+/**
+ * @brief Append a value escaped for a double-quoted field.
+ *
+ * @param sb Writer.
+ * @param value Raw value.
+ */
+void strbuf_put_quoted(strbuf_t *sb, const char *value) {
+	for (const char *p = value; *p; p++) {
+		if (*p == '\n') {
+			strbuf_printf(sb, "\\n");
+			continue;
+		}
+		if (*p == '\\' || *p == '"') {
+			strbuf_putc(sb, '\\');
+		}
+		strbuf_putc(sb, *p);
+	}
+}
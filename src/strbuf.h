@@ -0,0 +1,57 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <stddef.h>
+
+/**
+ * @brief Text being written into a fixed buffer.
+ *
+ * Writes past the capacity set overflow and are dropped, so callers check
+ * once at the end instead of after every append.
+ */
+typedef struct {
+	char *buffer;       /**< Destination (always NUL-terminated) */
+	size_t length;      /**< Bytes written */
+	size_t capacity;    /**< Size of buffer */
+	int overflow;       /**< Set once a write did not fit */
+} strbuf_t;
+
+/**
+ * @brief Starts writing into a buffer.
+ *
+ * @param sb Writer.
+ * @param buffer Destination.
+ * @param capacity Size of buffer (at least 1).
+ */
+void strbuf_init(strbuf_t *sb, char *buffer, size_t capacity);
+
+/**
+ * @brief Appends formatted text.
+ *
+ * @param sb Writer.
+ * @param format printf format.
+ */
+void strbuf_printf(strbuf_t *sb, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Appends one character.
+ *
+ * @param sb Writer.
+ * @param c Character.
+ */
+void strbuf_putc(strbuf_t *sb, char c);
+
+/**
+ * @brief Appends a value for a double-quoted field.
+ *
+ * Backslashes and double quotes are escaped with a backslash and newlines
+ * are written as \n (the Prometheus label rule), so the value can neither
+ * end its field nor start a new line.
+ *
+ * @param sb Writer.
+ * @param value Raw value.
+ */
+void strbuf_put_quoted(strbuf_t *sb, const char *value);
+
+#endif // STRBUF_H
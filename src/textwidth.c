@@ -0,0 +1,149 @@
+/**
+ * @file textwidth.c
+ * @brief UTF-8 decoding and display-width-aware truncation.
+ */
+
+#include "textwidth.h"
+#include <string.h>
+
+/* Direct-mapped cache of decoded names, indexed by name hash */
+#define TEXT_CACHE_SIZE 2048
+#define TEXT_KEY_MAX 64
+
+typedef struct {
+	unsigned int hash;
+	char key[TEXT_KEY_MAX];          /* Name (empty: slot unused) */
+	wchar_t cells[TEXT_CACHE_CELLS]; /* Decoded cells, untruncated */
+	int count;                       /* Cells used */
+} text_entry_t;
+
+static text_entry_t cache[TEXT_CACHE_SIZE];
+
+/* HELPER FUNCTIONS */
+
+/**
+ * @brief Decode one UTF-8 sequence.
+ *
+ * @param s Input (not at the terminator).
+ * @param out Decoded code point, or -1 for an invalid sequence.
+ * @return Number of bytes consumed (at least 1).
+ */
+static int decode_utf8(const unsigned char *s, long *out) {
+	static const long min_value[] = { 0, 0, 0x80, 0x800, 0x10000 };
+	int len;
+	long value;
+
+	if (s[0] < 0x80) {
+		*out = s[0];
+		return 1;
+	} else if ((s[0] & 0xe0) == 0xc0) {
+		len = 2;
+		value = s[0] & 0x1f;
+	} else if ((s[0] & 0xf0) == 0xe0) {
+		len = 3;
+		value = s[0] & 0x0f;
+	} else if ((s[0] & 0xf8) == 0xf0) {
+		len = 4;
+		value = s[0] & 0x07;
+	} else {
+		*out = -1;
+		return 1;
+	}
+
+	for (int i = 1; i < len; i++) {
+		if ((s[i] & 0xc0) != 0x80) {
+			*out = -1;
+			return i;
+		}
+		value = (value << 6) | (s[i] & 0x3f);
+	}
+	/* Overlong forms, surrogates and values beyond Unicode */
+	if (value < min_value[len] || (value >= 0xd800 && value <= 0xdfff) ||
+	    value > 0x10ffff) {
+		value = -1;
+	}
+	*out = value;
+	return len;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Convert UTF-8 text to screen cells, truncated to a width.
+ *
+ * Printable ASCII is copied without decoding.
+ *
+ * @param utf8 Text.
+ * @param cells Output of at least width elements.
+ * @param width Number of cells available.
+ * @return Number of cells used.
+ */
+int text_cells(const char *utf8, wchar_t *cells, int width) {
+	const unsigned char *s = (const unsigned char *)utf8;
+	int used = 0;
+
+	while (*s && used < width) {
+		if (*s >= 0x20 && *s < 0x7f) {
+			cells[used++] = *s++;
+			continue;
+		}
+
+		long code;
+		s += decode_utf8(s, &code);
+		int cw = code < 0 ? -1 : wcwidth((wchar_t)code);
+		if (cw < 0) {
+			/* Invalid, control or (non-UTF-8 locale) unknown */
+			code = '?';
+			cw = 1;
+		} else if (cw == 0) {
+			/* Combining marks are dropped rather than misplaced */
+			continue;
+		}
+		if (used + cw > width) {
+			break;
+		}
+		cells[used++] = (wchar_t)code;
+		if (cw == 2) {
+			cells[used++] = TEXT_CONTINUATION;
+		}
+	}
+	return used;
+}
+
+/**
+ * @brief Convert a name to screen cells through the per-name cache.
+ *
+ * A miss decodes the name once into its slot (replacing whatever was
+ * there); a hit only copies cells and fixes a wide character cut by the
+ * width.
+ *
+ * @param hash Name hash.
+ * @param utf8 Name.
+ * @param cells Output of at least width elements.
+ * @param width Number of cells available.
+ * @return Number of cells used.
+ */
+int text_cells_cached(unsigned int hash, const char *utf8, wchar_t *cells,
+		      int width) {
+	size_t len = strlen(utf8);
+	if (len >= TEXT_KEY_MAX || width > TEXT_CACHE_CELLS) {
+		return text_cells(utf8, cells, width);
+	}
+
+	text_entry_t *entry = &cache[hash % TEXT_CACHE_SIZE];
+	if (entry->hash != hash || !entry->key[0] ||
+	    memcmp(entry->key, utf8, len + 1) != 0) {
+		entry->hash = hash;
+		memcpy(entry->key, utf8, len + 1);
+		entry->count = text_cells(utf8, entry->cells, TEXT_CACHE_CELLS);
+	}
+
+	int used = entry->count < width ? entry->count : width;
+	memcpy(cells, entry->cells, used * sizeof(wchar_t));
+	if (used < entry->count && used > 0 &&
+	    entry->cells[used] == TEXT_CONTINUATION) {
+		/* Second half would be cut off: drop the whole character */
+		cells[--used] = L' ';
+	}
+	return used;
+}
@@ -0,0 +1,48 @@
+#ifndef TEXTWIDTH_H
+#define TEXTWIDTH_H
+
+#include <wchar.h>
+
+/**
+ * @brief Marker of a screen cell covered by the wide character before it.
+ */
+#define TEXT_CONTINUATION L'\0'
+
+/**
+ * @brief Longest name (in cells) kept in the per-name cache.
+ */
+#define TEXT_CACHE_CELLS 64
+
+/**
+ * @brief Converts UTF-8 text to screen cells, truncated to a width.
+ *
+ * Each output element is one terminal cell: a character, or
+ * TEXT_CONTINUATION for the second cell of a double-width character.
+ * A wide character that would be cut by the width is left out, invalid
+ * UTF-8 and non-printable characters become '?'. Cells after the text are
+ * not touched (callers pre-fill them with spaces).
+ *
+ * @param utf8 Text.
+ * @param cells Output of at least width elements.
+ * @param width Number of cells available.
+ * @return Number of cells used.
+ */
+int text_cells(const char *utf8, wchar_t *cells, int width);
+
+/**
+ * @brief Same as text_cells(), cached per interned name.
+ *
+ * Process names are decoded once and then copied from the cache while the
+ * name stays the same, so UTF-8 decoding and wcwidth() are not repeated
+ * every frame.
+ *
+ * @param hash Name hash (proc_info_t.name_hash).
+ * @param utf8 Name.
+ * @param cells Output of at least width elements.
+ * @param width Number of cells available.
+ * @return Number of cells used.
+ */
+int text_cells_cached(unsigned int hash, const char *utf8, wchar_t *cells,
+		      int width);
+
+#endif // TEXTWIDTH_H
@@ -1,41 +1,195 @@
 /**
  * @file ui.c
- * @brief Implementation of the Text User Interface using ncurses.
+ * @brief Implementation of the Text User Interface.
+ *
+ * Every view is drawn into the screen grid of render.h and presented once
+ * per frame, so the same code runs on ncurses, plain ANSI terminals and
+ * the in-memory grid used by tests and benchmarks.
  */
 
 #include "ui.h"
+#include "net.h"
+#include "columns.h"
+#include "textwidth.h"
+#include "rules.h"
 #include <ncurses.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <wchar.h>
+#include <time.h>
 
 /**
- * @brief Initialize the TUI (Text User Interface).
+ * @brief Unicode block elements used for sparklines, lowest to highest.
+ */
+static const wchar_t spark_blocks[] = {
+	L'\x2581', L'\x2582', L'\x2583', L'\x2584',
+	L'\x2585', L'\x2586', L'\x2587', L'\x2588'
+};
+
+/**
+ * @brief Style of each CellTone.
+ */
+static const unsigned char tone_styles[TONE_COUNT] = {
+	[TONE_NORMAL] = STYLE_NORMAL,
+	[TONE_WARN] = STYLE_WARN,
+	[TONE_CRIT] = STYLE_CRIT,
+	[TONE_TOP] = STYLE_TOP,
+	[TONE_DIM] = STYLE_DIM,
+};
+
+/**
+ * @brief Terminal size and everything derived from it.
  *
- * Sets up ncurses, disables line buffering, hides cursor,
- * enables keyboard input, and initializes color pairs.
+ * Rebuilt by ui_resize() when the size changes instead of every frame. The
+ * column layout is also rebuilt when the column selection or the
+ * sparkline changes.
  */
-void ui_init() {
-	initscr();
-	cbreak();
-	noecho();
-	curs_set(0);
-	keypad(stdscr, TRUE);
-	timeout(1000);
+static struct {
+	int rows;                   /* Terminal lines */
+	int cols;                   /* Terminal columns */
+	wchar_t *text;              /* One row of cells (cols + 1) */
+	unsigned char *tones;       /* CellTone of each cell */
+	column_layout_t layout;     /* Column layout of the process list */
+	int layout_valid;           /* 0: layout must be rebuilt */
+	unsigned int layout_gen;    /* columns_generation() of the layout */
+	int spark;                  /* Layout leaves room for a sparkline */
+	int spark_x;                /* First column of the sparkline */
+	int timeout_ms;             /* Wait of ui_handle_input() */
+} screen;
+
+/* HELPER FUNCTIONS */
 
-	if (has_colors()) {
-		start_color();
-		init_pair(1, COLOR_BLACK, COLOR_CYAN);   /* Header */
-		init_pair(2, COLOR_WHITE, COLOR_RED);    /* Dialog */
-		init_pair(3, COLOR_BLACK, COLOR_WHITE);  /* Selected row */
+/**
+ * @brief Draw a sparkline of a process history at the given position.
+ *
+ * Missing samples (young processes) are left blank on the left side so
+ * that the newest sample always sits in the rightmost cell.
+ *
+ * @param y Screen row.
+ * @param x Screen column of the first cell.
+ * @param width Number of cells available.
+ * @param pid Process whose history is drawn.
+ * @param kind Metric to draw.
+ * @param style Style of every cell.
+ */
+static void draw_sparkline(int y, int x, int width, pid_t pid,
+			   HistoryKind kind, RenderStyle style) {
+	float samples[HISTORY_LEN];
+	wchar_t cells[HISTORY_LEN];
+	int levels = sizeof(spark_blocks) / sizeof(spark_blocks[0]);
+	int count = history_samples(history_lookup(pid), kind, samples);
+
+	if (width > HISTORY_LEN) {
+		width = HISTORY_LEN;
+	}
+
+	/* Keep only the newest samples that fit */
+	int first = (count > width) ? count - width : 0;
+	int pad = width - (count - first);
+
+	for (int i = 0; i < width; i++) {
+		cells[i] = L' ';
+		if (i >= pad) {
+			int level = (int)(samples[first + i - pad] * levels);
+			if (level >= levels) {
+				level = levels - 1;
+			}
+			cells[i] = spark_blocks[level];
+		}
 	}
+	render_cells(y, x, cells, width, style, NULL, NULL);
+}
+
+/**
+ * @brief Rebuild the column layout if its inputs changed.
+ *
+ * @param spark_mode Sparkline shown next to the columns.
+ */
+static void update_layout(HistoryKind spark_mode) {
+	/* Sparkline cells are reserved before flexible columns grow */
+	int spark = spark_mode != HISTORY_NONE && screen.cols > HISTORY_LEN + 2;
+
+	if (screen.layout_valid && screen.spark == spark &&
+	    screen.layout_gen == columns_generation()) {
+		return;
+	}
+	columns_layout(&screen.layout,
+		       spark ? screen.cols - HISTORY_LEN - 1 : screen.cols);
+	screen.layout_gen = columns_generation();
+	screen.spark = spark;
+	screen.spark_x = screen.layout.end + 1;
+	screen.layout_valid = 1;
+}
+
+/* MAIN FUNCTIONS */
+
+/**
+ * @brief Initialize the TUI (Text User Interface).
+ *
+ * Opens the output backend (terminal setup, colors) and sizes the screen.
+ *
+ * @param backend Output device.
+ */
+void ui_init(RenderBackend backend) {
+	render_open(backend);
+	screen.timeout_ms = 1000;
+	ui_resize();
 }
 
 /**
  * @brief Close the TUI and restore terminal settings.
  */
 void ui_close() {
-	endwin();
+	render_close();
+	free(screen.text);
+	free(screen.tones);
+	memset(&screen, 0, sizeof(screen));
+}
+
+/**
+ * @brief Pick up the current terminal size.
+ *
+ * Row buffers are reallocated and the layout invalidated only if the size
+ * actually changed.
+ *
+ * @return 1 if the size changed, 0 otherwise.
+ */
+int ui_resize(void) {
+	if (!render_resize() && screen.text) {
+		return 0;
+	}
+	int cols = render_cols();
+
+	free(screen.text);
+	free(screen.tones);
+	screen.text = malloc((cols + 1) * sizeof(wchar_t));
+	screen.tones = malloc(cols + 1);
+	if (!screen.text || !screen.tones) {
+		free(screen.text);
+		free(screen.tones);
+		screen.text = NULL;
+		screen.tones = NULL;
+	}
+
+	screen.rows = render_rows();
+	screen.cols = cols;
+	screen.layout_valid = 0;
+	return 1;
+}
+
+/**
+ * @brief Get the number of list rows.
+ *
+ * @param detail 1 if the detail pane is open.
+ * @return Rows between header and footer (minus the pane if it fits).
+ */
+int ui_list_height(int detail) {
+	int height = screen.rows - 2;
+	if (detail && height > UI_DETAIL_HEIGHT) {
+		height -= UI_DETAIL_HEIGHT;
+	}
+	return height;
 }
 
 /**
@@ -49,28 +203,46 @@ void ui_close() {
  * @param start_index First visible row index (scroll offset).
  * @param filter_str Current filter string (displayed in footer).
  * @param search_mode 1 if user is typing search query, 0 otherwise.
+ * @param spark_mode Metric drawn as sparkline, HISTORY_NONE to hide it.
+ * @param stuck_only 1 if only D and Z processes are listed.
+ * @param ns_only 1 if only one PID namespace is listed.
  */
 void ui_draw(const proc_list_t *plist, int selected_idx, int start_index,
-	     const char *filter_str, int search_mode) {
-	clear();
+	     const char *filter_str, int search_mode, HistoryKind spark_mode,
+	     int stuck_only, int ns_only) {
+	render_erase();
+
+	int max_y = screen.rows;
+	int max_x = screen.cols;
+	wchar_t *text = screen.text;
+	unsigned char *tones = screen.tones;
+	if (!text) {
+		return;
+	}
 
-	int max_y, max_x;
-	getmaxyx(stdscr, max_y, max_x);
+	/* Layout only changes with the size, the columns or the sparkline */
+	update_layout(spark_mode);
+	column_layout_t *layout = &screen.layout;
+	int spark = screen.spark;
+	int spark_x = screen.spark_x;
+	columns_measure(layout, plist);
 
 	/* HEADER */
-	attron(COLOR_PAIR(1) | A_BOLD);
-
-	move(0, 0);
-	/* Fill entire header row with colored spaces */
-	for (int i = 0; i < max_x; i++) {
-		addch(' ' | COLOR_PAIR(1) | A_BOLD);
+	wmemset(text, L' ', max_x);
+	columns_format_header(layout, text);
+	if (spark) {
+		const char *title = spark_mode == HISTORY_CPU ? "CPU HISTORY" :
+								"MEM HISTORY";
+		for (int j = 0; title[j] && spark_x + j < max_x; j++) {
+			text[spark_x + j] = title[j];
+		}
+	}
+	render_cells(0, 0, text, max_x, STYLE_HEADER, NULL, NULL);
+	/* Focused column (target of [s]ort, { } move, [x] hide) */
+	if (layout->focus >= 0) {
+		render_restyle(0, layout->x[layout->focus],
+			       layout->width[layout->focus], STYLE_FOCUS);
 	}
-
-	/* Print column headers with proper alignment */
-	mvprintw(0, 0, " %-6s %-20s %-12s %12s %8s",
-		 "PID", "NAME", "USER", "MEM(kB)", "CPU%");
-
-	attroff(COLOR_PAIR(1) | A_BOLD);
 
 	int rows_available = max_y - 2;  /* Subtract header and footer */
 
@@ -79,99 +251,240 @@ void ui_draw(const proc_list_t *plist, int selected_idx, int start_index,
 	     i < plist->count && (i - start_index) < rows_available; i++) {
 		int screen_line = (i - start_index) + 1;
 
-		/* Truncate process name to 20 chars */
-		char safe_name[21];
-		strncpy(safe_name, plist->list[i].name, 20);
-		safe_name[20] = '\0';
-
-		/* Truncate username to 12 chars */
-		char safe_user[13];
-		strncpy(safe_user, plist->list[i].user, 12);
-		safe_user[12] = '\0';
-
-		/* Clamp memory display to avoid overflow */
-		long mem_display = (plist->list[i].memory > 999999999999L) ?
-				   999999999999L : plist->list[i].memory;
-
-		/* Clamp CPU percentage to [0.0, 100.0] range */
-		float cpu_display = plist->list[i].cpu_usage;
-		if (cpu_display > 100.0f) {
-			cpu_display = 100.0f;
-		}
-		if (cpu_display < 0.0f) {
-			cpu_display = 0.0f;
-		}
+		/* Cells and their tones come from the precomputed layout */
+		wmemset(text, L' ', max_x);
+		memset(tones, TONE_NORMAL, max_x);
+		columns_format_row(layout, &plist->list[i], text, tones);
 
 		/*
-		 * Format data into large buffer to accommodate
-		 * alignment spaces for full terminal width.
+		 * Selected row gets highlight, rows flagged by a firing rule
+		 * the alert style, others their cell tones
 		 */
-		char data_buffer[2048];
-		int written = snprintf(data_buffer, sizeof(data_buffer),
-				       " %-6d %-20s %-12s %12ld %8.1f",
-				       plist->list[i].pid, safe_name,
-				       safe_user, mem_display, cpu_display);
-
-		/* Pad with spaces if line shorter than terminal width */
-		if (written < max_x) {
-			memset(data_buffer + written, ' ', max_x - written);
-			data_buffer[max_x] = '\0';
-		} else {
-			data_buffer[max_x] = '\0';
+		int is_selected = (i == selected_idx);
+		int alert = !is_selected && rules_alerted(plist->list[i].pid);
+		RenderStyle style = is_selected ? STYLE_SELECTED :
+				    alert ? STYLE_ALERT : STYLE_NORMAL;
+		render_cells(screen_line, 0, text, max_x, style,
+			     is_selected || alert ? NULL : tones, tone_styles);
+
+		/* Sparkline is only formatted for rows that are visible */
+		if (spark) {
+			draw_sparkline(screen_line, spark_x, max_x - spark_x,
+				       plist->list[i].pid, spark_mode, style);
 		}
+	}
 
-		/*
-		 * Create chtype buffer for attribute application.
-		 * This allows entire row to have background color.
-		 */
-		chtype *line_buffer = (chtype *)malloc(max_x *
-						       sizeof(chtype));
-		if (!line_buffer) {
-			continue;
+	/* FOOTER */
+	if (search_mode) {
+		/* Show search prompt when filtering */
+		render_printf(max_y - 1, 0, STYLE_HEADER, "SEARCH: %s_",
+			      filter_str);
+	} else {
+		/* Firing rules, then system-wide state counts */
+		int x = 0;
+		if (rules_firing() > 0) {
+			x += render_printf(max_y - 1, x, STYLE_ALERT, "ALERTS:%d",
+					   rules_firing());
+			x++;
+		}
+		for (int i = 0; i < PROC_STATE_COUNT; i++) {
+			int alert = (PROC_STATES[i] == 'D' ||
+				     PROC_STATES[i] == 'Z') && plist->states[i] > 0;
+			x += render_printf(max_y - 1, x,
+					   alert ? STYLE_CRIT : STYLE_NORMAL,
+					   "%c:%d", PROC_STATES[i],
+					   plist->states[i]);
+			x++;
 		}
 
-		/* Selected row gets highlight, others normal */
-		chtype attr = (i == selected_idx) ? COLOR_PAIR(3) : A_NORMAL;
+		/* Show help text and status */
+		render_printf(max_y - 1, x, STYLE_NORMAL,
+			      "| Sort: [p]id [n]ame [m]em [c]pu [b]w | "
+			      "[h]istory | [Enter] detail | [k]ill | "
+			      "[u]sers [g]roups | [D]/Z only%s | "
+			      "[N]amespace%s | "
+			      "Cols: [ ] { } [x] [+] [s]ort [U]nits | "
+			      "Filter: [%s] | Total: %d | [q]uit",
+			      stuck_only ? " (on)" : "", ns_only ? " (on)" : "",
+			      filter_str ? filter_str : "", plist->count);
+	}
+}
 
-		/* Apply attribute to each character */
-		for (int j = 0; j < max_x; j++) {
-			line_buffer[j] = (unsigned char)data_buffer[j] | attr;
-		}
+/**
+ * @brief Render the per-user totals view.
+ *
+ * Same layout as the process list: header, one row per user and a footer
+ * with the keys of this view.
+ *
+ * @param users Sorted per-user totals.
+ * @param count Number of users.
+ * @param selected_idx Index of currently selected user.
+ * @param start_index First visible row index (scroll offset).
+ * @param total Number of processes accounted.
+ */
+void ui_draw_users(const user_rollup_t *users, int count, int selected_idx,
+		   int start_index, int total) {
+	render_erase();
 
-		/* Clear line before printing to avoid artifacts */
-		move(screen_line, 0);
-		clrtoeol();
+	int max_y = screen.rows;
+	int max_x = screen.cols;
 
-		/* Print entire line at once */
-		mvaddchnstr(screen_line, 0, line_buffer, max_x);
+	/* HEADER */
+	render_fill(0, 0, max_x, STYLE_HEADER);
+	render_printf(0, 0, STYLE_HEADER, " %-8s %-16s %6s %8s %12s %8s",
+		      "UID", "USER", "PROCS", "THREADS", "MEM(kB)", "CPU%");
 
-		free(line_buffer);
+	/* USER LIST */
+	int rows_available = max_y - 2;
+	for (int i = start_index;
+	     i < count && (i - start_index) < rows_available; i++) {
+		int screen_line = (i - start_index) + 1;
+		RenderStyle style = (i == selected_idx) ? STYLE_SELECTED :
+							  STYLE_NORMAL;
+
+		render_fill(screen_line, 0, max_x, style);
+		render_printf(screen_line, 0, style,
+			      " %-8u %-16s %6d %8d %12ld %8.1f",
+			      (unsigned int)users[i].uid, "",
+			      users[i].processes, users[i].threads,
+			      users[i].memory, users[i].cpu_usage);
+		render_text(screen_line, 10, 16, users[i].user, style);
 	}
 
-	/* Clear any remaining lines below the list */
-	for (int i = (plist->count - start_index); i < rows_available; i++) {
-		move(i + 1, 0);
-		clrtoeol();
+	/* FOOTER */
+	render_printf(max_y - 1, 0, STYLE_NORMAL,
+		      "Sort: [p]uid [n]ame pr[o]cs [t]hreads [m]em [c]pu | "
+		      "[Enter] members | [u] processes | Users: %d "
+		      "Procs: %d | [q]uit", count, total);
+}
+
+/**
+ * @brief Render the group-by-name view.
+ *
+ * One row per name with the member count, summed threads, RSS and CPU, and
+ * the smallest and largest RSS and CPU of a single member.
+ *
+ * @param groups Sorted groups.
+ * @param selected_idx Index of currently selected group.
+ * @param start_index First visible row index (scroll offset).
+ * @param total Number of processes grouped.
+ */
+void ui_draw_groups(const group_list_t *groups, int selected_idx,
+		    int start_index, int total) {
+	render_erase();
+
+	int max_y = screen.rows;
+	int max_x = screen.cols;
+
+	/* HEADER */
+	render_fill(0, 0, max_x, STYLE_HEADER);
+	render_printf(0, 0, STYLE_HEADER,
+		      " %5s %-20s %7s %12s %10s %10s %8s %6s %6s", "COUNT",
+		      "NAME", "THREADS", "MEM(kB)", "MEM MIN", "MEM MAX",
+		      "CPU%", "MIN", "MAX");
+
+	/* GROUP LIST */
+	int rows_available = max_y - 2;
+	for (int i = start_index;
+	     i < groups->count && (i - start_index) < rows_available; i++) {
+		const proc_group_t *group = &groups->list[i];
+		int screen_line = (i - start_index) + 1;
+		RenderStyle style = (i == selected_idx) ? STYLE_SELECTED :
+							  STYLE_NORMAL;
+
+		render_fill(screen_line, 0, max_x, style);
+		render_printf(screen_line, 0, style,
+			      " %5d %-20s %7d %12ld %10ld %10ld %8.1f %6.1f %6.1f",
+			      group->count, "", group->threads,
+			      group->memory, group->memory_min,
+			      group->memory_max, group->cpu_usage,
+			      group->cpu_min, group->cpu_max);
+		render_text(screen_line, 7, 20, group->name, style);
 	}
 
 	/* FOOTER */
-	move(max_y - 1, 0);
-	clrtoeol();
+	render_printf(max_y - 1, 0, STYLE_NORMAL,
+		      "Sort: [n]ame c[o]unt [m]em [c]pu | [Enter] expand | "
+		      "[g] processes | Groups: %d Procs: %d | [q]uit",
+		      groups->count, total);
+}
 
-	if (search_mode) {
-		/* Show search prompt when filtering */
-		attron(COLOR_PAIR(1) | A_BOLD);
-		mvprintw(max_y - 1, 0, "SEARCH: %s_", filter_str);
-		attroff(COLOR_PAIR(1) | A_BOLD);
-	} else {
-		/* Show help text and status */
-		mvprintw(max_y - 1, 0,
-			 "Sort: [p]id [n]ame [m]em [c]pu | [k]ill | "
-			 "Filter: [%s] | Total: %d | [q]uit",
-			 filter_str ? filter_str : "", plist->count);
+/**
+ * @brief Render one section of a diff between two recorded frames.
+ *
+ * The header names every section with its number of entries; the
+ * figures of each row depend on the section (see diff_print()).
+ *
+ * @param result Diff.
+ * @param section Section listed.
+ * @param selected_idx Index of currently selected entry.
+ * @param start_index First visible row index (scroll offset).
+ */
+void ui_draw_diff(const diff_result_t *result, DiffSection section,
+		  int selected_idx, int start_index) {
+	static const char *titles[DIFF_SECTIONS][2] = {
+		[DIFF_APPEARED] = { "MEM(kB)", "CPU(s)" },
+		[DIFF_DISAPPEARED] = { "MEM(kB)", "CPU(s)" },
+		[DIFF_CPU] = { "CPU(s)", "CORE%" },
+		[DIFF_RSS] = { "DELTA(kB)", "MEM(kB)" },
+		[DIFF_IO] = { "IO(kB)", "kB/s" },
+		[DIFF_NET] = { "NET(kB)", "kB/s" },
+	};
+	render_erase();
+
+	int max_y = screen.rows;
+	int max_x = screen.cols;
+
+	/* SECTIONS */
+	int x = 0;
+	for (int i = 0; i < DIFF_SECTIONS; i++) {
+		RenderStyle style = i == (int)section ? STYLE_SELECTED :
+							 STYLE_NORMAL;
+		x += render_printf(0, x, style, " %d %s (%d) ", i + 1,
+				   diff_section_name(i), result->counts[i]);
+	}
+
+	/* HEADER */
+	render_fill(1, 0, max_x, STYLE_HEADER);
+	render_printf(1, 0, STYLE_HEADER, " %7s %-12s %12s %12s  %s", "PID",
+		      "USER", titles[section][0], titles[section][1], "NAME");
+
+	/* ENTRY LIST */
+	const diff_entry_t *entries = result->entries[section];
+	int count = result->counts[section];
+	int rows_available = max_y - 3;
+	for (int i = start_index;
+	     i < count && (i - start_index) < rows_available; i++) {
+		const recording_record_t *record = entries[i].after ?
+						   entries[i].after :
+						   entries[i].before;
+		int screen_line = (i - start_index) + 2;
+		RenderStyle style = (i == selected_idx) ? STYLE_SELECTED :
+							  STYLE_NORMAL;
+		double figures[2];
+		diff_figures(result, section, &entries[i], figures);
+
+		render_fill(screen_line, 0, max_x, style);
+		render_printf(screen_line, 0, style, " %7d %-12s %12.*f %12.*f",
+			      record->pid, "",
+			      section == DIFF_CPU || section == DIFF_IO ||
+			      section == DIFF_NET ? 1 : 0,
+			      figures[0], section == DIFF_RSS ? 0 : 1,
+			      figures[1]);
+		render_text(screen_line, 9, 12, record->user, style);
+		render_text(screen_line, 49, max_x - 49, record->name, style);
 	}
 
-	refresh();
+	/* FOOTER */
+	char from[32], to[32];
+	time_t from_s = result->from_ms / 1000, to_s = result->to_ms / 1000;
+	strftime(from, sizeof(from), "%Y-%m-%d %H:%M:%S", localtime(&from_s));
+	strftime(to, sizeof(to), "%Y-%m-%d %H:%M:%S", localtime(&to_s));
+	render_printf(max_y - 1, 0, STYLE_NORMAL,
+		      "%s -> %s (%.0fs) | Procs: %d -> %d | [1-6]/[Tab] "
+		      "section | [q]uit", from, to,
+		      (result->to_ms - result->from_ms) / 1000.0,
+		      result->before_count, result->after_count);
 }
 
 /**
@@ -185,8 +498,8 @@ void ui_draw(const proc_list_t *plist, int selected_idx, int start_index,
  */
 void ui_show_confirm_dialog(const char *proc_name, int pid)
 {
-	int max_y, max_x;
-	getmaxyx(stdscr, max_y, max_x);
+	int max_y = screen.rows;
+	int max_x = screen.cols;
 
 	int height = 5;
 	int width = 60;
@@ -198,39 +511,142 @@ void ui_show_confirm_dialog(const char *proc_name, int pid)
 	if (start_y < 0)
 		start_y = 0;
 
-	if (has_colors())
-		attron(COLOR_PAIR(2) | A_BOLD);
+	/* Draw solid background block */
+	for (int i = 0; i < height; i++)
+		render_fill(start_y + i, start_x, width, STYLE_DIALOG);
+
+	/* Content (name truncated by display width, never mid-character) */
+	render_printf(start_y + 1, start_x + 2, STYLE_DIALOG,
+		      "WARNING: Kill process?");
+	int name_cells = render_text(start_y + 2, start_x + 2, 39, proc_name,
+				     STYLE_DIALOG);
+	render_printf(start_y + 2, start_x + 2 + name_cells, STYLE_DIALOG,
+		      " (PID: %d)", pid);
+	render_printf(start_y + 3, start_x + 2, STYLE_DIALOG,
+		      "Press [Y] to Confirm  or  [N] to Cancel");
+}
+
+/**
+ * @brief Draw the process detail pane.
+ *
+ * Occupies the UI_DETAIL_HEIGHT rows above the footer. Each value is
+ * truncated to the terminal width.
+ *
+ * @param detail Latest detail data.
+ * @param ready 1 if detail holds data for the selected PID, 0 while loading.
+ */
+void ui_draw_detail(const proc_detail_t *detail, int ready)
+{
+	int max_y = screen.rows;
+	int max_x = screen.cols;
+
+	int start_y = max_y - 1 - UI_DETAIL_HEIGHT;
+	int width = max_x - 2;
+
+	if (start_y < 1 || width < 10)
+		return;
 
 	/* Draw solid background block */
-	for (int i = 0; i < height; i++) {
-		move(start_y + i, start_x);
-		for (int j = 0; j < width; j++)
-			addch(' ');
+	for (int i = 0; i < UI_DETAIL_HEIGHT; i++)
+		render_fill(start_y + i, 0, max_x, STYLE_DETAIL);
+
+	if (!ready) {
+		render_printf(start_y, 1, STYLE_DETAIL_TITLE,
+			      "DETAIL: loading...");
+	} else if (!detail->valid) {
+		render_printf(start_y, 1, STYLE_DETAIL_TITLE,
+			      "DETAIL: PID %d (process exited)", detail->pid);
+	} else {
+		render_printf(start_y, 1, STYLE_DETAIL_TITLE,
+			      "DETAIL: PID %d (updated %lds ago)", detail->pid,
+			      (long)(time(NULL) - detail->updated));
 	}
 
-	/* Truncate name */
-	char safe_name[40];
-	snprintf(safe_name, sizeof(safe_name), "%s", proc_name);
+	if (ready && detail->valid) {
+		int y = start_y + 1;
+		RenderStyle style = STYLE_DETAIL;
+
+		render_printf(y++, 1, style, "exe:     %.*s", width - 9,
+			      detail->exe);
+		render_printf(y++, 1, style, "cmdline: %.*s", width - 9,
+			      detail->cmdline);
+		render_printf(y++, 1, style, "cwd:     %.*s", width - 9,
+			      detail->cwd);
+		render_printf(y++, 1, style,
+			      "threads: %d   fds: %d   env: %d vars, %ld bytes",
+			      detail->threads, detail->fd_count,
+			      detail->env_count, detail->env_size);
+		render_printf(y++, 1, style,
+			      "limits:  open files %s   processes %s",
+			      detail->limit_nofile, detail->limit_nproc);
+		render_printf(y++, 1, style, "cgroup:  %.*s", width - 9,
+			      detail->cgroup);
+
+		/* Namespace inodes, built first so the line can be truncated */
+		char ns_line[256];
+		int len = 0;
+		for (int i = 0; i < DETAIL_NS_COUNT; i++)
+			len += snprintf(ns_line + len, sizeof(ns_line) - len,
+					" %s:%lu", detail_ns_names[i],
+					detail->ns[i]);
+		render_printf(y++, 1, style, "ns:     %.*s", width - 8, ns_line);
+
+		/* Traffic of the whole network namespace (index 2 = "net") */
+		const net_ns_stat_t *netns = net_ns_lookup(detail->ns[DETAIL_NS_NET]);
+		if (netns) {
+			render_printf(y++, 1, style,
+				      "netns:   rx %.1f kB/s   tx %.1f kB/s",
+				      netns->rx_rate, netns->tx_rate);
+		}
+
+		render_printf(y++, 1, style, "maps:    %d regions (%d "
+			      "file-backed), %ld kB mapped", detail->map_count,
+			      detail->map_file_count, detail->map_total_kb);
 
-	/* Content */
-	mvprintw(start_y + 1, start_x + 2, "WARNING: Kill process?");
-	mvprintw(start_y + 2, start_x + 2, "%s (PID: %d)", safe_name, pid);
-	mvprintw(start_y + 3, start_x + 2,
-		 "Press [Y] to Confirm  or  [N] to Cancel");
+		/* Where an uninterruptible sleep is blocked */
+		if (detail->state == 'D') {
+			render_printf(y++, 1, style, "wchan:   %.*s",
+				      width - 9, detail->wchan);
+			render_printf(y++, 1, style, "stack:   %.*s",
+				      width - 9, detail->stack);
+		}
+	}
+}
 
-	if (has_colors())
-		attroff(COLOR_PAIR(2) | A_BOLD);
+/**
+ * @brief Send the frame drawn so far to the terminal.
+ *
+ * @return Number of cells that changed since the previous frame.
+ */
+int ui_present(void) {
+	return render_present();
+}
 
-	refresh();
+/**
+ * @brief Set how long ui_handle_input() waits for a key.
+ *
+ * @param timeout_ms Time in milliseconds, -1 to block.
+ */
+void ui_set_timeout(int timeout_ms) {
+	screen.timeout_ms = timeout_ms;
 }
 
 /**
  * @brief Handle keyboard input from user.
  *
- * Blocks (or times out per timeout() setting) waiting for input.
+ * Presents the pending frame, then waits (up to the timeout set by
+ * ui_set_timeout()) for a key. A resize (KEY_RESIZE, also from SIGWINCH
+ * in the ANSI backend) is applied here, so drawing never has to query the
+ * terminal size.
  *
- * @return Character code of pressed key (including special keys like KEY_UP).
+ * @return Character code of pressed key (including special keys like
+ *         KEY_UP), or -1 on timeout.
  */
 int ui_handle_input() {
-	return getch();
-}
\ No newline at end of file
+	render_present();
+	int ch = render_key(screen.timeout_ms);
+	if (ch == KEY_RESIZE) {
+		ui_resize();
+	}
+	return ch;
+}
@@ -2,14 +2,27 @@
 #define UI_H
 
 #include "proc.h"
+#include "history.h"
+#include "detail.h"
+#include "rollup.h"
+#include "group.h"
+#include "diff.h"
+#include "render.h"
+
+/**
+ * @brief Number of screen rows occupied by the detail pane.
+ */
+#define UI_DETAIL_HEIGHT 12
 
 /**
  * @brief Initializes the TUI (Text User Interface).
  *
- * Sets up ncurses, disables line buffering, hides the cursor,
- * and initializes color pairs.
+ * Opens the output backend (ncurses, plain ANSI escapes or the in-memory
+ * grid) and sizes the screen.
+ *
+ * @param backend Output device.
  */
-void ui_init();
+void ui_init(RenderBackend backend);
 
 /**
  * @brief Closes the TUI and restores the terminal settings.
@@ -18,24 +31,104 @@ void ui_init();
  */
 void ui_close();
 
+/**
+ * @brief Picks up the current terminal size.
+ *
+ * Called by ui_init() and on KEY_RESIZE. Row buffers and the column layout
+ * are rebuilt only here (and when the columns change), not per frame.
+ *
+ * @return 1 if the size changed, 0 otherwise.
+ */
+int ui_resize(void);
+
+/**
+ * @brief Returns the number of list rows for the current terminal size.
+ *
+ * @param detail 1 if the detail pane is open (it covers the bottom rows).
+ * @return Rows between header and footer.
+ */
+int ui_list_height(int detail);
+
 /**
  * @brief Renders the process list and interface elements to the screen.
  *
  * Draws the table header, the list of processes (handling scrolling),
- * and the footer with status information.
+ * and the footer with the per-state counts and status information.
  *
  * @param plist Pointer to the list of processes to display (usually the filtered list).
  * @param selected_idx The index of the currently selected row in the list.
  * @param start_index The index of the first visible row (scroll offset).
  * @param filter_str Current filter string (to display in the footer).
  * @param search_mode Boolean flag: 1 if user is currently typing a search query, 0 otherwise.
+ * @param spark_mode Metric drawn as a per-row sparkline (HISTORY_NONE to hide it).
+ * @param stuck_only 1 if only uninterruptible (D) and zombie (Z) processes are listed.
+ * @param ns_only 1 if only one PID namespace is listed.
+ */
+void ui_draw(const proc_list_t *plist, int selected_idx, int start_index, const char *filter_str, int search_mode, HistoryKind spark_mode, int stuck_only, int ns_only);
+
+/**
+ * @brief Renders the per-user totals view.
+ *
+ * @param users Sorted per-user totals.
+ * @param count Number of users.
+ * @param selected_idx The index of the currently selected row.
+ * @param start_index The index of the first visible row (scroll offset).
+ * @param total Number of processes accounted.
+ */
+void ui_draw_users(const user_rollup_t *users, int count, int selected_idx, int start_index, int total);
+
+/**
+ * @brief Renders the group-by-name view.
+ *
+ * @param groups Sorted groups.
+ * @param selected_idx The index of the currently selected row.
+ * @param start_index The index of the first visible row (scroll offset).
+ * @param total Number of processes grouped.
+ */
+void ui_draw_groups(const group_list_t *groups, int selected_idx, int start_index, int total);
+
+/**
+ * @brief Renders one section of a diff between two recorded frames.
+ *
+ * @param result Diff.
+ * @param section Section listed.
+ * @param selected_idx The index of the currently selected row.
+ * @param start_index The index of the first visible row (scroll offset).
+ */
+void ui_draw_diff(const diff_result_t *result, DiffSection section, int selected_idx, int start_index);
+
+/**
+ * @brief Draws the process detail pane over the bottom of the list.
+ *
+ * @param detail Latest detail data (may belong to a previous refresh).
+ * @param ready 1 if detail holds data for the selected PID, 0 while loading.
  */
-void ui_draw(const proc_list_t *plist, int selected_idx, int start_index, const char *filter_str, int search_mode);
+void ui_draw_detail(const proc_detail_t *detail, int ready);
+
+/**
+ * @brief Sends the frame drawn so far to the output device.
+ *
+ * Only cells that differ from the previously presented frame are sent.
+ * ui_handle_input() presents implicitly.
+ *
+ * @return Number of cells that changed.
+ */
+int ui_present(void);
+
+/**
+ * @brief Sets how long ui_handle_input() waits for a key.
+ *
+ * @param timeout_ms Time in milliseconds, -1 to block.
+ */
+void ui_set_timeout(int timeout_ms);
 
 /**
  * @brief Handles user keyboard input.
  *
- * @return The character code of the pressed key.
+ * Presents the pending frame first. A terminal resize arrives as
+ * KEY_RESIZE and is applied (see ui_resize()) before the key is returned.
+ *
+ * @return The character code of the pressed key, or -1 on timeout.
  */
 int ui_handle_input();
 
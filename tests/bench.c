@@ -0,0 +1,101 @@
+/**
+ * @file bench.c
+ * @brief Benchmark of /proc reads: synchronous vs io_uring backend.
+ *
+ * Spawns a number of sleeping children (default 30000, first argument
+ * overrides), then times enumeration plus stat/statm reads of every PID
+ * with both procio backends and reports wall and system CPU time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../src/proc.h"
+#include "../src/procio.h"
+
+#define ROUNDS 5
+
+static double seconds(struct timeval tv) {
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Time ROUNDS full scans with one backend.
+ *
+ * @param backend Backend to request.
+ */
+static void run(ProcioBackend backend) {
+	pid_scan_t scan = { 0 };
+	int count = proc_scan_pids(&scan, 1);
+	procio_t *io = procio_open(count + 1024, backend);
+	if (!io) {
+		fprintf(stderr, "procio_open failed\n");
+		return;
+	}
+
+	struct rusage before, after;
+	getrusage(RUSAGE_SELF, &before);
+	double start = now();
+	int read_ok = 0;
+	for (int round = 0; round < ROUNDS; round++) {
+		count = proc_scan_pids(&scan, 1);
+		int n = procio_read(io, scan.pids, count);
+		read_ok = 0;
+		for (int i = 0; i < n; i++) {
+			read_ok += procio_stat(io, i) && procio_statm(io, i);
+		}
+	}
+	double wall = now() - start;
+	getrusage(RUSAGE_SELF, &after);
+
+	printf("%-6s %6d pids  %5d read  wall %7.2f ms/scan  sys %7.2f ms/scan\n",
+	       procio_backend(io) == PROCIO_URING ? "uring" : "sync", count,
+	       read_ok, wall * 1000 / ROUNDS,
+	       (seconds(after.ru_stime) - seconds(before.ru_stime)) * 1000 /
+		       ROUNDS);
+
+	procio_close(io);
+	proc_scan_free(&scan);
+}
+
+int main(int argc, char **argv) {
+	int children = argc > 1 ? atoi(argv[1]) : 30000;
+	pid_t *pids = calloc(children > 0 ? children : 1, sizeof(pid_t));
+	int spawned = 0;
+
+	for (; spawned < children; spawned++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			pause();
+			_exit(0);
+		}
+		if (pid < 0) {
+			fprintf(stderr, "fork stopped after %d children\n",
+				spawned);
+			break;
+		}
+		pids[spawned] = pid;
+	}
+
+	run(PROCIO_SYNC);
+	run(PROCIO_URING);
+
+	for (int i = 0; i < spawned; i++) {
+		kill(pids[i], SIGKILL);
+	}
+	for (int i = 0; i < spawned; i++) {
+		waitpid(pids[i], NULL, 0);
+	}
+	free(pids);
+	return 0;
+}
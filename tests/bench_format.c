@@ -0,0 +1,266 @@
+/**
+ * @file bench_format.c
+ * @brief Microbenchmark of row formatting and of whole frames.
+ *
+ * Formats the same synthetic rows (default columns, scaled and raw units)
+ * for a fixed time per variant and reports rows formatted per second.
+ * The snprintf variant reproduces the former hard-coded row format.
+ *
+ * The frame variants run the browser's pipeline (filter, sort, draw,
+ * diff against the previous frame) on the headless grid backend, once on
+ * the synthetic rows and once with a full /proc update per frame, and
+ * report frames per second. The rules variant evaluates 100 watch rules
+ * per pass over the synthetic rows; the diff variant compares two
+ * recorded frames of DIFF_ROWS processes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include "../src/columns.h"
+#include "../src/sort.h"
+#include "../src/arena.h"
+#include "../src/ui.h"
+#include "../src/rules.h"
+#include "../src/diff.h"
+
+#define ROWS 1024
+#define DIFF_ROWS 100000
+#define SECONDS 1.0
+#define WIDTH 200
+#define HEIGHT 60
+
+static proc_info_t rows[ROWS];
+static wchar_t line[WIDTH + 1];
+static unsigned char tones[WIDTH];
+static char text[WIDTH + 1];
+static volatile char sink;
+static proc_list_t all_processes;
+static proc_list_t visible_processes;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Fill the rows with varied values.
+ */
+static void make_rows(void) {
+	for (int i = 0; i < ROWS; i++) {
+		proc_info_t *proc = &rows[i];
+		proc->pid = 1 + i * 37;
+		snprintf(proc->name, sizeof(proc->name), "worker-%d", i);
+		proc->name_hash = proc_name_hash(proc->name);
+		snprintf(proc->user, sizeof(proc->user), "user%d", i % 17);
+		proc->memory = (long)i * i * 977;
+		proc->cpu_usage = (i % 1000) / 10.0f;
+		proc->fd_count = i % 3 ? i % 200 : -1;
+		proc->sock_count = i % 11;
+		proc->fd_age = i % 60;
+		proc->net_rate = i * 3.7f;
+	}
+}
+
+/**
+ * @brief Format rows with the column engine.
+ */
+static long run_columns(const column_layout_t *layout) {
+	long count = 0;
+	double end = now() + SECONDS;
+	while (now() < end) {
+		for (int i = 0; i < ROWS; i++) {
+			columns_format_row(layout, &rows[i], line, tones);
+			sink = line[i % layout->end];
+		}
+		count += ROWS;
+	}
+	return count;
+}
+
+/**
+ * @brief Format rows with the former snprintf format string.
+ */
+static long run_snprintf(void) {
+	long count = 0;
+	double end = now() + SECONDS;
+	while (now() < end) {
+		for (int i = 0; i < ROWS; i++) {
+			const proc_info_t *proc = &rows[i];
+			char fds[12] = "-", socks[12] = "-", age[12] = "-";
+			if (proc->fd_count >= 0) {
+				snprintf(fds, sizeof(fds), "%d", proc->fd_count);
+				snprintf(socks, sizeof(socks), "%d",
+					 proc->sock_count);
+			}
+			snprintf(age, sizeof(age), "%ds", proc->fd_age);
+			snprintf(text, sizeof(text),
+				 " %-6d %-20.20s %-12.12s %12ld %8.1f %6s %5s %4s"
+				 " %9.1f", proc->pid, proc->name, proc->user,
+				 proc->memory, proc->cpu_usage, fds, socks, age,
+				 proc->net_rate);
+			sink = text[i % 64];
+		}
+		count += ROWS;
+	}
+	return count;
+}
+
+/**
+ * @brief Run frames of the browser pipeline on the grid backend.
+ *
+ * @param live 1 to update from /proc every frame, 0 to reuse the
+ *             synthetic rows (one CPU value changes per frame).
+ * @param cells Output for the average number of cells sent per frame.
+ * @return Number of frames.
+ */
+static long run_frames(int live, double *cells) {
+	long count = 0;
+	long sent = 0;
+	double end = now() + SECONDS;
+	while (now() < end) {
+		arena_reset(frame_arena());
+		if (live) {
+			proc_list_update(&all_processes);
+			history_update(&all_processes);
+		} else {
+			all_processes.list[count % ROWS].cpu_usage += 0.1f;
+		}
+		proc_list_filter(&all_processes, &visible_processes, "");
+		sort_processes(&visible_processes, SORT_CPU);
+		ui_draw(&visible_processes, 0, 0, "", 0, HISTORY_NONE, 0, 0);
+		sent += ui_present();
+		count++;
+	}
+	*cells = count ? (double)sent / count : 0;
+	return count;
+}
+
+/**
+ * @brief Evaluate 100 rules over the synthetic rows.
+ *
+ * @return Number of evaluations.
+ */
+static long run_rules(void) {
+	char line[128];
+	for (int i = 0; i < 100; i++) {
+		switch (i % 4) {
+		case 0:
+			snprintf(line, sizeof(line), "r%d: any cpu > %d for 30s", i,
+				 50 + i % 50);
+			break;
+		case 1:
+			snprintf(line, sizeof(line), "r%d: sum mem where user == "
+				 "user%d > 4G for 1m", i, i % 17);
+			break;
+		case 2:
+			snprintf(line, sizeof(line), "r%d: count where fds > %d and "
+				 "net > 100 > 20", i, i);
+			break;
+		default:
+			snprintf(line, sizeof(line), "r%d: max cpu where name ~ "
+				 "worker-%d >= 90", i, i % 10);
+			break;
+		}
+		rules_add(line, NULL, 0);
+	}
+
+	long count = 0;
+	double end = now() + SECONDS;
+	while (now() < end) {
+		arena_reset(frame_arena());
+		rules_evaluate(&all_processes, now());
+		count++;
+	}
+	rules_clear();
+	return count;
+}
+
+/**
+ * @brief Diff two frames of DIFF_ROWS processes with 10% churn.
+ *
+ * @return Number of diffs.
+ */
+static long run_diff(void) {
+	recording_record_t *old_records = calloc(DIFF_ROWS, sizeof(*old_records));
+	recording_record_t *new_records = calloc(DIFF_ROWS, sizeof(*new_records));
+	for (int i = 0; i < DIFF_ROWS; i++) {
+		old_records[i].pid = 2 * i + 1;
+		old_records[i].cpu_ticks = i;
+		old_records[i].memory = i % 4096;
+		new_records[i] = old_records[i];
+		new_records[i].pid += i % 10 == 0;
+		new_records[i].cpu_ticks += i % 97;
+		new_records[i].memory += i % 61;
+		new_records[i].net_kb = i % 89;
+		new_records[i].read_bytes = (i % 83) * 4096LL;
+	}
+	recording_frame_t before = { 0, DIFF_ROWS, DIFF_ROWS, old_records };
+	recording_frame_t after = { 60000, DIFF_ROWS, DIFF_ROWS, new_records };
+
+	long count = 0;
+	double end = now() + SECONDS;
+	while (now() < end) {
+		diff_result_t result;
+		diff_frames(&before, &after, &result);
+		diff_free(&result);
+		count++;
+	}
+	free(old_records);
+	free(new_records);
+	return count;
+}
+
+int main(void) {
+	column_layout_t layout;
+
+	make_rows();
+	/* The columns of the former hard-coded format */
+	columns_select("pid,name,user,mem,cpu,fds,sock,age,net");
+
+	printf("%-18s %12.0f rows/s\n", "snprintf",
+	       run_snprintf() / SECONDS);
+
+	columns_set_unit(COL_MEM, COLUMN_UNIT_RAW);
+	columns_set_unit(COL_NET, COLUMN_UNIT_RAW);
+	columns_layout(&layout, WIDTH);
+	printf("%-18s %12.0f rows/s\n", "columns (raw)",
+	       run_columns(&layout) / SECONDS);
+
+	columns_set_unit(COL_MEM, COLUMN_UNIT_AUTO);
+	columns_set_unit(COL_NET, COLUMN_UNIT_AUTO);
+	columns_layout(&layout, WIDTH);
+	printf("%-18s %12.0f rows/s\n", "columns (scaled)",
+	       run_columns(&layout) / SECONDS);
+
+	/* Whole frames with the default columns on a HEIGHT x WIDTH grid */
+	double cells;
+	columns_select(COLUMNS_DEFAULT);
+	history_init();
+	render_grid_resize(HEIGHT, WIDTH);
+	ui_init(RENDER_GRID);
+
+	memcpy(all_processes.list, rows, sizeof(rows));
+	all_processes.count = ROWS;
+	long frames = run_frames(0, &cells);
+	printf("%-18s %12.0f frames/s %8.0f cells/frame\n",
+	       "frame (synthetic)", frames / SECONDS, cells);
+
+	long passes = run_rules();
+	printf("%-18s %12.0f passes/s %8.1f us/pass (%d rows)\n", "rules (100)",
+	       passes / SECONDS, SECONDS * 1e6 / passes, all_processes.count);
+
+	long diffs = run_diff();
+	printf("%-18s %12.0f diffs/s  %8.2f ms/diff (%d rows)\n", "diff",
+	       diffs / SECONDS, SECONDS * 1e3 / diffs, DIFF_ROWS);
+
+	proc_list_init(&all_processes);
+	frames = run_frames(1, &cells);
+	printf("%-18s %12.0f frames/s %8.0f cells/frame\n", "frame (/proc)",
+	       frames / SECONDS, cells);
+	ui_close();
+	return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file soak.c
+ * @brief Soak test of the collector against a synthetic /proc tree.
+ *
+ * Builds a /proc-like tree (default 1000 processes) in a temporary
+ * directory and runs daemon passes against it for a number of seconds
+ * (first argument, default 30; hours for a real soak): every pass changes
+ * CPU and memory figures, retires some processes and starts new ones
+ * (reusing PIDs now and then), then collects, evaluates rules and
+ * policies, encodes metrics, answers a query, publishes a snapshot and
+ * records a frame now and then.
+ * The resident size after warmup must stay flat; the exit status is 1 if
+ * it grew by more than SOAK_TOLERANCE_KB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../src/proc.h"
+#include "../src/arena.h"
+#include "../src/history.h"
+#include "../src/rules.h"
+#include "../src/policy.h"
+#include "../src/exporter.h"
+#include "../src/query.h"
+#include "../src/snapshot.h"
+#include "../src/budget.h"
+#include "../src/recording.h"
+
+#define SOAK_PROCESSES 1000
+#define SOAK_CHURN 10              /* Processes replaced per pass */
+#define SOAK_WARMUP 50             /* Passes before the baseline */
+#define SOAK_TOLERANCE_KB 64
+#define SOAK_PID_BASE 1000
+#define SOAK_PID_SPAN 4000         /* PIDs wrap, so some get reused */
+
+typedef struct {
+	pid_t pid;
+	unsigned long long start_time;
+	unsigned long long ticks;
+	long rss_pages;
+} fake_proc_t;
+
+static char root[PATH_MAX];
+static fake_proc_t procs[SOAK_PROCESSES];
+static int proc_count = 0;
+static pid_t next_pid = SOAK_PID_BASE;
+static unsigned long long clock_ticks = 0;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long own_resident_kb(void) {
+	long pages = 0;
+	FILE *file = fopen("/proc/self/statm", "r");
+	if (file) {
+		if (fscanf(file, "%*s %ld", &pages) != 1) {
+			pages = 0;
+		}
+		fclose(file);
+	}
+	return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief Replace a file below the synthetic root.
+ */
+static void put_file(const char *path, const char *text) {
+	char full[PATH_MAX + 64];
+	snprintf(full, sizeof(full), "%s/%s", root, path);
+	int fd = open(full, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		perror(full);
+		exit(2);
+	}
+	size_t len = strlen(text);
+	if (write(fd, text, len) != (ssize_t)len) {
+		perror(full);
+		exit(2);
+	}
+	close(fd);
+}
+
+static void put_link(const char *path, const char *target) {
+	char full[PATH_MAX + 64];
+	snprintf(full, sizeof(full), "%s/%s", root, path);
+	if (symlink(target, full) < 0 && errno != EEXIST) {
+		perror(full);
+		exit(2);
+	}
+}
+
+static void make_dir(const char *path) {
+	char full[PATH_MAX + 64];
+	snprintf(full, sizeof(full), "%s/%s", root, path);
+	if (mkdir(full, 0755) < 0 && errno != EEXIST) {
+		perror(full);
+		exit(2);
+	}
+}
+
+/**
+ * @brief Remove a directory tree (two levels are enough here).
+ */
+static void remove_tree(const char *path) {
+	DIR *dir = opendir(path);
+	if (!dir) {
+		unlink(path);
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		if (strcmp(entry->d_name, ".") == 0 ||
+		    strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+		char child[PATH_MAX + 300];
+		snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+		if (entry->d_type == DT_DIR) {
+			remove_tree(child);
+		} else {
+			unlink(child);
+		}
+	}
+	closedir(dir);
+	rmdir(path);
+}
+
+/**
+ * @brief Write the changing files of one process (stat and statm).
+ */
+static void write_counters(const fake_proc_t *proc) {
+	char path[64], text[512];
+	snprintf(path, sizeof(path), "%d/stat", proc->pid);
+	snprintf(text, sizeof(text),
+		 "%d (worker-%d) %c 1 %d %d 0 -1 4194304 0 0 0 0 %llu %llu "
+		 "0 0 20 0 %d 0 %llu 1000000 %ld\n", proc->pid,
+		 proc->pid % 97, proc->pid % 50 ? 'S' : 'R', proc->pid,
+		 proc->pid, proc->ticks / 2, proc->ticks - proc->ticks / 2,
+		 1 + proc->pid % 8, proc->start_time, proc->rss_pages);
+	put_file(path, text);
+	snprintf(path, sizeof(path), "%d/statm", proc->pid);
+	snprintf(text, sizeof(text), "%ld %ld 100 10 0 %ld 0\n",
+		 proc->rss_pages * 2, proc->rss_pages, proc->rss_pages);
+	put_file(path, text);
+}
+
+/**
+ * @brief Create the directory of a new process.
+ */
+static void spawn(fake_proc_t *proc) {
+	char path[64], text[256];
+	proc->pid = next_pid;
+	next_pid = SOAK_PID_BASE + (next_pid - SOAK_PID_BASE + 7) % SOAK_PID_SPAN;
+	proc->start_time = ++clock_ticks;
+	proc->ticks = 0;
+	proc->rss_pages = 256 + rand() % 65536;
+
+	snprintf(path, sizeof(path), "%d", proc->pid);
+	make_dir(path);
+	snprintf(path, sizeof(path), "%d/fd", proc->pid);
+	make_dir(path);
+	snprintf(path, sizeof(path), "%d/ns", proc->pid);
+	make_dir(path);
+	for (int fd = 0; fd < 3; fd++) {
+		snprintf(path, sizeof(path), "%d/fd/%d", proc->pid, fd);
+		put_link(path, "/dev/null");
+	}
+	const char *kinds[] = { "pid", "mnt", "net" };
+	for (int i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), "%d/ns/%s", proc->pid, kinds[i]);
+		snprintf(text, sizeof(text), "%s:[%d]", kinds[i],
+			 402653180 + proc->pid % 3);
+		put_link(path, text);
+	}
+	snprintf(path, sizeof(path), "%d/status", proc->pid);
+	snprintf(text, sizeof(text), "Name:\tworker-%d\nUid:\t%d\t%d\t%d\t%d\n"
+		 "NStgid:\t%d\t%d\nNSpid:\t%d\t%d\n", proc->pid % 97,
+		 getuid(), getuid(), getuid(), getuid(), proc->pid,
+		 proc->pid % 100 + 1, proc->pid, proc->pid % 100 + 1);
+	put_file(path, text);
+	snprintf(path, sizeof(path), "%d/cgroup", proc->pid);
+	snprintf(text, sizeof(text), "0::/system.slice/soak-%d.service\n",
+		 proc->pid % 20);
+	put_file(path, text);
+	write_counters(proc);
+}
+
+/**
+ * @brief Advance the synthetic system by one pass.
+ */
+static void mutate(void) {
+	/* Retire some processes; newcomers take fresh (or reused) PIDs */
+	for (int i = 0; i < SOAK_CHURN; i++) {
+		int victim = rand() % proc_count;
+		char path[PATH_MAX + 32];
+		snprintf(path, sizeof(path), "%s/%d", root, procs[victim].pid);
+		remove_tree(path);
+		pid_t taken;
+		int clash;
+		do {
+			taken = next_pid;
+			clash = 0;
+			for (int j = 0; j < proc_count; j++) {
+				clash |= procs[j].pid == taken && j != victim;
+			}
+			if (clash) {
+				next_pid = SOAK_PID_BASE +
+					   (next_pid - SOAK_PID_BASE + 1) %
+					   SOAK_PID_SPAN;
+			}
+		} while (clash);
+		spawn(&procs[victim]);
+	}
+
+	clock_ticks += 100;
+	char text[128];
+	snprintf(text, sizeof(text), "cpu  %llu 0 %llu %llu 0 0 0 0\n",
+		 clock_ticks * 4, clock_ticks, clock_ticks * 3);
+	put_file("stat", text);
+	for (int i = 0; i < proc_count; i++) {
+		procs[i].ticks += rand() % 20;
+		procs[i].rss_pages += rand() % 33 - 16;
+		if (procs[i].rss_pages < 16) {
+			procs[i].rss_pages = 16;
+		}
+		write_counters(&procs[i]);
+	}
+}
+
+int main(int argc, char **argv) {
+	double duration = argc > 1 ? atof(argv[1]) : 30;
+	int count = argc > 2 ? atoi(argv[2]) : SOAK_PROCESSES;
+	proc_count = count > 0 && count <= SOAK_PROCESSES ? count :
+							     SOAK_PROCESSES;
+
+	snprintf(root, sizeof(root), "/tmp/pb-soak-XXXXXX");
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	make_dir("net");
+	srand(1);
+	for (int i = 0; i < proc_count; i++) {
+		spawn(&procs[i]);
+	}
+	mutate();
+
+	char shm_name[64], record_path[64], error[128];
+	snprintf(shm_name, sizeof(shm_name), "/pb-soak-%d", getpid());
+	snprintf(record_path, sizeof(record_path), "/tmp/pb-soak-%d.pb",
+		 getpid());
+	if (recording_open(record_path, 5) < 0) {
+		perror(record_path);
+		return 2;
+	}
+	if (snapshot_publish_open(shm_name) < 0) {
+		fprintf(stderr, "cannot publish %s\n", shm_name);
+		return 2;
+	}
+	if (rules_add("hot: any cpu > 50 for 5s", error, sizeof(error)) < 0 ||
+	    rules_add("big: sum rss where name ~ worker-1 > 1G", error,
+		      sizeof(error)) < 0 ||
+	    policy_add("cap: kill rss > 200M for 3 limit 5/1m", error,
+		       sizeof(error)) < 0) {
+		fprintf(stderr, "%s\n", error);
+		return 2;
+	}
+	policy_set_dry_run(1);
+
+	static proc_list_t plist;
+	proc_set_root(root);
+	budget_init(0);
+	proc_list_init(&plist);
+	history_init();
+
+	long baseline = 0, peak = 0;
+	unsigned long passes = 0;
+	double start = now();
+	while (now() - start < duration || passes <= SOAK_WARMUP) {
+		mutate();
+
+		arena_reset(frame_arena());
+		budget_pass_begin();
+		proc_list_update(&plist);
+		history_update(&plist);
+		rules_evaluate(&plist, now());
+		policy_evaluate(&plist, now());
+		snapshot_publish(&plist);
+		struct timespec wall;
+		clock_gettime(CLOCK_REALTIME, &wall);
+		recording_update(&plist, (int64_t)wall.tv_sec * 1000 +
+						 wall.tv_nsec / 1000000);
+		budget_pass_end();
+		passes++;
+
+		size_t length;
+		exporter_render(&plist, passes, &length);
+		query_execute("top 5 cpu", &plist, passes, &length);
+		query_execute("filter user == root and mem > 100M", &plist,
+			      passes, &length);
+
+		long resident = own_resident_kb();
+		if (passes == SOAK_WARMUP) {
+			baseline = resident;
+			peak = resident;
+		} else if (passes > SOAK_WARMUP && resident > peak) {
+			peak = resident;
+		}
+	}
+
+	snapshot_publish_close();
+	recording_close();
+	unlink(record_path);
+	remove_tree(root);
+
+	const budget_stats_t *self = budget_stats();
+	printf("soak: %lu passes in %.0f s over %d processes (%d listed)\n",
+	       passes, now() - start, proc_count, plist.count);
+	printf("soak: %.2f ms CPU per pass, frame arena peak %zu KiB\n",
+	       self->pass_average * 1000, frame_arena()->peak / 1024);
+	printf("soak: resident %ld KiB after warmup, peak %ld KiB (+%ld KiB)\n",
+	       baseline, peak, peak - baseline);
+	if (plist.count != proc_count) {
+		printf("soak: FAILED (listed %d of %d processes)\n", plist.count,
+		       proc_count);
+		return 1;
+	}
+	if (peak - baseline > SOAK_TOLERANCE_KB) {
+		printf("soak: FAILED (grew by more than %d KiB)\n",
+		       SOAK_TOLERANCE_KB);
+		return 1;
+	}
+	printf("soak: PASSED (flat memory profile)\n");
+	return 0;
+}
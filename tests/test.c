@@ -9,8 +9,40 @@
 #include <criterion/criterion.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "../src/proc.h"
 #include "../src/sort.h"
+#include "../src/history.h"
+#include "../src/detail.h"
+#include "../src/fdscan.h"
+#include "../src/net.h"
+#include "../src/procio.h"
+#include "../src/arena.h"
+#include "../src/snapshot.h"
+#include "../src/expr.h"
+#include "../src/query.h"
+#include "../src/exporter.h"
+#include "../src/rollup.h"
+#include "../src/group.h"
+#include "../src/columns.h"
+#include "../src/textwidth.h"
+#include "../src/ui.h"
+#include "../src/rules.h"
+#include "../src/policy.h"
+#include "../src/budget.h"
+#include "../src/recording.h"
+#include "../src/diff.h"
+#include <locale.h>
+#include <wchar.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 /**
  * @brief Setup fixture
@@ -124,4 +156,2142 @@ Test(proc_suite, proc_update) {
 	cr_assert_gt(plist.count, 0,
 		     "Should find at least one process on Linux system");
 	cr_assert_gt(plist.list[0].pid, 0, "PID should be positive");
-}
\ No newline at end of file
+
+	/* Our own process is running (or just went to sleep) */
+	for (int i = 0; i < plist.count; i++) {
+		if (plist.list[i].pid == getpid()) {
+			cr_assert(plist.list[i].state == 'R' ||
+				  plist.list[i].state == 'S');
+		}
+	}
+	cr_assert_gt(plist.states[proc_state_index('R')], 0,
+		     "The test itself is running");
+	cr_assert_eq(proc_state_index('t'), proc_state_index('T'));
+	cr_assert_eq(proc_state_index('I'), -1, "Idle threads are not counted");
+}
+
+/**
+ * @brief Test: Namespaces and in-namespace PID of a new process
+ */
+Test(proc_suite, namespaces) {
+	static proc_list_t plist;
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+
+	struct stat pid_ns, mnt_ns;
+	cr_assert_eq(stat("/proc/self/ns/pid", &pid_ns), 0);
+	cr_assert_eq(stat("/proc/self/ns/mnt", &mnt_ns), 0);
+	const proc_info_t *self = NULL;
+	for (int i = 0; i < plist.count; i++) {
+		if (plist.list[i].pid == getpid()) {
+			self = &plist.list[i];
+		}
+	}
+	cr_assert_not_null(self);
+	cr_assert_eq(self->pid_ns, pid_ns.st_ino);
+	cr_assert_eq(self->mnt_ns, mnt_ns.st_ino);
+	cr_assert_eq(self->ns_pid, getpid(), "/proc is of our own namespace");
+	cr_assert_eq(self->ns_level, 0);
+
+	char id[13];
+	proc_container_id("/system.slice/docker-"
+			  "4f1c2b9e0d8a7c6b5a4f3e2d1c0b9a8f7e6d5c4b3a2f1e0d"
+			  "9c8b7a6f5e4d3c2b.scope", id, sizeof(id));
+	cr_assert_str_eq(id, "4f1c2b9e0d8a");
+	proc_container_id("/kubepods/burstable/pod1234/"
+			  "0123456789abcdef0123456789abcdef"
+			  "0123456789abcdef0123456789abcdef", id, sizeof(id));
+	cr_assert_str_eq(id, "0123456789ab");
+	proc_container_id("/user.slice/user-1000.slice/session-2.scope", id,
+			  sizeof(id));
+	cr_assert_str_eq(id, "");
+}
+
+/**
+ * @brief Test: getdents64 scan returns sorted PIDs including our own
+ */
+Test(proc_suite, scan_pids_sorted) {
+	pid_scan_t scan = {0};
+
+	int count = proc_scan_pids(&scan, 1);
+
+	cr_assert_gt(count, 0, "Should enumerate at least one PID");
+	cr_assert_eq(scan.sorted, 1);
+	int found_self = 0;
+	for (int i = 0; i < count; i++) {
+		if (i > 0) {
+			cr_assert_lt(scan.pids[i - 1], scan.pids[i],
+				     "PIDs should be strictly ascending");
+		}
+		if (scan.pids[i] == getpid()) {
+			found_self = 1;
+		}
+	}
+	cr_assert_eq(found_self, 1, "Own PID should be enumerated");
+
+	/* Once sized from the previous count, the buffer is reused */
+	proc_scan_pids(&scan, 1);
+	pid_t *buffer = scan.pids;
+	proc_scan_pids(&scan, 1);
+	cr_assert_eq(scan.pids, buffer, "Steady-state scan should not realloc");
+
+	proc_scan_free(&scan);
+}
+
+/**
+ * @brief Helper: check whether a PID occurs in an event array
+ */
+static int contains_pid(const pid_t *pids, int count, pid_t pid) {
+	for (int i = 0; i < count; i++) {
+		if (pids[i] == pid) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Test: Merge-join reports new and exited processes exactly once
+ */
+Test(proc_suite, merge_join_events) {
+	proc_list_t plist;
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+
+	const proc_events_t *events = proc_list_events();
+	cr_assert_eq(events->added_count, plist.count,
+		     "First update should report every process as new");
+
+	pid_t child = fork();
+	if (child == 0) {
+		pause();
+		_exit(0);
+	}
+	proc_list_update(&plist);
+	cr_assert(contains_pid(events->added, events->added_count, child),
+		  "Forked child should be reported as added");
+	cr_assert_not(contains_pid(events->added, events->added_count,
+				   getpid()),
+		      "Surviving process must not be re-added");
+
+	kill(child, SIGKILL);
+	waitpid(child, NULL, 0);
+	proc_list_update(&plist);
+	cr_assert(contains_pid(events->exited, events->exited_count, child),
+		  "Killed child should be reported as exited");
+
+	for (int i = 1; i < plist.count; i++) {
+		cr_assert_lt(plist.list[i - 1].pid, plist.list[i].pid,
+			     "Collector output should stay sorted by PID");
+	}
+}
+
+/**
+ * @brief Helper: write one file of a synthetic /proc tree
+ */
+static void write_fake(const char *root, const char *name, const char *text) {
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", root, name);
+	FILE *file = fopen(path, "w");
+	cr_assert_not_null(file, "%s", path);
+	fputs(text, file);
+	fclose(file);
+}
+
+/**
+ * @brief Test: Processes are read from a configured proc root
+ */
+Test(proc_suite, synthetic_root) {
+	static proc_list_t plist;
+	char root[] = "/tmp/pb-root-XXXXXX";
+	char path[256];
+
+	cr_assert_not_null(mkdtemp(root));
+	write_fake(root, "stat", "cpu  100 0 100 800 0 0 0 0\n");
+	for (pid_t pid = 40; pid <= 42; pid += 2) {
+		snprintf(path, sizeof(path), "%s/%d", root, pid);
+		cr_assert_eq(mkdir(path, 0755), 0);
+		snprintf(path, sizeof(path), "%d/stat", pid);
+		write_fake(root, path, pid == 40 ?
+			   "40 (fake init) S 0 40 40 0 -1 0 0 0 0 0 5 5 0 0 20 "
+			   "0 1 0 7 0 0\n" :
+			   "42 (fake worker) R 40 42 42 0 -1 0 0 0 0 0 9 1 0 0 "
+			   "20 0 4 0 9 0 0\n");
+		snprintf(path, sizeof(path), "%d/statm", pid);
+		write_fake(root, path, pid == 40 ? "100 25 0 0 0 0 0\n" :
+						   "100 1024 0 0 0 0 0\n");
+		snprintf(path, sizeof(path), "%d/status", pid);
+		write_fake(root, path, pid == 40 ? "NStgid:\t40\t1\n" :
+						   "NStgid:\t42\t3\n");
+	}
+	/* Kubernetes path longer than proc_info_t.cgroup: id is at the end */
+	write_fake(root, "42/cgroup", "0::/kubepods.slice/kubepods-burstable."
+		   "slice/kubepods-burstable-pod0a1b2c3d_4e5f_6789_abcd_"
+		   "ef0123456789.slice/cri-containerd-"
+		   "fedcba9876543210fedcba9876543210"
+		   "fedcba9876543210fedcba9876543210.scope\n");
+
+	cr_assert_eq(proc_set_root(root), 0);
+	cr_assert_str_eq(proc_root(), root);
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+	cr_assert_eq(plist.count, 2);
+	cr_assert_str_eq(plist.list[0].name, "fake init");
+	cr_assert_eq(plist.list[1].pid, 42);
+	cr_assert_eq(plist.list[1].threads, 4);
+	cr_assert_eq(plist.list[1].start_time, 9);
+	cr_assert_eq(plist.list[1].memory, 1024 * (sysconf(_SC_PAGESIZE) / 1024));
+	cr_assert_eq(plist.list[1].ns_pid, 3);
+	cr_assert_str_eq(plist.list[1].container, "fedcba987654");
+	cr_assert_eq(strlen(plist.list[1].cgroup),
+		     sizeof(plist.list[1].cgroup) - 1, "Path is cut, id is not");
+	cr_assert_eq(plist.list[1].uid, getuid(), "Owner of the directory");
+	cr_assert_eq(plist.states[proc_state_index('R')], 1);
+
+	/* Signals check the live /proc, never the synthetic one */
+	cr_assert_eq(proc_signal_process(42, 9, 0), -1);
+
+	char too_long[PROC_ROOT_MAX + 8];
+	memset(too_long, 'x', sizeof(too_long) - 1);
+	too_long[sizeof(too_long) - 1] = '\0';
+	cr_assert_eq(proc_set_root(too_long), -1);
+
+	cr_assert_eq(proc_set_root("/proc"), 0);
+	proc_list_init(&plist);
+	snprintf(path, sizeof(path), "rm -rf %s", root);
+	cr_assert_eq(system(path), 0);
+}
+
+/**
+ * @brief Helper: add a running process to a synthetic /proc tree
+ */
+static void write_fake_process(const char *root, pid_t pid) {
+	char path[256], text[128];
+	snprintf(path, sizeof(path), "%s/%d", root, pid);
+	cr_assert_eq(mkdir(path, 0755), 0);
+	snprintf(path, sizeof(path), "%d/stat", pid);
+	snprintf(text, sizeof(text), "%d (p) S 1 %d %d 0 -1 0 0 0 0 0 1 1 0 0 "
+		 "20 0 1 0 5 0 0\n", pid, pid, pid);
+	write_fake(root, path, text);
+	snprintf(path, sizeof(path), "%d/statm", pid);
+	write_fake(root, path, "10 5 0 0 0 0 0\n");
+}
+
+/**
+ * @brief Test: A process pushed past MAX_PROCESSES is not reported exited
+ */
+Test(proc_suite, cap_is_not_exit) {
+	static proc_list_t plist;
+	char root[] = "/tmp/pb-root-XXXXXX";
+	char command[64];
+
+	cr_assert_not_null(mkdtemp(root));
+	write_fake(root, "stat", "cpu  100 0 100 800 0 0 0 0\n");
+	for (pid_t pid = 1000; pid < 1000 + MAX_PROCESSES; pid++) {
+		write_fake_process(root, pid);
+	}
+	cr_assert_eq(proc_set_root(root), 0);
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+	cr_assert_eq(plist.count, MAX_PROCESSES);
+
+	/* A lower PID takes the last slot: the highest one is unlisted */
+	write_fake_process(root, 10);
+	proc_list_update(&plist);
+	const proc_events_t *events = proc_list_events();
+	cr_assert_eq(plist.total, MAX_PROCESSES + 1);
+	cr_assert_eq(plist.count, MAX_PROCESSES);
+	cr_assert_eq(events->added_count, 1);
+	cr_assert_eq(events->exited_count, 0,
+		     "Still scanned, so it did not exit");
+
+	cr_assert_eq(proc_set_root("/proc"), 0);
+	proc_list_init(&plist);
+	snprintf(command, sizeof(command), "rm -rf %s", root);
+	cr_assert_eq(system(command), 0);
+}
+
+/* --- Budget Suite --- */
+
+/**
+ * @brief Test: The interval stretches to keep passes within the budget
+ */
+Test(budget_suite, adaptive_interval) {
+	budget_init(0);
+	cr_assert_eq(budget_account(0.5, 0.5, 0), BUDGET_MIN_INTERVAL,
+		     "Without a budget the interval is fixed");
+
+	budget_init(2);
+	cr_assert_eq(budget_account(0.001, 0.001, 0), BUDGET_MIN_INTERVAL);
+	cr_assert_float_eq(budget_account(0.1, 0.1, 1), 0.0307 * 50, 1e-9,
+			   "Smoothed cost / 2%%");
+	for (int i = 0; i < 50; i++) {
+		budget_account(0.1, 0.1, 5);
+	}
+	cr_assert_float_eq(budget_stats()->interval, 5.0, 1e-3);
+	cr_assert_float_eq(budget_stats()->cpu_percent, 2.0, 1e-9);
+
+	/* Serving uses 1% between passes: passes get the other 1% */
+	for (int i = 0; i < 50; i++) {
+		budget_account(0.1, 0.2, 10);
+	}
+	cr_assert_float_eq(budget_stats()->background_percent, 1.0, 1e-6);
+	cr_assert_float_eq(budget_stats()->interval, 10.0, 1e-3);
+
+	/* Serving alone over the budget: passes as rare as allowed */
+	for (int i = 0; i < 10; i++) {
+		budget_account(0.1, 0.1 + 0.5, 10);
+	}
+	cr_assert_eq(budget_stats()->interval, BUDGET_MAX_INTERVAL);
+	cr_assert_eq(budget_account(10, 10, 0), BUDGET_MAX_INTERVAL);
+
+	/* A real pass is measured and reports the process's own usage */
+	budget_pass_begin();
+	double interval = budget_pass_end();
+	const budget_stats_t *self = budget_stats();
+	cr_assert_geq(interval, BUDGET_MIN_INTERVAL);
+	cr_assert_gt(self->resident_bytes, 0);
+	cr_assert_geq(self->peak_resident_bytes, self->resident_bytes / 2);
+	cr_assert_gt(self->cpu_seconds, 0);
+	cr_assert_eq(self->cpu_budget, 2.0);
+}
+
+/* --- Rollup Suite --- */
+
+/**
+ * @brief Find one user in a rollup copy.
+ */
+static const user_rollup_t *find_user(const user_rollup_t *users, int count,
+				      uid_t uid) {
+	for (int i = 0; i < count; i++) {
+		if (users[i].uid == uid) {
+			return &users[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Test: Deltas move totals, owner changes and exits are undone
+ */
+Test(rollup_suite, apply_deltas) {
+	static user_rollup_t users[ROLLUP_MAX_USERS];
+	proc_info_t a = { .pid = 1, .uid = 10, .threads = 2, .memory = 100,
+			  .cpu_usage = 1.5f };
+	proc_info_t b = { .pid = 2, .uid = 10, .threads = 1, .memory = 50 };
+	strcpy(a.user, "alice");
+	strcpy(b.user, "alice");
+
+	rollup_reset();
+	rollup_apply(NULL, &a);
+	rollup_apply(NULL, &b);
+
+	proc_info_t a2 = a;
+	a2.memory = 300;
+	a2.threads = 4;
+	rollup_apply(&a, &a2);
+
+	int count = rollup_users(users, ROLLUP_MAX_USERS);
+	const user_rollup_t *alice = find_user(users, count, 10);
+	cr_assert_eq(count, 1);
+	cr_assert_str_eq(alice->user, "alice");
+	cr_assert_eq(alice->processes, 2);
+	cr_assert_eq(alice->threads, 5);
+	cr_assert_eq(alice->memory, 350);
+
+	/* setuid: the process moves to another user */
+	proc_info_t b2 = b;
+	b2.uid = 0;
+	strcpy(b2.user, "root");
+	rollup_apply(&b, &b2);
+	rollup_apply(&a2, NULL);
+
+	count = rollup_users(users, ROLLUP_MAX_USERS);
+	cr_assert_eq(count, 1, "Users without processes are hidden");
+	cr_assert_eq(users[0].uid, 0);
+	cr_assert_eq(users[0].memory, 50);
+}
+
+/**
+ * @brief Test: Incremental totals of the collector equal a full recount
+ */
+Test(rollup_suite, matches_rebuild) {
+	static proc_list_t plist;
+	static user_rollup_t incremental[ROLLUP_MAX_USERS];
+	static user_rollup_t rebuilt[ROLLUP_MAX_USERS];
+
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+	pid_t child = fork();
+	if (child == 0) {
+		pause();
+		_exit(0);
+	}
+	proc_list_update(&plist);
+	kill(child, SIGKILL);
+	waitpid(child, NULL, 0);
+	proc_list_update(&plist);
+
+	int count = rollup_users(incremental, ROLLUP_MAX_USERS);
+	rollup_rebuild(&plist);
+	cr_assert_eq(rollup_users(rebuilt, ROLLUP_MAX_USERS), count);
+	rollup_sort(incremental, count, ROLLUP_SORT_UID);
+	rollup_sort(rebuilt, count, ROLLUP_SORT_UID);
+
+	int processes = 0;
+	for (int i = 0; i < count; i++) {
+		cr_assert_eq(incremental[i].uid, rebuilt[i].uid);
+		cr_assert_eq(incremental[i].processes, rebuilt[i].processes);
+		cr_assert_eq(incremental[i].threads, rebuilt[i].threads);
+		cr_assert_eq(incremental[i].memory, rebuilt[i].memory);
+		cr_assert_float_eq(incremental[i].cpu_usage,
+				   rebuilt[i].cpu_usage, 0.01);
+		processes += incremental[i].processes;
+	}
+	cr_assert_eq(processes, plist.count);
+	cr_assert_gt(find_user(rebuilt, count, getuid())->threads, 0);
+}
+
+/* --- Group Suite --- */
+
+/**
+ * @brief Test: Identical workers collapse into one row with min/max
+ */
+Test(group_suite, collapse_workers) {
+	static proc_list_t plist;
+	static group_list_t groups;
+
+	plist.count = 0;
+	for (int i = 0; i < 400; i++) {
+		proc_info_t *proc = &plist.list[plist.count++];
+		memset(proc, 0, sizeof(*proc));
+		proc->pid = 100 + i;
+		strcpy(proc->name, "worker");
+		proc->name_hash = proc_name_hash(proc->name);
+		proc->memory = 1000 + i;
+		proc->cpu_usage = (i == 7) ? 50.0f : 0.5f;
+	}
+	/* Same hash, different name: must stay a separate group */
+	proc_info_t *other = &plist.list[plist.count++];
+	memset(other, 0, sizeof(*other));
+	other->pid = 1;
+	strcpy(other->name, "init");
+	other->name_hash = plist.list[0].name_hash;
+	other->memory = 5;
+
+	group_by_name(&plist, &groups);
+	cr_assert_eq(groups.count, 2);
+	group_sort(&groups, GROUP_SORT_COUNT);
+	const proc_group_t *workers = &groups.list[0];
+	cr_assert_str_eq(workers->name, "worker");
+	cr_assert_eq(workers->count, 400);
+	cr_assert_eq(workers->memory_min, 1000);
+	cr_assert_eq(workers->memory_max, 1399);
+	cr_assert_float_eq(workers->cpu_max, 50.0f, 0.001);
+	cr_assert_float_eq(workers->cpu_min, 0.5f, 0.001);
+	cr_assert_eq(groups.list[1].count, 1);
+
+	group_members(&plist, other->name_hash, "init");
+	cr_assert_eq(plist.count, 1);
+	cr_assert_eq(plist.list[0].pid, 1);
+}
+
+/**
+ * @brief Test: Collector stores the name hash used for grouping
+ */
+Test(group_suite, collector_hashes_names) {
+	static proc_list_t plist;
+	proc_list_init(&plist);
+	proc_list_update(&plist);
+
+	cr_assert_gt(plist.count, 0);
+	for (int i = 0; i < plist.count; i++) {
+		cr_assert_eq(plist.list[i].name_hash,
+			     proc_name_hash(plist.list[i].name));
+	}
+}
+
+/* --- Columns Suite --- */
+
+/**
+ * @brief Convert ASCII screen cells to a C string for comparisons.
+ */
+static const char *narrow(const wchar_t *cells, int count) {
+	static char text[512];
+	for (int i = 0; i < count; i++) {
+		text[i] = cells[i] < 0x80 ? (char)cells[i] : '#';
+	}
+	text[count] = '\0';
+	return text;
+}
+
+/**
+ * @brief Test: Default row matches the former printf layout
+ */
+Test(columns_suite, format_matches_printf) {
+	proc_info_t proc;
+	memset(&proc, 0, sizeof(proc));
+	proc.pid = 4242;
+	strcpy(proc.name, "a-rather-long-process-name");
+	strcpy(proc.user, "alice");
+	proc.memory = 123456;
+	proc.cpu_usage = 12.34f;
+	proc.fd_count = 17;
+	proc.sock_count = 3;
+	proc.fd_age = 5;
+	proc.net_rate = 0.96f;
+
+	cr_assert_eq(columns_select("pid,name,user,mem,cpu,fds,sock,age,net"), 0);
+	columns_set_unit(COL_MEM, COLUMN_UNIT_RAW);
+	columns_set_unit(COL_NET, COLUMN_UNIT_RAW);
+	column_layout_t layout;
+	columns_layout(&layout, 90);
+	cr_assert_eq(layout.count, 9);
+
+	char expected[128];
+	wchar_t line[128];
+	snprintf(expected, sizeof(expected),
+		 " %-6d %-20.20s %-12s %12ld %6.1f %6d %5d %3ds %9.1f",
+		 proc.pid, proc.name, proc.user, proc.memory, proc.cpu_usage,
+		 proc.fd_count, proc.sock_count, proc.fd_age, proc.net_rate);
+	columns_format_row(&layout, &proc, line, NULL);
+	cr_assert_str_eq(narrow(line, layout.end), expected);
+
+	/* Unsampled descriptors and values that do not fit */
+	proc.fd_count = -1;
+	proc.net_rate = -1;
+	proc.pid = 12345678;
+	columns_format_row(&layout, &proc, line, NULL);
+	cr_assert(strncmp(narrow(line, 8), " ****** ", 8) == 0);
+	cr_assert_eq(line[layout.x[5] + layout.width[5] - 1], '-');
+	cr_assert_eq(line[layout.x[8] + layout.width[8] - 1], '-',
+		     "Unknown traffic is not shown as 0");
+	columns_set_unit(COL_MEM, COLUMN_UNIT_AUTO);
+	columns_set_unit(COL_NET, COLUMN_UNIT_AUTO);
+}
+
+/**
+ * @brief Format a scaled size into a 6-character cell.
+ */
+static const char *scaled(unsigned long long tenths_kb) {
+	wchar_t cell[6];
+	wmemset(cell, L' ', 6);
+	columns_put_scaled(cell, 6, tenths_kb, 1);
+	return narrow(cell, 6);
+}
+
+/**
+ * @brief Test: Sizes scale to K/M/G/T with at most 5 characters
+ */
+Test(columns_suite, scaled_units) {
+	cr_assert_str_eq(scaled(0), "  0.0K");
+	cr_assert_str_eq(scaled(5120), "  512K");
+	cr_assert_str_eq(scaled(15360), "  1.5M");
+	cr_assert_str_eq(scaled(64ULL * 1024 * 1024 * 10), " 64.0G");
+	cr_assert_str_eq(scaled(123ULL * 1024 * 1024 * 10), "  123G");
+	cr_assert_str_eq(scaled(3ULL * 1024 * 1024 * 1024 * 10), "  3.0T");
+
+	/* Default units: MEM and NET/s headers, scaled cells */
+	proc_info_t proc;
+	memset(&proc, 0, sizeof(proc));
+	proc.memory = 64L * 1024 * 1024;
+	columns_select("mem,net");
+	column_layout_t layout;
+	columns_layout(&layout, 14);
+	wchar_t line[32];
+	columns_format_header(&layout, line);
+	cr_assert_str_eq(narrow(line, layout.end), "    MEM  NET/s");
+	columns_format_row(&layout, &proc, line, NULL);
+	cr_assert_str_eq(narrow(line, layout.end), "  64.0G   0.0K");
+
+	cr_assert_eq(columns_toggle_unit(), 0);
+	columns_layout(&layout, 40);
+	cr_assert_eq(layout.width[0], 12, "Raw kB needs the wide cell");
+	columns_toggle_unit();
+	columns_select(COLUMNS_DEFAULT);
+}
+
+/**
+ * @brief Test: Cells are toned by the threshold table, Z/D rows dimmed
+ */
+Test(columns_suite, cell_tones) {
+	static proc_list_t plist;
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 200;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = i + 1;
+		plist.list[i].state = 'S';
+		plist.list[i].memory = 1000 + i;
+	}
+
+	columns_select("state,mem,cpu");
+	column_layout_t layout;
+	columns_layout(&layout, 40);
+	wchar_t line[64];
+	unsigned char tones[64];
+	int cpu_cell = layout.x[2] + layout.width[2] - 1;
+	int mem_cell = layout.x[1] + layout.width[1] - 1;
+
+	proc_info_t *proc = &plist.list[plist.count - 1];
+	proc->cpu_usage = 95.0f;
+	columns_format_row(&layout, proc, line, tones);
+	cr_assert_eq(line[layout.x[0]], 'S');
+	cr_assert_eq(tones[cpu_cell], TONE_CRIT);
+	cr_assert_eq(tones[mem_cell], TONE_NORMAL,
+		     "Percentiles are disabled before columns_measure()");
+
+	/* Top 1% of 200 rows: the two largest RSS values */
+	columns_measure(&layout, &plist);
+	proc->cpu_usage = 60.0f;
+	columns_format_row(&layout, proc, line, tones);
+	cr_assert_eq(tones[cpu_cell], TONE_WARN);
+	cr_assert_eq(tones[mem_cell], TONE_TOP);
+	columns_format_row(&layout, &plist.list[plist.count - 2], line, tones);
+	cr_assert_eq(tones[mem_cell], TONE_TOP);
+	columns_format_row(&layout, &plist.list[plist.count - 3], line, tones);
+	cr_assert_eq(tones[mem_cell], TONE_NORMAL);
+
+	proc->state = 'Z';
+	columns_format_row(&layout, proc, line, tones);
+	cr_assert_eq(line[layout.x[0]], 'Z');
+	for (int i = 0; i < layout.end; i++) {
+		cr_assert_eq(tones[i], TONE_DIM);
+	}
+	columns_select(COLUMNS_DEFAULT);
+}
+
+/**
+ * @brief Test: Spare width goes to flexible columns, order is editable
+ */
+Test(columns_suite, layout_and_editing) {
+	column_layout_t layout;
+
+	cr_assert_eq(columns_select("pid,name,bogus"), -1);
+	cr_assert_eq(columns_select("pid,pid"), -1);
+	cr_assert_eq(columns_select(""), -1);
+	cr_assert_eq(columns_select("pid,name,cpu"), 0);
+
+	columns_layout(&layout, 300);
+	cr_assert_eq(layout.width[1], 64, "Name grows to its maximum");
+	cr_assert_eq(layout.end, 1 + 6 + 1 + 64 + 1 + 6);
+
+	columns_layout(&layout, 20);
+	cr_assert_eq(layout.count, 2, "Columns beyond the screen are dropped");
+	cr_assert_eq(layout.end, 20);
+
+	/* Move pid right, hide it, bring back the next hidden column */
+	unsigned int generation = columns_generation();
+	columns_move(1);
+	cr_assert_neq(columns_generation(), generation,
+		      "Edits invalidate cached layouts");
+	generation = columns_generation();
+	columns_layout(&layout, 300);
+	cr_assert_eq(columns_generation(), generation,
+		     "Computing a layout changes nothing");
+	columns_layout(&layout, 300);
+	cr_assert_eq(layout.ids[0], COL_NAME);
+	cr_assert_eq(layout.ids[1], COL_PID);
+	columns_hide();
+	columns_show_next();
+	columns_layout(&layout, 300);
+	cr_assert_eq(layout.count, 3);
+	cr_assert_eq(layout.ids[2], COL_FDS, "Next hidden after cpu");
+
+	SortType sort = SORT_PID;
+	cr_assert_eq(columns_sort_key(&sort), -1, "fds has no sort key");
+	columns_focus(1);
+	cr_assert_eq(columns_sort_key(&sort), 0);
+	cr_assert_eq(sort, SORT_NAME);
+	columns_select(COLUMNS_DEFAULT);
+}
+
+/**
+ * @brief Test: UTF-8 is truncated by display width, never mid-character
+ */
+Test(columns_suite, utf8_width) {
+	cr_assert(setlocale(LC_CTYPE, "C.UTF-8"));
+	wchar_t cells[8];
+
+	/* "é" is one cell, "日本" two cells each */
+	cr_assert_eq(text_cells("caf\xc3\xa9", cells, 8), 4);
+	cr_assert_eq(cells[3], 0xe9);
+
+	wmemset(cells, L' ', 8);
+	cr_assert_eq(text_cells("\xe6\x97\xa5\xe6\x9c\xac", cells, 3), 2,
+		     "Second wide character does not fit in 3 cells");
+	cr_assert_eq(cells[0], 0x65e5);
+	cr_assert_eq(cells[1], TEXT_CONTINUATION);
+	cr_assert_eq(cells[2], L' ');
+
+	/* Invalid UTF-8 and control characters */
+	cr_assert_eq(text_cells("a\xff\tb", cells, 8), 4);
+	cr_assert_str_eq(narrow(cells, 4), "a??b");
+
+	/* Cached path: same cells, cut wide characters are blanked */
+	unsigned int hash = proc_name_hash("\xe6\x97\xa5\xe6\x9c\xac");
+	wmemset(cells, L' ', 8);
+	cr_assert_eq(text_cells_cached(hash, "\xe6\x97\xa5\xe6\x9c\xac",
+				       cells, 8), 4);
+	cr_assert_eq(cells[2], 0x672c);
+	wmemset(cells, L' ', 8);
+	cr_assert_eq(text_cells_cached(hash, "\xe6\x97\xa5\xe6\x9c\xac",
+				       cells, 3), 2);
+	cr_assert_eq(cells[2], L' ');
+	setlocale(LC_CTYPE, "C");
+}
+
+/* --- UI Suite --- */
+
+/**
+ * @brief Test: Frames drawn on the grid backend, only changes are presented
+ */
+Test(ui_suite, grid_frames) {
+	static proc_list_t plist;
+	memset(&plist, 0, sizeof(plist));
+	const char *names[] = { "init", "sshd", "worker" };
+	plist.count = 3;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = i + 1;
+		plist.list[i].state = 'S';
+		strcpy(plist.list[i].name, names[i]);
+	}
+	plist.states[proc_state_index('S')] = 3;
+
+	char text[256];
+	ui_init(RENDER_GRID);
+	cr_assert_eq(render_rows(), RENDER_GRID_ROWS);
+	ui_draw(&plist, 1, 0, "", 0, HISTORY_NONE, 0, 0);
+	cr_assert_eq(ui_present(), RENDER_GRID_ROWS * RENDER_GRID_COLS,
+		     "First frame sends every cell");
+
+	render_line_text(0, text, sizeof(text));
+	cr_assert(strstr(text, "PID") && strstr(text, "NAME"));
+	render_line_text(2, text, sizeof(text));
+	cr_assert(strstr(text, "sshd"));
+	cr_assert_eq(render_line(2)[0].style, STYLE_SELECTED);
+	cr_assert_eq(render_line(1)[0].style, STYLE_NORMAL);
+	render_line_text(RENDER_GRID_ROWS - 1, text, sizeof(text));
+	cr_assert_eq(strncmp(text, "R:0 S:3 D:0", 11), 0);
+
+	/* Same frame again: nothing to send; one new value: a short run */
+	ui_draw(&plist, 1, 0, "", 0, HISTORY_NONE, 0, 0);
+	cr_assert_eq(ui_present(), 0);
+	plist.list[2].cpu_usage = 12.5f;
+	ui_draw(&plist, 1, 0, "", 0, HISTORY_NONE, 0, 0);
+	int sent = ui_present();
+	cr_assert(sent > 0 && sent <= 4, "sent %d cells", sent);
+	render_line_text(3, text, sizeof(text));
+	cr_assert(strstr(text, "12.5"));
+
+	/* Overlays are drawn into the same frame */
+	ui_draw(&plist, 1, 0, "", 0, HISTORY_NONE, 0, 0);
+	ui_show_confirm_dialog("sshd", 2);
+	ui_present();
+	render_line_text((RENDER_GRID_ROWS - 5) / 2 + 2, text, sizeof(text));
+	cr_assert(strstr(text, "sshd (PID: 2)"));
+
+	/* Simulated terminal resize */
+	render_grid_resize(30, 100);
+	cr_assert_eq(ui_resize(), 1);
+	cr_assert_eq(ui_resize(), 0);
+	cr_assert_eq(ui_list_height(0), 28);
+	ui_draw(&plist, 0, 0, "", 0, HISTORY_NONE, 0, 0);
+	cr_assert_eq(ui_present(), 30 * 100);
+	ui_close();
+}
+
+/**
+ * @brief Test: Wide characters clipped by the screen edge become blanks
+ */
+Test(ui_suite, grid_wide_clip) {
+	cr_assert(setlocale(LC_CTYPE, "C.UTF-8"));
+	char text[256];
+
+	ui_init(RENDER_GRID);
+	render_grid_resize(2, 10);
+	ui_resize();
+	render_erase();
+	const wchar_t wide[] = { L'a', L'b', 0x65e5, TEXT_CONTINUATION };
+	render_cells(0, 7, wide, 4, STYLE_NORMAL, NULL, NULL);
+	render_text(1, 6, 10, "x\xe6\x97\xa5", STYLE_WARN);
+	ui_present();
+
+	render_line_text(0, text, sizeof(text));
+	cr_assert_str_eq(text, "       ab ", "Cut wide character is blanked");
+	render_line_text(1, text, sizeof(text));
+	cr_assert_str_eq(text, "      x\xe6\x97\xa5 ");
+	cr_assert_eq(render_line(1)[8].ch, TEXT_CONTINUATION);
+	cr_assert_eq(render_line(1)[6].style, STYLE_WARN);
+	ui_close();
+	setlocale(LC_CTYPE, "C");
+}
+
+/* --- History Suite --- */
+
+/**
+ * @brief Test: Ring keeps only the newest HISTORY_LEN samples, oldest first
+ */
+Test(history_suite, ring_wraps) {
+	proc_list_t plist;
+	plist.count = 1;
+	plist.list[0].pid = 42;
+	plist.list[0].memory = 0;
+
+	history_init();
+	for (int i = 0; i < HISTORY_LEN + 4; i++) {
+		plist.list[0].cpu_usage = (float)i;
+		history_update(&plist);
+	}
+
+	float samples[HISTORY_LEN];
+	int count = history_samples(history_lookup(42), HISTORY_CPU, samples);
+
+	cr_assert_eq(count, HISTORY_LEN, "Ring should be full");
+	cr_assert_float_eq(samples[0], 0.04f, 0.0001f,
+			   "Oldest kept sample should be the 5th one");
+	cr_assert_float_eq(samples[HISTORY_LEN - 1],
+			   (HISTORY_LEN + 3) / 100.0f, 0.0001f,
+			   "Newest sample should be last");
+}
+
+/**
+ * @brief Test: Rings of exited processes are returned to the pool
+ */
+Test(history_suite, exited_pid_released) {
+	proc_list_t plist;
+	plist.count = 2;
+	plist.list[0].pid = 1;
+	plist.list[1].pid = 2;
+	plist.list[0].cpu_usage = plist.list[1].cpu_usage = 0.0f;
+	plist.list[0].memory = plist.list[1].memory = 0;
+
+	history_init();
+	history_update(&plist);
+	cr_assert_not_null(history_lookup(2));
+
+	plist.count = 1;
+	history_update(&plist);
+
+	cr_assert_null(history_lookup(2), "Exited PID should lose its ring");
+	cr_assert_not_null(history_lookup(1), "Surviving PID keeps its ring");
+}
+
+/* --- Detail Suite --- */
+
+/**
+ * @brief Test: Deep inspection of the test process itself
+ */
+Test(detail_suite, read_self) {
+	proc_detail_t detail;
+
+	cr_assert_eq(detail_read(getpid(), &detail), 0,
+		     "Own process should be readable");
+	cr_assert_eq(detail.valid, 1);
+	cr_assert_geq(detail.threads, 1, "At least one thread expected");
+	cr_assert_geq(detail.fd_count, 3, "stdin/out/err should be open");
+	cr_assert_gt(detail.map_count, 0, "Process should have mappings");
+	cr_assert_str_neq(detail.exe, "-", "Own exe link should resolve");
+	cr_assert_eq(detail.state, 'R', "Reading itself, so running");
+	cr_assert_str_eq(detail.wchan, "-", "Only read for D-state");
+}
+
+/**
+ * @brief Test: Kernel stack is reduced to a chain of function names
+ */
+Test(detail_suite, format_stack) {
+	char line[64];
+
+	detail_format_stack("[<0>] io_schedule+0x16/0x40\n"
+			    "[<0>] wait_on_page_bit+0x11a/0x1f0\n", line,
+			    sizeof(line));
+	cr_assert_str_eq(line, "io_schedule < wait_on_page_bit");
+
+	detail_format_stack("", line, sizeof(line));
+	cr_assert_str_eq(line, "-");
+
+	/* Long chains are truncated, not overflowed */
+	detail_format_stack("[<0>] aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa+0x1/0x2\n"
+			    "[<0>] bbbbbbbbbbbbbbbbbbbbbbbbbbbbbb+0x1/0x2\n"
+			    "[<0>] cccccccccccccccccccccccccccccc+0x1/0x2\n",
+			    line, sizeof(line));
+	cr_assert_eq(strlen(line), sizeof(line) - 1);
+}
+
+/**
+ * @brief Test: Brief read skips the walks that grow with the process
+ */
+Test(detail_suite, read_brief) {
+	proc_detail_t detail;
+
+	cr_assert_eq(detail_read_brief(getpid(), &detail), 0);
+	cr_assert_geq(detail.threads, 1);
+	cr_assert_str_neq(detail.cmdline, "", "Command line is still read");
+	cr_assert_eq(detail.env_count, -1, "Environment is not scanned");
+	cr_assert_eq(detail.fd_count, -1, "Descriptors are not counted");
+	cr_assert_eq(detail.map_count, -1, "Maps are not walked");
+}
+
+/**
+ * @brief Test: Nonexistent PID is reported as an error
+ */
+Test(detail_suite, read_missing) {
+	proc_detail_t detail;
+
+	cr_assert_eq(detail_read(-5, &detail), -1);
+}
+
+/* --- Descriptor Suite --- */
+
+/**
+ * @brief Test: Descriptor and socket counts of the test process
+ */
+Test(fdscan_suite, count_self) {
+	int sockets_before, sockets_after;
+	int fds_before = fdscan_count(getpid(), &sockets_before);
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	cr_assert_geq(sock, 0);
+	int fds_after = fdscan_count(getpid(), &sockets_after);
+	close(sock);
+
+	cr_assert_geq(fds_before, 3, "stdin/out/err should be counted");
+	cr_assert_eq(fds_after, fds_before + 1, "New socket adds one fd");
+	cr_assert_eq(sockets_after, sockets_before + 1,
+		     "New socket should be counted as socket");
+}
+
+/* --- Network Suite --- */
+
+/**
+ * @brief Push data through a loopback connection.
+ *
+ * @param client Sending end.
+ * @param peer Receiving end.
+ */
+static void push_traffic(int client, int peer) {
+	static char payload[65536];
+	long moved = 0;
+	for (int i = 0; i < 16; i++) {
+		moved += write(client, payload, sizeof(payload));
+		for (long got = 0; got < (long)sizeof(payload);) {
+			got += read(peer, payload, sizeof(payload));
+		}
+	}
+	cr_assert_eq(moved, 16L * (long)sizeof(payload));
+}
+
+/**
+ * @brief Test: Loopback TCP traffic is charged once fdscan saw the sockets
+ */
+Test(net_suite, loopback_attribution) {
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t addr_len = sizeof(addr);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	cr_assert_eq(bind(server, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	cr_assert_eq(listen(server, 1), 0);
+	getsockname(server, (struct sockaddr *)&addr, &addr_len);
+
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	cr_assert_eq(connect(client, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	int peer = accept(server, NULL, NULL);
+
+	proc_list_t plist;
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 1;
+	plist.list[0].pid = getpid();
+
+	/* net walks no descriptors itself: unseen sockets are not charged */
+	fdscan_init();
+	net_init();
+	net_update(&plist);
+	push_traffic(client, peer);
+	net_update(&plist);
+	cr_assert_eq(plist.list[0].net_rate, 0.0f, "Owner not sampled yet");
+
+	/* The rotation reads this process's sockets; from now on they count */
+	fdscan_update(&plist);
+	net_update(&plist);
+	push_traffic(client, peer);
+	net_update(&plist);
+	cr_assert_gt(plist.list[0].net_rate, 0.0f,
+		     "Loopback traffic should be charged to own PID");
+
+	fdscan_init();
+	close(peer);
+	close(client);
+	close(server);
+}
+
+/**
+ * @brief Test: A huge descriptor table is walked over several refreshes
+ */
+Test(fdscan_suite, resumable_walk) {
+	static proc_list_t plist;
+	char root[] = "/tmp/pb-root-XXXXXX";
+	char path[256];
+	const int fds = FDSCAN_BUDGET + FDSCAN_BUDGET / 2;
+
+	cr_assert_not_null(mkdtemp(root));
+	snprintf(path, sizeof(path), "%s/50", root);
+	cr_assert_eq(mkdir(path, 0755), 0);
+	snprintf(path, sizeof(path), "%s/50/fd", root);
+	cr_assert_eq(mkdir(path, 0755), 0);
+	for (int fd = 0; fd < fds; fd++) {
+		snprintf(path, sizeof(path), "%s/50/fd/%d", root, fd);
+		close(open(path, O_WRONLY | O_CREAT, 0600));
+	}
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 1;
+	plist.list[0].pid = 50;
+	plist.list[0].fd_count = -1;
+	cr_assert_eq(proc_set_root(root), 0);
+	fdscan_init();
+
+	fdscan_update(&plist);
+	cr_assert_eq(plist.list[0].fd_count, -1, "Budget ran out mid-walk");
+	fdscan_update(&plist);
+	cr_assert_eq(plist.list[0].fd_count, fds, "Resumed, not restarted");
+	cr_assert_eq(plist.list[0].sock_count, 0);
+
+	fdscan_init();
+	cr_assert_eq(proc_set_root("/proc"), 0);
+	snprintf(path, sizeof(path), "rm -rf %s", root);
+	cr_assert_eq(system(path), 0);
+}
+
+/* --- Procio Suite --- */
+
+/**
+ * @brief Both backends must return the same stat/statm of this process.
+ */
+Test(procio_suite, backends_agree) {
+	pid_t pids[2] = { getpid(), 999999999 };
+	procio_t *sync_io = procio_open(2, PROCIO_SYNC);
+	procio_t *auto_io = procio_open(2, PROCIO_AUTO);
+	cr_assert_not_null(sync_io);
+	cr_assert_not_null(auto_io);
+	cr_assert_eq(procio_backend(sync_io), PROCIO_SYNC);
+
+	/* Read twice so cached descriptors are exercised as well */
+	for (int round = 0; round < 2; round++) {
+		cr_assert_eq(procio_read(sync_io, pids, 2), 2);
+		cr_assert_eq(procio_read(auto_io, pids, 2), 2);
+
+		const char *a = procio_stat(sync_io, 0);
+		const char *b = procio_stat(auto_io, 0);
+		cr_assert_not_null(a);
+		cr_assert_not_null(b);
+		/* Fields up to the name are stable */
+		cr_assert_eq(strncmp(a, b, strchr(a, ')') - a), 0);
+		cr_assert_not_null(procio_statm(auto_io, 0));
+
+		cr_assert_null(procio_stat(sync_io, 1));
+		cr_assert_null(procio_stat(auto_io, 1));
+		cr_assert_null(procio_statm(auto_io, 1));
+	}
+
+	procio_forget(auto_io, pids, 1);
+	cr_assert_eq(procio_read(auto_io, pids, 1), 1);
+	cr_assert_not_null(procio_stat(auto_io, 0));
+
+	procio_close(sync_io);
+	procio_close(auto_io);
+}
+
+/* --- Arena Suite --- */
+
+Test(arena_suite, alloc_rewind) {
+	arena_t arena;
+	cr_assert_eq(arena_init(&arena, 256), 0);
+
+	char *a = arena_alloc(&arena, 10);
+	size_t mark = arena_mark(&arena);
+	char *b = arena_alloc(&arena, 10);
+	cr_assert_not_null(a);
+	cr_assert_eq(((size_t)b) % 16, 0);
+	cr_assert_null(arena_alloc(&arena, 512));
+
+	/* Rewinding hands the same memory out again */
+	arena_rewind(&arena, mark);
+	cr_assert_eq(arena_alloc(&arena, 10), b);
+	arena_reset(&arena);
+	cr_assert_eq(arena_alloc(&arena, 10), a);
+	cr_assert_geq(arena.peak, 26);
+
+	arena_free(&arena);
+}
+
+/**
+ * @brief sort_array must be stable and leave the frame arena as it was.
+ */
+Test(arena_suite, sort_array_stable) {
+	proc_list_t plist;
+	int mem[] = { 5, 1, 5, 3, 1, 5 };
+	plist.count = 6;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = i + 1;
+		plist.list[i].memory = mem[i];
+	}
+
+	size_t mark = arena_mark(frame_arena());
+	sort_processes(&plist, SORT_MEM);
+	cr_assert_eq(arena_mark(frame_arena()), mark);
+
+	int expected[] = { 1, 3, 6, 4, 2, 5 };
+	for (int i = 0; i < plist.count; i++) {
+		cr_assert_eq(plist.list[i].pid, expected[i]);
+	}
+}
+
+/* --- Snapshot Suite --- */
+
+/**
+ * @brief Published snapshots are readable in place and via snapshot_read.
+ */
+Test(snapshot_suite, publish_and_read) {
+	static proc_list_t plist, copy;
+	char name[64];
+	snprintf(name, sizeof(name), "/pb-test-%d", getpid());
+
+	plist.count = 2;
+	plist.total = 2;
+	plist.list[0].pid = 10;
+	strcpy(plist.list[0].name, "first");
+	plist.list[0].memory = 100;
+	plist.list[1].pid = 20;
+	strcpy(plist.list[1].name, "second");
+	plist.list[1].fd_count = 7;
+	plist.list[1].ns_pid = 1;
+	plist.list[1].pid_ns = 4026532201ul;
+	strcpy(plist.list[1].container, "4f1c2b9e0d8a");
+
+	/* A segment left behind by a dead publisher is replaced */
+	int stale = shm_open(name, O_CREAT | O_RDWR, 0600);
+	cr_assert_geq(stale, 0);
+	close(stale);
+	cr_assert_eq(snapshot_publish_open(name), 0);
+	snapshot_publish(&plist);
+
+	/* A live publisher's segment is not */
+	stale = shm_open(name, O_RDWR, 0);
+	cr_assert_neq(flock(stale, LOCK_EX | LOCK_NB), 0, "Held while publishing");
+	close(stale);
+
+	pb_shm_t shm;
+	cr_assert_eq(pb_shm_attach(&shm, name), 0);
+	uint32_t seq;
+	const pb_snapshot_t *snap = pb_snapshot_begin(&shm, &seq);
+	cr_assert_eq(snap->generation, 1);
+	cr_assert_eq(snap->count, 2);
+	cr_assert_str_eq(snap->records[1].name, "second");
+	cr_assert(pb_snapshot_valid(snap, seq));
+
+	/* The first publish goes to the other buffer; the second reuses ours */
+	plist.list[0].memory = 200;
+	snapshot_publish(&plist);
+	cr_assert(pb_snapshot_valid(snap, seq));
+	snapshot_publish(&plist);
+	cr_assert_not(pb_snapshot_valid(snap, seq));
+
+	cr_assert_eq(snapshot_attach(name), 0);
+	cr_assert(snapshot_publisher_alive());
+	cr_assert_eq(snapshot_read(&copy), 3);
+	cr_assert_eq(copy.count, 2);
+	cr_assert_eq(copy.list[0].memory, 200);
+	cr_assert_eq(copy.list[1].fd_count, 7);
+	cr_assert_eq(copy.list[1].ns_pid, 1);
+	cr_assert_eq(copy.list[1].pid_ns, 4026532201ul);
+	cr_assert_str_eq(copy.list[1].container, "4f1c2b9e0d8a");
+
+	/* Closing removes the segment */
+	pb_shm_detach(&shm);
+	snapshot_detach();
+	snapshot_publish_close();
+	cr_assert_neq(pb_shm_attach(&shm, name), 0);
+}
+
+/* --- Expression Suite --- */
+
+Test(expr_suite, compile_and_match) {
+	expr_t expr;
+	proc_info_t proc;
+	memset(&proc, 0, sizeof(proc));
+	proc.pid = 42;
+	strcpy(proc.name, "nginx");
+	strcpy(proc.user, "www");
+	proc.memory = 2048;
+	proc.cpu_usage = 12.5;
+
+	cr_assert_eq(expr_compile("cpu > 10 and name ~ NGI", &expr, NULL, 0), 0);
+	cr_assert(expr_match(&expr, &proc));
+	cr_assert_eq(expr_compile("not (user == www or pid < 10)", &expr,
+				  NULL, 0), 0);
+	cr_assert_not(expr_match(&expr, &proc));
+	cr_assert_eq(expr_compile("mem >= 2048 && name != \"nginx\" || pid == 42",
+				  &expr, NULL, 0), 0);
+	cr_assert(expr_match(&expr, &proc));
+
+	/* Namespace and container filters */
+	proc.pid_ns = 4026532201ul;
+	strcpy(proc.container, "4f1c2b9e0d8a");
+	cr_assert_eq(expr_compile("pidns == 4026532201 and container ~ 4f1c",
+				  &expr, NULL, 0), 0);
+	cr_assert(expr_match(&expr, &proc));
+	cr_assert_eq(expr_compile("container == \"\"", &expr, NULL, 0), 0);
+	cr_assert_not(expr_match(&expr, &proc));
+
+	/* D-state and zombie filter */
+	proc.state = 'D';
+	cr_assert_eq(expr_compile("state == D or state == Z", &expr, NULL, 0), 0);
+	cr_assert(expr_match(&expr, &proc));
+	proc.state = 'S';
+	cr_assert_not(expr_match(&expr, &proc));
+
+	/* Empty expression matches everything */
+	cr_assert_eq(expr_compile("  ", &expr, NULL, 0), 0);
+	cr_assert(expr_match(&expr, &proc));
+}
+
+Test(expr_suite, syntax_errors) {
+	expr_t expr;
+	char error[64];
+
+	cr_assert_eq(expr_compile("bogus > 1", &expr, error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "unknown field 'bogus'");
+	cr_assert_eq(expr_compile("cpu ~ 1", &expr, NULL, 0), -1);
+	cr_assert_eq(expr_compile("name < a", &expr, NULL, 0), -1);
+	cr_assert_eq(expr_compile("(pid > 1", &expr, NULL, 0), -1);
+	cr_assert_eq(expr_compile("pid > x1", &expr, NULL, 0), -1);
+	cr_assert_eq(expr_compile("pid > 1 pid", &expr, NULL, 0), -1);
+}
+
+/**
+ * @brief Test: Columnar evaluation agrees with per-process matching
+ */
+Test(expr_suite, columns_match_rows) {
+	static proc_list_t plist;
+	const char *sources[] = {
+		"", "rss > 8G", "cpu >= 50 and not (user == root or pid < 10)",
+		"name ~ work or fds > 100 and socks != 0", "state == Z",
+	};
+	unsigned char match[MAX_PROCESSES];
+
+	plist.count = 500;
+	for (int i = 0; i < plist.count; i++) {
+		proc_info_t *proc = &plist.list[i];
+		memset(proc, 0, sizeof(*proc));
+		proc->pid = i + 1;
+		proc->memory = (long)i * 40000;
+		proc->cpu_usage = i % 100;
+		proc->fd_count = i % 150;
+		proc->sock_count = i % 3;
+		proc->state = i % 7 ? 'S' : 'Z';
+		strcpy(proc->user, i % 2 ? "root" : "app");
+		strcpy(proc->name, i % 5 ? "worker" : "init");
+	}
+
+	arena_reset(frame_arena());
+	expr_columns_t columns;
+	expr_columns_init(&columns, &plist);
+	for (size_t n = 0; n < sizeof(sources) / sizeof(sources[0]); n++) {
+		expr_t expr;
+		cr_assert_eq(expr_compile(sources[n], &expr, NULL, 0), 0);
+		int expected = 0;
+		int matches = expr_match_columns(&expr, &columns, match);
+		for (int i = 0; i < plist.count; i++) {
+			int row = expr_match(&expr, &plist.list[i]);
+			cr_assert_eq(match[i], row, "'%s' row %d", sources[n], i);
+			expected += row;
+		}
+		cr_assert_eq(matches, expected);
+	}
+	cr_assert_eq(expr_column(&columns, EXPR_FIELD_MEM)[10], 400000);
+	cr_assert_null(expr_column(&columns, EXPR_FIELD_NAME));
+}
+
+/* --- Rules Suite --- */
+
+/**
+ * @brief Test: Rule syntax and error messages
+ */
+Test(rules_suite, parse) {
+	char error[128];
+
+	rules_clear();
+	cr_assert_eq(rules_add("# comment", NULL, 0), 0);
+	cr_assert_eq(rules_add("bigrss: any rss > 8G for 30s", NULL, 0), 1);
+	cr_assert_eq(rules_add("build: sum cpu where user == build > 90 for 1m "
+			       "run echo hot", NULL, 0), 1);
+	cr_assert_eq(rules_add("zombies: count where state == Z >= 10", NULL,
+			       0), 1);
+	cr_assert_eq(rules_count(), 3);
+
+	rule_status_t status;
+	cr_assert_eq(rules_status(1, &status), 0);
+	cr_assert_str_eq(status.name, "build");
+	cr_assert_eq(status.kind, RULE_SUM);
+	cr_assert_eq(status.hold, 60.0);
+	cr_assert_eq(rules_status(3, &status), -1);
+
+	cr_assert_eq(rules_add("no colon here", error, sizeof(error)), -1);
+	cr_assert_eq(rules_add("x: avg cpu > 1", error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "expected any, count, sum or max 'avg cpu > 1'");
+	cr_assert_eq(rules_add("x: sum name > 1", error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "expected numeric field 'name'");
+	cr_assert_eq(rules_add("x: any cpu > 1 for soon", error, sizeof(error)),
+		     -1);
+	cr_assert_eq(rules_add("x: max cpu where > 1", error, sizeof(error)),
+		     -1);
+	cr_assert_eq(rules_count(), 3, "Failed rules are not added");
+	rules_clear();
+}
+
+/**
+ * @brief Test: Rule and policy files share one loader, all or nothing
+ */
+Test(rules_suite, load_file) {
+	char path[64], error[128];
+	snprintf(path, sizeof(path), "/tmp/pb-rules-%d", getpid());
+
+	FILE *file = fopen(path, "w");
+	cr_assert_not_null(file);
+	fputs("# watch\n\nhot: any cpu > 90\nbig: any rss > 1G\n", file);
+	fclose(file);
+	rules_clear();
+	cr_assert_eq(rules_load(path, error, sizeof(error)), 2);
+	cr_assert_eq(rules_count(), 2);
+
+	file = fopen(path, "w");
+	cr_assert_not_null(file);
+	fputs("cap: kill rss > 4G\nbad name: renice 5 cpu > 1\n", file);
+	fclose(file);
+	policy_clear();
+	cr_assert_eq(policy_load(path, error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "line 2: expected 'name:' 'bad name: renice 5 "
+			 "cpu > 1'");
+	cr_assert_eq(policy_count(), 0, "Policies before the error dropped");
+
+	unlink(path);
+	cr_assert_eq(rules_load(path, error, sizeof(error)), -1);
+	cr_assert_eq(rules_count(), 2);
+	rules_clear();
+}
+
+/**
+ * @brief Test: Hold times per process and per aggregate, flagged rows
+ */
+Test(rules_suite, state_machines) {
+	static proc_list_t plist;
+	rule_status_t status;
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 4;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = 100 + i;
+		plist.list[i].start_time = 1;
+		plist.list[i].cpu_usage = 30;
+		strcpy(plist.list[i].user, i < 3 ? "build" : "root");
+	}
+	plist.list[1].memory = 9L * 1024 * 1024;
+
+	rules_clear();
+	cr_assert_eq(rules_add("bigrss: any rss > 8G for 30s", NULL, 0), 1);
+	cr_assert_eq(rules_add("build: sum cpu where user == build > 80 for 10",
+			       NULL, 0), 1);
+
+	arena_reset(frame_arena());
+	cr_assert_eq(rules_evaluate(&plist, 1000.0), 0);
+	rules_status(0, &status);
+	cr_assert_eq(status.state, RULE_PENDING);
+	cr_assert_eq(status.matches, 1);
+	rules_status(1, &status);
+	cr_assert_eq(status.state, RULE_PENDING);
+	cr_assert_eq(status.value, 90.0);
+
+	/* The aggregate holds for 10s, the process not yet for 30s */
+	cr_assert_eq(rules_evaluate(&plist, 1010.0), 1);
+	cr_assert(rules_alerted(100) && rules_alerted(102));
+	cr_assert_not(rules_alerted(103), "root is not a member");
+
+	/* A reused PID restarts the per-process hold time */
+	plist.list[1].start_time = 2;
+	rules_evaluate(&plist, 1020.0);
+	rules_evaluate(&plist, 1040.0);
+	rules_status(0, &status);
+	cr_assert_eq(status.state, RULE_PENDING);
+	cr_assert_eq(status.held, 20.0);
+	cr_assert_eq(rules_evaluate(&plist, 1050.0), 2);
+	rules_status(0, &status);
+	cr_assert_eq(status.state, RULE_FIRING);
+	cr_assert_eq(status.value, 1);
+
+	/* Conditions clear: back to OK, nothing flagged */
+	plist.list[1].memory = 0;
+	plist.list[0].cpu_usage = 0;
+	cr_assert_eq(rules_evaluate(&plist, 1060.0), 0);
+	rules_status(1, &status);
+	cr_assert_eq(status.state, RULE_OK);
+	cr_assert_not(rules_alerted(101));
+	rules_clear();
+}
+
+/**
+ * @brief Test: An "any" rule tracks every matching process of a full list
+ */
+Test(rules_suite, track_full_list) {
+	static proc_list_t plist;
+	rule_status_t status;
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = MAX_PROCESSES;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = 100 + i;
+		plist.list[i].start_time = 1;
+		plist.list[i].cpu_usage = 50;
+	}
+
+	rules_clear();
+	cr_assert_eq(rules_add("busy: any cpu > 10 for 5", NULL, 0), 1);
+	arena_reset(frame_arena());
+	rules_evaluate(&plist, 0);
+	rules_evaluate(&plist, 5);
+	rules_status(0, &status);
+	cr_assert_eq(status.value, MAX_PROCESSES);
+	cr_assert(rules_alerted(100 + MAX_PROCESSES - 1));
+	rules_clear();
+}
+
+/**
+ * @brief Test: A firing rule runs its hook once with the rule's environment
+ */
+Test(rules_suite, hook) {
+	static proc_list_t plist;
+	char path[64], command[160], line[128] = "";
+
+	snprintf(path, sizeof(path), "/tmp/pb-rule-%d", getpid());
+	snprintf(command, sizeof(command), "hot: count > 0 run "
+		 "echo \"$PB_RULE $PB_VALUE $PB_PIDS\" >> %s", path);
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 2;
+	plist.list[0].pid = 7;
+	plist.list[1].pid = 9;
+
+	rules_clear();
+	cr_assert_eq(rules_add(command, NULL, 0), 1);
+	setenv("PB_RULE", "stale", 1);
+	arena_reset(frame_arena());
+	rules_evaluate(&plist, 0);
+	rules_evaluate(&plist, 1);
+	for (int i = 0; i < 100 && !line[0]; i++) {
+		usleep(20000);
+		FILE *file = fopen(path, "r");
+		if (file) {
+			if (!fgets(line, sizeof(line), file)) {
+				line[0] = '\0';
+			}
+			fclose(file);
+		}
+	}
+	cr_assert_str_eq(line, "hot 2 7 9\n");
+	unsetenv("PB_RULE");
+	rules_evaluate(&plist, 2);
+	unlink(path);
+	rules_clear();
+}
+
+/* --- Policy Suite --- */
+
+/**
+ * @brief Read the start time of a live process (field 22 of stat).
+ */
+static unsigned long long stat_start_time(pid_t pid) {
+	char path[64], buffer[1024];
+	unsigned long long start = 0;
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	FILE *file = fopen(path, "r");
+	if (file) {
+		if (fgets(buffer, sizeof(buffer), file)) {
+			char *rpar = strrchr(buffer, ')');
+			sscanf(rpar + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u "
+			       "%*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start);
+		}
+		fclose(file);
+	}
+	return start;
+}
+
+/**
+ * @brief Test: Policy syntax, defaults and errors
+ */
+Test(policy_suite, parse) {
+	char error[128];
+	policy_status_t status;
+
+	policy_clear();
+	cr_assert_eq(policy_add("# comment", NULL, 0), 0);
+	cr_assert_eq(policy_add("rsscap: kill rss > 4G and user == batch for 3 "
+				"grace 10s limit 2/1m", NULL, 0), 1);
+	cr_assert_eq(policy_add("hogs: renice 10 cpu > 90 limit 1/30 for 5 "
+				"samples", NULL, 0), 1);
+	cr_assert_eq(policy_add("any: kill state == Z", NULL, 0), 1);
+	cr_assert_eq(policy_count(), 3);
+
+	cr_assert_eq(policy_status(0, &status), 0);
+	cr_assert_str_eq(status.name, "rsscap");
+	cr_assert_eq(status.action, POLICY_KILL);
+	cr_assert_eq(status.samples, 3);
+	cr_assert_eq(status.grace, 10.0);
+	cr_assert_eq(status.limit, 2);
+	cr_assert_eq(status.window, 60.0);
+	policy_status(1, &status);
+	cr_assert_eq(status.action, POLICY_RENICE);
+	cr_assert_eq(status.nice, 10);
+	cr_assert_eq(status.samples, 5);
+	cr_assert_eq(status.window, 30.0);
+	policy_status(2, &status);
+	cr_assert_eq(status.samples, 1);
+	cr_assert_eq(status.grace, POLICY_GRACE);
+	cr_assert_eq(status.limit, POLICY_LIMIT);
+
+	cr_assert_eq(policy_add("x: stop cpu > 1", error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "expected kill or renice 'stop cpu > 1'");
+	cr_assert_eq(policy_add("x: renice 40 cpu > 1", error, sizeof(error)),
+		     -1);
+	cr_assert_str_eq(error, "expected nice value '40'");
+	cr_assert_eq(policy_add("x: renice 5 cpu > 1 grace 3", error,
+				sizeof(error)), -1);
+	cr_assert_str_eq(error, "grace applies to kill only");
+	cr_assert_eq(policy_add("x: kill cpu > 1 for 2 for 3", error,
+				sizeof(error)), -1);
+	cr_assert_eq(policy_add("x: kill cpu > 1 limit 5", error,
+				sizeof(error)), -1);
+	cr_assert_eq(policy_add("x: kill cpu > 1 for 2s", error, sizeof(error)),
+		     -1);
+	cr_assert_eq(policy_count(), 3, "Failed policies are not added");
+	policy_clear();
+}
+
+/**
+ * @brief Test: SIGTERM after N samples, SIGKILL after the grace time, audited
+ */
+Test(policy_suite, kill_escalates) {
+	static proc_list_t plist;
+	char path[64], log[1024];
+	int ready[2];
+
+	/* The child ignores SIGTERM, so only the escalation stops it */
+	cr_assert_eq(pipe(ready), 0);
+	pid_t child = fork();
+	if (child == 0) {
+		signal(SIGTERM, SIG_IGN);
+		if (write(ready[1], "x", 1) != 1) {
+			_exit(1);
+		}
+		for (;;) {
+			pause();
+		}
+	}
+	char byte;
+	cr_assert_eq(read(ready[0], &byte, 1), 1);
+	close(ready[0]);
+	close(ready[1]);
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 1;
+	plist.list[0].pid = child;
+	plist.list[0].start_time = stat_start_time(child);
+	plist.list[0].memory = 5L * 1024 * 1024;
+	strcpy(plist.list[0].name, "hog");
+
+	snprintf(path, sizeof(path), "/tmp/pb-audit-%d", getpid());
+	unlink(path);
+	policy_clear();
+	policy_set_dry_run(0);
+	cr_assert_eq(policy_open_audit(path), 0);
+	cr_assert_eq(policy_add("cap: kill rss > 4G for 2 grace 5", NULL, 0), 1);
+
+	arena_reset(frame_arena());
+	cr_assert_eq(policy_evaluate(&plist, 100.0), 0, "One sample only");
+	cr_assert_eq(policy_evaluate(&plist, 101.0), 1, "SIGTERM");
+	cr_assert_eq(waitpid(child, NULL, WNOHANG), 0, "SIGTERM is ignored");
+
+	/* Still condemned when it stops matching; killed after the grace */
+	plist.list[0].memory = 0;
+	cr_assert_eq(policy_evaluate(&plist, 103.0), 0);
+	cr_assert_eq(policy_evaluate(&plist, 106.0), 1, "SIGKILL");
+	int status;
+	cr_assert_eq(waitpid(child, &status, 0), child);
+	cr_assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+	policy_set_audit(-1);
+	FILE *file = fopen(path, "r");
+	cr_assert_not_null(file);
+	size_t len = fread(log, 1, sizeof(log) - 1, file);
+	log[len] = '\0';
+	fclose(file);
+	unlink(path);
+	cr_assert_not_null(strstr(log, "policy=cap action=\"SIGTERM\""));
+	cr_assert_not_null(strstr(log, "action=\"SIGKILL\""));
+	cr_assert_not_null(strstr(log, "result=\"ok\" name=\"hog\"\n"));
+	policy_clear();
+}
+
+/**
+ * @brief Test: Dry-run decides and audits without acting, within the limit
+ */
+Test(policy_suite, dry_run_rate_limit) {
+	static proc_list_t plist;
+	policy_status_t status;
+	int pipefd[2];
+	char log[4096];
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 3;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = 4000000 + i;
+		plist.list[i].start_time = 1;
+		plist.list[i].cpu_usage = 95;
+	}
+
+	cr_assert_eq(pipe(pipefd), 0);
+	policy_clear();
+	policy_set_dry_run(1);
+	policy_set_audit(pipefd[1]);
+	cr_assert_eq(policy_add("hogs: renice 10 cpu > 90 limit 2/1m", NULL, 0),
+		     1);
+
+	arena_reset(frame_arena());
+	cr_assert_eq(policy_evaluate(&plist, 0.0), 2);
+	cr_assert_eq(policy_evaluate(&plist, 1.0), 0, "Limit reached");
+	policy_status(0, &status);
+	cr_assert_eq(status.actions, 2);
+	cr_assert_eq(status.suppressed, 2);
+
+	/* Next window: the third process, reniced once */
+	cr_assert_eq(policy_evaluate(&plist, 61.0), 1);
+	cr_assert_eq(policy_evaluate(&plist, 62.0), 0);
+
+	policy_set_audit(-1);
+	close(pipefd[1]);
+	ssize_t len = read(pipefd[0], log, sizeof(log) - 1);
+	close(pipefd[0]);
+	cr_assert_gt(len, 0);
+	log[len] = '\0';
+	int lines = 0, dry = 0;
+	for (char *p = log; (p = strchr(p, '\n')); p++) {
+		lines++;
+	}
+	for (char *p = log; (p = strstr(p, "result=\"dry-run\"")); p++) {
+		dry++;
+	}
+	cr_assert_eq(lines, 4, "Three actions and one rate-limited line");
+	cr_assert_eq(dry, 3);
+	cr_assert_not_null(strstr(log, "pid=4000002 user=\"\" rss_kb=0 cpu=95.0 "
+				  "result=\"rate-limited\""));
+	policy_set_dry_run(0);
+	policy_clear();
+}
+
+/**
+ * @brief Test: A hostile process name cannot end its audit line or forge fields
+ */
+Test(policy_suite, audit_escapes_fields) {
+	static proc_list_t plist;
+	int pipefd[2];
+	char log[1024];
+
+	memset(&plist, 0, sizeof(plist));
+	plist.count = 1;
+	plist.list[0].pid = 4000000;
+	plist.list[0].start_time = 1;
+	plist.list[0].cpu_usage = 95;
+	strcpy(plist.list[0].name, "x\" result=\"ok\"\n2024 policy=a\\");
+	strcpy(plist.list[0].user, "eve\" x=\"");
+
+	cr_assert_eq(pipe(pipefd), 0);
+	policy_clear();
+	policy_set_dry_run(1);
+	policy_set_audit(pipefd[1]);
+	cr_assert_eq(policy_add("hogs: renice 10 cpu > 90", NULL, 0), 1);
+	arena_reset(frame_arena());
+	cr_assert_eq(policy_evaluate(&plist, 0.0), 1);
+
+	policy_set_audit(-1);
+	close(pipefd[1]);
+	ssize_t len = read(pipefd[0], log, sizeof(log) - 1);
+	close(pipefd[0]);
+	cr_assert_gt(len, 0);
+	log[len] = '\0';
+	cr_assert_eq(strchr(log, '\n'), log + len - 1, "One line only");
+	cr_assert_not_null(strstr(log, "user=\"eve\\\" x=\\\"\" "));
+	cr_assert_not_null(strstr(log, "result=\"dry-run\" name=\"x\\\" "
+				  "result=\\\"ok\\\"\\n2024 policy=a\\\\\"\n"));
+	policy_set_dry_run(0);
+	policy_clear();
+}
+
+/* --- Query Suite --- */
+
+/**
+ * @brief Identical requests of one generation are served from the cache.
+ */
+Test(query_suite, execute_cached) {
+	static proc_list_t plist;
+	size_t length;
+
+	plist.count = 2;
+	plist.list[0].pid = 1;
+	strcpy(plist.list[0].name, "init");
+	plist.list[0].memory = 10;
+	plist.list[1].pid = 2;
+	strcpy(plist.list[1].name, "big\"one");
+	plist.list[1].memory = 20;
+
+	const char *first = query_execute("top 1 mem", &plist, 1, &length);
+	cr_assert_str_eq(first, "{\"generation\":1,\"processes\":[{\"pid\":2,"
+			 "\"name\":\"big\\\"one\",\"user\":\"\",\"mem\":20,"
+			 "\"cpu\":0.0,\"fds\":0,\"socks\":0,\"net\":0.0}]}\n");
+	cr_assert_eq(length, strlen(first));
+
+	/* Served from the cache, even though the data changed meanwhile */
+	plist.list[0].memory = 30;
+	cr_assert_eq(query_execute("top 1 mem", &plist, 1, &length), first);
+	cr_assert(strstr(first, "\"pid\":2,"));
+
+	/* A new generation re-evaluates */
+	const char *second = query_execute("top 1 mem", &plist, 2, &length);
+	cr_assert(strstr(second, "\"pid\":1,"));
+
+	cr_assert(strstr(query_execute("filter pid >", &plist, 2, &length),
+			 "\"error\""));
+	cr_assert(strstr(query_execute("nonsense", &plist, 2, &length),
+			 "unknown request"));
+	query_close();
+}
+
+/**
+ * @brief The default socket lives in a per-user or root-only directory.
+ */
+Test(query_suite, default_path) {
+	setenv("XDG_RUNTIME_DIR", "/run/user/1000", 1);
+	cr_assert_str_eq(query_default_path(), "/run/user/1000/pb.sock");
+
+	setenv("XDG_RUNTIME_DIR", "relative", 1);
+	cr_assert_str_eq(query_default_path(), "/run/pb/pb.sock");
+
+	unsetenv("XDG_RUNTIME_DIR");
+	cr_assert_str_eq(query_default_path(), "/run/pb/pb.sock");
+}
+
+/**
+ * @brief A client gets its answer through the socket and epoll loop.
+ */
+Test(query_suite, socket_roundtrip) {
+	static proc_list_t plist;
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/pb-test-%d.sock", getpid());
+
+	plist.count = 1;
+	plist.list[0].pid = 7;
+	strcpy(plist.list[0].name, "seven");
+
+	cr_assert_eq(query_open(path), 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	cr_assert_eq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	cr_assert_eq(send(fd, "filter pid == 7\n", 16, 0), 16);
+
+	char buffer[512];
+	ssize_t n = 0;
+	for (int i = 0; i < 10 && n <= 0; i++) {
+		query_poll(&plist, 5, 50);
+		n = recv(fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
+	}
+	cr_assert_gt(n, 0);
+	buffer[n] = '\0';
+	cr_assert(strstr(buffer, "\"name\":\"seven\""));
+
+	close(fd);
+	query_close();
+	cr_assert_neq(access(path, F_OK), 0);
+}
+
+/**
+ * @brief A client that pipelines large requests is answered one response
+ *        at a time, in order, as it reads.
+ */
+Test(query_suite, pipelined_backpressure) {
+	static proc_list_t plist;
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/pb-test-pipe-%d.sock", getpid());
+
+	plist.count = MAX_PROCESSES;
+	for (int i = 0; i < MAX_PROCESSES; i++) {
+		plist.list[i].pid = i + 1;
+		snprintf(plist.list[i].name, sizeof(plist.list[i].name),
+			 "process-with-a-rather-long-name-%d", i);
+	}
+	cr_assert_eq(query_open(path), 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	cr_assert_eq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+
+	/* Twenty responses of ~200 kB each, nothing read yet */
+	enum { REQUESTS = 20 };
+	for (int i = 0; i < REQUESTS; i++) {
+		cr_assert_eq(send(fd, "top 2048 name\n", 14, 0), 14);
+	}
+	for (int i = 0; i < 20; i++) {
+		query_poll(&plist, 1, 5);
+	}
+
+	static char buffer[65536];
+	int lines = 0;
+	for (int i = 0; i < 20000 && lines < REQUESTS; i++) {
+		query_poll(&plist, 1, 0);
+		ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+		for (ssize_t j = 0; j < n; j++) {
+			lines += buffer[j] == '\n';
+		}
+	}
+	cr_assert_eq(lines, REQUESTS);
+
+	close(fd);
+	query_close();
+}
+
+/* --- Exporter Suite --- */
+
+/**
+ * @brief Count lines of a payload starting with a prefix.
+ */
+static int count_lines(const char *text, const char *prefix) {
+	int count = 0;
+	size_t len = strlen(prefix);
+	for (const char *line = text; line && *line;) {
+		if (strncmp(line, prefix, len) == 0) {
+			count++;
+		}
+		line = strchr(line, '\n');
+		line = line ? line + 1 : NULL;
+	}
+	return count;
+}
+
+/**
+ * @brief Series stay bounded no matter how many processes and users exist.
+ */
+Test(exporter_suite, bounded_cardinality) {
+	static proc_list_t plist;
+	size_t length;
+
+	plist.count = 1000;
+	plist.total = 30000;
+	plist.states[proc_state_index('D')] = 7;
+	for (int i = 0; i < plist.count; i++) {
+		plist.list[i].pid = i + 1;
+		snprintf(plist.list[i].name, sizeof(plist.list[i].name), "p%d", i);
+		snprintf(plist.list[i].user, sizeof(plist.list[i].user), "u%d", i);
+		snprintf(plist.list[i].cgroup, sizeof(plist.list[i].cgroup),
+			 "/g%d", i % 3);
+		plist.list[i].cpu_usage = (float)i / 10;
+		plist.list[i].memory = 1000 - i;
+		plist.list[i].fd_count = -1;
+	}
+	strcpy(plist.list[0].name, "we\"ird");
+
+	const char *text = exporter_render(&plist, 1, &length);
+	cr_assert_eq(strlen(text), length);
+	cr_assert(strstr(text, "pb_processes 30000\n"));
+	cr_assert(strstr(text, "pb_unlisted_processes 29000\n"));
+	cr_assert(strstr(text, "pb_processes_state{state=\"D\"} 7\n"));
+	cr_assert_eq(count_lines(text, "pb_process_cpu_percent{"),
+		     2 * EXPORTER_TOP_PROCESSES);
+	cr_assert_eq(count_lines(text, "pb_process_open_fds{"), 0);
+	cr_assert(strstr(text, "name=\"we\\\"ird\""));
+	cr_assert(strstr(text, "pb_other_processes 900\n"));
+	cr_assert_eq(count_lines(text, "pb_user_processes{"),
+		     EXPORTER_TOP_GROUPS + 1);
+	cr_assert(strstr(text, "pb_user_processes{user=\"__other__\"} 950\n"));
+	cr_assert(strstr(text, "pb_cgroup_processes{cgroup=\"/g1\"} 333\n"));
+	cr_assert(strstr(text, "# TYPE pb_self_resident_bytes gauge\n"));
+	cr_assert(strstr(text, "pb_self_interval_seconds "));
+
+	/* Same generation: not re-encoded */
+	plist.total = 5;
+	cr_assert(strstr(exporter_render(&plist, 1, &length), "pb_processes 30000"));
+	cr_assert(strstr(exporter_render(&plist, 2, &length), "pb_processes 5\n"));
+	exporter_close();
+}
+
+/**
+ * @brief GET /metrics over HTTP on localhost.
+ */
+Test(exporter_suite, http_scrape) {
+	static proc_list_t plist;
+	plist.count = 1;
+	plist.total = 1;
+	plist.list[0].pid = 3;
+	strcpy(plist.list[0].name, "three");
+
+	cr_assert_eq(exporter_open(0), 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(exporter_port());
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	cr_assert_eq(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	const char *request = "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n";
+	cr_assert_eq(send(fd, request, strlen(request), 0), (ssize_t)strlen(request));
+
+	static char buffer[65536];
+	size_t total = 0;
+	for (int i = 0; i < 20; i++) {
+		exporter_poll(&plist, 1, 20);
+		ssize_t n = recv(fd, buffer + total, sizeof(buffer) - 1 - total,
+				 MSG_DONTWAIT);
+		if (n == 0) {
+			break;
+		}
+		if (n > 0) {
+			total += n;
+		}
+	}
+	buffer[total] = '\0';
+	cr_assert(strncmp(buffer, "HTTP/1.1 200 OK", 15) == 0);
+	cr_assert(strstr(buffer, "name=\"three\""));
+	cr_assert(strstr(buffer, "# EOF\n"));
+
+	close(fd);
+	exporter_close();
+}
+
+/* --- Recording Suite --- */
+
+/**
+ * @brief Frames are written per interval and found again by time.
+ */
+Test(recording_suite, roundtrip) {
+	static proc_list_t plist;
+	char path[64], when[32], error[128];
+	char root[] = "/tmp/pb-root-XXXXXX";
+	snprintf(path, sizeof(path), "/tmp/pb-record-%d", getpid());
+	unlink(path);
+
+	/* I/O counters for PID 20 only; PID 10 has none to read */
+	cr_assert_not_null(mkdtemp(root));
+	snprintf(when, sizeof(when), "%s/20", root);
+	cr_assert_eq(mkdir(when, 0755), 0);
+	write_fake(root, "20/io", "rchar: 9\nwchar: 9\nsyscr: 1\nsyscw: 1\n"
+		   "read_bytes: 4096\nwrite_bytes: 8192\n"
+		   "cancelled_write_bytes: 512\n");
+	cr_assert_eq(proc_set_root(root), 0);
+
+	plist.count = 2;
+	plist.total = 2;
+	plist.list[0].pid = 10;
+	plist.list[0].start_time = 5;
+	strcpy(plist.list[0].name, "ten");
+	plist.list[1].pid = 20;
+	plist.list[1].start_time = 7;
+	plist.list[1].net_rate = 100;
+	strcpy(plist.list[1].name, "twenty");
+
+	/* First refresh writes, then one frame per 10 s; traffic integrates */
+	int64_t t0 = 1760000000000LL;
+	cr_assert_eq(recording_open(path, 10), 0);
+	cr_assert_eq(recording_update(&plist, t0), 1);
+	plist.list[1].cpu_ticks = 50;
+	cr_assert_eq(recording_update(&plist, t0 + 5000), 0);
+	plist.list[0].memory = 4096;
+	cr_assert_eq(recording_update(&plist, t0 + 10000), 1);
+	plist.count = 1;
+	cr_assert_eq(recording_update(&plist, t0 + 12000), 0);
+	recording_close();
+
+	recording_frame_t frame;
+	cr_assert_eq(recording_read(path, NULL, &frame, error, sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0 + 12000);
+	cr_assert_eq(frame.count, 1);
+	recording_frame_free(&frame);
+
+	cr_assert_eq(recording_read(path, "-2s", &frame, error, sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0 + 10000);
+	cr_assert_eq(frame.count, 2);
+	cr_assert_eq(frame.records[0].memory, 4096);
+	cr_assert_eq(frame.records[1].cpu_ticks, 50);
+	cr_assert_float_eq(frame.records[1].net_kb, 1000, 1e-6);
+	cr_assert_eq(frame.records[0].read_bytes, -1);
+	cr_assert_eq(frame.records[1].read_bytes, 4096);
+	cr_assert_eq(frame.records[1].write_bytes, 8192);
+	cr_assert_str_eq(frame.records[1].name, "twenty");
+	recording_frame_free(&frame);
+
+	snprintf(when, sizeof(when), "%lld", (long long)(t0 / 1000 + 9));
+	cr_assert_eq(recording_read(path, when, &frame, error, sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0);
+	recording_frame_free(&frame);
+	cr_assert_eq(recording_read(path, "2025-10-09T08:53:20Z", &frame, error,
+				    sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0);
+	recording_frame_free(&frame);
+
+	cr_assert_eq(recording_read(path, "2020-01-01T00:00", &frame, error,
+				    sizeof(error)), -1);
+	cr_assert(strstr(error, "no frame at or before"));
+	cr_assert_eq(recording_read(path, "yesterday", &frame, error,
+				    sizeof(error)), -1);
+	cr_assert_str_eq(error, "bad time 'yesterday'");
+
+	/* A torn frame is ignored, then cut off before appending */
+	FILE *file = fopen(path, "a");
+	fwrite("PBFR torn", 1, 9, file);
+	fclose(file);
+	cr_assert_eq(recording_read(path, NULL, &frame, error, sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0 + 12000);
+	recording_frame_free(&frame);
+	cr_assert_eq(recording_open(path, 10), 0);
+	cr_assert_eq(recording_update(&plist, t0 + 60000), 1);
+	recording_close();
+	cr_assert_eq(recording_read(path, NULL, &frame, error, sizeof(error)), 0);
+	cr_assert_eq(frame.timestamp_ms, t0 + 60000);
+	recording_frame_free(&frame);
+
+	/* Anything else is refused */
+	file = fopen(path, "w");
+	fputs("not a recording\n", file);
+	fclose(file);
+	cr_assert_eq(recording_open(path, 10), -1);
+	cr_assert_eq(recording_read(path, NULL, &frame, error, sizeof(error)), -1);
+	cr_assert_str_eq(error, "not a pb recording");
+	unlink(path);
+
+	cr_assert_eq(proc_set_root("/proc"), 0);
+	snprintf(path, sizeof(path), "rm -rf %s", root);
+	cr_assert_eq(system(path), 0);
+}
+
+/* --- Diff Suite --- */
+
+/**
+ * @brief Fill a record of a synthetic frame.
+ */
+static void make_record(recording_record_t *record, int pid,
+			unsigned long long start_time, unsigned long long ticks,
+			long memory, double net_kb, const char *name) {
+	memset(record, 0, sizeof(*record));
+	record->pid = pid;
+	record->start_time = start_time;
+	record->cpu_ticks = ticks;
+	record->memory = memory;
+	record->net_kb = net_kb;
+	snprintf(record->name, sizeof(record->name), "%s", name);
+	strcpy(record->user, "root");
+}
+
+/**
+ * @brief Appeared, disappeared, reused PIDs and the biggest deltas.
+ */
+Test(diff_suite, merge_join) {
+	long hz = sysconf(_SC_CLK_TCK);
+	recording_record_t old_records[4], new_records[4];
+	make_record(&old_records[0], 1, 1, 100, 1000, 0, "init");
+	make_record(&old_records[1], 5, 10, 0, 5000, 100, "gone");
+	make_record(&old_records[2], 7, 20, 0, 9000, 0, "old7");
+	make_record(&old_records[3], 9, 30, 10, 100, 50, "grows");
+	make_record(&new_records[0], 1, 1, 100 + 60 * hz, 1000, 0, "init");
+	make_record(&new_records[1], 7, 99, 2 * hz, 300, 0, "new7");
+	make_record(&new_records[2], 9, 30, 10, 8292, 2050, "grows");
+	make_record(&new_records[3], 12, 98, 0, 10, 0, "fresh");
+	old_records[3].read_bytes = 1 << 20;
+	new_records[2].read_bytes = 3 << 20;
+	new_records[2].write_bytes = 1 << 20;
+	/* Unreadable counters are left out, not counted from zero */
+	old_records[0].read_bytes = -1;
+	new_records[0].read_bytes = 5 << 20;
+	recording_frame_t before = { 1000000, 4, 4, old_records };
+	recording_frame_t after = { 1060000, 4, 4, new_records };
+
+	/* Order of the arguments does not matter */
+	diff_result_t result;
+	cr_assert_eq(diff_frames(&after, &before, &result), 0);
+	cr_assert_eq(result.from_ms, 1000000);
+	cr_assert_eq(result.counts[DIFF_APPEARED], 2);
+	cr_assert_eq(result.entries[DIFF_APPEARED][0].after->pid, 7);
+	cr_assert_eq(result.entries[DIFF_APPEARED][1].after->pid, 12);
+	cr_assert_eq(result.counts[DIFF_DISAPPEARED], 2);
+	cr_assert_str_eq(result.entries[DIFF_DISAPPEARED][0].before->name, "gone");
+	cr_assert_str_eq(result.entries[DIFF_DISAPPEARED][1].before->name, "old7");
+
+	cr_assert_eq(result.counts[DIFF_CPU], 2);
+	cr_assert_str_eq(result.entries[DIFF_CPU][0].after->name, "init");
+	cr_assert_float_eq(result.entries[DIFF_CPU][0].cpu_seconds, 60, 1e-9);
+	cr_assert_float_eq(result.entries[DIFF_CPU][1].cpu_seconds, 2, 1e-9);
+	cr_assert_eq(result.entries[DIFF_RSS][0].rss_kb, 8192);
+	cr_assert_eq(result.counts[DIFF_IO], 1);
+	cr_assert_float_eq(result.entries[DIFF_IO][0].io_kb, 3072, 1e-9);
+	cr_assert_eq(result.counts[DIFF_NET], 1);
+	cr_assert_float_eq(result.entries[DIFF_NET][0].net_kb, 2000, 1e-9);
+
+	char *text = NULL;
+	size_t size = 0;
+	FILE *out = open_memstream(&text, &size);
+	diff_print(&result, out);
+	fclose(out);
+	cr_assert(strncmp(text, "# from 1970-01-01T00:16:40Z to "
+			  "1970-01-01T00:17:40Z seconds 60 processes 4 4 "
+			  "appeared 2 disappeared 2\n", 88) == 0);
+	cr_assert(strstr(text, "\nappeared 12 root 10 0.00 fresh\n"));
+	cr_assert(strstr(text, "\ncpu 1 root 60.00 100.0 init\n"));
+	cr_assert(strstr(text, "\nrss 9 root +8192 8292 grows\n"));
+	cr_assert(strstr(text, "\nio 9 root 3072.0 51.2 grows\n"));
+	cr_assert(strstr(text, "\nnet 9 root 2000.0 33.3 grows\n"));
+	free(text);
+	diff_free(&result);
+}
+
+/**
+ * @brief Large frames: one linear pass, bounded top lists.
+ */
+Test(diff_suite, large_frames) {
+	enum { COUNT = 100000 };
+	recording_record_t *old_records = calloc(COUNT, sizeof(*old_records));
+	recording_record_t *new_records = calloc(COUNT, sizeof(*new_records));
+	for (int i = 0; i < COUNT; i++) {
+		/* Every tenth process is replaced by one with the next PID */
+		int replaced = i % 10 == 0;
+		make_record(&old_records[i], 2 * i + 1, i, i, 1000, 0, "worker");
+		make_record(&new_records[i], 2 * i + 1 + replaced, i,
+			    i + i % 7, 1000 + i % 13, i % 5, "worker");
+		new_records[i].write_bytes = (i % 11) * 1024;
+	}
+	recording_frame_t before = { 0, COUNT, COUNT, old_records };
+	recording_frame_t after = { 60000, COUNT, COUNT, new_records };
+
+	diff_result_t result;
+	cr_assert_eq(diff_frames(&before, &after, &result), 0);
+	cr_assert_eq(result.counts[DIFF_APPEARED], COUNT / 10);
+	cr_assert_eq(result.counts[DIFF_DISAPPEARED], COUNT / 10);
+	for (int section = DIFF_CPU; section < DIFF_SECTIONS; section++) {
+		cr_assert_eq(result.counts[section], DIFF_TOP);
+	}
+	/* Appeared processes count from zero, so they rank first */
+	cr_assert_eq(result.entries[DIFF_CPU][0].after->pid, 2 * (COUNT - 10) + 2);
+	cr_assert_eq(result.entries[DIFF_RSS][0].rss_kb, 1012);
+	diff_free(&result);
+	free(old_records);
+	free(new_records);
+}